@@ -151,7 +151,7 @@ extern uint32_t SystemCoreClock;
   * configTASK_NOTIFICATION_ARRAY_ENTRIES sets the number of indexes in the
   * array. See https://www.freertos.org/RTOS-task-notifications.html  Defaults to
   * 1 if left undefined. */
-#define configTASK_NOTIFICATION_ARRAY_ENTRIES 1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 3
 
 /* configQUEUE_REGISTRY_SIZE sets the maximum number of queues and semaphores
   * that can be referenced from the queue registry.  Only required when using a
@@ -265,7 +265,7 @@ extern uint32_t SystemCoreClock;
   * FreeRTOS/source/stream_buffer.c source file must be included in the build if
   * configUSE_STREAM_BUFFERS is set to 1. Defaults to 1 if left undefined. */
 
-#define configUSE_STREAM_BUFFERS 0
+#define configUSE_STREAM_BUFFERS 1
 
 /******************************************************************************/
 /* Memory allocation related definitions. *************************************/
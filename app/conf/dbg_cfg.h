@@ -49,6 +49,32 @@
 
 //------------------------------------------------------------------------------
 
+/**
+ * Log modules: ID, name for the shell "log -m", build level.
+ * Prints below the build level are removed at compile time, the rest are
+ * filtered by the module level set from the shell (global level by default).
+ * A .c file selects its module with "#define DEBUG_MODULE DBG_MOD_xxx"
+ * before the includes, DBG_MOD_MAIN is used otherwise
+ */
+#if DEBUG_ENABLE
+#define DEBUG_MOD_BUILD_LVL_DEF LOG_LVL_TRACE
+#else /* DEBUG_ENABLE */
+#define DEBUG_MOD_BUILD_LVL_DEF LOG_LVL_INFO
+#endif /* DEBUG_ENABLE */
+
+/* clang-format off */
+#define DEBUG_MODULE_TABLE() \
+X_ENTRY(DBG_MOD_MAIN,		"main",		DEBUG_MOD_BUILD_LVL_DEF) \
+X_ENTRY(DBG_MOD_RTOS,		"rtos",		DEBUG_MOD_BUILD_LVL_DEF) \
+X_ENTRY(DBG_MOD_MEM,		"mem",		DEBUG_MOD_BUILD_LVL_DEF) \
+X_ENTRY(DBG_MOD_COLL,		"coll",		DEBUG_MOD_BUILD_LVL_DEF) \
+X_ENTRY(DBG_MOD_STORAGE,	"storage",	DEBUG_MOD_BUILD_LVL_DEF) \
+X_ENTRY(DBG_MOD_FS,			"fs",		DEBUG_MOD_BUILD_LVL_DEF) \
+X_ENTRY(DBG_MOD_IO,			"io",		DEBUG_MOD_BUILD_LVL_DEF) \
+/* clang-format on */
+
+//------------------------------------------------------------------------------
+
 extern void ErrorHandler(char* pFile, int line);
 
 //------------------------------------------------------------------------------
@@ -1,3 +1,5 @@
+#define DEBUG_MODULE DBG_MOD_RTOS
+
 #include "health_check.h"
 #include "debug.h"
 #include "health_check_cfg.h"
@@ -5,16 +7,7 @@
 
 #if HEALTH_CHECK
 
-#if DEBUG_ENABLE
-#define LOCAL_DEBUG_PRINT_ENABLE 0
-#endif /* DEBUG_ENABLE */
-
-#if LOCAL_DEBUG_PRINT_ENABLE
-#warning LOCAL_DEBUG_PRINT_ENABLE
-#define LOCAL_DEBUG_PRINT DEBUG_LOG_PRINT
-#else /* DEBUG_ENABLE */
-#define LOCAL_DEBUG_PRINT(_f_, ...)
-#endif /* DEBUG_ENABLE */
+#define LOCAL_DEBUG_PRINT(_f_, ...) DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
 
 static TaskHandle_t HealthCheck_Handle;
 
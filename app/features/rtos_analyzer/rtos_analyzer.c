@@ -1,17 +1,10 @@
+#define DEBUG_MODULE DBG_MOD_RTOS
+
 #include "rtos_analyzer.h"
 #include "debug.h"
 #include "rtos_analyzer_cfg.h"
 
-#if DEBUG_ENABLE
-#define LOCAL_DEBUG_PRINT_ENABLE 0
-#endif /* DEBUG_ENABLE */
-
-#if LOCAL_DEBUG_PRINT_ENABLE
-#warning LOCAL_DEBUG_PRINT_ENABLE
-#define LOCAL_DEBUG_PRINT DEBUG_LOG_PRINT
-#else /* DEBUG_ENABLE */
-#define LOCAL_DEBUG_PRINT(_f_, ...)
-#endif /* DEBUG_ENABLE */
+#define LOCAL_DEBUG_PRINT(_f_, ...) DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
 
 #if RTOS_ANALYZER
 
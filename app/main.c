@@ -35,6 +35,7 @@ void FreeRTOS_InitComponents(bool resources, bool tasks) {
 	FreeRTOS_DebugSend_InitComponents(resources, tasks);
 	FreeRTOS_ShellRoot_InitComponents(resources, tasks);
 	FreeRTOS_HealthCheck_InitComponents(resources, tasks);
+	FreeRTOS_Storage_InitComponents(resources, tasks);
 }
 
 int main(void) {
@@ -1,5 +1,6 @@
 #include "debug.h"
 #include "platform.h"
+#include "storage.h"
 #include "stringlib.h"
 #include "wsh_shell.h"
 
@@ -7,7 +8,10 @@
 #define CMD_DEBUG_LOG_OPT_TABLE() \
 X_CMD_ENTRY(CMD_DEBUG_LOG_OPT_HELP, WSH_SHELL_OPT_HELP()) \
 X_CMD_ENTRY(CMD_DEBUG_LOG_OPT_DEF, WSH_SHELL_OPT_NO(WSH_SHELL_OPT_ACCESS_ANY)) \
+X_CMD_ENTRY(CMD_DEBUG_LOG_OPT_MOD, WSH_SHELL_OPT_STR(WSH_SHELL_OPT_ACCESS_WRITE, "-m", "--module", "Select module for the next -l/-r")) \
 X_CMD_ENTRY(CMD_DEBUG_LOG_OPT_SET, WSH_SHELL_OPT_STR(WSH_SHELL_OPT_ACCESS_WRITE, "-l", "--lvl", "Set log level")) \
+X_CMD_ENTRY(CMD_DEBUG_LOG_OPT_RESET, WSH_SHELL_OPT_WO_PARAM(WSH_SHELL_OPT_ACCESS_WRITE, "-r", "--reset", "Module(s) back to global lvl")) \
+X_CMD_ENTRY(CMD_DEBUG_LOG_OPT_SHOW, WSH_SHELL_OPT_WO_PARAM(WSH_SHELL_OPT_ACCESS_ANY, "-s", "--show", "Show module levels")) \
 X_CMD_ENTRY(CMD_DEBUG_LOG_OPT_QUIT, WSH_SHELL_OPT_WO_PARAM(WSH_SHELL_OPT_ACCESS_ANY, "-q", "--quit", "Deactivate log mode")) \
 X_CMD_ENTRY(CMD_DEBUG_LOG_OPT_END, WSH_SHELL_OPT_END())
 /* clang-format on */
@@ -20,12 +24,28 @@ typedef enum { CMD_DEBUG_LOG_OPT_TABLE() CMD_DEBUG_LOG_OPT_ENUM_SIZE } CMD_DEBUG
 WshShellOption_t DebugOptArr[] = {CMD_DEBUG_LOG_OPT_TABLE()};
 #undef X_CMD_ENTRY
 
+#define CMD_DEBUG_LOG_MOD_NAME_LEN 16
+
+static void shell_cmd_debug_log_show(void) {
+	WSH_SHELL_PRINT("Global lvl: %s\r\n", Debug_LogLvl_GetStr(Debug_LogLvl_Get()));
+	WSH_SHELL_PRINT("%-10s %-8s %-8s %-8s\r\n", "Module", "Build", "Set", "Active");
+
+	for (u32 mod = 0; mod < DBG_MOD_ENUM_SIZE; mod++) {
+		u8 lvl = Debug_ModLvl_Get(mod);
+		WSH_SHELL_PRINT("%-10s %-8s %-8s %-8s\r\n", Debug_Mod_GetStr(mod),
+						Debug_LogLvl_GetStr(Debug_Mod_GetBuildLvl(mod)),
+						lvl == DEBUG_MOD_LVL_INHERIT ? "global" : Debug_LogLvl_GetStr(lvl),
+						Debug_LogLvl_GetStr(Debug_ModLvl_GetActive(mod)));
+	}
+}
+
 static WSH_SHELL_RET_STATE_t shell_cmd_debug_log(const WshShellCmd_t* pcCmd, WshShell_Size_t argc,
 												 const char* pArgv[], void* pCtx) {
 	if ((argc > 0 && pArgv == NULL) || pcCmd == NULL)
 		return WSH_SHELL_RET_STATE_ERROR;
 
 	LOG_LVL_t reqLvl = LOG_LVL_DISABLE;
+	DBG_MOD_t mod	 = DBG_MOD_ENUM_SIZE; // none selected, -l and -r act globally
 
 	WshShell_Size_t tokenPos = 0;
 	while (tokenPos < argc) {
@@ -39,6 +59,19 @@ static WSH_SHELL_RET_STATE_t shell_cmd_debug_log(const WshShellCmd_t* pcCmd, Wsh
 				WshShellCmd_PrintOptionsOverview(pcCmd);
 				return WSH_SHELL_RET_STATE_SUCCESS;
 
+			case CMD_DEBUG_LOG_OPT_MOD: {
+				char modStr[CMD_DEBUG_LOG_MOD_NAME_LEN] = "";
+				WshShellCmd_GetOptValue(&optCtx, argc, pArgv, sizeof(modStr) - 1,
+										(WshShell_Size_t*)modStr);
+
+				mod = Debug_Mod_GetByStr(modStr);
+				if (mod == DBG_MOD_ENUM_SIZE) {
+					WSH_SHELL_PRINT_WARN("Unknown module '%s', see -s\r\n", modStr);
+					return WSH_SHELL_RET_STATE_ERROR;
+				}
+				break;
+			}
+
 			case CMD_DEBUG_LOG_OPT_SET: {
 				char lvlStr = '\0';
 				WshShellCmd_GetOptValue(&optCtx, argc, pArgv, sizeof(lvlStr),
@@ -74,8 +107,13 @@ static WSH_SHELL_RET_STATE_t shell_cmd_debug_log(const WshShellCmd_t* pcCmd, Wsh
 						return WSH_SHELL_RET_STATE_ERROR;
 				}
 
-				LOG_LVL_t currLvl = Debug_LogLvl_Get();
-				if (currLvl == reqLvl) {
+				if (mod != DBG_MOD_ENUM_SIZE) {
+					Debug_ModLvl_Set(mod, reqLvl);
+					WSH_SHELL_PRINT_INFO("Module %s lvl: ", Debug_Mod_GetStr(mod));
+					if (reqLvl < Debug_Mod_GetBuildLvl(mod))
+						WSH_SHELL_PRINT_WARN("below build lvl %s, ",
+											 Debug_LogLvl_GetStr(Debug_Mod_GetBuildLvl(mod)));
+				} else if (Debug_LogLvl_Get() == reqLvl) {
 					WSH_SHELL_PRINT_INFO("The same lvl selected: ");
 				} else {
 					Debug_LogLvl_Set(reqLvl);
@@ -87,6 +125,21 @@ static WSH_SHELL_RET_STATE_t shell_cmd_debug_log(const WshShellCmd_t* pcCmd, Wsh
 				break;
 			}
 
+			case CMD_DEBUG_LOG_OPT_RESET:
+				if (mod != DBG_MOD_ENUM_SIZE) {
+					Debug_ModLvl_Set(mod, DEBUG_MOD_LVL_INHERIT);
+					WSH_SHELL_PRINT_INFO("Module %s follows global lvl\r\n", Debug_Mod_GetStr(mod));
+				} else {
+					for (u32 i = 0; i < DBG_MOD_ENUM_SIZE; i++)
+						Debug_ModLvl_Set(i, DEBUG_MOD_LVL_INHERIT);
+					WSH_SHELL_PRINT_INFO("All modules follow global lvl\r\n");
+				}
+				break;
+
+			case CMD_DEBUG_LOG_OPT_SHOW:
+				shell_cmd_debug_log_show();
+				break;
+
 			case CMD_DEBUG_LOG_OPT_QUIT:
 				Debug_LogLvl_Set(LOG_LVL_DISABLE);
 				WSH_SHELL_PRINT_INFO("Debug mode deactivated\r\n");
@@ -142,6 +195,7 @@ static WSH_SHELL_RET_STATE_t shell_cmd_reset(const WshShellCmd_t* pcCmd, WshShel
 				break;
 
 			case CMD_RESET_OPT_DEF:
+				Storage_Shutdown();
 				Pl_SoftReset();
 				break;
 
@@ -128,10 +128,12 @@ static void vTask_Shell_Process(void* pvParameters) {
 #endif /* DEBUG_ENABLE */
 
 	for (;;) {
-		char symbol = 0;
-		symbol		= Debug_ReceiveSymbol(DELAY_1_SECOND);
-		if (symbol)
-			WshShell_InsertChar(&ShellRoot, symbol);
+		char rxBuff[32];
+		u32 len = Debug_ReceiveBuff(rxBuff, sizeof(rxBuff), DELAY_1_SECOND);
+		for (u32 i = 0; i < len; i++) {
+			if (rxBuff[i])
+				WshShell_InsertChar(&ShellRoot, rxBuff[i]);
+		}
 
 		vTaskDelay(RTOS_MIN_TIMEOUT_MS);
 	}
@@ -1,122 +1,140 @@
+#define DEBUG_MODULE DBG_MOD_FS
+
 #include "file_system.h"
 #include "debug.h"
+#include "fs_walk.h"
 #include "fs_wrapper.h"
+#include "io_msc.h"
 #include "mem_wrapper.h"
 #include "storage.h"
+#include "storage_cache.h"
+#include "storage_cfg.h"
+#include "storage_pipe.h"
+#include "storage_ram.h"
 #include "storage_utils.h"
 #include "stringlib.h"
 #include "time_date.h"
 #include "wsh_shell.h"
 
 #if DEBUG_ENABLE
-#define LOCAL_DEBUG_PRINT_ENABLE 0
-#define LOCAL_DEBUG_TEST_ENABLE	 0
+#define LOCAL_DEBUG_TEST_ENABLE 0
 #endif /* DEBUG_ENABLE */
 
-#if LOCAL_DEBUG_PRINT_ENABLE
-#warning LOCAL_DEBUG_PRINT_ENABLE
-#define LOCAL_DEBUG_PRINT	  DEBUG_PRINT_NL
-#define LOCAL_DEBUG_LOG_PRINT DEBUG_LOG_PRINT
-#else /* LOCAL_DEBUG_PRINT_ENABLE */
-#define LOCAL_DEBUG_PRINT(_f_, ...)
-#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)
-#endif /* LOCAL_DEBUG_PRINT_ENABLE */
+#define LOCAL_DEBUG_PRINT(_f_, ...)		DEBUG_TRACE_DO(DEBUG_PRINT_NL(_f_, ##__VA_ARGS__))
+#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)	DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
+
+#define FS_SHELL_BUFF_SIZE		  1280
+#define FS_SHELL_PRETTY_BUFF_SIZE (FS_SHELL_BUFF_SIZE * 2) // indents and line ends
+#define FS_SHELL_MINUTES_TTL_DEF  3
+#define FS_SHELL_MINUTES_TTL_MAX  5
 
-#define FS_SHELL_BUFF_SIZE		 512
-#define FS_SHELL_MINUTES_TTL_DEF 3
-#define FS_SHELL_MINUTES_TTL_MAX 5
+static const char* FileSystem_EmmcTimingStr[] = {
+	[PL_SD_EMMC_TIMING_LEGACY] = "legacy",
+	[PL_SD_EMMC_TIMING_HS]	   = "HS52",
+	[PL_SD_EMMC_TIMING_DDR52]  = "DDR52",
+};
 
 static STORAGE_DRIVE_t Storage_CurrDrive = STORAGE_DRIVE_EMMC;
 static char Storage_CurrDrivePath[4];
 
-static RET_STATE_t FileSystem_ScanFiles(const char* pPath, const char* pPrefix) {
-	RET_STATE_t res = RET_STATE_SUCCESS;
-
-	char* pCurrPath =
-		(char*)MemWrap_Malloc(FS_MAX_FILE_NAME + 1, __FILENAME__, __LINE__, DELAY_1_SECOND * 5);
-	char* pNewPefix =
-		MemWrap_Malloc(FS_MAX_FILE_NAME + 1, __FILENAME__, __LINE__, DELAY_1_SECOND * 5);
-	FsWrap_Dir_t* pDir =
-		MemWrap_Malloc(sizeof(FsWrap_Dir_t), __FILENAME__, __LINE__, DELAY_1_SECOND * 5);
-	FsWrap_DirEnt_t* pFno =
-		MemWrap_Malloc(sizeof(FsWrap_DirEnt_t), __FILENAME__, __LINE__, DELAY_1_SECOND * 5);
-	if (!pCurrPath || !pNewPefix || !pDir || !pFno) {
-		WSH_SHELL_PRINT("Memory allocation failed for path!\r\n");
-		return RET_STATE_ERR_MEMORY;
-	}
-
-	strncpy(pCurrPath, pPath, FS_MAX_FILE_NAME);
-	memset(pDir, 0, sizeof(FsWrap_Dir_t));
+static bool FileSystem_ScanFilter(const FsWrap_DirEnt_t* pEntry, void* pCtx) {
+	(void)pCtx;
+	return pEntry->Name[0] != '.';
+}
 
-	res = FsWrap_OpenDir(pDir, pCurrPath);
-	if (res != RET_STATE_SUCCESS) {
-		WSH_SHELL_PRINT("Failed to open directory: %s\r\n", pCurrPath);
-		MemWrap_Free(pCurrPath);
-		MemWrap_Free(pDir);
-		MemWrap_Free(pFno);
-		return res;
+static FS_WALK_t FileSystem_ScanVisitor(const FsWrap_WalkEntry_t* pEntry) {
+	for (u32 i = 0; i < pEntry->Depth; i++) {
+		WSH_SHELL_PRINT("%s", pEntry->LastMask & (1UL << i) ? "    " : "│   ");
 	}
 
-	u32 dirCnt = 0;
-	while (FsWrap_ReadDir(pDir, pFno) == RET_STATE_SUCCESS) {
-		if (pFno->Name[0] == 0) {
-			FsWrap_CloseDir(pDir);
-			break;
-		}
-
-		dirCnt++;
-	}
+	WSH_SHELL_PRINT("%s── %s\r\n", pEntry->IsLast ? "└" : "├", pEntry->pEntry->Name);
+	return FS_WALK_CONTINUE;
+}
 
-	res = FsWrap_OpenDir(pDir, pCurrPath);
-	if (res != RET_STATE_SUCCESS) {
-		WSH_SHELL_PRINT_ERR("Failed to open directory: %s\r\n", pCurrPath);
-		MemWrap_Free(pCurrPath);
-		MemWrap_Free(pDir);
-		MemWrap_Free(pFno);
-		return res;
+static RET_STATE_t FileSystem_ScanFiles(const char* pPath) {
+	FsWrap_Walk_t* pWalk =
+		MemWrap_Malloc(sizeof(FsWrap_Walk_t), __FILENAME__, __LINE__, DELAY_1_SECOND * 5);
+	if (!pWalk) {
+		WSH_SHELL_PRINT("Memory allocation failed for walk!\r\n");
+		return RET_STATE_ERR_MEMORY;
 	}
 
-	u32 currCnt = 0;
-	while (FsWrap_ReadDir(pDir, pFno) == RET_STATE_SUCCESS) {
-		if (pFno->Name[0] == 0)
-			break;
+	FsWrap_WalkCfg_t cfg = {
+		.Visitor  = FileSystem_ScanVisitor,
+		.Filter	  = FileSystem_ScanFilter,
+		.MaxDepth = FS_WALK_DEPTH_MAX,
+		.pCtx	  = NULL,
+	};
 
-		currCnt++;
+	RET_STATE_t res = FsWrap_Walk(pWalk, pPath, &cfg);
+	if (res != RET_STATE_SUCCESS)
+		WSH_SHELL_PRINT_ERR("Failed to walk directory: %s\r\n", pPath);
 
-		// Skip "." and ".."
-		if (pFno->Name[0] == '.')
-			continue;
+	MemWrap_Free(pWalk);
+	return res;
+}
 
-		bool isLast = currCnt == dirCnt;
+/**
+ * @brief Appends to the shell buffer at @p n and returns the length added.
+ * On overflow the total reaches FS_SHELL_BUFF_SIZE and stays there, which
+ * FileSystem_PrintJson() reports as truncated
+ */
+static u32 FileSystem_Print(char* pBuff, u32 n, const char* pFmt, ...) {
+	if (n >= FS_SHELL_BUFF_SIZE)
+		return 0;
 
-		u32 pCurPathLen = strnlen(pCurrPath, FS_MAX_FILE_NAME);
-		if (pCurPathLen + strlen(pFno->Name) > FS_MAX_FILE_NAME) {
-			WSH_SHELL_PRINT_WARN("Path too long: %s/%s\r\n", pCurrPath, pFno->Name);
-			continue;
-		}
+	va_list args;
+	va_start(args, pFmt);
+	int len = vsnprintf(pBuff + n, FS_SHELL_BUFF_SIZE - n, pFmt, args);
+	va_end(args);
 
-		WSH_SHELL_PRINT("%s%s── %s\r\n", pPrefix, isLast ? "└" : "├", pFno->Name);
+	if (len < 0)
+		return 0;
 
-		if (pFno->Type & FS_DIR_ENTRY_DIR) {
-			snprintf(&pCurrPath[pCurPathLen], FS_MAX_FILE_NAME - pCurPathLen, "/%s", pFno->Name);
-			snprintf(pNewPefix, FS_MAX_FILE_NAME + 1, "%s%s   ", pPrefix, isLast ? " " : "│");
+	return GET_MIN((u32)len, FS_SHELL_BUFF_SIZE - n);
+}
 
-			res = FileSystem_ScanFiles(pCurrPath, pNewPefix);
-			if (res != RET_STATE_SUCCESS) {
-				break;
-			}
-		}
+/**
+ * @brief the shell runs in one task, so the output buffers are static
+ * instead of taking the task stack
+ */
+static void FileSystem_PrintJson(const char* pJson, u32 len) {
+	static char prettyPrint[FS_SHELL_PRETTY_BUFF_SIZE];
 
-		pCurrPath[pCurPathLen] = 0;
+	if (len >= FS_SHELL_BUFF_SIZE) {
+		WSH_SHELL_PRINT_ERR("Output exceeds %d bytes!\r\n", FS_SHELL_BUFF_SIZE);
+		return;
 	}
 
-	FsWrap_CloseDir(pDir);
-	MemWrap_Free(pCurrPath);
-	MemWrap_Free(pNewPefix);
-	MemWrap_Free(pDir);
-	MemWrap_Free(pFno);
+	STRING_LIB_JSON_PRETTY_PRINT_DEF(pJson, prettyPrint, FS_SHELL_PRETTY_BUFF_SIZE);
+	WSH_SHELL_PRINT(prettyPrint);
+}
 
-	return res;
+/**
+ * @brief Speed and latency fields of one benchmark phase, nothing for a phase not run
+ */
+static u32 FileSystem_BenchStatPrint(char* pBuff, u32 n, const char* pName,
+									 const StorageBench_Stat_t* pStat) {
+	if (pStat->Ops == 0)
+		return 0;
+
+	char key[16];
+	u32 len = 0;
+
+	snprintf(key, sizeof(key), "speed%s", pName);
+	len += FileSystem_Print(pBuff, n + len, JSON_FIELD_STR_FLT2, key, StorageBench_GetSpeed(pStat));
+	snprintf(key, sizeof(key), "p50%sUs", pName);
+	len += FileSystem_Print(pBuff, n + len, JSON_FIELD_STR_ULONG, key,
+							StorageBench_GetPercentile(pStat, 50));
+	snprintf(key, sizeof(key), "p99%sUs", pName);
+	len += FileSystem_Print(pBuff, n + len, JSON_FIELD_STR_ULONG, key,
+							StorageBench_GetPercentile(pStat, 99));
+	snprintf(key, sizeof(key), "max%sUs", pName);
+	len += FileSystem_Print(pBuff, n + len, JSON_FIELD_STR_ULONG, key, pStat->LatMaxUs);
+	snprintf(key, sizeof(key), "err%s", pName);
+	len += FileSystem_Print(pBuff, n + len, JSON_FIELD_STR_ULONG, key, pStat->Errors);
+
+	return len;
 }
 
 /* clang-format off */
@@ -127,7 +145,15 @@ X_ENTRY(CMD_FS_OPT_DISK_NUM, WSH_SHELL_OPT_INT(WSH_SHELL_OPT_ACCESS_EXECUTE, "-d
 X_ENTRY(CMD_FS_OPT_SCAN, WSH_SHELL_OPT_WO_PARAM(WSH_SHELL_OPT_ACCESS_READ, "-s", "--scan", "Scan files")) \
 X_ENTRY(CMD_FS_OPT_MSD, WSH_SHELL_OPT_INT(WSH_SHELL_OPT_ACCESS_EXECUTE, "-m", "--msd", "Run MSD for specified amount of minutes")) \
 X_ENTRY(CMD_FS_OPT_INFO, WSH_SHELL_OPT_WO_PARAM(WSH_SHELL_OPT_ACCESS_READ, "-i", "--info", "Show information about storage")) \
-X_ENTRY(CMD_FS_OPT_TEST_SPEED, WSH_SHELL_OPT_WO_PARAM(WSH_SHELL_OPT_ACCESS_READ, "-t", "--testspeed", "Fast speed test")) \
+X_ENTRY(CMD_FS_OPT_RAM_SIZE, WSH_SHELL_OPT_INT(WSH_SHELL_OPT_ACCESS_EXECUTE, "-R", "--ramsize", "Resize and format RAM drive, size in KiB")) \
+X_ENTRY(CMD_FS_OPT_BENCH_BLOCK, WSH_SHELL_OPT_INT(WSH_SHELL_OPT_ACCESS_READ, "-b", "--block", "Set speed test block size in bytes")) \
+X_ENTRY(CMD_FS_OPT_BENCH_SIZE, WSH_SHELL_OPT_INT(WSH_SHELL_OPT_ACCESS_READ, "-z", "--size", "Set speed test file size in KiB")) \
+X_ENTRY(CMD_FS_OPT_BENCH_OP, WSH_SHELL_OPT_STR(WSH_SHELL_OPT_ACCESS_READ, "-o", "--op", "Set speed test operation: b (write, then read), w, r, x (mixed)")) \
+X_ENTRY(CMD_FS_OPT_BENCH_MIX, WSH_SHELL_OPT_INT(WSH_SHELL_OPT_ACCESS_READ, "-x", "--mix", "Set share of reads in percent for the mixed speed test")) \
+X_ENTRY(CMD_FS_OPT_BENCH_RAND, WSH_SHELL_OPT_WO_PARAM(WSH_SHELL_OPT_ACCESS_READ, "-r", "--random", "Use random offsets in speed test")) \
+X_ENTRY(CMD_FS_OPT_BENCH_SYNC, WSH_SHELL_OPT_INT(WSH_SHELL_OPT_ACCESS_READ, "-y", "--sync", "Sync speed test file after this many writes")) \
+X_ENTRY(CMD_FS_OPT_BENCH_QD, WSH_SHELL_OPT_INT(WSH_SHELL_OPT_ACCESS_READ, "-q", "--qdepth", "Set speed test queue depth, above 1 for async requests")) \
+X_ENTRY(CMD_FS_OPT_TEST_SPEED, WSH_SHELL_OPT_WO_PARAM(WSH_SHELL_OPT_ACCESS_READ, "-t", "--testspeed", "Run speed test with the options given before")) \
 X_ENTRY(CMD_FS_OPT_END, WSH_SHELL_OPT_END())
 /* clang-format on */
 
@@ -144,10 +170,10 @@ static WSH_SHELL_RET_STATE_t shell_cmd_fs(const WshShellCmd_t* pcCmd, WshShell_S
 	if ((argc > 0 && pArgv == NULL) || pcCmd == NULL)
 		return WSH_SHELL_RET_STATE_ERROR;
 
-	u32 n								 = 0;
-	char infoBuff[FS_SHELL_BUFF_SIZE]	 = "";
-	char prettyPrint[FS_SHELL_BUFF_SIZE] = "";
-	u32 ttlMin							 = FS_SHELL_MINUTES_TTL_DEF;
+	static char infoBuff[FS_SHELL_BUFF_SIZE];
+	u32 n						= 0;
+	u32 ttlMin					= FS_SHELL_MINUTES_TTL_DEF;
+	StorageBench_Cfg_t benchCfg = STORAGE_BENCH_CFG_DEF;
 	snprintf(Storage_CurrDrivePath, sizeof(Storage_CurrDrivePath), "%d:", Storage_CurrDrive);
 
 	WshShell_Size_t tokenPos = 0;
@@ -178,9 +204,7 @@ static WSH_SHELL_RET_STATE_t shell_cmd_fs(const WshShellCmd_t* pcCmd, WshShell_S
 			}
 
 			case CMD_FS_OPT_SCAN:
-				char localPath[FS_MAX_FILE_NAME + 1];
-				strcpy(localPath, Storage_CurrDrivePath);
-				FileSystem_ScanFiles(localPath, "");
+				FileSystem_ScanFiles(Storage_CurrDrivePath);
 				break;
 
 			case CMD_FS_OPT_MSD: {
@@ -196,12 +220,16 @@ static WSH_SHELL_RET_STATE_t shell_cmd_fs(const WshShellCmd_t* pcCmd, WshShell_S
 					return WSH_SHELL_RET_STATE_WARNING;
 				}
 
-				if (FsWrap_Lock(Storage_CurrDrivePath) == RET_STATE_ERR_TIMEOUT) {
+				/* both FAT volumes are exported, each one has own lock */
+				if (FsWrap_Lock(STORAGE_EMMC_ROOT_PATH) == RET_STATE_ERR_TIMEOUT ||
+					FsWrap_Lock(STORAGE_RAM_ROOT_PATH) == RET_STATE_ERR_TIMEOUT) {
 					WSH_SHELL_PRINT_WARN("File system is busy!\r\n");
 				}
+				StorageCache_Flush();
 
 				WSH_SHELL_PRINT("MSD storage plugged\r\n");
-				Pl_USB_MSC_Init();
+				if (!IoMsc_Start())
+					WSH_SHELL_PRINT_ERR("MSD start failed!\r\n");
 
 				// u32 tsEnd = xTaskGetTickCount() + ttlMin * DELAY_1_MINUTE;
 				// while (true) {
@@ -226,8 +254,16 @@ static WSH_SHELL_RET_STATE_t shell_cmd_fs(const WshShellCmd_t* pcCmd, WshShell_S
 				// Pl_USB_CDC_Init(Shell_RxCallbackUSB, Shell_GetReceiveBuff(), 1);
 				// Shell_Hardware_Init();
 				// TODO switch to uart
-				Pl_USB_DeInit();
-				FsWrap_Unlock(Storage_CurrDrivePath);
+				if (!IoMsc_Stop())
+					WSH_SHELL_PRINT_WARN("MSD write failed!\r\n");
+#if STORAGE_PIPE_ENABLE
+				StoragePipe_Stats_t pipeStats = StoragePipe_GetStats();
+				WSH_SHELL_PRINT("MSD pipe: hits %d, prefetches %d, stalls %d, stall max %d us\r\n",
+								pipeStats.ReadHits, pipeStats.Prefetches, pipeStats.Stalls,
+								pipeStats.StallMaxUs);
+#endif /* STORAGE_PIPE_ENABLE */
+				FsWrap_Unlock(STORAGE_RAM_ROOT_PATH);
+				FsWrap_Unlock(STORAGE_EMMC_ROOT_PATH);
 				WSH_SHELL_PRINT("\r\nMSD storage unplugged\r\n");
 				break;
 			}
@@ -235,69 +271,249 @@ static WSH_SHELL_RET_STATE_t shell_cmd_fs(const WshShellCmd_t* pcCmd, WshShell_S
 			case CMD_FS_OPT_INFO: {
 				RET_STATE_t retState = RET_STATE_SUCCESS;
 
-				n += sprintf(infoBuff + n, JSON_FIELD_FIRST, "cmd", pcCmd->Name);
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_FIRST, "cmd", pcCmd->Name);
 				if (Storage_CurrDrive == STORAGE_DRIVE_EMMC) {
-					n += sprintf(infoBuff + n, JSON_FIELD_STR_STR, "emmcHwIsInit",
-								 JSON_BOOL_VAL_GET(Storage_EmmcHw_IsInit()));
-					n += sprintf(infoBuff + n, JSON_FIELD_STR_STR, "emmcFsIsInit",
-								 JSON_BOOL_VAL_GET(Storage_EmmcFs_IsInit()));
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "emmcHwIsInit",
+										  JSON_BOOL_VAL_GET(Storage_EmmcHw_IsInit()));
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "emmcFsIsInit",
+										  JSON_BOOL_VAL_GET(Storage_EmmcFs_IsInit()));
 
 					if (Storage_EmmcHw_IsInit()) {
 						Pl_SdEmmcInfo_t cardInfo = Storage_GetEmmcInfo();
-						n += sprintf(infoBuff + n, JSON_FIELD_STR_ULONG, "mfgID", cardInfo.Class);
-						n += sprintf(infoBuff + n, JSON_FIELD_STR_STR, "name", cardInfo.ProdName);
-						n += sprintf(infoBuff + n, JSON_FIELD_STR_ULONG, "rev", cardInfo.ProdRev);
-						n += sprintf(infoBuff + n, JSON_FIELD_STR_ULONG, "SN", cardInfo.ProdSN);
-						n += sprintf(infoBuff + n, JSON_FIELD_STR_ULONG, "cardType",
-									 cardInfo.CardType);
-						n += sprintf(infoBuff + n, JSON_FIELD_STR_ULONG, "class", cardInfo.Class);
-						n += sprintf(infoBuff + n, JSON_FIELD_STR_ULONG, "relCardAdd",
-									 cardInfo.RelCardAdd);
-						n += sprintf(infoBuff + n, JSON_FIELD_STR_ULONG, "blockNbr",
-									 cardInfo.BlockNbr);
-						n += sprintf(infoBuff + n, JSON_FIELD_STR_ULONG, "blockSize",
-									 cardInfo.BlockSize);
-						n += sprintf(infoBuff + n, JSON_FIELD_STR_ULONG, "logBlockNbr",
-									 cardInfo.LogBlockNbr);
-						n += sprintf(infoBuff + n, JSON_FIELD_STR_ULONG, "logBlockSize",
-									 cardInfo.LogBlockSize);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "mfgID",
+											  cardInfo.MfgID);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "name",
+											  cardInfo.ProdName);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "rev",
+											  cardInfo.ProdRev);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "SN",
+											  cardInfo.ProdSN);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "cardType",
+											  cardInfo.CardType);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "class",
+											  cardInfo.Class);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "relCardAdd",
+											  cardInfo.RelCardAdd);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "blockNbr",
+											  cardInfo.BlockNbr);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "blockSize",
+											  cardInfo.BlockSize);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "logBlockNbr",
+											  cardInfo.LogBlockNbr);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "logBlockSize",
+											  cardInfo.LogBlockSize);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "busWidth",
+											  cardInfo.BusWidth);
+						const char* pTiming = FileSystem_EmmcTimingStr[cardInfo.Timing];
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "timing", pTiming);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "busClk",
+											  cardInfo.BusClk);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "busFallbacks",
+											  cardInfo.BusFallbacks);
+
+						StorageCache_Stats_t cacheStats = StorageCache_GetStats();
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "cacheHits",
+											  cacheStats.Hits + cacheStats.ReadAheadHits);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "cacheMisses",
+											  cacheStats.Misses);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "cacheEvictions",
+											  cacheStats.Evictions);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "cacheDirty",
+											  cacheStats.Dirty);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "cacheWrCmds",
+											  cacheStats.WriteCmds);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "cacheWrBlocks",
+											  cacheStats.WriteBlocks);
+
+						Storage_ReadyStats_t readyStats = Storage_Emmc_GetReadyStats();
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "readyBusyWaits",
+											  readyStats.BusyWaits);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "readyTimeouts",
+											  readyStats.Timeouts);
+						u32 readyAvgUs = 0;
+						if (readyStats.BusyWaits)
+							readyAvgUs = (u32)(readyStats.BusyTimeUs / readyStats.BusyWaits);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "readyAvgUs",
+											  readyAvgUs);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "readyMaxUs",
+											  readyStats.MaxUs);
+
+						Storage_TrimStats_t trimStats = Storage_Emmc_GetTrimStats();
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "discardAlign",
+											  cardInfo.DiscardAlign);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "trimCmds",
+											  trimStats.Cmds);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "trimBlocks",
+											  trimStats.Blocks);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "trimPending",
+											  cacheStats.TrimPending);
+						n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "trimCancels",
+											  cacheStats.TrimCancels);
 					} else {
 						retState = RET_STATE_ERROR;
 					}
 
 				} else if (Storage_CurrDrive == STORAGE_DRIVE_RAM) {
-					n += sprintf(infoBuff + n, JSON_FIELD_STR_STR, "ramHwIsInit",
-								 JSON_BOOL_VAL_GET(Storage_RamHw_IsInit()));
-					n += sprintf(infoBuff + n, JSON_FIELD_STR_STR, "ramFsIsInit",
-								 JSON_BOOL_VAL_GET(Storage_RamFs_IsInit()));
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "ramHwIsInit",
+										  JSON_BOOL_VAL_GET(Storage_RamHw_IsInit()));
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "ramFsIsInit",
+										  JSON_BOOL_VAL_GET(Storage_RamFs_IsInit()));
+
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "region",
+										  StorageRam_GetRegionStr());
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "capacity",
+										  StorageRam_GetCapacity());
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "capacityMax",
+										  StorageRam_GetCapacityMax());
+
+					StorageRam_Stats_t ramStats = StorageRam_GetStats();
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "reads",
+										  ramStats.Reads);
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "writes",
+										  ramStats.Writes);
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "maps", ramStats.Maps);
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "errors",
+										  ramStats.Errors);
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "snapSaves",
+										  ramStats.SnapSaves);
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "snapLoads",
+										  ramStats.SnapLoads);
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "snapErrors",
+										  ramStats.SnapErrors);
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "snapSize",
+										  ramStats.SnapSize);
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "snapTimeMs",
+										  ramStats.SnapTimeMs);
+
+					Storage_TrimStats_t trimStats = StorageRam_GetTrimStats();
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "trimCmds",
+										  trimStats.Cmds);
+					n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "trimBlocks",
+										  trimStats.Blocks);
 				} else {
 					retState = RET_STATE_ERROR;
 				}
 
-				n += sprintf(infoBuff + n, JSON_FIELD_STR_STR, "result", RetState_GetStr(retState));
-				n += sprintf(infoBuff + n, JSON_FIELD_LAST, JSON_KEY_TSTAMP,
-							 TimeDate_Timestamp_Get());
-				STRING_LIB_JSON_PRETTY_PRINT_DEF(infoBuff, prettyPrint, FS_SHELL_BUFF_SIZE);
-				WSH_SHELL_PRINT(prettyPrint);
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "result",
+									  RetState_GetStr(retState));
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_LAST, JSON_KEY_TSTAMP,
+									  TimeDate_Timestamp_Get());
+				FileSystem_PrintJson(infoBuff, n);
+
+				break;
+			}
+
+			case CMD_FS_OPT_RAM_SIZE: {
+				u32 sizeKb = 0;
+				WshShellCmd_GetOptValue(&optCtx, argc, pArgv, sizeof(sizeKb),
+										(WshShell_Size_t*)&sizeKb);
+
+				if (!Storage_Ram_Resize(sizeKb * DATA_1_KBYTE)) {
+					WSH_SHELL_PRINT_WARN("RAM drive resize failed, %d..%d KiB allowed\r\n",
+										 STORAGE_RAM_CAPACITY_MIN / DATA_1_KBYTE,
+										 StorageRam_GetCapacityMax() / DATA_1_KBYTE);
+					return WSH_SHELL_RET_STATE_ERROR;
+				}
+
+				WSH_SHELL_PRINT_INFO("RAM drive resized to %d bytes\r\n", StorageRam_GetCapacity());
+				break;
+			}
+
+			case CMD_FS_OPT_BENCH_BLOCK:
+				WshShellCmd_GetOptValue(&optCtx, argc, pArgv, sizeof(benchCfg.BlockSize),
+										(WshShell_Size_t*)&benchCfg.BlockSize);
+				break;
 
+			case CMD_FS_OPT_BENCH_SIZE: {
+				u32 sizeKb = 0;
+				WshShellCmd_GetOptValue(&optCtx, argc, pArgv, sizeof(sizeKb),
+										(WshShell_Size_t*)&sizeKb);
+				benchCfg.FileSize = sizeKb * DATA_1_KBYTE;
 				break;
 			}
 
+			case CMD_FS_OPT_BENCH_OP: {
+				char opStr = '\0';
+				WshShellCmd_GetOptValue(&optCtx, argc, pArgv, sizeof(opStr),
+										(WshShell_Size_t*)&opStr);
+				switch (opStr) {
+					case 'b':
+					case 'B':
+						benchCfg.Op = STORAGE_BENCH_OP_WRITE_READ;
+						break;
+					case 'w':
+					case 'W':
+						benchCfg.Op = STORAGE_BENCH_OP_WRITE;
+						break;
+					case 'r':
+					case 'R':
+						benchCfg.Op = STORAGE_BENCH_OP_READ;
+						break;
+					case 'x':
+					case 'X':
+						benchCfg.Op = STORAGE_BENCH_OP_MIXED;
+						break;
+					default:
+						WSH_SHELL_PRINT_WARN("Invalid speed test operation '%c'\r\n", opStr);
+						return WSH_SHELL_RET_STATE_ERROR;
+				}
+				break;
+			}
+
+			case CMD_FS_OPT_BENCH_MIX:
+				WshShellCmd_GetOptValue(&optCtx, argc, pArgv, sizeof(benchCfg.ReadPct),
+										(WshShell_Size_t*)&benchCfg.ReadPct);
+				benchCfg.Op = STORAGE_BENCH_OP_MIXED;
+				break;
+
+			case CMD_FS_OPT_BENCH_RAND:
+				benchCfg.Pattern = STORAGE_BENCH_PATTERN_RAND;
+				break;
+
+			case CMD_FS_OPT_BENCH_SYNC:
+				WshShellCmd_GetOptValue(&optCtx, argc, pArgv, sizeof(benchCfg.SyncEvery),
+										(WshShell_Size_t*)&benchCfg.SyncEvery);
+				break;
+
+			case CMD_FS_OPT_BENCH_QD:
+				WshShellCmd_GetOptValue(&optCtx, argc, pArgv, sizeof(benchCfg.QueueDepth),
+										(WshShell_Size_t*)&benchCfg.QueueDepth);
+				break;
+
 			case CMD_FS_OPT_TEST_SPEED: {
-				float rSpeed, wSpeed;
+				StorageBench_Result_t* pBenchRes = MemWrap_Malloc(
+					sizeof(StorageBench_Result_t), __FILENAME__, __LINE__, DELAY_1_SECOND * 5);
+				if (!pBenchRes) {
+					WSH_SHELL_PRINT_ERR("Memory allocation failed for speed test!\r\n");
+					return WSH_SHELL_RET_STATE_ERROR;
+				}
+
 				RET_STATE_t retState =
-					StorageUtils_FsSpeedTest(Storage_CurrDrivePath, &rSpeed, &wSpeed);
-
-				n += sprintf(infoBuff + n, JSON_FIELD_FIRST, "cmd", pcCmd->Name);
-				n += sprintf(infoBuff + n, JSON_FIELD_STR_STR, "drive", Storage_CurrDrivePath);
-				n += sprintf(infoBuff + n, JSON_FIELD_STR_FLT, "speedWrite", wSpeed);
-				n += sprintf(infoBuff + n, JSON_FIELD_STR_FLT, "speedRead", rSpeed);
-				n += sprintf(infoBuff + n, JSON_FIELD_STR_STR, "result", RetState_GetStr(retState));
-				n += sprintf(infoBuff + n, JSON_FIELD_LAST, JSON_KEY_TSTAMP,
-							 TimeDate_Timestamp_Get());
-				STRING_LIB_JSON_PRETTY_PRINT_DEF(infoBuff, prettyPrint, FS_SHELL_BUFF_SIZE);
-
-				WSH_SHELL_PRINT(prettyPrint);
+					StorageUtils_FsSpeedTest(Storage_CurrDrivePath, &benchCfg, pBenchRes);
+
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_FIRST, "cmd", pcCmd->Name);
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "drive",
+									  Storage_CurrDrivePath);
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "op",
+									  StorageBench_GetOpStr(benchCfg.Op));
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "pattern",
+									  StorageBench_GetPatternStr(benchCfg.Pattern));
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "block",
+									  benchCfg.BlockSize);
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "size", benchCfg.FileSize);
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "qdepth",
+									  benchCfg.QueueDepth);
+				n += FileSystem_BenchStatPrint(infoBuff, n, "Write", &pBenchRes->Write);
+				n += FileSystem_BenchStatPrint(infoBuff, n, "Read", &pBenchRes->Read);
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "syncs", pBenchRes->Syncs);
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_ULONG, "syncMaxUs",
+									  pBenchRes->SyncMaxUs);
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_STR_STR, "result",
+									  RetState_GetStr(retState));
+				n += FileSystem_Print(infoBuff, n, JSON_FIELD_LAST, JSON_KEY_TSTAMP,
+									  TimeDate_Timestamp_Get());
+				FileSystem_PrintJson(infoBuff, n);
+				MemWrap_Free(pBenchRes);
 				break;
 			}
 
@@ -4,6 +4,259 @@
 #include "mem_wrapper.h"
 #include "stringlib.h"
 
+#define FATFS_POOL_SIZE			 FF_FS_LOCK
+#define FATFS_POOL_HEAP_FALLBACK 1 // allocate from heap when the pool is exhausted
+
+/* Section for the pools, default .bss is AXI SRAM reachable by the eMMC DMA */
+#define FATFS_POOL_DATA
+
+#define FATFS_DIR_CACHE_SIZE	 8	// entries per volume
+#define FATFS_DIR_CACHE_NAME_MAX 24 // UTF-16 units, longer names are not cached
+
+typedef struct {
+	u8* pMem;
+	u32 ItemSize;
+	u32 UnusedNum; // items never acquired yet, taken in order
+	u32 FreeNum;   // released items, taken in LIFO order
+	u8 FreeIdx[FATFS_POOL_SIZE];
+	FsWrap_PoolStats_t Stats;
+} FatFS_Pool_t;
+
+static FIL FATFS_POOL_DATA FatFS_FilMem[FATFS_POOL_SIZE];
+static DIR FATFS_POOL_DATA FatFS_DirMem[FATFS_POOL_SIZE];
+
+static FatFS_Pool_t FatFS_FilPool = {
+	.pMem	  = (u8*)FatFS_FilMem,
+	.ItemSize = sizeof(FIL),
+	.Stats	  = {.Size = FATFS_POOL_SIZE},
+};
+
+static FatFS_Pool_t FatFS_DirPool = {
+	.pMem	  = (u8*)FatFS_DirMem,
+	.ItemSize = sizeof(DIR),
+	.Stats	  = {.Size = FATFS_POOL_SIZE},
+};
+
+static void* FatFS_Pool_Acquire(FatFS_Pool_t* pPool) {
+	u8* pItem = NULL;
+
+	SYS_CRITICAL_ON();
+	if (pPool->FreeNum || pPool->UnusedNum < FATFS_POOL_SIZE) {
+		u32 idx = pPool->FreeNum ? pPool->FreeIdx[--pPool->FreeNum] : pPool->UnusedNum++;
+		pItem	= &pPool->pMem[idx * pPool->ItemSize];
+		pPool->Stats.InUse++;
+		pPool->Stats.Peak = GET_MAX(pPool->Stats.Peak, pPool->Stats.InUse);
+	} else {
+		pPool->Stats.Exhausted++;
+	}
+	SYS_CRITICAL_OFF();
+
+#if FATFS_POOL_HEAP_FALLBACK
+	if (pItem == NULL)
+		pItem = MemWrap_Malloc(pPool->ItemSize, __FILENAME__, __LINE__, MEM_ALLOC_UNLIM_TMO);
+#endif /* FATFS_POOL_HEAP_FALLBACK */
+
+	if (pItem != NULL)
+		memset(pItem, 0x00, pPool->ItemSize);
+
+	return pItem;
+}
+
+static void FatFS_Pool_Release(FatFS_Pool_t* pPool, void* pItem) {
+	u8* pMemEnd = &pPool->pMem[FATFS_POOL_SIZE * pPool->ItemSize];
+
+	if ((u8*)pItem < pPool->pMem || (u8*)pItem >= pMemEnd) {
+		MemWrap_Free(pItem);
+		return;
+	}
+
+	SYS_CRITICAL_ON();
+	pPool->FreeIdx[pPool->FreeNum++] = ((u8*)pItem - pPool->pMem) / pPool->ItemSize;
+	pPool->Stats.InUse--;
+	SYS_CRITICAL_OFF();
+}
+
+#if FF_USE_FASTSEEK
+
+#define FATFS_FASTSEEK_MAP_SIZE	 32 // initial link map size in DWORDs, fits 14 fragments
+#define FATFS_FASTSEEK_MAP_SPARE 8	// DWORDs added on growth for upcoming fragments
+
+/**
+ * @brief Build the cluster link map of a file. The map buffer is owned by
+ * the file, the DWORD before fp->cltbl keeps its capacity
+ */
+static FRESULT FatFS_FastSeek_Build(FIL* fp, DWORD* pMem) {
+	FRESULT res = FR_NOT_ENOUGH_CORE;
+
+	while (pMem != NULL) {
+		fp->cltbl	 = &pMem[1];
+		fp->cltbl[0] = pMem[0];
+
+		res = f_lseek(fp, CREATE_LINKMAP);
+		if (res != FR_NOT_ENOUGH_CORE)
+			break;
+
+		/* cltbl[0] holds the required size now */
+		DWORD mapSize = fp->cltbl[0] + FATFS_FASTSEEK_MAP_SPARE;
+		fp->cltbl	  = NULL;
+		MemWrap_Free(pMem);
+
+		pMem = MemWrap_Malloc((mapSize + 1) * sizeof(DWORD), __FILENAME__, __LINE__,
+							  MEM_ALLOC_UNLIM_TMO);
+		if (pMem != NULL)
+			pMem[0] = mapSize;
+	}
+
+	if (res != FR_OK) {
+		fp->cltbl = NULL;
+		if (pMem != NULL)
+			MemWrap_Free(pMem);
+	}
+
+	return res;
+}
+
+static DWORD* FatFS_FastSeek_Suspend(FIL* fp) {
+	if (fp->cltbl == NULL)
+		return NULL;
+
+	DWORD* pMem = fp->cltbl - 1;
+	fp->cltbl	= NULL;
+	return pMem;
+}
+
+static u32 FatFS_FastSeek_ClustNum(FIL* fp) {
+#if FF_MAX_SS != FF_MIN_SS
+	u32 clustSize = fp->obj.fs->csize * fp->obj.fs->ssize;
+#else
+	u32 clustSize = fp->obj.fs->csize * FF_MIN_SS;
+#endif
+
+	return (f_size(fp) + clustSize - 1) / clustSize;
+}
+
+/**
+ * @brief The map can't follow a changing cluster chain, so it is rebuilt
+ * only when the number of clusters of the file has changed
+ */
+static void FatFS_FastSeek_Resume(FIL* fp, DWORD* pMem, u32 prevClustNum) {
+	if (pMem == NULL)
+		return;
+
+	if (FatFS_FastSeek_ClustNum(fp) == prevClustNum)
+		fp->cltbl = &pMem[1];
+	else
+		(void)FatFS_FastSeek_Build(fp, pMem);
+}
+
+#endif /* FF_USE_FASTSEEK */
+
+#if FF_USE_DIR_CACHE
+typedef struct {
+	DWORD Dclst; // start cluster of the directory, 0 for the FAT12/16 root
+	DWORD Dptr;
+	DWORD BlkOfs;
+	u32 Stamp; // last use, the least recently used entry is replaced
+	BYTE Sfn[11];
+	u8 NameLen; // 0 for a free entry
+	WCHAR Name[FATFS_DIR_CACHE_NAME_MAX];
+} FatFS_DirCacheEntry_t;
+
+typedef struct {
+	FatFS_DirCacheEntry_t Entries[FATFS_DIR_CACHE_SIZE];
+	u32 Stamp;
+} FatFS_DirCache_t;
+
+/* Accessed by FatFS with the volume locked, so every volume needs no other lock */
+static FatFS_DirCache_t FatFS_DirCache[FF_VOLUMES];
+
+static u32 FatFS_DirCache_NameLen(const WCHAR* pName) {
+	u32 len = 0;
+	while (len <= FATFS_DIR_CACHE_NAME_MAX && pName[len] != 0)
+		len++;
+
+	return len;
+}
+
+static FatFS_DirCacheEntry_t* FatFS_DirCache_Lookup(FatFS_DirCache_t* pCache, DWORD dclst,
+													const WCHAR* pName, u32 nameLen) {
+	for (u32 i = 0; i < FATFS_DIR_CACHE_SIZE; i++) {
+		FatFS_DirCacheEntry_t* pEntry = &pCache->Entries[i];
+		if (pEntry->NameLen != nameLen || pEntry->Dclst != dclst)
+			continue;
+
+		/* case-insensitive like the FatFS name matching */
+		u32 idx = 0;
+		while (idx < nameLen && ff_wtoupper(pEntry->Name[idx]) == ff_wtoupper(pName[idx]))
+			idx++;
+
+		if (idx == nameLen)
+			return pEntry;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Find the entry of a name in a directory, ff.c checks the SFN entry at
+ * the returned index before using it
+ */
+int ff_dircache_find(FATFS* fs, DWORD dclst, const WCHAR* name, DWORD* dptr, DWORD* blk_ofs,
+					 BYTE* sfn) {
+	FatFS_DirCache_t* pCache = &FatFS_DirCache[fs->ldrv];
+
+	u32 nameLen = FatFS_DirCache_NameLen(name);
+	if (nameLen > FATFS_DIR_CACHE_NAME_MAX)
+		return 0;
+
+	FatFS_DirCacheEntry_t* pEntry = FatFS_DirCache_Lookup(pCache, dclst, name, nameLen);
+	if (pEntry == NULL)
+		return 0;
+
+	pEntry->Stamp = ++pCache->Stamp;
+	*dptr		  = pEntry->Dptr;
+	*blk_ofs	  = pEntry->BlkOfs;
+	memcpy(sfn, pEntry->Sfn, sizeof(pEntry->Sfn));
+
+	return 1;
+}
+
+void ff_dircache_store(FATFS* fs, DWORD dclst, const WCHAR* name, DWORD dptr, DWORD blk_ofs,
+					   const BYTE* sfn) {
+	FatFS_DirCache_t* pCache = &FatFS_DirCache[fs->ldrv];
+
+	u32 nameLen = FatFS_DirCache_NameLen(name);
+	if (nameLen > FATFS_DIR_CACHE_NAME_MAX)
+		return;
+
+	FatFS_DirCacheEntry_t* pEntry = FatFS_DirCache_Lookup(pCache, dclst, name, nameLen);
+	if (pEntry == NULL) {
+		pEntry = &pCache->Entries[0];
+		for (u32 i = 1; i < FATFS_DIR_CACHE_SIZE && pEntry->NameLen != 0; i++) {
+			if (pCache->Entries[i].NameLen == 0 || pCache->Entries[i].Stamp < pEntry->Stamp)
+				pEntry = &pCache->Entries[i];
+		}
+	}
+
+	pEntry->Dclst	= dclst;
+	pEntry->Dptr	= dptr;
+	pEntry->BlkOfs	= blk_ofs;
+	pEntry->Stamp	= ++pCache->Stamp;
+	pEntry->NameLen = (u8)nameLen;
+	memcpy(pEntry->Sfn, sfn, sizeof(pEntry->Sfn));
+	memcpy(pEntry->Name, name, nameLen * sizeof(WCHAR));
+}
+
+/**
+ * @brief Called by f_unlink() and f_rename() after an entry is removed and on
+ * every mount. New entries never move the existing ones, so f_open() with a
+ * create flag and f_mkdir() keep the cache.
+ */
+void ff_dircache_drop(FATFS* fs) {
+	memset(&FatFS_DirCache[fs->ldrv], 0, sizeof(FatFS_DirCache_t));
+}
+#endif /* FF_USE_DIR_CACHE */
+
 static RET_STATE_t TranslateFsRetCode(FRESULT error) {
 	switch (error) {
 		case FR_OK:
@@ -39,23 +292,60 @@ static u32 TranslateFlags(u32 flags) {
 }
 
 static RET_STATE_t FatFS_Open(FsWrap_File_t* pFile, const char* pPath, u32 flags) {
-	pFile->pFileHandler = MemWrap_Malloc(sizeof(FIL), __FILE__, __LINE__, MEM_ALLOC_UNLIM_TMO);
-	(void)memset(pFile->pFileHandler, 0x00, sizeof(FIL));
+	pFile->pFileHandler = FatFS_Pool_Acquire(&FatFS_FilPool);
+	if (pFile->pFileHandler == NULL)
+		return RET_STATE_ERR_MEMORY;
+
+	pFile->PreallocSize = 0;
+	pFile->DataEnd		= 0;
 
 	u32 ffMode	= TranslateFlags(flags);
 	FRESULT res = f_open(pFile->pFileHandler, pPath, (u8)ffMode);
 
 	if (res != FR_OK) {
-		MemWrap_Free(pFile->pFileHandler);
+		FatFS_Pool_Release(&FatFS_FilPool, pFile->pFileHandler);
 		pFile->pFileHandler = NULL;
+		return TranslateFsRetCode(res);
+	}
+
+#if FF_USE_FASTSEEK
+	if (flags & FS_MODE_FAST_SEEK) {
+		DWORD* pMem = MemWrap_Malloc((FATFS_FASTSEEK_MAP_SIZE + 1) * sizeof(DWORD), __FILENAME__,
+									 __LINE__, MEM_ALLOC_UNLIM_TMO);
+		if (pMem != NULL)
+			pMem[0] = FATFS_FASTSEEK_MAP_SIZE;
+
+		/* not fatal, the file just stays in the normal seek mode */
+		(void)FatFS_FastSeek_Build(pFile->pFileHandler, pMem);
 	}
+#endif /* FF_USE_FASTSEEK */
 
 	return TranslateFsRetCode(res);
 }
 
 static RET_STATE_t FatFS_Close(FsWrap_File_t* pFile) {
-	FRESULT res = f_close(pFile->pFileHandler);
-	MemWrap_Free(pFile->pFileHandler);
+	FIL* fp		= pFile->pFileHandler;
+	FRESULT res = FR_OK;
+
+#if !FF_FS_READONLY
+	/* give back the reserved space which was not written */
+	if (pFile->PreallocSize && f_size(fp) > pFile->DataEnd) {
+		res = f_lseek(fp, pFile->DataEnd);
+		if (res == FR_OK)
+			res = f_truncate(fp);
+	}
+	pFile->PreallocSize = 0;
+#endif
+
+	FRESULT closeRes = f_close(fp);
+	if (res == FR_OK)
+		res = closeRes;
+#if FF_USE_FASTSEEK
+	DWORD* pMem = FatFS_FastSeek_Suspend(pFile->pFileHandler);
+	if (pMem != NULL)
+		MemWrap_Free(pMem);
+#endif /* FF_USE_FASTSEEK */
+	FatFS_Pool_Release(&FatFS_FilPool, pFile->pFileHandler);
 	pFile->pFileHandler = NULL;
 
 	return TranslateFsRetCode(res);
@@ -90,15 +380,29 @@ static RET_STATE_t FatFS_Rename(FsWrap_Mount_t* pMntPoint, const char* pFrom, co
 	return RET_STATE_ERROR;
 }
 
+/**
+ * @brief a preallocated file has its data only up to DataEnd, the rest
+ * up to f_size() is reserved space which is trimmed on close
+ */
+static u32 FatFS_DataSize(FsWrap_File_t* pFile) {
+	return pFile->PreallocSize ? pFile->DataEnd : f_size((FIL*)pFile->pFileHandler);
+}
+
 static RET_STATE_t FatFS_Read(FsWrap_File_t* pFile, void* pDest, u32 bytesNum, u32* pBytesRd) {
-	FRESULT res = f_read(pFile->pFileHandler, pDest, bytesNum, (size_t*)pBytesRd);
+	/* the reserved space past DataEnd holds stale card data, it reads as EOF */
+	if (pFile->PreallocSize) {
+		u32 pos	 = f_tell((FIL*)pFile->pFileHandler);
+		bytesNum = pos < pFile->DataEnd ? GET_MIN(bytesNum, pFile->DataEnd - pos) : 0;
+	}
+
+	FRESULT res = f_read(pFile->pFileHandler, pDest, bytesNum, (UINT*)pBytesRd);
 	return TranslateFsRetCode(res);
 }
 
-static RET_STATE_t FatFS_Write(FsWrap_File_t* pFile, const void* pSrc, u32 bytesNum,
-							   u32* pBytesWr) {
+static RET_STATE_t FatFS_WriteRaw(FsWrap_File_t* pFile, const void* pSrc, u32 bytesNum,
+								  u32* pBytesWr) {
 #if !FF_FS_READONLY
-	u32 pos		= f_size((FIL*)pFile->pFileHandler);
+	u32 pos		= FatFS_DataSize(pFile);
 	FRESULT res = FR_OK;
 
 	/* FA_APPEND flag means that file has been opened for append.
@@ -111,9 +415,12 @@ static RET_STATE_t FatFS_Write(FsWrap_File_t* pFile, const void* pSrc, u32 bytes
 	}
 
 	if (res == FR_OK) {
-		res = f_write(pFile->pFileHandler, pSrc, bytesNum, (size_t*)pBytesWr);
+		res = f_write(pFile->pFileHandler, pSrc, bytesNum, (UINT*)pBytesWr);
 	}
 
+	if (pFile->PreallocSize)
+		pFile->DataEnd = GET_MAX(pFile->DataEnd, f_tell((FIL*)pFile->pFileHandler));
+
 	return TranslateFsRetCode(res);
 #endif
 
@@ -132,13 +439,13 @@ static RET_STATE_t FatFS_Seek(FsWrap_File_t* pFile, s32 offset, FS_SEEK_t whence
 			pos = f_tell((FIL*)pFile->pFileHandler) + offset;
 			break;
 		case FS_SEEK_END:
-			pos = f_size((FIL*)pFile->pFileHandler) + offset;
+			pos = FatFS_DataSize(pFile) + offset;
 			break;
 		default:
 			return RET_STATE_ERROR;
 	}
 
-	if ((pos < 0) || (pos > f_size((FIL*)pFile->pFileHandler))) {
+	if ((pos < 0) || (pos > FatFS_DataSize(pFile))) {
 		return RET_STATE_ERROR;
 	}
 
@@ -157,7 +464,7 @@ static RET_STATE_t FatFS_Tell(FsWrap_File_t* pFile, u32* pPos) {
 }
 
 static RET_STATE_t FatFS_Size(FsWrap_File_t* pFile, u32* pSize) {
-	*pSize = f_size((FIL*)pFile->pFileHandler);
+	*pSize = FatFS_DataSize(pFile);
 
 	if (*pSize >= 0) {
 		return RET_STATE_SUCCESS;
@@ -166,9 +473,22 @@ static RET_STATE_t FatFS_Size(FsWrap_File_t* pFile, u32* pSize) {
 	}
 }
 
-static RET_STATE_t FatFS_Truncate(FsWrap_File_t* pFile, u32 length) {
+static RET_STATE_t FatFS_ClustSize(FsWrap_File_t* pFile, u32* pSize) {
+	FATFS* fs = ((FIL*)pFile->pFileHandler)->obj.fs;
+
+#if FF_MAX_SS != FF_MIN_SS
+	*pSize = fs->csize * fs->ssize;
+#else
+	*pSize = fs->csize * FF_MIN_SS;
+#endif
+
+	return RET_STATE_SUCCESS;
+}
+
+static RET_STATE_t FatFS_TruncateRaw(FsWrap_File_t* pFile, u32 length) {
 #if !FF_FS_READONLY
-	u32 curLength = f_size((FIL*)pFile->pFileHandler);
+	/* inside the preallocated space the gap from DataEnd is zero filled too */
+	u32 curLength = FatFS_DataSize(pFile);
 
 	/* f_lseek expands file if new position is larger than file size */
 	FRESULT res = f_lseek(pFile->pFileHandler, length);
@@ -197,7 +517,7 @@ static RET_STATE_t FatFS_Truncate(FsWrap_File_t* pFile, u32 length) {
 		 * using additional code and memory for doing any
 		 * optimization.
 		 */
-		size_t bw;
+		UINT bw;
 		u8 c = 0;
 
 		for (u32 i = curLength; i < length; i++) {
@@ -208,12 +528,114 @@ static RET_STATE_t FatFS_Truncate(FsWrap_File_t* pFile, u32 length) {
 		}
 	}
 
+	if (pFile->PreallocSize)
+		pFile->DataEnd = f_tell((FIL*)pFile->pFileHandler);
+
 	return TranslateFsRetCode(res);
 #endif
 
 	return RET_STATE_ERROR;
 }
 
+static RET_STATE_t FatFS_Write(FsWrap_File_t* pFile, const void* pSrc, u32 bytesNum,
+							   u32* pBytesWr) {
+#if FF_USE_FASTSEEK
+	FIL* fp = pFile->pFileHandler;
+
+	/* overwriting inside the file keeps the cluster chain and the map valid */
+	bool isAppend = (pFile->Flags & FS_MODE_APPEND) || (pFile->Flags & FS_MODE_CREATE_OR_APPEND);
+	if (fp->cltbl == NULL || (!isAppend && f_tell(fp) + bytesNum <= f_size(fp)))
+		return FatFS_WriteRaw(pFile, pSrc, bytesNum, pBytesWr);
+
+	u32 clustNum		 = FatFS_FastSeek_ClustNum(fp);
+	DWORD* pMem			 = FatFS_FastSeek_Suspend(fp);
+	RET_STATE_t retState = FatFS_WriteRaw(pFile, pSrc, bytesNum, pBytesWr);
+	FatFS_FastSeek_Resume(fp, pMem, clustNum);
+
+	return retState;
+#else  /* FF_USE_FASTSEEK */
+	return FatFS_WriteRaw(pFile, pSrc, bytesNum, pBytesWr);
+#endif /* FF_USE_FASTSEEK */
+}
+
+static RET_STATE_t FatFS_Truncate(FsWrap_File_t* pFile, u32 length) {
+#if FF_USE_FASTSEEK
+	FIL* fp = pFile->pFileHandler;
+	if (fp->cltbl == NULL)
+		return FatFS_TruncateRaw(pFile, length);
+
+	u32 clustNum		 = FatFS_FastSeek_ClustNum(fp);
+	DWORD* pMem			 = FatFS_FastSeek_Suspend(fp);
+	RET_STATE_t retState = FatFS_TruncateRaw(pFile, length);
+	FatFS_FastSeek_Resume(fp, pMem, clustNum);
+
+	return retState;
+#else  /* FF_USE_FASTSEEK */
+	return FatFS_TruncateRaw(pFile, length);
+#endif /* FF_USE_FASTSEEK */
+}
+
+static RET_STATE_t FatFS_PreallocateRaw(FsWrap_File_t* pFile, u32 bytesNum, bool isContiguous) {
+#if !FF_FS_READONLY
+	FIL* fp				 = pFile->pFileHandler;
+	u32 curSize			 = f_size(fp);
+	RET_STATE_t retState = RET_STATE_SUCCESS;
+	FRESULT res			 = FR_DENIED;
+
+	if (bytesNum <= curSize)
+		return RET_STATE_SUCCESS;
+
+#if FF_USE_EXPAND
+	/* one contiguous block can only be given to an empty file */
+	if (isContiguous && curSize == 0)
+		res = f_expand(fp, bytesNum, 1);
+#endif /* FF_USE_EXPAND */
+
+	if (res == FR_DENIED) {
+		if (isContiguous)
+			retState = RET_STATE_WARNING;
+
+		/* f_lseek expands the cluster chain if new position is larger than file size */
+		u32 pos = f_tell(fp);
+		res		= f_lseek(fp, bytesNum);
+		if (res == FR_OK && f_tell(fp) < bytesNum)
+			res = FR_DENIED;
+
+		FRESULT seekRes = f_lseek(fp, pos);
+		if (res == FR_OK)
+			res = seekRes;
+	}
+
+	if (res != FR_OK)
+		return TranslateFsRetCode(res);
+
+	if (pFile->PreallocSize == 0)
+		pFile->DataEnd = curSize;
+	pFile->PreallocSize = bytesNum;
+
+	return retState;
+#endif
+
+	return RET_STATE_ERROR;
+}
+
+static RET_STATE_t FatFS_Preallocate(FsWrap_File_t* pFile, u32 bytesNum, bool isContiguous) {
+#if FF_USE_FASTSEEK
+	FIL* fp = pFile->pFileHandler;
+	if (fp->cltbl == NULL)
+		return FatFS_PreallocateRaw(pFile, bytesNum, isContiguous);
+
+	u32 clustNum		 = FatFS_FastSeek_ClustNum(fp);
+	DWORD* pMem			 = FatFS_FastSeek_Suspend(fp);
+	RET_STATE_t retState = FatFS_PreallocateRaw(pFile, bytesNum, isContiguous);
+	FatFS_FastSeek_Resume(fp, pMem, clustNum);
+
+	return retState;
+#else  /* FF_USE_FASTSEEK */
+	return FatFS_PreallocateRaw(pFile, bytesNum, isContiguous);
+#endif /* FF_USE_FASTSEEK */
+}
+
 static RET_STATE_t FatFS_Sync(FsWrap_File_t* pFile) {
 #if !FF_FS_READONLY
 	FRESULT res = f_sync(pFile->pFileHandler);
@@ -246,13 +668,14 @@ static RET_STATE_t FatFS_Mkdir(FsWrap_Mount_t* pMntPoint, const char* pPath) {
 static RET_STATE_t FatFS_OpenDir(FsWrap_Dir_t* pDir, const char* pPath) {
 	FRESULT res;
 
-	pDir->pDirHandler = MemWrap_Malloc(sizeof(DIR), __FILENAME__, __LINE__, MEM_ALLOC_UNLIM_TMO);
-	memset(pDir->pDirHandler, 0, sizeof(DIR));
+	pDir->pDirHandler = FatFS_Pool_Acquire(&FatFS_DirPool);
+	if (pDir->pDirHandler == NULL)
+		return RET_STATE_ERR_MEMORY;
 
 	res = f_opendir(pDir->pDirHandler, pPath);
 
 	if (res != FR_OK) {
-		MemWrap_Free(pDir->pDirHandler);
+		FatFS_Pool_Release(&FatFS_DirPool, pDir->pDirHandler);
 		pDir->pDirHandler = NULL;
 	}
 
@@ -280,7 +703,7 @@ static RET_STATE_t FatFS_CloseDir(FsWrap_Dir_t* pDir) {
 
 	res = f_closedir(pDir->pDirHandler);
 
-	MemWrap_Free(pDir->pDirHandler);
+	FatFS_Pool_Release(&FatFS_DirPool, pDir->pDirHandler);
 	pDir->pDirHandler = NULL;
 
 	return TranslateFsRetCode(res);
@@ -433,60 +856,66 @@ static RET_STATE_t FatFS_GetLabel(const char* pPath, char* pLabel, u32* pVsn) {
 
 #endif /* FF_USE_LABEL */
 
+/**
+ * @brief Only the volume of the mount point is locked, the other volumes and
+ * the system mutex (taken by path based calls) stay available
+ */
 static RET_STATE_t FatFS_Lock(FsWrap_Mount_t* pMntPoint) {
-	RET_STATE_t res;
+	FATFS* pFs = (FATFS*)pMntPoint->pFsData;
 
-	// Take all the volume mutexes
-	for (u32 i = 0; i < FF_VOLUMES; i++) {
-		res = ff_mutex_take(i);
-		if (res != 1) {
-			return RET_STATE_ERR_TIMEOUT;
-		}
-	}
+	return ff_mutex_take(pFs->ldrv) == 1 ? RET_STATE_SUCCESS : RET_STATE_ERR_TIMEOUT;
+}
 
-	// And the system one
-	res = ff_mutex_take(FF_VOLUMES);
+static RET_STATE_t FatFS_Unlock(FsWrap_Mount_t* pMntPoint) {
+	FATFS* pFs = (FATFS*)pMntPoint->pFsData;
 
-	return res == 1 ? RET_STATE_SUCCESS : RET_STATE_ERR_TIMEOUT;
+#if FF_USE_DIR_CACHE
+	/* the volume might have been changed by the USB host meanwhile */
+	ff_dircache_drop(pFs);
+#endif /* FF_USE_DIR_CACHE */
+	ff_mutex_give(pFs->ldrv);
+	return RET_STATE_SUCCESS;
 }
 
-static RET_STATE_t FatFS_Unlock(FsWrap_Mount_t* pMntPoint) {
-	// Take all the volume mutexes
-	for (u32 i = 0; i < FF_VOLUMES; i++) {
-		ff_mutex_give(i);
-	}
+static RET_STATE_t FatFS_PoolStats(FsWrap_PoolStats_t* pFileStats,
+								   FsWrap_PoolStats_t* pDirStats) {
+	SYS_CRITICAL_ON();
+	*pFileStats = FatFS_FilPool.Stats;
+	*pDirStats	= FatFS_DirPool.Stats;
+	SYS_CRITICAL_OFF();
 
-	// And the system one
-	ff_mutex_give(FF_VOLUMES);
 	return RET_STATE_SUCCESS;
 }
 
 /* File system interface */
 const FsWrap_FileSystem_t FsWrap_Fs_Fatfs = {
-	.open	  = FatFS_Open,
-	.close	  = FatFS_Close,
-	.read	  = FatFS_Read,
-	.write	  = FatFS_Write,
-	.lseek	  = FatFS_Seek,
-	.tell	  = FatFS_Tell,
-	.size	  = FatFS_Size,
-	.truncate = FatFS_Truncate,
-	.sync	  = FatFS_Sync,
-	.forward  = FatFS_Forward,
-	.opendir  = FatFS_OpenDir,
-	.readdir  = FatFS_ReadDir,
-	.closedir = FatFS_CloseDir,
-	.mount	  = FatFS_Mount,
-	.unmount  = FatFS_Unmount,
-	.unlink	  = FatFS_Unlink,
-	.rename	  = FatFS_Rename,
-	.mkdir	  = FatFS_Mkdir,
-	.stat	  = FatFS_Stat,
-	.statvfs  = FatFS_StatVFS,
-	.setlabel = FatFS_SetLabel,
-	.getlabel = FatFS_GetLabel,
-	.lock	  = FatFS_Lock,
-	.unlock	  = FatFS_Unlock,
+	.open		 = FatFS_Open,
+	.close		 = FatFS_Close,
+	.read		 = FatFS_Read,
+	.write		 = FatFS_Write,
+	.lseek		 = FatFS_Seek,
+	.tell		 = FatFS_Tell,
+	.size		 = FatFS_Size,
+	.clustsize	 = FatFS_ClustSize,
+	.truncate	 = FatFS_Truncate,
+	.preallocate = FatFS_Preallocate,
+	.sync		 = FatFS_Sync,
+	.forward	 = FatFS_Forward,
+	.opendir	 = FatFS_OpenDir,
+	.readdir	 = FatFS_ReadDir,
+	.closedir	 = FatFS_CloseDir,
+	.mount		 = FatFS_Mount,
+	.unmount	 = FatFS_Unmount,
+	.unlink		 = FatFS_Unlink,
+	.rename		 = FatFS_Rename,
+	.mkdir		 = FatFS_Mkdir,
+	.stat		 = FatFS_Stat,
+	.statvfs	 = FatFS_StatVFS,
+	.setlabel	 = FatFS_SetLabel,
+	.getlabel	 = FatFS_GetLabel,
+	.lock		 = FatFS_Lock,
+	.unlock		 = FatFS_Unlock,
+	.poolstats	 = FatFS_PoolStats,
 #if FS_FF_USE_MKFS
 	.mkfs = FatFS_Mkfs,
 #endif
@@ -0,0 +1,273 @@
+#define DEBUG_MODULE DBG_MOD_FS
+
+#include "fs_async.h"
+#include "debug.h"
+#include "rtos_analyzer.h"
+
+#define LOCAL_DEBUG_PRINT(_f_, ...)		DEBUG_TRACE_DO(DEBUG_PRINT_NL(_f_, ##__VA_ARGS__))
+#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)	DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
+
+static TaskHandle_t FsAsync_Handle;
+/* Sorted by priority, FIFO inside one priority */
+static FsWrap_AsyncReq_t* FsAsync_Queue[FS_ASYNC_QUEUE_SIZE];
+static u32 FsAsync_QueueNum;
+static FsWrap_AsyncStats_t FsAsync_Stats;
+
+/**
+ * @brief Queue helpers, called inside a critical section
+ */
+static bool FsAsync_QueueInsert(FsWrap_AsyncReq_t* pReq) {
+	if (FsAsync_QueueNum >= FS_ASYNC_QUEUE_SIZE)
+		return false;
+
+	u32 pos = FsAsync_QueueNum;
+	while (pos > 0 && FsAsync_Queue[pos - 1]->Prio < pReq->Prio) {
+		FsAsync_Queue[pos] = FsAsync_Queue[pos - 1];
+		pos--;
+	}
+	FsAsync_Queue[pos] = pReq;
+	FsAsync_QueueNum++;
+	return true;
+}
+
+static FsWrap_AsyncReq_t* FsAsync_QueueRemove(u32 pos) {
+	FsWrap_AsyncReq_t* pReq = FsAsync_Queue[pos];
+	for (u32 i = pos + 1; i < FsAsync_QueueNum; i++) {
+		FsAsync_Queue[i - 1] = FsAsync_Queue[i];
+	}
+	FsAsync_QueueNum--;
+	return pReq;
+}
+
+/**
+ * @brief Take the next request which continues @p pPrev: the same file and
+ * operation, starting at @p end. With @p end unknown (FS_ASYNC_OFFSET_CUR)
+ * only requests at the current position match. Any other request of the same
+ * file found first stops the search, so requests of one file are never reordered.
+ */
+static FsWrap_AsyncReq_t* FsAsync_QueueTakeAdjacent(const FsWrap_AsyncReq_t* pPrev, u32 end) {
+	for (u32 i = 0; i < FsAsync_QueueNum; i++) {
+		FsWrap_AsyncReq_t* pReq = FsAsync_Queue[i];
+		if (pReq->pFile != pPrev->pFile)
+			continue;
+
+		if (pReq->Op != pPrev->Op)
+			return NULL;
+
+		if (pReq->Op == FS_ASYNC_OP_SYNC || pReq->Offset == FS_ASYNC_OFFSET_CUR ||
+			(end != FS_ASYNC_OFFSET_CUR && pReq->Offset == end))
+			return FsAsync_QueueRemove(i);
+
+		return NULL;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Take the head request and the adjacent ones following it
+ * @retval Number of requests in @p ppBatch
+ */
+static u32 FsAsync_QueueTakeBatch(FsWrap_AsyncReq_t** ppBatch) {
+	u32 num = 0;
+
+	taskENTER_CRITICAL();
+	if (FsAsync_QueueNum) {
+		ppBatch[num++] = FsAsync_QueueRemove(0);
+
+		u32 end = ppBatch[0]->Offset;
+		while (num < FS_ASYNC_MERGE_MAX) {
+			if (end != FS_ASYNC_OFFSET_CUR)
+				end += ppBatch[num - 1]->Size;
+
+			FsWrap_AsyncReq_t* pNext = FsAsync_QueueTakeAdjacent(ppBatch[num - 1], end);
+			if (pNext == NULL)
+				break;
+
+			ppBatch[num++] = pNext;
+		}
+
+		for (u32 i = 0; i < num; i++) {
+			ppBatch[i]->State = FS_ASYNC_STATE_BUSY;
+		}
+		FsAsync_Stats.Merged += num - 1;
+		FsAsync_Stats.Depth	  = FsAsync_QueueNum;
+	}
+	taskEXIT_CRITICAL();
+
+	return num;
+}
+
+static void FsAsync_Complete(FsWrap_AsyncReq_t* pReq, RET_STATE_t res, u32 done) {
+	/* the request may be reused by its owner as soon as it is marked done */
+	FsWrap_AsyncClbk_t clbk = pReq->Clbk;
+	TaskHandle_t pOwner		= pReq->pOwner;
+
+	pReq->Result = res;
+	pReq->Done	 = done;
+	FsAsync_Stats.Completed++;
+	if (res != RET_STATE_SUCCESS)
+		FsAsync_Stats.Errors++;
+	pReq->State = FS_ASYNC_STATE_DONE;
+
+	if (clbk != NULL) {
+		clbk(pReq);
+	} else {
+		xTaskNotifyGiveIndexed(pOwner, FS_ASYNC_NOTIFY_IDX);
+	}
+}
+
+/**
+ * @brief Serve a batch of adjacent read or write requests. Requests whose
+ * buffers follow each other in memory go to the file system as one call.
+ */
+static void FsAsync_ServeData(FsWrap_AsyncReq_t** ppBatch, u32 num) {
+	FsWrap_File_t* pFile = ppBatch[0]->pFile;
+	bool isWrite		 = ppBatch[0]->Op == FS_ASYNC_OP_WRITE;
+
+	RET_STATE_t res = RET_STATE_SUCCESS;
+	if (ppBatch[0]->Offset != FS_ASYNC_OFFSET_CUR) {
+		res = FsWrap_Seek(pFile, (s32)ppBatch[0]->Offset, FS_SEEK_START);
+	}
+
+	u32 idx = 0;
+	while (idx < num) {
+		u8* pData = ppBatch[idx]->pData;
+		u32 size  = ppBatch[idx]->Size;
+		u32 last  = idx + 1;
+		while (last < num && (u8*)ppBatch[last]->pData == pData + size) {
+			size += ppBatch[last]->Size;
+			last++;
+		}
+
+		u32 done = 0;
+		if (res == RET_STATE_SUCCESS) {
+			res = isWrite ? FsWrap_Write(pFile, pData, size, &done)
+						  : FsWrap_Read(pFile, pData, size, &done);
+			LOCAL_DEBUG_LOG_PRINT("Op %d of %d reqs, size %d, done %d, res %d\r\n", isWrite,
+								  last - idx, size, done, res);
+		}
+
+		/* a short transfer is not an error, the following requests get nothing */
+		for (; idx < last; idx++) {
+			u32 reqDone = done < ppBatch[idx]->Size ? done : ppBatch[idx]->Size;
+			done	   -= reqDone;
+			FsAsync_Complete(ppBatch[idx], res, reqDone);
+		}
+	}
+}
+
+static void FsAsync_ServeSync(FsWrap_AsyncReq_t** ppBatch, u32 num) {
+	RET_STATE_t res = FsWrap_Sync(ppBatch[0]->pFile);
+	for (u32 i = 0; i < num; i++) {
+		FsAsync_Complete(ppBatch[i], res, 0);
+	}
+}
+
+static RET_STATE_t FsAsync_Submit(FsWrap_AsyncReq_t* pReq, FS_ASYNC_OP_t op) {
+	if (pReq == NULL || pReq->pFile == NULL || pReq->Prio >= FS_ASYNC_PRIO_ENUM_SIZE)
+		return RET_STATE_ERR_PARAM;
+
+	if (op != FS_ASYNC_OP_SYNC && (pReq->pData == NULL || pReq->Size == 0))
+		return RET_STATE_ERR_PARAM;
+
+	if (pReq->State == FS_ASYNC_STATE_QUEUED || pReq->State == FS_ASYNC_STATE_BUSY)
+		return RET_STATE_ERR_PARAM;
+
+	if (FsAsync_Handle == NULL)
+		return RET_STATE_ERROR;
+
+	pReq->Op	 = op;
+	pReq->Result = RET_STATE_UNDEF;
+	pReq->Done	 = 0;
+	pReq->pOwner = pReq->Clbk == NULL ? xTaskGetCurrentTaskHandle() : NULL;
+	pReq->State	 = FS_ASYNC_STATE_QUEUED;
+
+	taskENTER_CRITICAL();
+	bool queued = FsAsync_QueueInsert(pReq);
+	if (queued) {
+		FsAsync_Stats.Submitted++;
+		FsAsync_Stats.Depth = FsAsync_QueueNum;
+		if (FsAsync_QueueNum > FsAsync_Stats.DepthMax)
+			FsAsync_Stats.DepthMax = FsAsync_QueueNum;
+	} else {
+		FsAsync_Stats.Rejected++;
+		pReq->State = FS_ASYNC_STATE_IDLE;
+	}
+	taskEXIT_CRITICAL();
+
+	if (!queued)
+		return RET_STATE_ERR_BUSY;
+
+	xTaskNotifyGive(FsAsync_Handle);
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_ReadAsync(FsWrap_AsyncReq_t* pReq) {
+	return FsAsync_Submit(pReq, FS_ASYNC_OP_READ);
+}
+
+RET_STATE_t FsWrap_WriteAsync(FsWrap_AsyncReq_t* pReq) {
+	return FsAsync_Submit(pReq, FS_ASYNC_OP_WRITE);
+}
+
+RET_STATE_t FsWrap_SyncAsync(FsWrap_AsyncReq_t* pReq) {
+	return FsAsync_Submit(pReq, FS_ASYNC_OP_SYNC);
+}
+
+RET_STATE_t FsWrap_AsyncWait(FsWrap_AsyncReq_t* pReq, u32 tmo) {
+	if (pReq == NULL || pReq->Clbk != NULL || pReq->State == FS_ASYNC_STATE_IDLE)
+		return RET_STATE_ERR_PARAM;
+
+	TimeOut_t timeOut;
+	TickType_t ticksLeft = pdMS_TO_TICKS(tmo);
+	vTaskSetTimeOutState(&timeOut);
+
+	/* notifications of other requests of this task only cause one more check */
+	while (pReq->State != FS_ASYNC_STATE_DONE) {
+		if (xTaskCheckForTimeOut(&timeOut, &ticksLeft) == pdTRUE)
+			return RET_STATE_ERR_TIMEOUT;
+
+		ulTaskNotifyTakeIndexed(FS_ASYNC_NOTIFY_IDX, pdTRUE, ticksLeft);
+	}
+
+	return pReq->Result;
+}
+
+u32 FsWrap_AsyncGetFree(void) {
+	return FS_ASYNC_QUEUE_SIZE - FsAsync_QueueNum;
+}
+
+FsWrap_AsyncStats_t FsWrap_AsyncGetStats(void) {
+	taskENTER_CRITICAL();
+	FsWrap_AsyncStats_t stats = FsAsync_Stats;
+	taskEXIT_CRITICAL();
+	return stats;
+}
+
+static void vTask_FsAsync_Process(void* pvParameters) {
+	FsWrap_AsyncReq_t* batch[FS_ASYNC_MERGE_MAX];
+
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		u32 num;
+		while ((num = FsAsync_QueueTakeBatch(batch)) != 0) {
+			if (batch[0]->Op == FS_ASYNC_OP_SYNC) {
+				FsAsync_ServeSync(batch, num);
+			} else {
+				FsAsync_ServeData(batch, num);
+			}
+		}
+	}
+}
+
+void FreeRTOS_FsAsync_InitComponents(bool resources, bool tasks) {
+	if (resources) {
+	}
+
+	if (tasks) {
+		RTOS_Analyzer_CreateTask(vTask_FsAsync_Process, "fs-async", FS_ASYNC_TASK_STACK, NULL,
+								 FS_ASYNC_TASK_PRIORITY, &FsAsync_Handle);
+	}
+}
@@ -0,0 +1,141 @@
+#ifndef __FS_ASYNC_H
+#define __FS_ASYNC_H
+
+#include "fs_wrapper.h"
+#include "main.h"
+
+#define FS_ASYNC_QUEUE_SIZE 16
+#define FS_ASYNC_MERGE_MAX	8 // requests served by one worker pass
+#define FS_ASYNC_NOTIFY_IDX 2 // see configTASK_NOTIFICATION_ARRAY_ENTRIES
+
+/* Request offset to read or write at the current file position */
+#define FS_ASYNC_OFFSET_CUR 0xFFFFFFFF
+
+typedef enum {
+	FS_ASYNC_OP_READ = 0,
+	FS_ASYNC_OP_WRITE,
+	FS_ASYNC_OP_SYNC,
+} FS_ASYNC_OP_t;
+
+typedef enum {
+	FS_ASYNC_PRIO_LOW = 0,
+	FS_ASYNC_PRIO_NORMAL,
+	FS_ASYNC_PRIO_HIGH,
+
+	FS_ASYNC_PRIO_ENUM_SIZE
+} FS_ASYNC_PRIO_t;
+
+typedef enum {
+	FS_ASYNC_STATE_IDLE = 0,
+	FS_ASYNC_STATE_QUEUED,
+	FS_ASYNC_STATE_BUSY,
+	FS_ASYNC_STATE_DONE,
+} FS_ASYNC_STATE_t;
+
+typedef struct fs_async_req_s FsWrap_AsyncReq_t;
+typedef void (*FsWrap_AsyncClbk_t)(FsWrap_AsyncReq_t* pReq);
+
+/**
+ * @brief Asynchronous request, owned by the caller and not copied by the queue.
+ * The object and the data buffer must stay valid until the request is done.
+ */
+struct fs_async_req_s {
+	/* Filled by the caller */
+	FsWrap_File_t* pFile;
+	void* pData;
+	u32 Offset; // FS_ASYNC_OFFSET_CUR for the current file position
+	u32 Size;
+	FS_ASYNC_PRIO_t Prio;
+	FsWrap_AsyncClbk_t Clbk; // NULL to notify the submitting task instead
+	void* pCtx;
+	/* The following fields are filled by the async core */
+	FS_ASYNC_OP_t Op;
+	volatile FS_ASYNC_STATE_t State;
+	RET_STATE_t Result;
+	u32 Done; // bytes transferred
+	TaskHandle_t pOwner;
+};
+
+typedef struct {
+	u32 Submitted;
+	u32 Completed;
+	u32 Merged;	  // requests served together with a previous one
+	u32 Rejected; // queue full
+	u32 Errors;
+	u32 Depth;
+	u32 DepthMax;
+} FsWrap_AsyncStats_t;
+
+/**
+ * @brief Queue a file read
+ *
+ * Reads up to @p pReq->Size bytes at @p pReq->Offset to @p pReq->pData in the
+ * storage worker task. The file position is left after the read data.
+ * Requests of one priority are served in the order of submission, requests of
+ * a higher priority overtake them. Adjacent reads of the same file are served
+ * by one worker pass with a single seek.
+ *
+ * @param pReq Pointer to the request with the caller fields filled
+ *
+ * @retval RET_STATE_SUCCESS when queued;
+ * @retval RET_STATE_ERR_PARAM on a bad request or a request still in progress;
+ * @retval RET_STATE_ERR_BUSY when the queue is full, the caller should back off;
+ * @retval RET_STATE_ERROR when the worker is not running.
+ */
+RET_STATE_t FsWrap_ReadAsync(FsWrap_AsyncReq_t* pReq);
+
+/**
+ * @brief Queue a file write
+ *
+ * The same as FsWrap_ReadAsync() for writing. Adjacent writes whose buffers
+ * follow each other in memory are passed to FsWrap_Write() as one transfer.
+ *
+ * @param pReq Pointer to the request with the caller fields filled
+ *
+ * @retval See FsWrap_ReadAsync()
+ */
+RET_STATE_t FsWrap_WriteAsync(FsWrap_AsyncReq_t* pReq);
+
+/**
+ * @brief Queue a file sync
+ *
+ * Only @p pReq->pFile, @p pReq->Prio and the completion fields are used.
+ * Consecutive syncs of the same file are served by one FsWrap_Sync() call.
+ *
+ * @param pReq Pointer to the request with the caller fields filled
+ *
+ * @retval See FsWrap_ReadAsync()
+ */
+RET_STATE_t FsWrap_SyncAsync(FsWrap_AsyncReq_t* pReq);
+
+/**
+ * @brief Wait for a request queued without a callback
+ *
+ * Must be called from the task which submitted the request.
+ *
+ * @param pReq Pointer to the request
+ * @param tmo Timeout in ms
+ *
+ * @retval The request result when done;
+ * @retval RET_STATE_ERR_TIMEOUT when the request is still in progress;
+ * @retval RET_STATE_ERR_PARAM for a request with a callback or never submitted.
+ */
+RET_STATE_t FsWrap_AsyncWait(FsWrap_AsyncReq_t* pReq, u32 tmo);
+
+/**
+ * @brief Get free queue slots
+ *
+ * @retval Number of requests which can be queued at the moment.
+ */
+u32 FsWrap_AsyncGetFree(void);
+
+/**
+ * @brief Get async queue statistics
+ *
+ * @retval Request counters since start and the queue depth.
+ */
+FsWrap_AsyncStats_t FsWrap_AsyncGetStats(void);
+
+void FreeRTOS_FsAsync_InitComponents(bool resources, bool tasks);
+
+#endif /* __FS_ASYNC_H */
@@ -0,0 +1,138 @@
+#define DEBUG_MODULE DBG_MOD_FS
+
+#include "fs_walk.h"
+#include "debug.h"
+
+#define LOCAL_DEBUG_PRINT(_f_, ...)		DEBUG_TRACE_DO(DEBUG_PRINT_NL(_f_, ##__VA_ARGS__))
+#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)	DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
+
+static bool FsWalk_IsDotEntry(const char* pName) {
+	return pName[0] == '.' && (pName[1] == 0 || (pName[1] == '.' && pName[2] == 0));
+}
+
+/**
+ * @brief reads the next visible entry of the frame directory ahead
+ */
+static RET_STATE_t FsWalk_ReadAhead(FsWrap_WalkFrame_t* pFrame, const FsWrap_WalkCfg_t* pCfg) {
+	pFrame->HasNext = false;
+
+	for (;;) {
+		RET_STATE_t res = FsWrap_ReadDir(&pFrame->Dir, &pFrame->Next);
+		if (res != RET_STATE_SUCCESS)
+			return res;
+
+		if (pFrame->Next.Name[0] == 0)
+			return RET_STATE_SUCCESS;
+
+		if (FsWalk_IsDotEntry(pFrame->Next.Name))
+			continue;
+
+		if (pCfg->Filter != NULL && !pCfg->Filter(&pFrame->Next, pCfg->pCtx))
+			continue;
+
+		pFrame->HasNext = true;
+		return RET_STATE_SUCCESS;
+	}
+}
+
+static RET_STATE_t FsWalk_Enter(FsWrap_Walk_t* pWalk, u32 depth, const FsWrap_WalkCfg_t* pCfg) {
+	FsWrap_WalkFrame_t* pFrame = &pWalk->Frames[depth];
+
+	memset(&pFrame->Dir, 0, sizeof(pFrame->Dir));
+	pFrame->PathLen = strnlen(pWalk->Path, FS_MAX_FILE_NAME);
+	pFrame->HasNext = false;
+
+	RET_STATE_t res = FsWrap_OpenDir(&pFrame->Dir, pWalk->Path);
+	if (res != RET_STATE_SUCCESS) {
+		LOCAL_DEBUG_LOG_PRINT("Open '%s' failed, %s\r\n", pWalk->Path, RetState_GetStr(res));
+		return res;
+	}
+
+	res = FsWalk_ReadAhead(pFrame, pCfg);
+	if (res != RET_STATE_SUCCESS)
+		FsWrap_CloseDir(&pFrame->Dir);
+
+	return res;
+}
+
+RET_STATE_t FsWrap_Walk(FsWrap_Walk_t* pWalk, const char* pPath, const FsWrap_WalkCfg_t* pCfg) {
+	if (pWalk == NULL || pPath == NULL || pCfg == NULL || pCfg->Visitor == NULL)
+		return RET_STATE_ERR_PARAM;
+
+	if (strnlen(pPath, FS_MAX_FILE_NAME + 1) > FS_MAX_FILE_NAME)
+		return RET_STATE_ERR_PARAM;
+
+	u32 maxDepth = pCfg->MaxDepth;
+	if (maxDepth == 0 || maxDepth > FS_WALK_DEPTH_MAX)
+		maxDepth = FS_WALK_DEPTH_MAX;
+
+	strcpy(pWalk->Path, pPath);
+	RET_STATE_t res = FsWalk_Enter(pWalk, 0, pCfg);
+	if (res != RET_STATE_SUCCESS)
+		return res;
+
+	u32 openNum	 = 1; // frames with an open directory
+	u32 lastMask = 0;
+
+	while (openNum) {
+		u32 depth				   = openNum - 1;
+		FsWrap_WalkFrame_t* pFrame = &pWalk->Frames[depth];
+
+		if (!pFrame->HasNext) {
+			FsWrap_CloseDir(&pFrame->Dir);
+			openNum--;
+			if (openNum)
+				pWalk->Path[pWalk->Frames[openNum - 1].PathLen] = 0;
+			continue;
+		}
+
+		pWalk->Curr = pFrame->Next;
+		res			= FsWalk_ReadAhead(pFrame, pCfg);
+		if (res != RET_STATE_SUCCESS)
+			break;
+
+		u32 nameLen = strlen(pWalk->Curr.Name);
+		if (pFrame->PathLen + 1 + nameLen > FS_MAX_FILE_NAME) {
+			LOCAL_DEBUG_LOG_PRINT("Path too long: %s/%s\r\n", pWalk->Path, pWalk->Curr.Name);
+			continue;
+		}
+
+		pWalk->Path[pFrame->PathLen] = '/';
+		memcpy(&pWalk->Path[pFrame->PathLen + 1], pWalk->Curr.Name, nameLen + 1);
+
+		bool isLast = !pFrame->HasNext;
+		lastMask	= isLast ? (lastMask | (1UL << depth)) : (lastMask & ~(1UL << depth));
+
+		FsWrap_WalkEntry_t entry = {
+			.pPath	  = pWalk->Path,
+			.pEntry	  = &pWalk->Curr,
+			.Depth	  = depth,
+			.IsLast	  = isLast,
+			.LastMask = lastMask,
+			.pCtx	  = pCfg->pCtx,
+		};
+
+		FS_WALK_t action = pCfg->Visitor(&entry);
+		if (action == FS_WALK_STOP)
+			break;
+
+		if (action == FS_WALK_CONTINUE && (pWalk->Curr.Type & FS_DIR_ENTRY_DIR) &&
+			openNum < maxDepth) {
+			res = FsWalk_Enter(pWalk, openNum, pCfg);
+			if (res != RET_STATE_SUCCESS)
+				break;
+
+			openNum++;
+			continue;
+		}
+
+		pWalk->Path[pFrame->PathLen] = 0;
+	}
+
+	/* stopped or failed, close what is still open */
+	while (openNum) {
+		FsWrap_CloseDir(&pWalk->Frames[--openNum].Dir);
+	}
+
+	return res;
+}
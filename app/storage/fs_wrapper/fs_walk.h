@@ -0,0 +1,72 @@
+#ifndef __FS_WALK_H
+#define __FS_WALK_H
+
+#include "fs_wrapper.h"
+#include "main.h"
+
+/* Directory levels kept open at once, deeper directories are not descended */
+#define FS_WALK_DEPTH_MAX 8
+
+typedef enum {
+	FS_WALK_CONTINUE = 0,
+	FS_WALK_SKIP, // do not descend into the visited directory
+	FS_WALK_STOP,
+} FS_WALK_t;
+
+typedef struct {
+	const char* pPath; // full path of the entry
+	const FsWrap_DirEnt_t* pEntry;
+	u32 Depth;	  // 0 for the entries of the walk root
+	bool IsLast;  // the last visible entry of its directory
+	u32 LastMask; // bit N is set when the ancestor at depth N is the last one
+	void* pCtx;
+} FsWrap_WalkEntry_t;
+
+typedef FS_WALK_t (*FsWrap_WalkVisitor_t)(const FsWrap_WalkEntry_t* pEntry);
+/* Returns false to hide the entry, a hidden directory is not descended */
+typedef bool (*FsWrap_WalkFilter_t)(const FsWrap_DirEnt_t* pEntry, void* pCtx);
+
+typedef struct {
+	FsWrap_WalkVisitor_t Visitor;
+	FsWrap_WalkFilter_t Filter; // NULL to visit every entry
+	u32 MaxDepth;				// 0 or above FS_WALK_DEPTH_MAX for FS_WALK_DEPTH_MAX
+	void* pCtx;
+} FsWrap_WalkCfg_t;
+
+typedef struct {
+	FsWrap_Dir_t Dir;
+	FsWrap_DirEnt_t Next; // lookahead entry, valid when HasNext is set
+	u32 PathLen;
+	bool HasNext;
+} FsWrap_WalkFrame_t;
+
+/**
+ * @brief Walk state, owned by the caller and reusable between walks. Too
+ * big for a task stack, it is expected to be static or allocated once.
+ */
+typedef struct {
+	FsWrap_WalkFrame_t Frames[FS_WALK_DEPTH_MAX];
+	FsWrap_DirEnt_t Curr;
+	char Path[FS_MAX_FILE_NAME + 1];
+} FsWrap_Walk_t;
+
+/**
+ * @brief Walk a directory tree
+ *
+ * Visits the entries below @p pPath in the depth-first order, every
+ * directory is opened and read once. "." and ".." entries are never
+ * visited. One entry of every open directory is read ahead, so the visitor
+ * knows whether the entry is the last one without a counting pass.
+ * Entries with a path longer than FS_MAX_FILE_NAME are skipped.
+ *
+ * @param pWalk Pointer to the walk state
+ * @param pPath Path of the root directory
+ * @param pCfg Pointer to the walk configuration
+ *
+ * @retval RET_STATE_SUCCESS when the tree was walked or stopped by the visitor;
+ * @retval RET_STATE_ERR_PARAM on a bad argument;
+ * @retval RET_STATE_ERROR or an other errno code from FsWrap_OpenDir()/FsWrap_ReadDir().
+ */
+RET_STATE_t FsWrap_Walk(FsWrap_Walk_t* pWalk, const char* pPath, const FsWrap_WalkCfg_t* pCfg);
+
+#endif /* __FS_WALK_H */
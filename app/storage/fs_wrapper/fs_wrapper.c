@@ -1,20 +1,17 @@
+#define DEBUG_MODULE DBG_MOD_FS
+
 #include "fs_wrapper.h"
 #include "debug.h"
 #include "linked_list.h"
+#include "mem_wrapper.h"
 
 #define FS_WRAP_MAX_TIMEOUT portMAX_DELAY
 
 #if DEBUG_ENABLE
-#define LOCAL_DEBUG_PRINT_ENABLE 0
-#define LOCAL_DEBUG_TEST_ENABLE	 0
+#define LOCAL_DEBUG_TEST_ENABLE 0
 #endif /* DEBUG_ENABLE */
 
-#if LOCAL_DEBUG_PRINT_ENABLE
-#warning LOCAL_DEBUG_PRINT_ENABLE
-#define LOCAL_DEBUG_PRINT DEBUG_LOG_PRINT
-#else /* LOCAL_DEBUG_PRINT_ENABLE */
-#define LOCAL_DEBUG_PRINT(_f_, ...)
-#endif /* LOCAL_DEBUG_PRINT_ENABLE */
+#define LOCAL_DEBUG_PRINT(_f_, ...) DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
 
 #if LOCAL_DEBUG_TEST_ENABLE
 #warning LOCAL_DEBUG_TEST_ENABLE
@@ -30,6 +27,11 @@ typedef struct {
 static FsWrap_RegistryEntry_t Registry[FS_TYPE_ENUM_SIZE];
 
 static LinkedList_Handle_t MountList;
+/* "N:" drive mounts resolved without the list, see FsWrapper_GetDriveIdx() */
+static FsWrap_Mount_t* volatile DriveTable[FS_MOUNT_DRIVES_MAX];
+static volatile u32 NotDriveMountsNum;
+
+static FsWrap_Stats_t FsWrap_Stats;
 
 static inline bool FsWrapper_FunctionIsNotImplemented(void* pFunc, char* pFuncName) {
 	if (!pFunc) {
@@ -65,18 +67,20 @@ static RET_STATE_t FsRegistry_Add(FS_TYPE_t type, const FsWrap_FileSystem_t* pFs
 }
 
 static FsWrap_RegistryEntry_t* FsRegistry_Find(FS_TYPE_t type) {
+	FsWrap_RegistryEntry_t* pFound = NULL;
 
 	SYS_CRITICAL_ON();
 	for (u32 i = 0; i < NUM_ELEMENTS(Registry); ++i) {
 		FsWrap_RegistryEntry_t* pRegEntry = &Registry[i];
 
 		if ((pRegEntry->pFs != NULL) && (pRegEntry->Type == type)) {
-			return pRegEntry;
+			pFound = pRegEntry;
+			break;
 		}
 	}
 	SYS_CRITICAL_OFF();
 
-	return NULL;
+	return pFound;
 }
 
 static const FsWrap_FileSystem_t* FsRegistry_GetType(FS_TYPE_t type) {
@@ -85,26 +89,54 @@ static const FsWrap_FileSystem_t* FsRegistry_GetType(FS_TYPE_t type) {
 	return (pRegEntry != NULL) ? pRegEntry->pFs : NULL;
 }
 
+/**
+ * @brief Drive index of a path in FatFS "N:" form, or -1 for any other path
+ */
+static inline s32 FsWrapper_GetDriveIdx(const char* pPath) {
+	if (pPath[0] >= '0' && pPath[0] < '0' + FS_MOUNT_DRIVES_MAX && pPath[1] == ':')
+		return pPath[0] - '0';
+
+	return -1;
+}
+
 static RET_STATE_t Fs_GetMntPoint(FsWrap_Mount_t** ppMnt, const char* pName, u32* pMatchLen,
 								  u32* pNodeId) {
 
+	/* Drive prefix can't be shadowed by a longer mount path, so take it directly */
+	s32 driveIdx = FsWrapper_GetDriveIdx(pName);
+	if (driveIdx >= 0 && pNodeId == NULL && NotDriveMountsNum == 0) {
+		FsWrap_Mount_t* pMntPt = DriveTable[driveIdx];
+		if (pMntPt == NULL) {
+			return RET_STATE_ERROR;
+		}
+
+		*ppMnt = pMntPt;
+		if (pMatchLen) {
+			*pMatchLen = pMntPt->MntPointSize;
+		}
+
+		return RET_STATE_SUCCESS;
+	}
+
 	RET_STATE_t res = LinkedList_ReadWriteLock(&MountList, FS_WRAP_MAX_TIMEOUT, NULL);
 	if (res != RET_STATE_SUCCESS) {
 		LOCAL_DEBUG_PRINT("Unable to lock MountList");
 		return res;
 	}
 
-	u32 nameLen			   = strlen(pName);
-	u32 longestMatch	   = 0;
-	FsWrap_Mount_t* pMntPt = NULL;
-	u32 nodes			   = LinkedList_GetNodesNum(&MountList);
+	u32 nameLen				= strlen(pName);
+	u32 longestMatch		= 0;
+	FsWrap_Mount_t* pMntPt	= NULL;
+	FsWrap_Mount_t* pBestPt = NULL;
+	u32 nodes				= LinkedList_GetNodesNum(&MountList);
 	for (u32 i = 0; i < nodes; i++) {
 		res = LinkedList_GetDataPtr(&MountList, (void**)&pMntPt, NULL, i);
 		if (res != RET_STATE_SUCCESS) {
+			LinkedList_ReadWriteUnlock(&MountList);
 			return res;
 		}
 
-		u32 len = strlen(pMntPt->pMntPointPath);
+		u32 len = pMntPt->MntPointSize;
 		/*
 		 * Move to next node if mount point length is
 		 * shorter than longestMatch match or if path
@@ -117,6 +149,7 @@ static RET_STATE_t Fs_GetMntPoint(FsWrap_Mount_t** ppMnt, const char* pName, u32
 		/* Check for mount point match */
 		if (strncmp(pName, pMntPt->pMntPointPath, len) == 0) {
 			longestMatch = len;
+			pBestPt		 = pMntPt;
 			if (pNodeId) {
 				*pNodeId = i;
 			}
@@ -124,13 +157,13 @@ static RET_STATE_t Fs_GetMntPoint(FsWrap_Mount_t** ppMnt, const char* pName, u32
 	}
 	LinkedList_ReadWriteUnlock(&MountList);
 
-	if (pMntPt == NULL) {
+	if (pBestPt == NULL) {
 		return RET_STATE_ERROR;
 	}
 
-	*ppMnt = pMntPt;
+	*ppMnt = pBestPt;
 	if (pMatchLen) {
-		*pMatchLen = pMntPt->MntPointSize;
+		*pMatchLen = pBestPt->MntPointSize;
 	}
 
 	return RET_STATE_SUCCESS;
@@ -145,6 +178,147 @@ static inline RET_STATE_t FsWrapper_GetMntPoint(FsWrap_Mount_t** ppMntPt, const
 	return retState;
 }
 
+static inline RET_STATE_t FsWrapper_BackendRead(FsWrap_File_t* pFile, void* pData, u32 size,
+												u32* pBytesRd) {
+	FsWrap_Stats.BackendReads++;
+	return pFile->pMntPoint->pFs->read(pFile, pData, size, pBytesRd);
+}
+
+static inline RET_STATE_t FsWrapper_BackendWrite(FsWrap_File_t* pFile, const void* pData,
+												 u32 size, u32* pBytesWr) {
+	FsWrap_Stats.BackendWrites++;
+	return pFile->pMntPoint->pFs->write(pFile, pData, size, pBytesWr);
+}
+
+/**
+ * @brief Write out buffered data or give back read ahead data, so the
+ * back-end file position matches the stream position again
+ */
+static RET_STATE_t FsWrapper_BuffDrain(FsWrap_File_t* pFile) {
+	FsWrap_FileBuff_t* pBuff = &pFile->Buff;
+	RET_STATE_t retState	 = RET_STATE_SUCCESS;
+
+	if (pBuff->IsDirty) {
+		u32 wr	 = 0;
+		retState = FsWrapper_BackendWrite(pFile, pBuff->pData, pBuff->Len, &wr);
+		if (retState == RET_STATE_SUCCESS && wr < pBuff->Len) {
+			/* volume is full, keep the rest for the next attempt */
+			memmove(pBuff->pData, &pBuff->pData[wr], pBuff->Len - wr);
+			pBuff->Len -= wr;
+			return RET_STATE_ERR_OVERFLOW;
+		}
+	} else if (pBuff->Pos < pBuff->Len) {
+		if (!FsWrapper_FunctionIsNotImplemented(pFile->pMntPoint->pFs->lseek, "lseek"))
+			return RET_STATE_ERROR;
+
+		retState = pFile->pMntPoint->pFs->lseek(pFile, -(s32)(pBuff->Len - pBuff->Pos),
+												 FS_SEEK_CUR);
+	}
+
+	if (retState != RET_STATE_SUCCESS) {
+		LOCAL_DEBUG_PRINT("Buffer drain failed, %s", RetState_GetStr(retState));
+		return retState;
+	}
+
+	pBuff->Len	   = 0;
+	pBuff->Pos	   = 0;
+	pBuff->IsDirty = false;
+	return retState;
+}
+
+static RET_STATE_t FsWrapper_BuffRead(FsWrap_File_t* pFile, u8* pData, u32 size, u32* pBytesRd) {
+	FsWrap_FileBuff_t* pBuff = &pFile->Buff;
+	RET_STATE_t retState	 = RET_STATE_SUCCESS;
+	bool isBackendUsed		 = false;
+
+	*pBytesRd = 0;
+
+	if (pBuff->IsDirty) {
+		retState = FsWrapper_BuffDrain(pFile);
+		if (retState != RET_STATE_SUCCESS)
+			return retState;
+	}
+
+	while (size) {
+		if (pBuff->Pos < pBuff->Len) {
+			u32 chunk = GET_MIN(size, pBuff->Len - pBuff->Pos);
+			memcpy(pData, &pBuff->pData[pBuff->Pos], chunk);
+			pBuff->Pos += chunk;
+			pData += chunk;
+			size -= chunk;
+			*pBytesRd += chunk;
+			continue;
+		}
+
+		u32 rd = 0;
+		if (size >= pBuff->BypassSize) {
+			FsWrap_Stats.BypassReads++;
+			retState = FsWrapper_BackendRead(pFile, pData, size, &rd);
+			*pBytesRd += rd;
+			return retState;
+		}
+
+		isBackendUsed = true;
+		retState	  = FsWrapper_BackendRead(pFile, pBuff->pData, pBuff->Size, &rd);
+		pBuff->Len	  = rd;
+		pBuff->Pos	  = 0;
+		if (retState != RET_STATE_SUCCESS || rd == 0)
+			break;
+	}
+
+	if (!isBackendUsed)
+		FsWrap_Stats.BuffReads++;
+
+	return retState;
+}
+
+static RET_STATE_t FsWrapper_BuffWrite(FsWrap_File_t* pFile, const u8* pData, u32 size,
+									   u32* pBytesWr) {
+	FsWrap_FileBuff_t* pBuff = &pFile->Buff;
+	RET_STATE_t retState	 = RET_STATE_SUCCESS;
+	bool isBackendUsed		 = false;
+
+	*pBytesWr = 0;
+
+	/* switching from reading to writing gives back the read ahead data */
+	if (!pBuff->IsDirty && pBuff->Len) {
+		retState = FsWrapper_BuffDrain(pFile);
+		if (retState != RET_STATE_SUCCESS)
+			return retState;
+	}
+
+	if (size >= pBuff->BypassSize) {
+		retState = FsWrapper_BuffDrain(pFile);
+		if (retState != RET_STATE_SUCCESS)
+			return retState;
+
+		FsWrap_Stats.BypassWrites++;
+		return FsWrapper_BackendWrite(pFile, pData, size, pBytesWr);
+	}
+
+	while (size) {
+		u32 chunk = GET_MIN(size, pBuff->Size - pBuff->Len);
+		memcpy(&pBuff->pData[pBuff->Len], pData, chunk);
+		pBuff->Len += chunk;
+		pBuff->IsDirty = true;
+		pData += chunk;
+		size -= chunk;
+		*pBytesWr += chunk;
+
+		if (pBuff->Len == pBuff->Size) {
+			isBackendUsed = true;
+			retState	  = FsWrapper_BuffDrain(pFile);
+			if (retState != RET_STATE_SUCCESS)
+				return retState;
+		}
+	}
+
+	if (!isBackendUsed)
+		FsWrap_Stats.BuffWrites++;
+
+	return retState;
+}
+
 RET_STATE_t FsWrap_Init(void) {
 	RET_STATE_t retState = LinkedList_Create(&MountList, xTaskGetTickCount, vTaskDelay);
 	if (retState != RET_STATE_SUCCESS) {
@@ -272,6 +446,12 @@ RET_STATE_t FsWrap_Open(FsWrap_File_t* pFile, const char* pPath, u32 flags) {
 		}
 	}
 
+	if ((flags & FS_MODE_PREALLOCATE) != 0 && pMntPt->pFs->preallocate != NULL) {
+		/* Not fatal, the file is just extended cluster by cluster */
+		if (pMntPt->pFs->preallocate(pFile, FS_PREALLOC_SIZE_DEF, true) == RET_STATE_ERROR)
+			LOCAL_DEBUG_PRINT("Preallocate error");
+	}
+
 	return retState;
 }
 
@@ -292,6 +472,12 @@ RET_STATE_t FsWrap_Close(FsWrap_File_t* pFile) {
 	if (!FsWrapper_FunctionIsNotImplemented(pFile->pMntPoint->pFs->close, "close"))
 		return RET_STATE_ERROR;
 
+	/* the file is closed anyway, buffered data lost on error is reported */
+	RET_STATE_t drainState = FsWrapper_BuffDrain(pFile);
+	if (pFile->Buff.pData != NULL)
+		MemWrap_Free(pFile->Buff.pData);
+	memset(&pFile->Buff, 0, sizeof(pFile->Buff));
+
 	RET_STATE_t retState = pFile->pMntPoint->pFs->close(pFile);
 	if (retState != RET_STATE_SUCCESS) {
 		LOCAL_DEBUG_PRINT("Unlock failed, %s", RetState_GetStr(retState));
@@ -300,7 +486,55 @@ RET_STATE_t FsWrap_Close(FsWrap_File_t* pFile) {
 
 	pFile->pMntPoint = NULL;
 
-	return retState;
+	return drainState != RET_STATE_SUCCESS ? drainState : retState;
+}
+
+RET_STATE_t FsWrap_SetBuff(FsWrap_File_t* pFile, u32 size) {
+
+	ASSERT_CHECK(pFile != NULL);
+
+	if (pFile == NULL) {
+		LOCAL_DEBUG_PRINT("Incorrect file handle");
+		return RET_STATE_ERR_PARAM;
+	}
+
+	if (pFile->pMntPoint == NULL) {
+		LOCAL_DEBUG_PRINT("Wrong mount point");
+		return RET_STATE_ERR_PARAM;
+	}
+
+	RET_STATE_t retState = FsWrapper_BuffDrain(pFile);
+	if (retState != RET_STATE_SUCCESS)
+		return retState;
+
+	if (pFile->Buff.pData != NULL)
+		MemWrap_Free(pFile->Buff.pData);
+	memset(&pFile->Buff, 0, sizeof(pFile->Buff));
+
+	if (size == 0)
+		return RET_STATE_SUCCESS;
+
+	pFile->Buff.pData = MemWrap_Malloc(size, __FILENAME__, __LINE__, MEM_ALLOC_UNLIM_TMO);
+	if (pFile->Buff.pData == NULL) {
+		LOCAL_DEBUG_PRINT("Unable to allocate stream buffer");
+		return RET_STATE_ERR_MEMORY;
+	}
+
+	/* a transfer not shorter than a cluster or the buffer gains nothing from copying */
+	u32 clustSize = 0;
+	if (pFile->pMntPoint->pFs->clustsize == NULL ||
+		pFile->pMntPoint->pFs->clustsize(pFile, &clustSize) != RET_STATE_SUCCESS ||
+		clustSize == 0)
+		clustSize = size;
+
+	pFile->Buff.Size	   = size;
+	pFile->Buff.BypassSize = GET_MIN(clustSize, size);
+
+	return RET_STATE_SUCCESS;
+}
+
+FsWrap_Stats_t FsWrap_GetStats(void) {
+	return FsWrap_Stats;
 }
 
 RET_STATE_t FsWrap_Unlink(const char* pPath) {
@@ -390,7 +624,9 @@ RET_STATE_t FsWrap_Read(FsWrap_File_t* pFile, void* pData, u32 size, u32* pBytes
 	if (!FsWrapper_FunctionIsNotImplemented(pFile->pMntPoint->pFs->read, "read"))
 		return RET_STATE_ERROR;
 
-	RET_STATE_t retState = pFile->pMntPoint->pFs->read(pFile, pData, size, pBytesRd);
+	RET_STATE_t retState = pFile->Buff.pData != NULL
+							   ? FsWrapper_BuffRead(pFile, pData, size, pBytesRd)
+							   : FsWrapper_BackendRead(pFile, pData, size, pBytesRd);
 	if (retState != RET_STATE_SUCCESS) {
 		LOCAL_DEBUG_PRINT("Read failed, %s", RetState_GetStr(retState));
 		return retState;
@@ -417,7 +653,9 @@ RET_STATE_t FsWrap_Write(FsWrap_File_t* pFile, const void* pData, u32 size, u32*
 	if (!FsWrapper_FunctionIsNotImplemented(pFile->pMntPoint->pFs->write, "write"))
 		return RET_STATE_ERROR;
 
-	RET_STATE_t retState = pFile->pMntPoint->pFs->write(pFile, pData, size, pBytesWr);
+	RET_STATE_t retState = pFile->Buff.pData != NULL
+							   ? FsWrapper_BuffWrite(pFile, pData, size, pBytesWr)
+							   : FsWrapper_BackendWrite(pFile, pData, size, pBytesWr);
 	if (retState != RET_STATE_SUCCESS) {
 		LOCAL_DEBUG_PRINT("Write failed, %s", RetState_GetStr(retState));
 		return retState;
@@ -443,7 +681,11 @@ RET_STATE_t FsWrap_Seek(FsWrap_File_t* pFile, s32 offset, FS_SEEK_t whence) {
 	if (!FsWrapper_FunctionIsNotImplemented(pFile->pMntPoint->pFs->lseek, "lseek"))
 		return RET_STATE_ERROR;
 
-	RET_STATE_t retState = pFile->pMntPoint->pFs->lseek(pFile, offset, whence);
+	RET_STATE_t retState = FsWrapper_BuffDrain(pFile);
+	if (retState != RET_STATE_SUCCESS)
+		return retState;
+
+	retState = pFile->pMntPoint->pFs->lseek(pFile, offset, whence);
 	if (retState != RET_STATE_SUCCESS) {
 		LOCAL_DEBUG_PRINT("Seek failed, %s", RetState_GetStr(retState));
 		return retState;
@@ -475,6 +717,12 @@ RET_STATE_t FsWrap_Tell(FsWrap_File_t* pFile, u32* pPos) {
 		return retState;
 	}
 
+	/* the back-end position does not include the stream buffer contents */
+	if (pFile->Buff.IsDirty)
+		*pPos += pFile->Buff.Len;
+	else
+		*pPos -= pFile->Buff.Len - pFile->Buff.Pos;
+
 	return retState;
 }
 
@@ -495,9 +743,15 @@ RET_STATE_t FsWrap_Size(FsWrap_File_t* pFile, u32* pSize) {
 	if (!FsWrapper_FunctionIsNotImplemented(pFile->pMntPoint->pFs->size, "size"))
 		return RET_STATE_ERROR;
 
+	if (pFile->Buff.IsDirty) {
+		RET_STATE_t retState = FsWrapper_BuffDrain(pFile);
+		if (retState != RET_STATE_SUCCESS)
+			return retState;
+	}
+
 	RET_STATE_t rc = pFile->pMntPoint->pFs->size(pFile, pSize);
 	if (rc != RET_STATE_SUCCESS) {
-		LOCAL_DEBUG_PRINT("Size failed, %s", RetState_GetStr(retState));
+		LOCAL_DEBUG_PRINT("Size failed, %s", RetState_GetStr(rc));
 		return rc;
 	}
 
@@ -521,7 +775,11 @@ RET_STATE_t FsWrap_Truncate(FsWrap_File_t* pFile, u32 length) {
 	if (!FsWrapper_FunctionIsNotImplemented(pFile->pMntPoint->pFs->truncate, "truncate"))
 		return RET_STATE_ERROR;
 
-	RET_STATE_t retState = pFile->pMntPoint->pFs->truncate(pFile, length);
+	RET_STATE_t retState = FsWrapper_BuffDrain(pFile);
+	if (retState != RET_STATE_SUCCESS)
+		return retState;
+
+	retState = pFile->pMntPoint->pFs->truncate(pFile, length);
 	if (retState != RET_STATE_SUCCESS) {
 		LOCAL_DEBUG_PRINT("Truncate failed, %s", RetState_GetStr(retState));
 		return retState;
@@ -530,6 +788,36 @@ RET_STATE_t FsWrap_Truncate(FsWrap_File_t* pFile, u32 length) {
 	return retState;
 }
 
+RET_STATE_t FsWrap_Preallocate(FsWrap_File_t* pFile, u32 bytesNum, bool isContiguous) {
+
+	ASSERT_CHECK(pFile != NULL);
+
+	if (pFile == NULL) {
+		LOCAL_DEBUG_PRINT("Incorrect file handle");
+		return RET_STATE_ERR_PARAM;
+	}
+
+	if (pFile->pMntPoint == NULL) {
+		LOCAL_DEBUG_PRINT("Wrong mount point");
+		return RET_STATE_ERR_PARAM;
+	}
+
+	if (!FsWrapper_FunctionIsNotImplemented(pFile->pMntPoint->pFs->preallocate, "preallocate"))
+		return RET_STATE_ERROR;
+
+	RET_STATE_t retState = FsWrapper_BuffDrain(pFile);
+	if (retState != RET_STATE_SUCCESS)
+		return retState;
+
+	retState = pFile->pMntPoint->pFs->preallocate(pFile, bytesNum, isContiguous);
+	if (retState != RET_STATE_SUCCESS) {
+		LOCAL_DEBUG_PRINT("Preallocate failed, %s", RetState_GetStr(retState));
+		return retState;
+	}
+
+	return retState;
+}
+
 RET_STATE_t FsWrap_Sync(FsWrap_File_t* pFile) {
 
 	ASSERT_CHECK(pFile != NULL);
@@ -547,7 +835,11 @@ RET_STATE_t FsWrap_Sync(FsWrap_File_t* pFile) {
 	if (!FsWrapper_FunctionIsNotImplemented(pFile->pMntPoint->pFs->sync, "sync"))
 		return RET_STATE_ERROR;
 
-	RET_STATE_t retState = pFile->pMntPoint->pFs->sync(pFile);
+	RET_STATE_t retState = FsWrapper_BuffDrain(pFile);
+	if (retState != RET_STATE_SUCCESS)
+		return retState;
+
+	retState = pFile->pMntPoint->pFs->sync(pFile);
 	if (retState != RET_STATE_SUCCESS) {
 		LOCAL_DEBUG_PRINT("Sync failed, %s", RetState_GetStr(retState));
 		return retState;
@@ -576,7 +868,11 @@ RET_STATE_t FsWrap_Forward(FsWrap_File_t* pFile, u32 (*func)(const u8* pBuff, u3
 		return RET_STATE_ERROR;
 	}
 
-	RET_STATE_t rc = pFile->pMntPoint->pFs->forward(pFile, func, bytesNum, pBytesRd);
+	RET_STATE_t rc = FsWrapper_BuffDrain(pFile);
+	if (rc != RET_STATE_SUCCESS)
+		return rc;
+
+	rc = pFile->pMntPoint->pFs->forward(pFile, func, bytesNum, pBytesRd);
 	if (rc != RET_STATE_SUCCESS) {
 		LOCAL_DEBUG_PRINT("Forward failed");
 		return rc;
@@ -861,6 +1157,24 @@ RET_STATE_t FsWrap_Mkfs(FS_TYPE_t fsType, char* pDevId, void* pCfg, u32 flags) {
 
 #endif /* FS_FF_USE_MKFS */
 
+RET_STATE_t FsWrap_GetPoolStats(FS_TYPE_t fsType, FsWrap_PoolStats_t* pFileStats,
+								FsWrap_PoolStats_t* pDirStats) {
+
+	ASSERT_CHECK(pFileStats != NULL);
+	ASSERT_CHECK(pDirStats != NULL);
+
+	const FsWrap_FileSystem_t* pFs = FsRegistry_GetType(fsType);
+	if (pFs == NULL) {
+		DEBUG_LOG_LVL_PRINT(LOG_LVL_WARNING, "No FS registered with type %d", (u32)fsType);
+		return RET_STATE_ERROR;
+	}
+
+	if (!FsWrapper_FunctionIsNotImplemented(pFs->poolstats, "poolstats"))
+		return RET_STATE_ERROR;
+
+	return pFs->poolstats(pFileStats, pDirStats);
+}
+
 RET_STATE_t FsWrap_Mount(FsWrap_Mount_t* pMntPoint) {
 
 	ASSERT_CHECK(pMntPoint != NULL);
@@ -894,11 +1208,10 @@ RET_STATE_t FsWrap_Mount(FsWrap_Mount_t* pMntPoint) {
 
 		if (retState != RET_STATE_SUCCESS) {
 			DEBUG_LOG_LVL_PRINT(LOG_LVL_WARNING, "Can't access MountList item");
+			LinkedList_ReadWriteUnlock(&MountList);
 			return retState;
 		}
 
-		len = strlen(pMntPt->pMntPointPath);
-
 		/* continue if length does not match */
 		if (len != pMntPt->MntPointSize) {
 			continue;
@@ -938,7 +1251,21 @@ RET_STATE_t FsWrap_Mount(FsWrap_Mount_t* pMntPoint) {
 	pMntPoint->MntPointSize = len;
 	pMntPoint->pFs			= pFs;
 
-	return LinkedList_Insert(&MountList, pMntPoint, sizeof(FsWrap_Mount_t), 0);
+	retState = LinkedList_Insert(&MountList, pMntPoint, sizeof(FsWrap_Mount_t), 0);
+	if (retState != RET_STATE_SUCCESS)
+		return retState;
+
+	/* The list keeps its own copy of the mount point, resolve to it */
+	s32 driveIdx = FsWrapper_GetDriveIdx(pMntPoint->pMntPointPath);
+	if (driveIdx >= 0 && len == FS_MOUNT_DRIVE_PATH_LEN) {
+		retState = LinkedList_GetDataPtr(&MountList, (void**)&pMntPt, NULL, 0);
+		if (retState == RET_STATE_SUCCESS)
+			DriveTable[driveIdx] = pMntPt;
+	} else {
+		NotDriveMountsNum++;
+	}
+
+	return retState;
 }
 
 RET_STATE_t FsWrap_Unmount(FsWrap_Mount_t* pMntPoint) {
@@ -973,6 +1300,12 @@ RET_STATE_t FsWrap_Unmount(FsWrap_Mount_t* pMntPoint) {
 		return RET_STATE_ERROR;
 	}
 
+	s32 driveIdx = FsWrapper_GetDriveIdx(pMntPt->pMntPointPath);
+	if (driveIdx >= 0 && DriveTable[driveIdx] == pMntPt)
+		DriveTable[driveIdx] = NULL;
+	else
+		NotDriveMountsNum--;
+
 	/* clear file system interface */
 	pMntPt->pFs = NULL;
 
@@ -8,6 +8,13 @@
 
 #define FS_FF_USE_MKFS 1
 
+/* Space reserved for files opened with FS_MODE_PREALLOCATE */
+#define FS_PREALLOC_SIZE_DEF (4 * DATA_1_MBYTE)
+
+/* Mount points in "N:" form are resolved by a table lookup */
+#define FS_MOUNT_DRIVES_MAX		10
+#define FS_MOUNT_DRIVE_PATH_LEN 2
+
 #define FS_MOUNT_FLAG_NO_FORMAT		  0b00000001
 #define FS_MOUNT_FLAG_READ_ONLY		  0b00000010
 #define FS_MOUNT_FLAG_AUTOMOUNT		  0b00000100
@@ -25,6 +32,10 @@
 #define FS_MODE_APPEND			 0b01000000
 /* Auxiliary flag used to remove all the content from the file and set the file pointer to the start position. */
 #define FS_MODE_TRUNCATE		 0b10000000
+/* Auxiliary flag used to keep a cluster link map, so random seeks do not walk the FAT chain. */
+#define FS_MODE_FAST_SEEK		 0b100000000
+/* Auxiliary flag used to reserve FS_PREALLOC_SIZE_DEF bytes on open, the rest is freed on close */
+#define FS_MODE_PREALLOCATE		 0b1000000000
 
 typedef enum {
 	FS_TYPE_FATFS = 0,
@@ -57,10 +68,22 @@ typedef struct {
 	u32 Flags;
 } FsWrap_Mount_t;
 
+typedef struct {
+	u8* pData;
+	u32 Size;
+	u32 Len;		// valid bytes in the buffer
+	u32 Pos;		// read position inside the buffer
+	u32 BypassSize; // transfers of this size and above skip the buffer
+	bool IsDirty;	// buffer holds data not written to the back-end yet
+} FsWrap_FileBuff_t;
+
 typedef struct {
 	void* pFileHandler;
 	const FsWrap_Mount_t* pMntPoint;
 	u32 Flags;
+	FsWrap_FileBuff_t Buff;
+	u32 PreallocSize; // reserved size, 0 if the file was not preallocated
+	u32 DataEnd;	  // end of the written data inside the reserved space
 } FsWrap_File_t;
 
 typedef struct {
@@ -85,6 +108,25 @@ typedef struct {
 	u32 FreeBlocksNum;
 } FsWrap_StatVfs_t;
 
+typedef struct {
+	/** Read/write calls passed to the FS back-end */
+	u32 BackendReads;
+	u32 BackendWrites;
+	/** Buffered stream calls served without the back-end */
+	u32 BuffReads;
+	u32 BuffWrites;
+	/** Buffered stream calls passed straight to the back-end */
+	u32 BypassReads;
+	u32 BypassWrites;
+} FsWrap_Stats_t;
+
+typedef struct {
+	u32 Size;
+	u32 InUse;
+	u32 Peak;
+	u32 Exhausted; // acquires that found the pool empty
+} FsWrap_PoolStats_t;
+
 struct fs_file_system_s {
 	/**
 	 * @name File operations
@@ -96,7 +138,9 @@ struct fs_file_system_s {
 	RET_STATE_t (*lseek)(FsWrap_File_t* pFile, s32 offset, FS_SEEK_t whence);
 	RET_STATE_t (*tell)(FsWrap_File_t* pFile, u32* pPos);
 	RET_STATE_t (*size)(FsWrap_File_t* pFile, u32* pSize);
+	RET_STATE_t (*clustsize)(FsWrap_File_t* pFile, u32* pSize);
 	RET_STATE_t (*truncate)(FsWrap_File_t* pFile, u32 length);
+	RET_STATE_t (*preallocate)(FsWrap_File_t* pFile, u32 bytesNum, bool isContiguous);
 	RET_STATE_t (*sync)(FsWrap_File_t* pFile);
 	RET_STATE_t (*forward)(FsWrap_File_t* pFile, u32 (*func)(const u8* pBuff, u32 size),
 						   u32 bytesNum, u32* pBytesRd);
@@ -128,6 +172,7 @@ struct fs_file_system_s {
 
 	RET_STATE_t (*lock)(FsWrap_Mount_t* pMntPoint);
 	RET_STATE_t (*unlock)(FsWrap_Mount_t* pMntPoint);
+	RET_STATE_t (*poolstats)(FsWrap_PoolStats_t* pFileStats, FsWrap_PoolStats_t* pDirStats);
 
 #if FS_FF_USE_MKFS
 	RET_STATE_t (*mkfs)(char* devId, void* pCfg, u32 flags);
@@ -191,6 +236,8 @@ RET_STATE_t FsWrap_Unlock(const char* pPath);
  *   - @c FS_MODE_CREATE create file if it does not exist
  *   - @c FS_MODE_APPEND move to end of file before each write
  *   - @c FS_MODE_TRUNC truncate the file
+ *   - @c FS_MODE_FAST_SEEK keep a cluster link map for random access
+ *   - @c FS_MODE_PREALLOCATE reserve space for the file, see FsWrap_Preallocate()
  *
  * @warning If @p flags are set to 0 the function will open file, if it exists
  *          and is accessible, but you will have no read/write access to it.
@@ -218,6 +265,36 @@ RET_STATE_t FsWrap_Open(FsWrap_File_t* pFile, const char* pPath, u32 flags);
  */
 RET_STATE_t FsWrap_Close(FsWrap_File_t* pFile);
 
+/**
+ * @brief Set stream buffer of an open file
+ *
+ * Switches the file to the buffered stream mode: small reads and writes are
+ * gathered in a buffer of @p size bytes and passed to the FS back-end only
+ * when the buffer is full or drained. Transfers not shorter than a cluster
+ * (or than the buffer itself) bypass the buffer and go directly between the
+ * user buffer and the back-end. The buffer is flushed by FsWrap_Seek(),
+ * FsWrap_Truncate(), FsWrap_Sync(), FsWrap_Forward() and FsWrap_Close().
+ *
+ * @note Calling the function again flushes and replaces the current buffer,
+ * @p size of 0 returns the file to the unbuffered mode.
+ *
+ * @param pFile Pointer to the file object
+ * @param size Buffer size in bytes
+ *
+ * @retval RET_STATE_SUCCESS on success;
+ * @retval RET_STATE_ERR_PARAM when invoked on pFile that represents unopened/closed file;
+ * @retval RET_STATE_ERR_MEMORY when the buffer can not be allocated;
+ * @retval RET_STATE_ERROR or an other errno code, depending on a file system back-end.
+ */
+RET_STATE_t FsWrap_SetBuff(FsWrap_File_t* pFile, u32 size);
+
+/**
+ * @brief Get wrapper I/O statistics
+ *
+ * @retval Back-end and stream buffer call counters since start.
+ */
+FsWrap_Stats_t FsWrap_GetStats(void);
+
 /**
  * @brief Unlink file
  *
@@ -363,6 +440,31 @@ RET_STATE_t FsWrap_Size(FsWrap_File_t* pFile, u32* pSize);
  */
 RET_STATE_t FsWrap_Truncate(FsWrap_File_t* pFile, u32 length);
 
+/**
+ * @brief Reserve space for an open file
+ *
+ * Allocates clusters for @p bytesNum bytes of the file up front, so the
+ * following writes into the reserved space do not allocate clusters and do
+ * not update the FAT. With @p isContiguous set the space is looked for as
+ * one contiguous block (only possible for an empty file), which makes
+ * sequential writes go to consecutive sectors; if no such block exists the
+ * space is allocated as a regular cluster chain.
+ *
+ * @note The file size becomes @p bytesNum. Writes with FS_MODE_APPEND go to
+ * the end of the written data, and the unused reserved tail is freed by
+ * FsWrap_Close().
+ *
+ * @param pFile Pointer to the file object
+ * @param bytesNum Number of bytes to reserve
+ * @param isContiguous Look for a contiguous block
+ *
+ * @retval RET_STATE_SUCCESS on success;
+ * @retval RET_STATE_WARNING when contiguous space was requested but not found;
+ * @retval RET_STATE_ERR_PARAM when invoked on pFile that represents unopened/closed file;
+ * @retval RET_STATE_ERROR or an other errno code, depending on a file system back-end.
+ */
+RET_STATE_t FsWrap_Preallocate(FsWrap_File_t* pFile, u32 bytesNum, bool isContiguous);
+
 /**
  * @brief Flush cached write data buffers of an open file
  *
@@ -559,6 +661,19 @@ RET_STATE_t FsWrap_GetLabel(const char* pPath, char* pLabel, u32* pVsn);
  */
 RET_STATE_t FsWrap_Mkfs(FS_TYPE_t fsType, char* devId, void* pCfg, u32 flags);
 
+/**
+ * @brief Get statistics of file and directory handle pools
+ *
+ * @param fsType Type of file system to query.
+ * @param pFileStats Pointer to file handle pool statistics.
+ * @param pDirStats Pointer to directory handle pool statistics.
+ *
+ * @retval RET_STATE_SUCCESS on success;
+ * @retval RET_STATE_ERROR or an other errno code, depending on a file system back-end.
+ */
+RET_STATE_t FsWrap_GetPoolStats(FS_TYPE_t fsType, FsWrap_PoolStats_t* pFileStats,
+								FsWrap_PoolStats_t* pDirStats);
+
 /**
  * @brief Register a file system
  *
@@ -1,21 +1,16 @@
+#define DEBUG_MODULE DBG_MOD_IO
+
 #include "io_fatfs.h"
 #include "debug.h"
 #include "ff.h"
-#include "mmc.h"
 #include "storage.h"
+#include "storage_cache.h"
+#include "storage_ram.h"
 #include "time_date.h"
 
-#if DEBUG_ENABLE
-#define LOCAL_DEBUG_LOG_PRINT_ENABLE 0
-#endif /* DEBUG_ENABLE */
-
-#if LOCAL_DEBUG_LOG_PRINT_ENABLE
-#warning LOCAL_DEBUG_LOG_PRINT_ENABLE
-#define LOCAL_DEBUG_LOG_PRINT DEBUG_PRINT_DIRECT_NL
-#else /* LOCAL_DEBUG_LOG_PRINT_ENABLE */
-#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)
-#endif /* LOCAL_DEBUG_LOG_PRINT_ENABLE */
+#define LOCAL_DEBUG_LOG_PRINT(_f_, ...) DEBUG_TRACE_DO(DEBUG_PRINT_DIRECT_NL(_f_, ##__VA_ARGS__))
 
+/* Drive number is the FatFS volume number, see FF_VOLUMES */
 enum {
 	FATFS_DRV_EMMC = 0,
 	FATFS_DRV_RAM,
@@ -23,27 +18,6 @@ enum {
 	FATFS_DRV_ENUM_SIZE
 };
 
-#define DELAY_MAX_CNT 10
-
-static bool emmc_await_delay(const char* pcFuncName) {
-	u32 cnt		  = 0;
-	u32 cardState = Storage_Emmc_GetCardState();
-
-	while (cardState != HAL_MMC_CARD_TRANSFER) {
-		cnt++;
-		LOCAL_DEBUG_LOG_PRINT(ESC_COLOR_YELLOW "%s delay: cardState %d" ESC_RESET_STYLE, pcFuncName,
-							  cardState);
-		PL_DELAY_MS(1);
-		cardState = Storage_Emmc_GetCardState();
-		if (cnt >= DELAY_MAX_CNT) {
-			LOCAL_DEBUG_LOG_PRINT(ESC_COLOR_RED "await failed" ESC_RESET_STYLE);
-			return false;
-		}
-	}
-
-	return true;
-}
-
 DSTATUS disk_initialize(BYTE pdrv) {
 	DSTATUS stat = STA_NOINIT;
 
@@ -68,7 +42,8 @@ DSTATUS disk_status(BYTE pdrv) {
 
 	switch (pdrv) {
 		case FATFS_DRV_EMMC:
-			if (emmc_await_delay(__FUNCTION__))
+			/* asked on every FatFS call, so no CMD13: each transfer waits for the card */
+			if (Storage_EmmcHw_IsInit())
 				stat = STA_OK;
 			break;
 
@@ -87,16 +62,13 @@ DRESULT disk_read(BYTE pdrv, BYTE* pBuff, LBA_t sector, UINT count) {
 
 	switch (pdrv) {
 		case FATFS_DRV_EMMC:
-			//TODO add speed test, add DMA handling, check interrupts
-
-			if (emmc_await_delay(__FUNCTION__))
-				res = Storage_Emmc_Read(pBuff, sector, count) == true ? RES_OK : RES_ERROR;
+			res = StorageCache_Read(pBuff, sector, count) == true ? RES_OK : RES_ERROR;
 			break;
 
-		case FATFS_DRV_RAM:
-			Storage_Ram_Read(pBuff, sector * FF_MAX_SS, count * FF_MAX_SS);
-			res = RES_OK;
-			break;
+		case FATFS_DRV_RAM: {
+			bool isOk = StorageRam_Read(pBuff, sector * FF_MAX_SS, count * FF_MAX_SS);
+			res		  = isOk == true ? RES_OK : RES_ERROR;
+		} break;
 	}
 
 	LOCAL_DEBUG_LOG_PRINT("disk_read: drv %d, res %d, sector %d, count %d", pdrv, res, sector,
@@ -112,15 +84,13 @@ DRESULT disk_write(BYTE pdrv, const BYTE* pBuff, LBA_t sector, UINT count) {
 
 	switch (pdrv) {
 		case FATFS_DRV_EMMC:
-
-			if (emmc_await_delay(__FUNCTION__))
-				res = Storage_Emmc_Write(pBuff, sector, count) == true ? RES_OK : RES_ERROR;
+			res = StorageCache_Write(pBuff, sector, count) == true ? RES_OK : RES_ERROR;
 			break;
 
-		case FATFS_DRV_RAM:
-			Storage_Ram_Write(pBuff, sector * FF_MAX_SS, count * FF_MAX_SS);
-			res = RES_OK;
-			break;
+		case FATFS_DRV_RAM: {
+			bool isOk = StorageRam_Write(pBuff, sector * FF_MAX_SS, count * FF_MAX_SS);
+			res		  = isOk == true ? RES_OK : RES_ERROR;
+		} break;
 	}
 
 	LOCAL_DEBUG_LOG_PRINT("disk_write: drv %d, res %d, sector %d, count %d", pdrv, res, sector,
@@ -144,7 +114,7 @@ DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* pBuff) {
 
 			switch (cmd) {
 				case CTRL_SYNC:
-					res = RES_OK;
+					res = StorageCache_Flush() == true ? RES_OK : RES_ERROR;
 					break;
 				case GET_SECTOR_COUNT:
 					*(DWORD*)pBuff = sdEmmcInfo.LogBlockNbr;
@@ -158,6 +128,16 @@ DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* pBuff) {
 					*(DWORD*)pBuff = sdEmmcInfo.LogBlockSize / sdEmmcInfo.BlockSize;
 					res			   = RES_OK;
 					break;
+				case CTRL_TRIM: {
+					if (sdEmmcInfo.DiscardAlign == 0) {
+						res = RES_PARERR;
+						break;
+					}
+
+					LBA_t* pRange = (LBA_t*)pBuff;
+					u32 blockNum  = pRange[1] - pRange[0] + 1;
+					res = StorageCache_Trim(pRange[0], blockNum) == true ? RES_OK : RES_ERROR;
+				} break;
 				default:
 					res = RES_PARERR;
 			}
@@ -170,7 +150,7 @@ DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* pBuff) {
 					res = RES_OK;
 					break;
 				case GET_SECTOR_COUNT:
-					*(DWORD*)pBuff = Storage_Ram_GetStorageCap() / FF_MAX_SS;
+					*(DWORD*)pBuff = StorageRam_GetCapacity() / FF_MAX_SS;
 					res			   = RES_OK;
 					break;
 				case GET_SECTOR_SIZE:
@@ -181,6 +161,12 @@ DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* pBuff) {
 					*(DWORD*)pBuff = 1;
 					res			   = RES_OK;
 					break;
+				case CTRL_TRIM: {
+					LBA_t* pRange = (LBA_t*)pBuff;
+					u32 blockNum  = pRange[1] - pRange[0] + 1;
+					bool isOk	  = StorageRam_Trim(pRange[0] * FF_MAX_SS, blockNum * FF_MAX_SS);
+					res			  = isOk == true ? RES_OK : RES_ERROR;
+				} break;
 				default:
 					res = RES_PARERR;
 			}
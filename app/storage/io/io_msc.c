@@ -1,20 +1,17 @@
+#define DEBUG_MODULE DBG_MOD_IO
+
 #include "io_msc.h"
 #include "debug.h"
-#include "mmc.h"
+#include "rtos_analyzer.h"
 #include "storage.h"
+#include "storage_cache.h"
+#include "storage_cfg.h"
+#include "storage_pipe.h"
+#include "storage_ram.h"
 #include "usb.h"
 #include "usbd_msc.h"
 
-#if DEBUG_ENABLE
-#define LOCAL_DEBUG_LOG_PRINT_ENABLE 0
-#endif /* DEBUG_ENABLE */
-
-#if LOCAL_DEBUG_LOG_PRINT_ENABLE
-#warning LOCAL_DEBUG_LOG_PRINT_ENABLE
-#define LOCAL_DEBUG_LOG_PRINT DEBUG_PRINT_DIRECT_NL
-#else /* LOCAL_DEBUG_LOG_PRINT_ENABLE */
-#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)
-#endif /* LOCAL_DEBUG_LOG_PRINT_ENABLE */
+#define LOCAL_DEBUG_LOG_PRINT(_f_, ...) DEBUG_TRACE_DO(DEBUG_PRINT_DIRECT_NL(_f_, ##__VA_ARGS__))
 
 typedef s8 (*USB_MSC_Init_FS_Func)(u8 lun);
 typedef s8 (*USB_MSC_GetCapacity_FS_Func)(u8 lun, u32* pBlockNum, u16* pBlockSize);
@@ -23,6 +20,7 @@ typedef s8 (*USB_MSC_IsWriteProtected_FS_Func)(u8 lun);
 typedef s8 (*USB_MSC_Read_FS_Func)(u8 lun, u8* pBuff, u32 blockAddr, u16 blockLen);
 typedef s8 (*USB_MSC_Write_FS_Func)(u8 lun, u8* pBuff, u32 blockAddr, u16 blockLen);
 typedef s8 (*USB_MSC_GetMaxLun_FS_Func)(void);
+typedef s8 (*USB_MSC_ReadPtr_FS_Func)(u8 lun, u8** ppBuff, u32 blockAddr, u16 blockLen);
 
 enum {
 	MSC_LUN_RAM	 = 0,
@@ -31,34 +29,32 @@ enum {
 	MSC_LUN_ENUM_SIZE = 2
 };
 
-#define DELAY_MAX_CNT 10
-
-static bool emmc_await_delay(const char* pcFuncName) {
-	u32 cnt		  = 0;
-	u32 cardState = Storage_Emmc_GetCardState();
-
-	while (cardState != HAL_MMC_CARD_TRANSFER) {
-		cnt++;
-		LOCAL_DEBUG_LOG_PRINT(ESC_COLOR_YELLOW "%s delay: cardState %d" ESC_RESET_STYLE, pcFuncName,
-							  cardState);
-		PL_DELAY_MS(1);
-		cardState = Storage_Emmc_GetCardState();
-		if (cnt >= DELAY_MAX_CNT) {
-			LOCAL_DEBUG_LOG_PRINT(ESC_COLOR_RED "await failed" ESC_RESET_STYLE);
-			return false;
-		}
-	}
+static TaskHandle_t UsbMsc_Handle;
+static SemaphoreHandle_t UsbMsc_Mutex; // device stack, between the task and start/stop
 
-	return true;
-}
+#if STORAGE_PIPE_ENABLE
+static const StoragePipe_Dev_t USB_MSC_EmmcPipeDev = {
+	.XferStart	= Storage_Emmc_XferStart,
+	.XferWait	= Storage_Emmc_XferWait,
+	.XferAbort	= Storage_Emmc_XferAbort,
+	.Invalidate = StorageCache_Invalidate,
+};
+#endif /* STORAGE_PIPE_ENABLE */
 
 static u8 USB_MSC_Init(u8 lun) {
 	u8 retState = USBD_FAIL;
 
 	switch (lun) {
-		case MSC_LUN_EMMC:
+		case MSC_LUN_EMMC: {
+#if STORAGE_PIPE_ENABLE
+			Pl_SdEmmcInfo_t sdEmmcInfo;
+			if (Storage_Emmc_GetDeviceInfo(&sdEmmcInfo) != true)
+				break;
+
+			StoragePipe_Init(&USB_MSC_EmmcPipeDev, sdEmmcInfo.LogBlockNbr);
+#endif /* STORAGE_PIPE_ENABLE */
 			retState = USBD_OK;
-			break;
+		} break;
 
 		case MSC_LUN_RAM:
 			retState = USBD_OK;
@@ -75,7 +71,11 @@ static u8 USB_MSC_IsReady(u8 lun) {
 
 	switch (lun) {
 		case MSC_LUN_EMMC:
-			if (emmc_await_delay(__FUNCTION__))
+#if STORAGE_PIPE_ENABLE
+			/* a deferred write failure is reported by the next write */
+			StoragePipe_Drain();
+#endif /* STORAGE_PIPE_ENABLE */
+			if (Storage_Emmc_AwaitReady())
 				retState = USBD_OK;
 			else
 				retState = USBD_BUSY;
@@ -113,16 +113,18 @@ static u8 USB_MSC_Read(u8 lun, u8* pBuff, u32 blockAddr, u16 blockLen) {
 
 	switch (lun) {
 		case MSC_LUN_EMMC:
-			if (emmc_await_delay(__FUNCTION__))
-				retState =
-					Storage_Emmc_Read(pBuff, blockAddr, blockLen) == true ? USBD_OK : USBD_BUSY;
+#if STORAGE_PIPE_ENABLE
+			retState = StoragePipe_Read(pBuff, blockAddr, blockLen) == true ? USBD_OK : USBD_BUSY;
+#else  /* STORAGE_PIPE_ENABLE */
+			retState = StorageCache_Read(pBuff, blockAddr, blockLen) == true ? USBD_OK : USBD_BUSY;
+#endif /* STORAGE_PIPE_ENABLE */
 			break;
 
-		case MSC_LUN_RAM:
-			Storage_Ram_Read(pBuff, blockAddr * APP_RAM_MSC_BLOCK_SIZE,
-							 blockLen * APP_RAM_MSC_BLOCK_SIZE);
-			retState = USBD_OK;
-			break;
+		case MSC_LUN_RAM: {
+			bool isOk = StorageRam_Read(pBuff, blockAddr * APP_RAM_MSC_BLOCK_SIZE,
+										blockLen * APP_RAM_MSC_BLOCK_SIZE);
+			retState  = isOk == true ? USBD_OK : USBD_FAIL;
+		} break;
 	}
 
 	LOCAL_DEBUG_LOG_PRINT("USB_MSC_Read: lun %d, res %d, from block %d with len %d", lun, retState,
@@ -131,21 +133,45 @@ static u8 USB_MSC_Read(u8 lun, u8* pBuff, u32 blockAddr, u16 blockLen) {
 	return retState;
 }
 
+/**
+ * @brief RAM LUN data is sent by USB right from the drive, other LUNs
+ * leave the pointer NULL and are read into the MSC buffer
+ */
+static u8 USB_MSC_ReadPtr(u8 lun, u8** ppBuff, u32 blockAddr, u16 blockLen) {
+	u8 retState = USBD_OK;
+
+	switch (lun) {
+		case MSC_LUN_RAM:
+			*ppBuff = (u8*)StorageRam_Map(blockAddr * APP_RAM_MSC_BLOCK_SIZE,
+										  blockLen * APP_RAM_MSC_BLOCK_SIZE);
+			if (*ppBuff == NULL)
+				retState = USBD_FAIL;
+			break;
+	}
+
+	LOCAL_DEBUG_LOG_PRINT("USB_MSC_ReadPtr: lun %d, res %d, from block %d with len %d", lun,
+						  retState, blockAddr, blockLen);
+	return retState;
+}
+
 static u8 USB_MSC_Write(u8 lun, u8* pBuff, u32 blockAddr, u16 blockLen) {
 	u8 retState = USBD_FAIL;
 
 	switch (lun) {
 		case MSC_LUN_EMMC:
-			if (emmc_await_delay(__FUNCTION__))
-				retState =
-					Storage_Emmc_Write(pBuff, blockAddr, blockLen) == true ? USBD_OK : USBD_BUSY;
+#if STORAGE_PIPE_ENABLE
+			retState = StoragePipe_Write(pBuff, blockAddr, blockLen) == true ? USBD_OK : USBD_BUSY;
+#else  /* STORAGE_PIPE_ENABLE */
+			retState =
+				StorageCache_WriteThrough(pBuff, blockAddr, blockLen) == true ? USBD_OK : USBD_BUSY;
+#endif /* STORAGE_PIPE_ENABLE */
 			break;
 
-		case MSC_LUN_RAM:
-			Storage_Ram_Write(pBuff, blockAddr * APP_RAM_MSC_BLOCK_SIZE,
-							  blockLen * APP_RAM_MSC_BLOCK_SIZE);
-			retState = USBD_OK;
-			break;
+		case MSC_LUN_RAM: {
+			bool isOk = StorageRam_Write(pBuff, blockAddr * APP_RAM_MSC_BLOCK_SIZE,
+										 blockLen * APP_RAM_MSC_BLOCK_SIZE);
+			retState  = isOk == true ? USBD_OK : USBD_FAIL;
+		} break;
 	}
 
 	LOCAL_DEBUG_LOG_PRINT("USB_MSC_Write: lun %d, res %d, to block %d with len %d", lun, retState,
@@ -159,8 +185,6 @@ static u8 USB_MSC_GetCapacity(u8 lun, u32* pBlockNum, u16* pBlockSize) {
 
 	switch (lun) {
 		case MSC_LUN_EMMC: {
-			LOCAL_DEBUG_LOG_PRINT("USB_MSC_GetCapacity: cardState %d", Storage_Emmc_GetCardState());
-
 			Pl_SdEmmcInfo_t sdEmmcInfo;
 			if (Storage_Emmc_GetDeviceInfo(&sdEmmcInfo) != true)
 				return USBD_FAIL;
@@ -171,7 +195,7 @@ static u8 USB_MSC_GetCapacity(u8 lun, u32* pBlockNum, u16* pBlockSize) {
 		} break;
 
 		case MSC_LUN_RAM: {
-			*pBlockNum	= Storage_Ram_GetStorageCap() / APP_RAM_MSC_BLOCK_SIZE;
+			*pBlockNum	= StorageRam_GetCapacity() / APP_RAM_MSC_BLOCK_SIZE;
 			*pBlockSize = APP_RAM_MSC_BLOCK_SIZE;
 			retState	= USBD_OK;
 		} break;
@@ -229,4 +253,82 @@ USBD_StorageTypeDef USBD_StorageInterface = {
 	(USB_MSC_Write_FS_Func)USB_MSC_Write,
 	(USB_MSC_GetMaxLun_FS_Func)USB_MSC_GetMaxLun,
 	(s8*)USB_MSC_Inquirydata_FS,
+	(USB_MSC_ReadPtr_FS_Func)USB_MSC_ReadPtr,
 };
+
+/**
+ * @brief OTG IRQ, it stays masked until the task has handled it
+ */
+static void USB_MSC_IrqClbk(void) {
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	vTaskNotifyGiveFromISR(UsbMsc_Handle, &xHigherPriorityTaskWoken);
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/**
+ * @brief runs the USB device stack during the MSC session, so the storage
+ * callbacks block on the card and the cache as any other task does. When
+ * the host goes quiet the pipeline is drained and the card is released
+ */
+static void vTask_UsbMsc_Process(void* pvParameters) {
+	for (;;) {
+		TickType_t tmo = portMAX_DELAY;
+#if STORAGE_PIPE_ENABLE
+		if (StoragePipe_IsBusy())
+			tmo = pdMS_TO_TICKS(STORAGE_PIPE_IDLE_TIME);
+#endif /* STORAGE_PIPE_ENABLE */
+		bool isEvent = ulTaskNotifyTake(pdTRUE, tmo) != 0;
+
+		xSemaphoreTake(UsbMsc_Mutex, SYS_MAX_TIMEOUT);
+		if (isEvent && Pl_USB_IsClassMSC()) {
+			Pl_USB_IrqProcess();
+		} else {
+#if STORAGE_PIPE_ENABLE
+			StoragePipe_Drain();
+#endif /* STORAGE_PIPE_ENABLE */
+		}
+		xSemaphoreGive(UsbMsc_Mutex);
+	}
+}
+
+bool IoMsc_Start(void) {
+	if (UsbMsc_Handle == NULL)
+		return false;
+
+	xSemaphoreTake(UsbMsc_Mutex, SYS_MAX_TIMEOUT);
+	bool res = Pl_USB_MSC_Init(USB_MSC_IrqClbk);
+	xSemaphoreGive(UsbMsc_Mutex);
+
+	return res;
+}
+
+/**
+ * @brief the task drains the pipeline, a transfer in flight belongs to it
+ * @retval false if a deferred write failed
+ */
+bool IoMsc_Stop(void) {
+	xSemaphoreTake(UsbMsc_Mutex, SYS_MAX_TIMEOUT);
+	Pl_USB_DeInit();
+	xSemaphoreGive(UsbMsc_Mutex);
+
+#if STORAGE_PIPE_ENABLE
+	xTaskNotifyGive(UsbMsc_Handle);
+	while (StoragePipe_IsBusy())
+		SYS_DELAY_MS(1);
+
+	return StoragePipe_Drain();
+#else  /* STORAGE_PIPE_ENABLE */
+	return true;
+#endif /* STORAGE_PIPE_ENABLE */
+}
+
+void FreeRTOS_IoMsc_InitComponents(bool resources, bool tasks) {
+	if (resources) {
+		UsbMsc_Mutex = xSemaphoreCreateMutex();
+	}
+
+	if (tasks) {
+		RTOS_Analyzer_CreateTask(vTask_UsbMsc_Process, "usb-msc", USB_MSC_TASK_STACK, NULL,
+								 USB_MSC_TASK_PRIORITY, &UsbMsc_Handle);
+	}
+}
@@ -3,4 +3,9 @@
 
 #include "main.h"
 
+bool IoMsc_Start(void);
+bool IoMsc_Stop(void);
+
+void FreeRTOS_IoMsc_InitComponents(bool resources, bool tasks);
+
 #endif /* __IO_MSC */
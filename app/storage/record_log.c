@@ -0,0 +1,585 @@
+#define DEBUG_MODULE DBG_MOD_STORAGE
+
+#include "record_log.h"
+#include "debug.h"
+#include "platform.h"
+#include "rtos_analyzer.h"
+
+#define LOCAL_DEBUG_PRINT(_f_, ...)		DEBUG_TRACE_DO(DEBUG_PRINT_NL(_f_, ##__VA_ARGS__))
+#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)	DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
+
+#define RECLOG_SEG_MAGIC 0x474C4352 // "RCLG"
+#define RECLOG_REC_MAGIC 0xA55A
+#define RECLOG_SEG_EXT	 ".rlg"
+#define RECLOG_POS_UNDEF 0xFFFFFFFF
+
+typedef struct __attribute__((packed)) {
+	u32 Magic;
+	u32 SegIdx;
+	u32 FirstSeq; // sequence number of the first record in the segment
+	u32 Crc;	  // of the fields above
+} RecLog_SegHdr_t;
+
+/* The CRC goes first, it covers the rest of the header and the payload in one buffer */
+typedef struct __attribute__((packed)) {
+	u32 Crc;
+	u16 Magic;
+	u16 Len;
+	u32 Seq;
+} RecLog_RecHdr_t;
+
+typedef struct {
+	u32 Pos; // next record
+	u32 Seq; // expected sequence number of the next record
+	u32 Records;
+	u32 BuffPos; // file position of the buffer start
+	u32 BuffLen;
+	bool IsHdrValid;
+	bool IsStopped; // by the replay callback
+} RecLog_Scan_t;
+
+static TaskHandle_t RecLog_Handle;
+static RecLog_t* RecLog_Logs[RECLOG_LOGS_MAX];
+
+/**
+ * @brief the CRC unit has no lock of its own, the scheduler is suspended
+ * for the time of one buffer
+ */
+static u32 RecLog_Crc(const u8* pBuff, u32 size) {
+	vTaskSuspendAll();
+	u32 crc = Pl_Crc32_CheckBuff(pBuff, size);
+	xTaskResumeAll();
+	return crc;
+}
+
+static void RecLog_SegPath(const RecLog_t* pLog, u32 segIdx, char* pPath) {
+	snprintf(pPath, RECLOG_PATH_LEN, "%s/%08lx%s", pLog->Cfg.pDir, (unsigned long)segIdx,
+			 RECLOG_SEG_EXT);
+}
+
+static bool RecLog_SegParseName(const char* pName, u32* pSegIdx) {
+	char* pEnd = NULL;
+	u32 segIdx = strtoul(pName, &pEnd, 16);
+	if (pEnd != pName + 8 || strcmp(pEnd, RECLOG_SEG_EXT) != 0)
+		return false;
+
+	*pSegIdx = segIdx;
+	return true;
+}
+
+static RET_STATE_t RecLog_SegFind(RecLog_t* pLog, bool* pIsFound) {
+	FsWrap_Dir_t dir;
+	FsWrap_DirEnt_t entry;
+	memset(&dir, 0, sizeof(dir));
+
+	*pIsFound		= false;
+	RET_STATE_t res = FsWrap_OpenDir(&dir, pLog->Cfg.pDir);
+	if (res != RET_STATE_SUCCESS)
+		return res;
+
+	while ((res = FsWrap_ReadDir(&dir, &entry)) == RET_STATE_SUCCESS && entry.Name[0] != 0) {
+		u32 segIdx;
+		if (entry.Type != FS_DIR_ENTRY_FILE || !RecLog_SegParseName(entry.Name, &segIdx))
+			continue;
+
+		if (!*pIsFound || segIdx < pLog->SegFirst)
+			pLog->SegFirst = segIdx;
+		if (!*pIsFound || segIdx > pLog->SegLast)
+			pLog->SegLast = segIdx;
+		*pIsFound = true;
+	}
+
+	FsWrap_CloseDir(&dir);
+	return res;
+}
+
+/**
+ * @brief makes @p need bytes at the scan position available in the buffer
+ */
+static RET_STATE_t RecLog_ScanFill(RecLog_t* pLog, FsWrap_File_t* pFile, RecLog_Scan_t* pScan,
+								   u32 need, bool* pIsAvail) {
+	*pIsAvail = pScan->Pos + need <= pScan->BuffPos + pScan->BuffLen;
+	/* a short buffer read at this position already ends at the end of file */
+	if (*pIsAvail || (pScan->Pos == pScan->BuffPos && pScan->BuffLen != 0))
+		return RET_STATE_SUCCESS;
+
+	RET_STATE_t res = FsWrap_Seek(pFile, (s32)pScan->Pos, FS_SEEK_START);
+	if (res != RET_STATE_SUCCESS)
+		return res;
+
+	u32 done = 0;
+	res		 = FsWrap_Read(pFile, pLog->Cfg.pBuff, pLog->Cfg.BuffSize, &done);
+	if (res != RET_STATE_SUCCESS)
+		return res;
+
+	pScan->BuffPos = pScan->Pos;
+	pScan->BuffLen = done;
+	*pIsAvail	   = need <= done;
+	return RET_STATE_SUCCESS;
+}
+
+/**
+ * @brief walks the records of one segment until the first invalid one, a
+ * record is valid if it is complete, its CRC matches and its sequence number
+ * follows the previous one, so stale data in reused clusters is never taken
+ */
+static RET_STATE_t RecLog_ScanSeg(RecLog_t* pLog, FsWrap_File_t* pFile, u32 segIdx,
+								  RecLog_Scan_t* pScan, RecLog_ReplayClbk_t clbk, void* pCtx) {
+	memset(pScan, 0, sizeof(RecLog_Scan_t));
+
+	RET_STATE_t res = FsWrap_Seek(pFile, 0, FS_SEEK_START);
+	if (res != RET_STATE_SUCCESS)
+		return res;
+
+	RecLog_SegHdr_t segHdr;
+	u32 done = 0;
+	res		 = FsWrap_Read(pFile, &segHdr, sizeof(segHdr), &done);
+	if (res != RET_STATE_SUCCESS)
+		return res;
+
+	if (done != sizeof(segHdr) || segHdr.Magic != RECLOG_SEG_MAGIC || segHdr.SegIdx != segIdx ||
+		segHdr.Crc != RecLog_Crc((const u8*)&segHdr, offsetof(RecLog_SegHdr_t, Crc)))
+		return RET_STATE_SUCCESS;
+
+	pScan->IsHdrValid = true;
+	pScan->Pos		  = sizeof(RecLog_SegHdr_t);
+	pScan->Seq		  = segHdr.FirstSeq;
+	pScan->BuffPos	  = pScan->Pos;
+
+	for (;;) {
+		bool isAvail;
+		res = RecLog_ScanFill(pLog, pFile, pScan, sizeof(RecLog_RecHdr_t), &isAvail);
+		if (res != RET_STATE_SUCCESS || !isAvail)
+			break;
+
+		RecLog_RecHdr_t recHdr;
+		memcpy(&recHdr, &pLog->Cfg.pBuff[pScan->Pos - pScan->BuffPos], sizeof(recHdr));
+		u32 recSize = sizeof(RecLog_RecHdr_t) + recHdr.Len;
+		if (recHdr.Magic != RECLOG_REC_MAGIC || recHdr.Len == 0 ||
+			recHdr.Len > RECLOG_RECORD_SIZE_MAX || recSize > pLog->Cfg.BuffSize ||
+			recHdr.Seq != pScan->Seq)
+			break;
+
+		res = RecLog_ScanFill(pLog, pFile, pScan, recSize, &isAvail);
+		if (res != RET_STATE_SUCCESS || !isAvail)
+			break;
+
+		const u8* pRec = &pLog->Cfg.pBuff[pScan->Pos - pScan->BuffPos];
+		if (recHdr.Crc != RecLog_Crc(pRec + sizeof(u32), recSize - sizeof(u32)))
+			break;
+
+		pScan->Pos += recSize;
+		pScan->Seq++;
+		pScan->Records++;
+
+		if (clbk != NULL && !clbk(recHdr.Seq, pRec + sizeof(RecLog_RecHdr_t), recHdr.Len, pCtx)) {
+			pScan->IsStopped = true;
+			break;
+		}
+	}
+
+	return res;
+}
+
+/**
+ * @brief creates the segment with the header only, the whole segment is
+ * reserved up front so commits don't allocate clusters
+ */
+static RET_STATE_t RecLog_SegCreate(RecLog_t* pLog, u32 segIdx, u32 firstSeq) {
+	char path[RECLOG_PATH_LEN];
+	RecLog_SegPath(pLog, segIdx, path);
+
+	memset(&pLog->File, 0, sizeof(FsWrap_File_t));
+	RET_STATE_t res =
+		FsWrap_Open(&pLog->File, path, FS_MODE_CREATE_ALWAYS | FS_MODE_READ | FS_MODE_WRITE);
+	if (res != RET_STATE_SUCCESS)
+		return res;
+
+	/* not supported by every back-end, commits allocate space then */
+	res = FsWrap_Preallocate(&pLog->File, pLog->Cfg.SegmentSize, true);
+	LOCAL_DEBUG_LOG_PRINT("Segment %d reserve, %s\r\n", segIdx, RetState_GetStr(res));
+
+	RecLog_SegHdr_t segHdr = {
+		.Magic	  = RECLOG_SEG_MAGIC,
+		.SegIdx	  = segIdx,
+		.FirstSeq = firstSeq,
+	};
+	segHdr.Crc = RecLog_Crc((const u8*)&segHdr, offsetof(RecLog_SegHdr_t, Crc));
+
+	u32 done = 0;
+	res		 = FsWrap_Write(&pLog->File, &segHdr, sizeof(segHdr), &done);
+	if (res == RET_STATE_SUCCESS && done != sizeof(segHdr))
+		res = RET_STATE_ERROR;
+	if (res == RET_STATE_SUCCESS)
+		res = FsWrap_Sync(&pLog->File);
+
+	if (res != RET_STATE_SUCCESS) {
+		FsWrap_Close(&pLog->File);
+		return res;
+	}
+
+	pLog->SegLast = segIdx;
+	pLog->SegPos  = sizeof(RecLog_SegHdr_t);
+	pLog->FilePos = pLog->SegPos;
+	pLog->Stats.Segments++;
+	return RET_STATE_SUCCESS;
+}
+
+/**
+ * @brief closes the last segment, which frees its unused reserved space,
+ * starts the next one and removes the segments above the limit
+ */
+static RET_STATE_t RecLog_SegNext(RecLog_t* pLog) {
+	RET_STATE_t res = FsWrap_Close(&pLog->File);
+	if (res != RET_STATE_SUCCESS)
+		LOCAL_DEBUG_LOG_PRINT("Segment %d close, %s\r\n", pLog->SegLast, RetState_GetStr(res));
+
+	res = RecLog_SegCreate(pLog, pLog->SegLast + 1, pLog->NextSeq);
+	if (res != RET_STATE_SUCCESS) {
+		pLog->IsOpen = false;
+		return res;
+	}
+
+	while (pLog->Cfg.SegmentsMax && pLog->SegLast - pLog->SegFirst + 1 > pLog->Cfg.SegmentsMax) {
+		char path[RECLOG_PATH_LEN];
+		RecLog_SegPath(pLog, pLog->SegFirst++, path);
+		FsWrap_Unlink(path);
+	}
+
+	return RET_STATE_SUCCESS;
+}
+
+/**
+ * @brief cuts the last segment after its last valid record. A segment with
+ * a torn header was being created, it is created again after the previous one
+ */
+static RET_STATE_t RecLog_Recover(RecLog_t* pLog) {
+	char path[RECLOG_PATH_LEN];
+	RecLog_SegPath(pLog, pLog->SegLast, path);
+
+	memset(&pLog->File, 0, sizeof(FsWrap_File_t));
+	RET_STATE_t res = FsWrap_Open(&pLog->File, path, FS_MODE_READ | FS_MODE_WRITE);
+	if (res != RET_STATE_SUCCESS)
+		return res;
+
+	RecLog_Scan_t scan;
+	res = RecLog_ScanSeg(pLog, &pLog->File, pLog->SegLast, &scan, NULL, NULL);
+	if (res != RET_STATE_SUCCESS) {
+		FsWrap_Close(&pLog->File);
+		return res;
+	}
+
+	if (!scan.IsHdrValid) {
+		FsWrap_Close(&pLog->File);
+		FsWrap_Unlink(path);
+
+		u32 nextSeq = 0;
+		if (pLog->SegLast > pLog->SegFirst) {
+			RecLog_SegPath(pLog, pLog->SegLast - 1, path);
+			memset(&pLog->File, 0, sizeof(FsWrap_File_t));
+			res = FsWrap_Open(&pLog->File, path, FS_MODE_READ);
+			if (res != RET_STATE_SUCCESS)
+				return res;
+
+			res = RecLog_ScanSeg(pLog, &pLog->File, pLog->SegLast - 1, &scan, NULL, NULL);
+			FsWrap_Close(&pLog->File);
+			if (res != RET_STATE_SUCCESS)
+				return res;
+			nextSeq = scan.Seq;
+		}
+
+		pLog->NextSeq = nextSeq;
+		return RecLog_SegCreate(pLog, pLog->SegLast, nextSeq);
+	}
+
+	u32 size = 0;
+	res		 = FsWrap_Size(&pLog->File, &size);
+	if (res == RET_STATE_SUCCESS && size > scan.Pos) {
+		res = FsWrap_Truncate(&pLog->File, scan.Pos);
+		if (res == RET_STATE_SUCCESS)
+			res = FsWrap_Sync(&pLog->File);
+	}
+
+	if (res != RET_STATE_SUCCESS) {
+		FsWrap_Close(&pLog->File);
+		return res;
+	}
+
+	FsWrap_Preallocate(&pLog->File, pLog->Cfg.SegmentSize, false);
+
+	pLog->SegPos		  = scan.Pos;
+	pLog->FilePos		  = RECLOG_POS_UNDEF;
+	pLog->NextSeq		  = scan.Seq;
+	pLog->Stats.Recovered = scan.Records;
+	pLog->Stats.TornBytes = size - scan.Pos;
+	LOCAL_DEBUG_LOG_PRINT("Recovered %d records, %d bytes cut\r\n", scan.Records, size - scan.Pos);
+	return RET_STATE_SUCCESS;
+}
+
+/**
+ * @brief writes the buffer after the committed data and syncs the file. On
+ * a failure the buffer is kept and written again by the next commit
+ */
+static RET_STATE_t RecLog_CommitLocked(RecLog_t* pLog) {
+	if (pLog->BuffLen == 0)
+		return RET_STATE_SUCCESS;
+
+	u64 startUs		= PL_GET_US_CNT();
+	RET_STATE_t res = RET_STATE_SUCCESS;
+	if (pLog->FilePos != pLog->SegPos)
+		res = FsWrap_Seek(&pLog->File, (s32)pLog->SegPos, FS_SEEK_START);
+
+	u32 done = 0;
+	if (res == RET_STATE_SUCCESS)
+		res = FsWrap_Write(&pLog->File, pLog->Cfg.pBuff, pLog->BuffLen, &done);
+	if (res == RET_STATE_SUCCESS && done != pLog->BuffLen)
+		res = RET_STATE_ERROR;
+	if (res == RET_STATE_SUCCESS)
+		res = FsWrap_Sync(&pLog->File);
+
+	if (res != RET_STATE_SUCCESS) {
+		LOCAL_DEBUG_LOG_PRINT("Commit of %d bytes failed, %s\r\n", pLog->BuffLen,
+							  RetState_GetStr(res));
+		pLog->FilePos = RECLOG_POS_UNDEF;
+		pLog->Error	  = res;
+		return res;
+	}
+
+	pLog->SegPos += pLog->BuffLen;
+	pLog->FilePos = pLog->SegPos;
+	pLog->BuffLen = 0;
+	pLog->Error	  = RET_STATE_SUCCESS;
+
+	u32 us = (u32)(PL_GET_US_CNT() - startUs);
+	pLog->Stats.Commits++;
+	if (us > pLog->Stats.CommitMaxUs)
+		pLog->Stats.CommitMaxUs = us;
+
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t RecLog_Open(RecLog_t* pLog, const RecLog_Cfg_t* pCfg) {
+	if (pLog == NULL || pCfg == NULL || pCfg->pDir == NULL || pCfg->pBuff == NULL)
+		return RET_STATE_ERR_PARAM;
+
+	/* the segment name is "/xxxxxxxx.rlg" */
+	if (strlen(pCfg->pDir) + 14 > RECLOG_PATH_LEN)
+		return RET_STATE_ERR_PARAM;
+
+	u32 recSizeMin = sizeof(RecLog_RecHdr_t) + 1;
+	if (pCfg->BuffSize < recSizeMin || pCfg->SegmentSize < sizeof(RecLog_SegHdr_t) + recSizeMin)
+		return RET_STATE_ERR_PARAM;
+
+	memset(pLog, 0, sizeof(RecLog_t));
+	pLog->Cfg	= *pCfg;
+	pLog->Mutex = xSemaphoreCreateMutex();
+	if (pLog->Mutex == NULL)
+		return RET_STATE_ERR_MEMORY;
+
+	/* fails if the directory exists */
+	FsWrap_Mkdir(pCfg->pDir);
+
+	bool isFound;
+	RET_STATE_t res = RecLog_SegFind(pLog, &isFound);
+	if (res == RET_STATE_SUCCESS)
+		res = isFound ? RecLog_Recover(pLog) : RecLog_SegCreate(pLog, 0, 0);
+
+	if (res == RET_STATE_SUCCESS) {
+		res = RET_STATE_ERR_BUSY;
+		vTaskSuspendAll();
+		for (u32 i = 0; i < RECLOG_LOGS_MAX; i++) {
+			if (RecLog_Logs[i] == NULL) {
+				RecLog_Logs[i] = pLog;
+				res			   = RET_STATE_SUCCESS;
+				break;
+			}
+		}
+		xTaskResumeAll();
+
+		if (res != RET_STATE_SUCCESS)
+			FsWrap_Close(&pLog->File);
+	}
+
+	if (res != RET_STATE_SUCCESS) {
+		vSemaphoreDelete(pLog->Mutex);
+		pLog->Mutex = NULL;
+		return res;
+	}
+
+	pLog->IsOpen = true;
+	LOCAL_DEBUG_LOG_PRINT("Opened '%s', segments %d..%d, next seq %d\r\n", pCfg->pDir,
+						  pLog->SegFirst, pLog->SegLast, pLog->NextSeq);
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t RecLog_Append(RecLog_t* pLog, const void* pData, u32 size) {
+	if (pLog == NULL || pData == NULL || pLog->Mutex == NULL)
+		return RET_STATE_ERR_PARAM;
+
+	u32 recSize		= sizeof(RecLog_RecHdr_t) + size;
+	RET_STATE_t res = RET_STATE_SUCCESS;
+
+	xSemaphoreTake(pLog->Mutex, SYS_MAX_TIMEOUT);
+	if (!pLog->IsOpen || size == 0 || size > RECLOG_RECORD_SIZE_MAX ||
+		recSize > pLog->Cfg.BuffSize || sizeof(RecLog_SegHdr_t) + recSize > pLog->Cfg.SegmentSize)
+		res = RET_STATE_ERR_PARAM;
+
+	if (res == RET_STATE_SUCCESS && pLog->BuffLen + recSize > pLog->Cfg.BuffSize)
+		res = RecLog_CommitLocked(pLog);
+
+	u32 segEnd = pLog->SegPos + pLog->BuffLen + recSize;
+	if (res == RET_STATE_SUCCESS && segEnd > pLog->Cfg.SegmentSize) {
+		res = RecLog_CommitLocked(pLog);
+		if (res == RET_STATE_SUCCESS)
+			res = RecLog_SegNext(pLog);
+	}
+
+	if (res != RET_STATE_SUCCESS) {
+		pLog->Stats.Rejected++;
+		xSemaphoreGive(pLog->Mutex);
+		return res;
+	}
+
+	u8* pRec			   = &pLog->Cfg.pBuff[pLog->BuffLen];
+	RecLog_RecHdr_t recHdr = {
+		.Magic = RECLOG_REC_MAGIC,
+		.Len   = (u16)size,
+		.Seq   = pLog->NextSeq,
+	};
+	memcpy(pRec, &recHdr, sizeof(recHdr));
+	memcpy(pRec + sizeof(recHdr), pData, size);
+	recHdr.Crc = RecLog_Crc(pRec + sizeof(u32), recSize - sizeof(u32));
+	memcpy(pRec, &recHdr.Crc, sizeof(u32));
+
+	if (pLog->BuffLen == 0)
+		pLog->PendingSince = PL_GET_MS_CNT();
+	pLog->BuffLen += recSize;
+	pLog->NextSeq++;
+	pLog->Stats.Appended++;
+	xSemaphoreGive(pLog->Mutex);
+
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t RecLog_Commit(RecLog_t* pLog) {
+	if (pLog == NULL || pLog->Mutex == NULL)
+		return RET_STATE_ERR_PARAM;
+
+	xSemaphoreTake(pLog->Mutex, SYS_MAX_TIMEOUT);
+	RET_STATE_t res = pLog->IsOpen ? RecLog_CommitLocked(pLog) : RET_STATE_ERR_PARAM;
+	xSemaphoreGive(pLog->Mutex);
+	return res;
+}
+
+RET_STATE_t RecLog_Replay(RecLog_t* pLog, RecLog_ReplayClbk_t clbk, void* pCtx) {
+	if (pLog == NULL || clbk == NULL || pLog->Mutex == NULL)
+		return RET_STATE_ERR_PARAM;
+
+	xSemaphoreTake(pLog->Mutex, SYS_MAX_TIMEOUT);
+	RET_STATE_t res = pLog->IsOpen ? RecLog_CommitLocked(pLog) : RET_STATE_ERR_PARAM;
+
+	RecLog_Scan_t scan;
+	for (u32 segIdx = pLog->SegFirst; res == RET_STATE_SUCCESS && segIdx <= pLog->SegLast;
+		 segIdx++) {
+		if (segIdx == pLog->SegLast) {
+			pLog->FilePos = RECLOG_POS_UNDEF;
+			res			  = RecLog_ScanSeg(pLog, &pLog->File, segIdx, &scan, clbk, pCtx);
+			break;
+		}
+
+		char path[RECLOG_PATH_LEN];
+		FsWrap_File_t file;
+		memset(&file, 0, sizeof(file));
+		RecLog_SegPath(pLog, segIdx, path);
+
+		/* a segment removed by hand leaves a gap in the sequence numbers */
+		if (FsWrap_Open(&file, path, FS_MODE_READ) != RET_STATE_SUCCESS)
+			continue;
+
+		res = RecLog_ScanSeg(pLog, &file, segIdx, &scan, clbk, pCtx);
+		FsWrap_Close(&file);
+		if (scan.IsStopped)
+			break;
+	}
+	xSemaphoreGive(pLog->Mutex);
+
+	return res;
+}
+
+RET_STATE_t RecLog_Close(RecLog_t* pLog) {
+	if (pLog == NULL || pLog->Mutex == NULL)
+		return RET_STATE_ERR_PARAM;
+
+	xSemaphoreTake(pLog->Mutex, SYS_MAX_TIMEOUT);
+	RET_STATE_t res = RET_STATE_SUCCESS;
+	if (pLog->IsOpen) {
+		res = RecLog_CommitLocked(pLog);
+
+		RET_STATE_t closeRes = FsWrap_Close(&pLog->File);
+		if (res == RET_STATE_SUCCESS)
+			res = closeRes;
+		pLog->IsOpen = false;
+	}
+
+	vTaskSuspendAll();
+	for (u32 i = 0; i < RECLOG_LOGS_MAX; i++) {
+		if (RecLog_Logs[i] == pLog)
+			RecLog_Logs[i] = NULL;
+	}
+	xTaskResumeAll();
+	xSemaphoreGive(pLog->Mutex);
+
+	/* no other task may use the log from now on */
+	vSemaphoreDelete(pLog->Mutex);
+	pLog->Mutex = NULL;
+	return res;
+}
+
+RecLog_Stats_t RecLog_GetStats(RecLog_t* pLog) {
+	RecLog_Stats_t stats = {0};
+	if (pLog == NULL || pLog->Mutex == NULL)
+		return stats;
+
+	xSemaphoreTake(pLog->Mutex, SYS_MAX_TIMEOUT);
+	stats = pLog->Stats;
+	xSemaphoreGive(pLog->Mutex);
+	return stats;
+}
+
+/**
+ * @brief commits the logs whose oldest buffered record reached the latency bound
+ */
+static void vTask_RecLog_Process(void* pvParameters) {
+	for (;;) {
+		SYS_DELAY_MS(RECLOG_COMMIT_PERIOD);
+
+		for (u32 i = 0; i < RECLOG_LOGS_MAX; i++) {
+			/* the log can't be removed from the list and deleted in between,
+			 * RecLog_Close() removes it with the scheduler suspended */
+			vTaskSuspendAll();
+			RecLog_t* pLog = RecLog_Logs[i];
+			bool isTaken   = pLog != NULL && xSemaphoreTake(pLog->Mutex, 0) == pdTRUE;
+			xTaskResumeAll();
+			if (!isTaken)
+				continue;
+
+			if (pLog->IsOpen && pLog->BuffLen &&
+				PL_GET_MS_CNT() - pLog->PendingSince >= pLog->Cfg.CommitLatency) {
+				RET_STATE_t res = RecLog_CommitLocked(pLog);
+				LOCAL_DEBUG_LOG_PRINT("Timed commit, %s\r\n", RetState_GetStr(res));
+				DISCARD_UNUSED(res);
+			}
+			xSemaphoreGive(pLog->Mutex);
+		}
+	}
+}
+
+void FreeRTOS_RecLog_InitComponents(bool resources, bool tasks) {
+	if (resources) {
+	}
+
+	if (tasks) {
+		RTOS_Analyzer_CreateTask(vTask_RecLog_Process, "reclog", RECLOG_TASK_STACK, NULL,
+								 RECLOG_TASK_PRIORITY, &RecLog_Handle);
+	}
+}
@@ -0,0 +1,126 @@
+#ifndef __RECORD_LOG_H
+#define __RECORD_LOG_H
+
+#include "fs_wrapper.h"
+#include "main.h"
+
+#define RECLOG_LOGS_MAX		   2 // open logs committed by the reclog task
+#define RECLOG_PATH_LEN		   48
+#define RECLOG_RECORD_SIZE_MAX 1024
+#define RECLOG_COMMIT_PERIOD   (DELAY_1_SECOND / 20)
+
+typedef struct {
+	const char* pDir;  // directory of the segment files, created if missing
+	u32 SegmentSize;   // bytes, reserved when a segment is created
+	u32 SegmentsMax;   // the oldest segments are removed above, 0 to keep all
+	u32 CommitLatency; // ms, the longest time an appended record stays in RAM
+	u8* pBuff;		   // commit buffer, owned by the caller
+	u32 BuffSize;
+} RecLog_Cfg_t;
+
+typedef struct {
+	u32 Appended;
+	u32 Rejected; // too long records and appends to a failed log
+	u32 Commits;
+	u32 CommitMaxUs;
+	u32 Segments;  // created since open
+	u32 Recovered; // valid records found in the last segment on open
+	u32 TornBytes; // cut from the last segment on open, includes unused reserved space
+} RecLog_Stats_t;
+
+/**
+ * @brief Record log object, owned by the caller. The fields are private.
+ */
+typedef struct {
+	RecLog_Cfg_t Cfg;
+	FsWrap_File_t File;
+	SemaphoreHandle_t Mutex;
+	u32 SegFirst;
+	u32 SegLast;
+	u32 SegPos;	 // committed bytes of the last segment
+	u32 FilePos; // file position, a seek is skipped when it is the commit position
+	u32 NextSeq; // sequence number of the next appended record
+	u32 BuffLen;
+	u32 PendingSince;  // ms, the oldest record waiting for a commit
+	RET_STATE_t Error; // the last commit failure, appends are rejected until a commit succeeds
+	bool IsOpen;
+	RecLog_Stats_t Stats;
+} RecLog_t;
+
+/* Returns false to stop the replay */
+typedef bool (*RecLog_ReplayClbk_t)(u32 seq, const u8* pData, u32 size, void* pCtx);
+
+/**
+ * @brief Open or create a record log
+ *
+ * Looks up the segment files in @p pCfg->pDir and scans the last one: the
+ * records are checked one by one (length, CRC, sequence number) and the file
+ * is cut after the last valid record, so a record torn by a reset is dropped
+ * and appending continues after it. Only the last segment is scanned, the
+ * older ones were committed before the log moved on.
+ *
+ * @param pLog Pointer to the log object
+ * @param pCfg Pointer to the configuration, copied
+ *
+ * @retval RET_STATE_SUCCESS on success;
+ * @retval RET_STATE_ERR_PARAM on a bad configuration;
+ * @retval RET_STATE_ERR_BUSY when RECLOG_LOGS_MAX logs are open;
+ * @retval RET_STATE_ERROR or an other errno code from the file system.
+ */
+RET_STATE_t RecLog_Open(RecLog_t* pLog, const RecLog_Cfg_t* pCfg);
+
+/**
+ * @brief Append a record
+ *
+ * Copies the record to the commit buffer and returns. The buffer is committed
+ * (written and synced) by the reclog task at the latest @p CommitLatency ms
+ * after the oldest record in it was appended, by the appending task when it
+ * is full, or by RecLog_Commit(). All the records of one commit cost one sync.
+ *
+ * @param pLog Pointer to the log object
+ * @param pData Pointer to the record
+ * @param size Record size, up to RECLOG_RECORD_SIZE_MAX and the buffer size
+ *
+ * @retval RET_STATE_SUCCESS when buffered;
+ * @retval RET_STATE_ERR_PARAM on a bad record;
+ * @retval The error of a failed commit, the record is not stored.
+ */
+RET_STATE_t RecLog_Append(RecLog_t* pLog, const void* pData, u32 size);
+
+/**
+ * @brief Commit the buffered records
+ *
+ * The records appended before the call are on the media when it returns.
+ *
+ * @param pLog Pointer to the log object
+ *
+ * @retval RET_STATE_SUCCESS on success;
+ * @retval RET_STATE_ERROR or an other errno code from the file system.
+ */
+RET_STATE_t RecLog_Commit(RecLog_t* pLog);
+
+/**
+ * @brief Read all the records from the oldest segment
+ *
+ * Commits the buffered records first and then uses the commit buffer for
+ * reading, so appends of other tasks wait until the replay is finished.
+ *
+ * @param pLog Pointer to the log object
+ * @param clbk Called for every record in the order of appending
+ * @param pCtx Passed to @p clbk
+ *
+ * @retval RET_STATE_SUCCESS on success or when stopped by @p clbk;
+ * @retval RET_STATE_ERROR or an other errno code from the file system.
+ */
+RET_STATE_t RecLog_Replay(RecLog_t* pLog, RecLog_ReplayClbk_t clbk, void* pCtx);
+
+/**
+ * @brief Commit the buffered records and close the log
+ */
+RET_STATE_t RecLog_Close(RecLog_t* pLog);
+
+RecLog_Stats_t RecLog_GetStats(RecLog_t* pLog);
+
+void FreeRTOS_RecLog_InitComponents(bool resources, bool tasks);
+
+#endif /* __RECORD_LOG_H */
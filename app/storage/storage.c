@@ -1,22 +1,24 @@
+#define DEBUG_MODULE DBG_MOD_STORAGE
+
 #include "storage.h"
 #include "debug.h"
+#include "delay.h"
 #include "ff.h"
+#include "fs_async.h"
 #include "fs_wrapper.h"
+#include "io_msc.h"
+#include "record_log.h"
 #include "rtos_analyzer.h"
+#include "storage_cache.h"
+#include "storage_cfg.h"
+#include "storage_ram.h"
 
 #if DEBUG_ENABLE
-#define LOCAL_DEBUG_PRINT_ENABLE 0
-#define LOCAL_DEBUG_TEST_ENABLE	 0
+#define LOCAL_DEBUG_TEST_ENABLE 0
 #endif /* DEBUG_ENABLE */
 
-#if LOCAL_DEBUG_PRINT_ENABLE
-#warning LOCAL_DEBUG_PRINT_ENABLE
-#define LOCAL_DEBUG_PRINT	  DEBUG_PRINT_NL
-#define LOCAL_DEBUG_LOG_PRINT DEBUG_LOG_PRINT
-#else /* LOCAL_DEBUG_PRINT_ENABLE */
-#define LOCAL_DEBUG_PRINT(_f_, ...)
-#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)
-#endif /* LOCAL_DEBUG_PRINT_ENABLE */
+#define LOCAL_DEBUG_PRINT(_f_, ...)		DEBUG_TRACE_DO(DEBUG_PRINT_NL(_f_, ##__VA_ARGS__))
+#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)	DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
 
 static bool Storage_EmmcHw_InitState;
 static bool Storage_EmmcFs_InitState;
@@ -25,11 +27,310 @@ static FATFS Storage_EmmcFsObj;
 
 static bool Storage_RamHw_InitState;
 static bool Storage_RamFs_InitState;
-static u8 PL_STORAGE_IN_RAM_DATA RamStorageBuff[APP_RAM_STORAGE_CAPACITY];
 static FATFS Storage_RamFsObj;
+static FsWrap_Mount_t Storage_RamMountObj;
 
 static u32 Storage_ReadWriteOps_LastTime;
 
+typedef enum {
+	STORAGE_XFER_IDLE = 0,
+	STORAGE_XFER_BUSY,
+	STORAGE_XFER_DONE,
+	STORAGE_XFER_ERROR,
+} Storage_XferState_t;
+
+static SemaphoreHandle_t Storage_EmmcXfer_Mutex;
+static TaskHandle_t Storage_EmmcXfer_Task;
+static u8* Storage_EmmcAsync_pData;
+static u32 Storage_EmmcAsync_Len;
+static bool Storage_EmmcAsync_IsWrite;
+static volatile Storage_XferState_t Storage_EmmcXfer_State;
+static Storage_XferStats_t Storage_EmmcXfer_Stats;
+static u32 Storage_EmmcCrc_InRow;
+static Storage_ReadyStats_t Storage_EmmcReady_Stats;
+static Storage_TrimStats_t Storage_EmmcTrim_Stats;
+/* .bss is placed in AXI SRAM, which is reachable by SDMMC1 IDMA */
+static u8 Storage_EmmcDmaBuff[STORAGE_EMMC_DMA_BUFF_BLOCKS * PL_SDMMC_SECTOR_SIZE]
+	__attribute__((aligned(PL_DCACHE_LINE_SIZE)));
+
+/**
+ * @brief called from SDMMC IRQ on transfer complete or error
+ */
+static void Storage_Emmc_XferClbk(bool isOk) {
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	if (Storage_EmmcXfer_State != STORAGE_XFER_BUSY)
+		return;
+
+	Storage_EmmcXfer_State = isOk ? STORAGE_XFER_DONE : STORAGE_XFER_ERROR;
+	vTaskNotifyGiveIndexedFromISR(Storage_EmmcXfer_Task, STORAGE_EMMC_XFER_NOTIFY_IDX,
+								  &xHigherPriorityTaskWoken);
+
+	if (xHigherPriorityTaskWoken == pdTRUE)
+		portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+}
+
+static bool Storage_IsTaskContext(void) {
+	return SYS_OS_IS_RUNNING() && !xPortIsInsideInterrupt();
+}
+
+/**
+ * @brief DMA path needs a task to block on, init runs before
+ * the scheduler and uses polling
+ */
+static bool Storage_Emmc_IsDmaAllowed(void) {
+#if STORAGE_EMMC_DMA_ENABLE
+	return Storage_EmmcXfer_Mutex != NULL && Storage_IsTaskContext();
+#else  /* STORAGE_EMMC_DMA_ENABLE */
+	return false;
+#endif /* STORAGE_EMMC_DMA_ENABLE */
+}
+
+/**
+ * @brief every command to the card goes under the transfer mutex, CMD13
+ * included, so it can't reach SDMMC1 during a DMA transfer of another
+ * task. A transfer started by Storage_Emmc_XferStart() keeps the mutex
+ * until it is waited for or aborted. Before the scheduler starts only
+ * init touches the card
+ */
+static bool Storage_Emmc_Lock(void) {
+	if (Storage_EmmcXfer_Mutex == NULL || !Storage_IsTaskContext())
+		return false;
+
+	xSemaphoreTake(Storage_EmmcXfer_Mutex, SYS_MAX_TIMEOUT);
+	return true;
+}
+
+static void Storage_Emmc_Unlock(bool isLocked) {
+	if (isLocked)
+		xSemaphoreGive(Storage_EmmcXfer_Mutex);
+}
+
+static void Storage_Emmc_ReadyBackoff(u32* pStepUs, bool isTask) {
+	/* steps shorter than a tick are waited out, so CMD13 is not sent back to back */
+	if (isTask && *pStepUs >= 1000) {
+		SYS_DELAY_MS(*pStepUs / 1000);
+	} else {
+		Delay_WaitTime_MicroSec(*pStepUs);
+	}
+
+	*pStepUs = GET_MIN(*pStepUs * 2, STORAGE_EMMC_READY_STEP_MAX_US);
+}
+
+/**
+ * @brief waits until the card leaves the programming state, the card
+ * is polled by CMD13 with an exponential backoff between the polls.
+ * Before the scheduler starts it can only spin, so a shorter deadline
+ * is used there
+ */
+static bool Storage_Emmc_AwaitReadyLocked(void) {
+	if (Pl_Emmc_IsCardInTransfer()) {
+		Storage_EmmcReady_Stats.Waits++;
+		return true;
+	}
+
+	u64 startTime = PL_GET_US_CNT();
+	u32 stepUs	  = STORAGE_EMMC_READY_STEP_MIN_US;
+	bool isTask	  = Storage_IsTaskContext();
+	u64 tmoUs	  = (isTask ? STORAGE_EMMC_READY_TMO : STORAGE_EMMC_READY_SPIN_TMO) * 1000ULL;
+	bool res	  = true;
+
+	while (!Pl_Emmc_IsCardInTransfer()) {
+		if (PL_GET_US_CNT() - startTime >= tmoUs) {
+			res = false;
+			break;
+		}
+
+		Storage_Emmc_ReadyBackoff(&stepUs, isTask);
+		Storage_EmmcReady_Stats.Polls++;
+	}
+
+	u32 latencyUs = (u32)(PL_GET_US_CNT() - startTime);
+
+	Storage_EmmcReady_Stats.Waits++;
+	Storage_EmmcReady_Stats.BusyWaits++;
+	Storage_EmmcReady_Stats.BusyTimeUs += latencyUs;
+	Storage_EmmcReady_Stats.LastUs = latencyUs;
+	if (latencyUs > Storage_EmmcReady_Stats.MaxUs)
+		Storage_EmmcReady_Stats.MaxUs = latencyUs;
+
+	if (!res) {
+		Storage_EmmcReady_Stats.Timeouts++;
+		LOCAL_DEBUG_LOG_PRINT("Ready timeout: cardState %d\r\n", Pl_Emmc_GetCardState());
+	}
+
+	return res;
+}
+
+bool Storage_Emmc_AwaitReady(void) {
+	bool isLocked = Storage_Emmc_Lock();
+	bool res	  = Storage_Emmc_AwaitReadyLocked();
+	Storage_Emmc_Unlock(isLocked);
+
+	return res;
+}
+
+static bool Storage_Emmc_XferChunkDMA(u8* pData, u32 blockIdx, u32 blockNum, bool isWrite) {
+	/* drop a late notification of a timed out transfer */
+	ulTaskNotifyTakeIndexed(STORAGE_EMMC_XFER_NOTIFY_IDX, pdTRUE, 0);
+	Storage_EmmcXfer_Task  = xTaskGetCurrentTaskHandle();
+	Storage_EmmcXfer_State = STORAGE_XFER_BUSY;
+
+	bool res = isWrite ? Pl_Emmc_WriteDMA(pData, blockIdx, blockNum)
+					   : Pl_Emmc_ReadDMA(pData, blockIdx, blockNum);
+	if (!res) {
+		Storage_EmmcXfer_State = STORAGE_XFER_IDLE;
+		Storage_EmmcXfer_Stats.Errors++;
+		return false;
+	}
+
+	u32 tmo = STORAGE_EMMC_DMA_TMO_PER_BLOCK * blockNum;
+	if (ulTaskNotifyTakeIndexed(STORAGE_EMMC_XFER_NOTIFY_IDX, pdTRUE, pdMS_TO_TICKS(tmo)) == 0) {
+		SYS_CRITICAL_ON();
+		Storage_EmmcXfer_State = STORAGE_XFER_IDLE;
+		SYS_CRITICAL_OFF();
+
+		Pl_Emmc_AbortDMA();
+		Storage_EmmcXfer_Stats.Timeouts++;
+		LOCAL_DEBUG_LOG_PRINT("DMA timeout: block %d, num %d\r\n", blockIdx, blockNum);
+		return false;
+	}
+
+	res					   = Storage_EmmcXfer_State == STORAGE_XFER_DONE;
+	Storage_EmmcXfer_State = STORAGE_XFER_IDLE;
+	if (!res)
+		Storage_EmmcXfer_Stats.Errors++;
+
+	return res;
+}
+
+static bool Storage_Emmc_XferDMA(u8* pData, u32 blockIdx, u32 blockNum, bool isWrite) {
+	u32 len	 = blockNum * PL_SDMMC_SECTOR_SIZE;
+	bool res = true;
+
+	if (Pl_Emmc_IsDmaBuff(pData, len)) {
+		if (isWrite)
+			Pl_DCache_Clean(pData, len);
+		else
+			Pl_DCache_Invalidate(pData, len);
+
+		res = Storage_Emmc_XferChunkDMA(pData, blockIdx, blockNum, isWrite);
+		if (res && !isWrite)
+			Pl_DCache_Invalidate(pData, len);
+
+		Storage_EmmcXfer_Stats.DmaXfers++;
+		return res;
+	}
+
+	while (blockNum && res) {
+		u32 chunkNum = GET_MIN(blockNum, STORAGE_EMMC_DMA_BUFF_BLOCKS);
+		u32 chunkLen = chunkNum * PL_SDMMC_SECTOR_SIZE;
+
+		if (isWrite) {
+			memcpy(Storage_EmmcDmaBuff, pData, chunkLen);
+			Pl_DCache_Clean(Storage_EmmcDmaBuff, chunkLen);
+		} else {
+			Pl_DCache_Invalidate(Storage_EmmcDmaBuff, chunkLen);
+		}
+
+		res = Storage_Emmc_XferChunkDMA(Storage_EmmcDmaBuff, blockIdx, chunkNum, isWrite);
+		if (res && !isWrite) {
+			Pl_DCache_Invalidate(Storage_EmmcDmaBuff, chunkLen);
+			memcpy(pData, Storage_EmmcDmaBuff, chunkLen);
+		}
+
+		Storage_EmmcXfer_Stats.BounceXfers++;
+		pData += chunkLen;
+		blockIdx += chunkNum;
+		blockNum -= chunkNum;
+
+		if (res && blockNum)
+			res = Storage_Emmc_AwaitReadyLocked();
+	}
+
+	return res;
+}
+
+static bool Storage_Emmc_XferOnce(u8* pData, u32 blockIdx, u32 blockNum, bool isWrite) {
+	if (!Storage_Emmc_AwaitReadyLocked())
+		return false;
+
+	if (Storage_Emmc_IsDmaAllowed())
+		return Storage_Emmc_XferDMA(pData, blockIdx, blockNum, isWrite);
+
+	Storage_EmmcXfer_Stats.PollXfers++;
+	return isWrite ? Pl_Emmc_Write(pData, blockIdx, blockNum)
+				   : Pl_Emmc_Read(pData, blockIdx, blockNum);
+}
+
+/**
+ * @brief a CRC error is retried as is first, when they keep coming the bus
+ * steps down one mode (DDR -> HS -> legacy, then narrower widths),
+ * since a marginal trace usually fails only at the faster modes
+ * @retval true when the transfer is worth retrying
+ */
+static bool Storage_Emmc_CrcRecover(void) {
+	if (!Pl_Emmc_IsCrcError())
+		return false;
+
+	Storage_EmmcXfer_Stats.CrcErrors++;
+	if (++Storage_EmmcCrc_InRow < STORAGE_EMMC_CRC_ERRORS_MAX)
+		return true;
+
+	Storage_EmmcCrc_InRow = 0;
+	if (!Pl_Emmc_BusFallback(&Storage_EmmcInfo))
+		return false;
+
+	DEBUG_LOG_LVL_PRINT(LOG_LVL_WARNING, "eMMC CRC errors, bus %d-bit, timing %d, clk %d Hz",
+						Storage_EmmcInfo.BusWidth, Storage_EmmcInfo.Timing,
+						Storage_EmmcInfo.BusClk);
+	return true;
+}
+
+static bool Storage_Emmc_Xfer(u8* pData, u32 blockIdx, u32 blockNum, bool isWrite) {
+	bool isLocked = Storage_Emmc_Lock();
+	bool res	  = Storage_Emmc_XferOnce(pData, blockIdx, blockNum, isWrite);
+
+	for (u32 i = 0; !res && i < STORAGE_EMMC_CRC_RETRIES && Storage_Emmc_CrcRecover(); i++)
+		res = Storage_Emmc_XferOnce(pData, blockIdx, blockNum, isWrite);
+
+	if (res)
+		Storage_EmmcCrc_InRow = 0;
+
+	Storage_Emmc_Unlock(isLocked);
+	return res;
+}
+
+/**
+ * @brief the drive is cleared by StorageRam_Init, so the mount formats it
+ * unless a snapshot has been loaded into it
+ */
+static bool Storage_RamMount(void) {
+	char discLabel[32];
+
+	Storage_RamMountObj = (FsWrap_Mount_t){
+		.pFsData	   = &Storage_RamFsObj,
+		.pMntPointPath = STORAGE_RAM_ROOT_PATH,
+	};
+
+	RET_STATE_t res = FsWrap_Mount(&Storage_RamMountObj);
+	DEBUG_LOG_LVL_PRINT(LOG_LVL_INFO, "RAM mounted on '%s' with res %s",
+						Storage_RamMountObj.pMntPointPath, RetState_GetStr(res));
+	if (res != RET_STATE_SUCCESS) {
+		DEBUG_LOG_LVL_PRINT(LOG_LVL_ERROR, "Storage RAM init failed!");
+		return false;
+	}
+
+	char tmpBuff[32];
+	snprintf(tmpBuff, sizeof(tmpBuff), "%s%s", Storage_RamMountObj.pMntPointPath, "prss ram");
+	FsWrap_SetLabel(tmpBuff);
+	FsWrap_GetLabel(Storage_RamMountObj.pMntPointPath, discLabel, NULL);
+	DEBUG_LOG_LVL_PRINT(LOG_LVL_INFO, "Storage RAM FS inited on '%s' with label '%s', %s %d bytes",
+						Storage_RamMountObj.pMntPointPath, discLabel, StorageRam_GetRegionStr(),
+						StorageRam_GetCapacity());
+	return true;
+}
+
 Pl_SdEmmcInfo_t Storage_GetEmmcInfo(void) {
 	return Storage_EmmcInfo;
 };
@@ -39,7 +340,7 @@ void Storage_Init(void) {
 
 	FsWrap_Init();
 
-	bool eMmcInit = Pl_Emmc_Init(&Storage_EmmcInfo);
+	bool eMmcInit = Pl_Emmc_Init(&Storage_EmmcInfo, Storage_Emmc_XferClbk);
 	Delay_WaitTime_MilliSec(DELAY_1_MILSEC * 100);
 
 	u32 emmcState = Pl_Emmc_GetCardState();
@@ -54,9 +355,14 @@ void Storage_Init(void) {
 						Storage_EmmcInfo.RelCardAdd, Storage_EmmcInfo.BlockNbr,
 						Storage_EmmcInfo.BlockSize, Storage_EmmcInfo.LogBlockNbr,
 						Storage_EmmcInfo.LogBlockSize);
+	DEBUG_LOG_LVL_PRINT(LOG_LVL_INFO, "eMMC bus %d-bit, timing %d, clk %d Hz, fallbacks %d",
+						Storage_EmmcInfo.BusWidth, Storage_EmmcInfo.Timing, Storage_EmmcInfo.BusClk,
+						Storage_EmmcInfo.BusFallbacks);
 
 	Storage_EmmcHw_InitState = eMmcInit && Pl_Emmc_IsCardInTransfer();
 	if (Storage_EmmcHw_InitState) {
+		StorageCache_Init(Storage_EmmcInfo.LogBlockNbr);
+
 		FsWrap_Mount_t emmcMount = {
 			.pFsData	   = &Storage_EmmcFsObj,
 			.pMntPointPath = STORAGE_EMMC_ROOT_PATH,
@@ -79,28 +385,16 @@ void Storage_Init(void) {
 		DEBUG_LOG_LVL_PRINT(LOG_LVL_ERROR, "eMMC HW init failed!");
 	}
 
-	FsWrap_Mount_t ramMount = {
-		.pFsData	   = &Storage_RamFsObj,
-		.pMntPointPath = STORAGE_RAM_ROOT_PATH,
-	};
-
-	Storage_RamHw_InitState = true;
-
-	RET_STATE_t res = FsWrap_Mount(&ramMount);
-	DEBUG_LOG_LVL_PRINT(LOG_LVL_INFO, "RAM mounted on '%s' with res %s", ramMount.pMntPointPath,
-						RetState_GetStr(res));
-	if (res == RET_STATE_SUCCESS) {
-		Storage_RamFs_InitState = true;
-		ASSERT_CHECK(Storage_RamFs_InitState);
-
-		char tmpBuff[32];
-		snprintf(tmpBuff, sizeof(tmpBuff), "%s%s", ramMount.pMntPointPath, "prss ram");
-		FsWrap_SetLabel(tmpBuff);
-		FsWrap_GetLabel(ramMount.pMntPointPath, discLabel, NULL);
-		DEBUG_LOG_LVL_PRINT(LOG_LVL_INFO, "Storage RAM FS inited on '%s' with label '%s'",
-							ramMount.pMntPointPath, discLabel);
+	Storage_RamHw_InitState = StorageRam_Init(STORAGE_RAM_CAPACITY_DEF);
+	if (Storage_RamHw_InitState) {
+#if STORAGE_RAM_SNAPSHOT_ENABLE
+		if (Storage_EmmcFs_InitState && StorageRam_SnapshotLoad(STORAGE_RAM_SNAPSHOT_PATH))
+			DEBUG_LOG_LVL_PRINT(LOG_LVL_INFO, "Storage RAM restored from '%s'",
+								STORAGE_RAM_SNAPSHOT_PATH);
+#endif /* STORAGE_RAM_SNAPSHOT_ENABLE */
+		Storage_RamFs_InitState = Storage_RamMount();
 	} else {
-		DEBUG_LOG_LVL_PRINT(LOG_LVL_ERROR, "Storage RAM init failed!");
+		DEBUG_LOG_LVL_PRINT(LOG_LVL_ERROR, "RAM HW init failed!");
 	}
 }
 
@@ -117,23 +411,161 @@ bool Storage_Emmc_GetDeviceInfo(Pl_SdEmmcInfo_t* pSdEmmcInfo) {
 }
 
 bool Storage_Emmc_Read(u8* pData, u32 blockIdx, u32 blockNum) {
-	LOCAL_DEBUG_LOG_PRINT("R: from %d with len %d\r\n", offset, len);
+	LOCAL_DEBUG_LOG_PRINT("R: from %d with len %d\r\n", blockIdx, blockNum);
 	Storage_ReadWriteOps_LastTime = PL_GET_MS_CNT();
-	return Pl_Emmc_Read(pData, blockIdx, blockNum);
+
+	return Storage_Emmc_Xfer(pData, blockIdx, blockNum, false);
 }
 
 bool Storage_Emmc_Write(const u8* pData, u32 blockIdx, u32 blockNum) {
-	LOCAL_DEBUG_LOG_PRINT("W: to %d with len %d\r\n", offset, len);
+	LOCAL_DEBUG_LOG_PRINT("W: to %d with len %d\r\n", blockIdx, blockNum);
 	Storage_ReadWriteOps_LastTime = PL_GET_MS_CNT();
-	return Pl_Emmc_Write(pData, blockIdx, blockNum);
+
+	return Storage_Emmc_Xfer((u8*)pData, blockIdx, blockNum, true);
+}
+
+/**
+ * @brief starts a DMA transfer without waiting for it, so the caller can
+ * overlap it with other work (USB MSC pipeline). The caller owns the card
+ * until Storage_Emmc_XferWait() returns true or the transfer is aborted,
+ * other users block on the transfer mutex meanwhile. @p pData must be DMA
+ * capable and cache line aligned
+ */
+bool Storage_Emmc_XferStart(u8* pData, u32 blockIdx, u32 blockNum, bool isWrite) {
+	u32 len = blockNum * PL_SDMMC_SECTOR_SIZE;
+
+	if (!Storage_Emmc_IsDmaAllowed() || !Pl_Emmc_IsDmaBuff(pData, len))
+		return false;
+
+	Storage_ReadWriteOps_LastTime = PL_GET_MS_CNT();
+	bool isLocked				  = Storage_Emmc_Lock();
+	if (!Storage_Emmc_AwaitReadyLocked()) {
+		Storage_Emmc_Unlock(isLocked);
+		return false;
+	}
+
+	if (isWrite)
+		Pl_DCache_Clean(pData, len);
+	else
+		Pl_DCache_Invalidate(pData, len);
+
+	/* drop a late notification of a timed out transfer */
+	ulTaskNotifyTakeIndexed(STORAGE_EMMC_XFER_NOTIFY_IDX, pdTRUE, 0);
+	Storage_EmmcAsync_pData	  = pData;
+	Storage_EmmcAsync_Len	  = len;
+	Storage_EmmcAsync_IsWrite = isWrite;
+	Storage_EmmcXfer_Task	  = xTaskGetCurrentTaskHandle();
+	Storage_EmmcXfer_State	  = STORAGE_XFER_BUSY;
+
+	bool res = isWrite ? Pl_Emmc_WriteDMA(pData, blockIdx, blockNum)
+					   : Pl_Emmc_ReadDMA(pData, blockIdx, blockNum);
+	if (!res) {
+		Storage_EmmcXfer_State = STORAGE_XFER_IDLE;
+		Storage_EmmcXfer_Stats.Errors++;
+		Storage_Emmc_Unlock(isLocked);
+		return false;
+	}
+
+	Storage_EmmcXfer_Stats.DmaXfers++;
+	return true;
+}
+
+/**
+ * @brief waits up to @p tmoMs for the transfer started by
+ * Storage_Emmc_XferStart(), from the task which started it
+ * @retval false while the transfer is in flight, true when it is over
+ * with the result in @p pIsOk and the card is released
+ */
+bool Storage_Emmc_XferWait(bool* pIsOk, u32 tmoMs) {
+	if (Storage_EmmcXfer_State == STORAGE_XFER_BUSY &&
+		ulTaskNotifyTakeIndexed(STORAGE_EMMC_XFER_NOTIFY_IDX, pdTRUE, pdMS_TO_TICKS(tmoMs)) == 0)
+		return false;
+
+	*pIsOk = Storage_EmmcXfer_State == STORAGE_XFER_DONE;
+	if (*pIsOk && !Storage_EmmcAsync_IsWrite)
+		Pl_DCache_Invalidate(Storage_EmmcAsync_pData, Storage_EmmcAsync_Len);
+	if (!*pIsOk)
+		Storage_EmmcXfer_Stats.Errors++;
+
+	Storage_EmmcXfer_State = STORAGE_XFER_IDLE;
+	Storage_Emmc_Unlock(true);
+	return true;
+}
+
+void Storage_Emmc_XferAbort(void) {
+	SYS_CRITICAL_ON();
+	Storage_EmmcXfer_State = STORAGE_XFER_IDLE;
+	SYS_CRITICAL_OFF();
+
+	Pl_Emmc_AbortDMA();
+	Storage_EmmcXfer_Stats.Timeouts++;
+	Storage_Emmc_Unlock(true);
 }
 
 u32 Storage_Emmc_GetCardState(void) {
-	return Pl_Emmc_GetCardState();
+	bool isLocked = Storage_Emmc_Lock();
+	u32 state	  = Pl_Emmc_GetCardState();
+	Storage_Emmc_Unlock(isLocked);
+
+	return state;
 }
 
 u32 Storage_Emmc_IsCardInTransfer(void) {
-	return Pl_Emmc_IsCardInTransfer();
+	bool isLocked = Storage_Emmc_Lock();
+	u32 res		  = Pl_Emmc_IsCardInTransfer();
+	Storage_Emmc_Unlock(isLocked);
+
+	return res;
+}
+
+Storage_XferStats_t Storage_Emmc_GetXferStats(void) {
+	return Storage_EmmcXfer_Stats;
+}
+
+Storage_ReadyStats_t Storage_Emmc_GetReadyStats(void) {
+	return Storage_EmmcReady_Stats;
+}
+
+/**
+ * @brief the range is shrunk to the discard granularity, so a partially
+ * covered 4kB sector stays mapped. The card stays busy after the command,
+ * the next transfer waits for it in Storage_Emmc_AwaitReady
+ */
+bool Storage_Emmc_Discard(u32 blockIdx, u32 blockNum) {
+	u32 align = Storage_EmmcInfo.DiscardAlign;
+	if (align == 0)
+		return false;
+
+	u32 startIdx = (blockIdx + align - 1) / align * align;
+	u32 endIdx	 = (blockIdx + blockNum) / align * align;
+	if (endIdx <= startIdx) {
+		Storage_EmmcTrim_Stats.Skipped++;
+		return true;
+	}
+
+	LOCAL_DEBUG_LOG_PRINT("D: from %d with len %d\r\n", startIdx, endIdx - startIdx);
+
+	bool isLocked = Storage_Emmc_Lock();
+	if (!Storage_Emmc_AwaitReadyLocked()) {
+		Storage_Emmc_Unlock(isLocked);
+		return false;
+	}
+
+	/* the end address is the first block of the last discarded unit */
+	bool res = Pl_Emmc_Discard(startIdx, endIdx - align);
+	Storage_Emmc_Unlock(isLocked);
+	if (!res) {
+		Storage_EmmcTrim_Stats.Errors++;
+		return false;
+	}
+
+	Storage_EmmcTrim_Stats.Cmds++;
+	Storage_EmmcTrim_Stats.Blocks += endIdx - startIdx;
+	return true;
+}
+
+Storage_TrimStats_t Storage_Emmc_GetTrimStats(void) {
+	return Storage_EmmcTrim_Stats;
 }
 
 bool Storage_RamHw_IsInit(void) {
@@ -144,38 +576,64 @@ bool Storage_RamFs_IsInit(void) {
 	return Storage_RamFs_InitState;
 };
 
-u8* Storage_Ram_GetStoragePtr(void) {
-	return RamStorageBuff;
-}
+/**
+ * @brief resizes the RAM drive, the drive is formatted and all of its
+ * files are lost. Files of the RAM volume must be closed
+ */
+bool Storage_Ram_Resize(u32 capacity) {
+	if (capacity < STORAGE_RAM_CAPACITY_MIN || capacity > StorageRam_GetCapacityMax())
+		return false;
+
+	if (Storage_RamFs_InitState) {
+		if (FsWrap_Unmount(&Storage_RamMountObj) != RET_STATE_SUCCESS)
+			return false;
+		Storage_RamFs_InitState = false;
+	}
 
-u32 Storage_Ram_GetStorageCap(void) {
-	return sizeof(RamStorageBuff);
-}
+	Storage_RamHw_InitState = StorageRam_Init(capacity);
+	if (!Storage_RamHw_InitState)
+		return false;
 
-void Storage_Ram_Read(u8* pDst, u32 offset, u32 len) {
-	Storage_ReadWriteOps_LastTime = PL_GET_MS_CNT();
-	LOCAL_DEBUG_LOG_PRINT("R: from %d with len %d\r\n", offset, len);
+	Storage_RamFs_InitState = Storage_RamMount();
+	return Storage_RamFs_InitState;
+}
 
-	if (offset + len > Storage_Ram_GetStorageCap()) {
-		PANIC();
-		return;
+/**
+ * @brief to be called before a planned reset or power off: the RAM drive
+ * is saved to the eMMC and the eMMC cache is written back. Data not
+ * synced by files still open on the RAM volume is not in the snapshot
+ */
+void Storage_Shutdown(void) {
+#if STORAGE_RAM_SNAPSHOT_ENABLE
+	if (Storage_RamFs_InitState && Storage_EmmcFs_InitState) {
+		FsWrap_Lock(STORAGE_RAM_ROOT_PATH);
+		bool res = StorageRam_SnapshotSave(STORAGE_RAM_SNAPSHOT_PATH);
+		FsWrap_Unlock(STORAGE_RAM_ROOT_PATH);
+
+		StorageRam_Stats_t ramStats = StorageRam_GetStats();
+		if (res)
+			DEBUG_LOG_LVL_PRINT(LOG_LVL_INFO, "Storage RAM snapshot saved, %d bytes in %d ms",
+								ramStats.SnapSize, ramStats.SnapTimeMs);
+		else
+			DEBUG_LOG_LVL_PRINT(LOG_LVL_ERROR, "Storage RAM snapshot failed!");
 	}
+#endif /* STORAGE_RAM_SNAPSHOT_ENABLE */
 
-	memcpy((void*)pDst, (void*)&RamStorageBuff[offset], len);
+	if (Storage_EmmcHw_InitState)
+		StorageCache_Flush();
 }
 
-void Storage_Ram_Write(const u8* pSrc, u32 offset, u32 len) {
-	Storage_ReadWriteOps_LastTime = PL_GET_MS_CNT();
-	LOCAL_DEBUG_LOG_PRINT("W: to %d with len %d\r\n", offset, len);
+u32 Storage_GetReadWriteOps_LastTime(void) {
+	return GET_MAX(Storage_ReadWriteOps_LastTime, StorageRam_GetOpsLastTime());
+}
 
-	if (offset + len > Storage_Ram_GetStorageCap()) {
-		PANIC();
-		return;
+void FreeRTOS_Storage_InitComponents(bool resources, bool tasks) {
+	if (resources) {
+		Storage_EmmcXfer_Mutex = xSemaphoreCreateMutex();
 	}
 
-	memcpy((void*)&RamStorageBuff[offset], (void*)pSrc, len);
-}
-
-u32 Storage_GetReadWriteOps_LastTime(void) {
-	return Storage_ReadWriteOps_LastTime;
+	FreeRTOS_StorageCache_InitComponents(resources, tasks);
+	FreeRTOS_FsAsync_InitComponents(resources, tasks);
+	FreeRTOS_RecLog_InitComponents(resources, tasks);
+	FreeRTOS_IoMsc_InitComponents(resources, tasks);
 }
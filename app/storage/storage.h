@@ -21,6 +21,32 @@ typedef enum {
 #define STORAGE_EMMC_ROOT_PATH "0:"
 #define STORAGE_RAM_ROOT_PATH  "1:"
 
+typedef struct {
+	u32 DmaXfers;
+	u32 BounceXfers;
+	u32 PollXfers;
+	u32 Timeouts;
+	u32 Errors;
+	u32 CrcErrors;
+} Storage_XferStats_t;
+
+typedef struct {
+	u32 Waits;
+	u32 BusyWaits;	// waits that found the card not ready
+	u32 Polls;
+	u32 Timeouts;
+	u32 LastUs;
+	u32 MaxUs;
+	u64 BusyTimeUs;
+} Storage_ReadyStats_t;
+
+typedef struct {
+	u32 Cmds;
+	u32 Blocks;	 // actually discarded, after the alignment
+	u32 Skipped; // ranges shorter than the discard granularity
+	u32 Errors;
+} Storage_TrimStats_t;
+
 Pl_SdEmmcInfo_t Storage_GetEmmcInfo(void);
 
 void Storage_Init(void);
@@ -31,17 +57,25 @@ bool Storage_EmmcFs_IsInit(void);
 bool Storage_Emmc_GetDeviceInfo(Pl_SdEmmcInfo_t* pSdEmmcInfo);
 bool Storage_Emmc_Read(u8* pData, u32 blockIdx, u32 blockNum);
 bool Storage_Emmc_Write(const u8* pData, u32 blockIdx, u32 blockNum);
+bool Storage_Emmc_XferStart(u8* pData, u32 blockIdx, u32 blockNum, bool isWrite);
+bool Storage_Emmc_XferWait(bool* pIsOk, u32 tmoMs);
+void Storage_Emmc_XferAbort(void);
 u32 Storage_Emmc_GetCardState(void);
 u32 Storage_Emmc_IsCardInTransfer(void);
+bool Storage_Emmc_AwaitReady(void);
+Storage_XferStats_t Storage_Emmc_GetXferStats(void);
+Storage_ReadyStats_t Storage_Emmc_GetReadyStats(void);
+bool Storage_Emmc_Discard(u32 blockIdx, u32 blockNum);
+Storage_TrimStats_t Storage_Emmc_GetTrimStats(void);
 
 bool Storage_RamHw_IsInit(void);
 bool Storage_RamFs_IsInit(void);
 
-u8* Storage_Ram_GetStoragePtr(void);
-u32 Storage_Ram_GetStorageCap(void);
-void Storage_Ram_Read(u8* pDst, u32 offset, u32 len);
-void Storage_Ram_Write(const u8* pSrc, u32 offset, u32 len);
+bool Storage_Ram_Resize(u32 capacity);
+void Storage_Shutdown(void);
 
 u32 Storage_GetReadWriteOps_LastTime(void);
 
+void FreeRTOS_Storage_InitComponents(bool resources, bool tasks);
+
 #endif /* __STORAGE_H */
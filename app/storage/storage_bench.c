@@ -0,0 +1,362 @@
+#define DEBUG_MODULE DBG_MOD_STORAGE
+
+#include "storage_bench.h"
+#include "debug.h"
+#include "fs_async.h"
+#include "fs_wrapper.h"
+#include "mem_wrapper.h"
+#include "platform.h"
+#include "stringlib.h"
+
+#define LOCAL_DEBUG_PRINT(_f_, ...)		DEBUG_TRACE_DO(DEBUG_PRINT_NL(_f_, ##__VA_ARGS__))
+#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)	DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
+
+#define BENCH_HIST_SUB_NUM (1UL << STORAGE_BENCH_HIST_SUB_BITS)
+#define BENCH_PATH_LEN	   32
+
+#if STORAGE_BENCH_QD_MAX > FS_ASYNC_QUEUE_SIZE
+#error "STORAGE_BENCH_QD_MAX is above the async queue size"
+#endif
+
+static const char* StorageBench_OpStr[] = {
+	[STORAGE_BENCH_OP_WRITE_READ] = "write-read",
+	[STORAGE_BENCH_OP_WRITE]	  = "write",
+	[STORAGE_BENCH_OP_READ]		  = "read",
+	[STORAGE_BENCH_OP_MIXED]	  = "mixed",
+};
+
+static const char* StorageBench_PatternStr[] = {
+	[STORAGE_BENCH_PATTERN_SEQ]	 = "seq",
+	[STORAGE_BENCH_PATTERN_RAND] = "rand",
+};
+
+typedef struct {
+	const StorageBench_Cfg_t* pCfg;
+	StorageBench_Result_t* pRes;
+	FsWrap_File_t File;
+	u8* pBuff; // QueueDepth blocks
+	u32 BlockNum;
+	u32 Rand;
+	u32 WriteCnt;
+	u32 FilePos;
+	/* async path */
+	FsWrap_AsyncReq_t Reqs[STORAGE_BENCH_QD_MAX];
+	StorageBench_Stat_t* pReqStat[STORAGE_BENCH_QD_MAX];
+	u64 ReqStartUs[STORAGE_BENCH_QD_MAX];
+	u32 ReqIdx;
+} StorageBench_Ctx_t;
+
+/**
+ * @brief xorshift32, the sequence depends on the seed only
+ */
+static u32 StorageBench_Rand(StorageBench_Ctx_t* pCtx) {
+	u32 x = pCtx->Rand;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	pCtx->Rand = x;
+	return x;
+}
+
+static u32 StorageBench_HistIdx(u32 us) {
+	if (us < BENCH_HIST_SUB_NUM)
+		return us;
+
+	u32 msb = 31 - __builtin_clz(us);
+	u32 sub = (us >> (msb - STORAGE_BENCH_HIST_SUB_BITS)) & (BENCH_HIST_SUB_NUM - 1);
+	u32 idx = (msb - STORAGE_BENCH_HIST_SUB_BITS + 1) * BENCH_HIST_SUB_NUM + sub;
+	return idx < STORAGE_BENCH_HIST_SIZE ? idx : STORAGE_BENCH_HIST_SIZE - 1;
+}
+
+static u32 StorageBench_HistUpper(u32 idx) {
+	if (idx < BENCH_HIST_SUB_NUM)
+		return idx;
+
+	u32 shift = idx / BENCH_HIST_SUB_NUM - 1;
+	u32 sub	  = idx % BENCH_HIST_SUB_NUM;
+	return ((BENCH_HIST_SUB_NUM + sub + 1) << shift) - 1;
+}
+
+static void StorageBench_Account(StorageBench_Stat_t* pStat, u64 startUs, bool isOk, u32 size) {
+	u32 us = (u32)(PL_GET_US_CNT() - startUs);
+
+	pStat->Ops++;
+	pStat->Hist[StorageBench_HistIdx(us)]++;
+	if (us > pStat->LatMaxUs)
+		pStat->LatMaxUs = us;
+
+	if (isOk) {
+		pStat->Bytes += size;
+	} else {
+		pStat->Errors++;
+	}
+}
+
+static u32 StorageBench_NextOffset(StorageBench_Ctx_t* pCtx, u32 opIdx) {
+	if (pCtx->pCfg->Pattern == STORAGE_BENCH_PATTERN_RAND)
+		return (StorageBench_Rand(pCtx) % pCtx->BlockNum) * pCtx->pCfg->BlockSize;
+
+	return opIdx * pCtx->pCfg->BlockSize;
+}
+
+static bool StorageBench_Sync(StorageBench_Ctx_t* pCtx) {
+	u64 startUs		= PL_GET_US_CNT();
+	RET_STATE_t res = FsWrap_Sync(&pCtx->File);
+	u32 us			= (u32)(PL_GET_US_CNT() - startUs);
+
+	pCtx->pRes->Syncs++;
+	if (us > pCtx->pRes->SyncMaxUs)
+		pCtx->pRes->SyncMaxUs = us;
+
+	return res == RET_STATE_SUCCESS;
+}
+
+static void StorageBench_DirectOp(StorageBench_Ctx_t* pCtx, bool isWrite, u32 offset) {
+	StorageBench_Stat_t* pStat = isWrite ? &pCtx->pRes->Write : &pCtx->pRes->Read;
+	u32 size				   = pCtx->pCfg->BlockSize;
+	u32 done				   = 0;
+
+	u64 startUs		= PL_GET_US_CNT();
+	RET_STATE_t res = RET_STATE_SUCCESS;
+	if (offset != pCtx->FilePos)
+		res = FsWrap_Seek(&pCtx->File, (s32)offset, FS_SEEK_START);
+
+	if (res == RET_STATE_SUCCESS) {
+		res = isWrite ? FsWrap_Write(&pCtx->File, pCtx->pBuff, size, &done)
+					  : FsWrap_Read(&pCtx->File, pCtx->pBuff, size, &done);
+	}
+	StorageBench_Account(pStat, startUs, res == RET_STATE_SUCCESS && done == size, size);
+
+	/* a failed seek leaves the position unknown, the next request seeks again */
+	pCtx->FilePos = res == RET_STATE_SUCCESS ? offset + done : 0xFFFFFFFF;
+}
+
+static void StorageBench_AsyncReap(StorageBench_Ctx_t* pCtx, u32 slot) {
+	FsWrap_AsyncReq_t* pReq = &pCtx->Reqs[slot];
+	if (pReq->State == FS_ASYNC_STATE_IDLE)
+		return;
+
+	/* the buffer stays owned by the worker until the request is done */
+	RET_STATE_t res;
+	while ((res = FsWrap_AsyncWait(pReq, STORAGE_BENCH_WAIT_TMO)) == RET_STATE_ERR_TIMEOUT) {
+		LOCAL_DEBUG_LOG_PRINT("Request %d is still in progress\r\n", slot);
+	}
+
+	StorageBench_Account(pCtx->pReqStat[slot], pCtx->ReqStartUs[slot],
+						 res == RET_STATE_SUCCESS && pReq->Done == pReq->Size, pReq->Size);
+	pReq->State = FS_ASYNC_STATE_IDLE;
+}
+
+static void StorageBench_AsyncDrain(StorageBench_Ctx_t* pCtx) {
+	for (u32 i = 0; i < pCtx->pCfg->QueueDepth; i++) {
+		u32 slot = (pCtx->ReqIdx + i) % pCtx->pCfg->QueueDepth;
+		StorageBench_AsyncReap(pCtx, slot);
+	}
+}
+
+/**
+ * @brief Keeps up to QueueDepth requests in the async queue, the oldest one
+ * is reaped before its slot is reused
+ */
+static void StorageBench_AsyncOp(StorageBench_Ctx_t* pCtx, bool isWrite, u32 offset) {
+	u32 slot				= pCtx->ReqIdx;
+	FsWrap_AsyncReq_t* pReq = &pCtx->Reqs[slot];
+	pCtx->ReqIdx			= (pCtx->ReqIdx + 1) % pCtx->pCfg->QueueDepth;
+
+	StorageBench_AsyncReap(pCtx, slot);
+
+	pReq->pFile			 = &pCtx->File;
+	pReq->pData			 = pCtx->pBuff + slot * pCtx->pCfg->BlockSize;
+	pReq->Offset		 = offset;
+	pReq->Size			 = pCtx->pCfg->BlockSize;
+	pReq->Prio			 = FS_ASYNC_PRIO_NORMAL;
+	pReq->Clbk			 = NULL;
+	pCtx->pReqStat[slot] = isWrite ? &pCtx->pRes->Write : &pCtx->pRes->Read;
+
+	pCtx->ReqStartUs[slot] = PL_GET_US_CNT();
+	RET_STATE_t res		   = isWrite ? FsWrap_WriteAsync(pReq) : FsWrap_ReadAsync(pReq);
+	if (res != RET_STATE_SUCCESS) {
+		StorageBench_Account(pCtx->pReqStat[slot], pCtx->ReqStartUs[slot], false, 0);
+		pReq->State = FS_ASYNC_STATE_IDLE;
+	}
+}
+
+static void StorageBench_Op(StorageBench_Ctx_t* pCtx, bool isWrite, u32 offset) {
+	if (pCtx->pCfg->QueueDepth > 1) {
+		StorageBench_AsyncOp(pCtx, isWrite, offset);
+	} else {
+		StorageBench_DirectOp(pCtx, isWrite, offset);
+	}
+
+	if (isWrite && pCtx->pCfg->SyncEvery && ++pCtx->WriteCnt % pCtx->pCfg->SyncEvery == 0) {
+		/* the file is not used directly while its requests are queued */
+		StorageBench_AsyncDrain(pCtx);
+		if (!StorageBench_Sync(pCtx))
+			pCtx->pRes->Write.Errors++;
+	}
+}
+
+/**
+ * @brief One measured pass over the file, @p readPct of the requests are reads
+ */
+static void StorageBench_Phase(StorageBench_Ctx_t* pCtx, u32 readPct) {
+	u64 startUs = PL_GET_US_CNT();
+	u32 writes	= pCtx->pRes->Write.Ops;
+
+	for (u32 i = 0; i < pCtx->BlockNum; i++) {
+		bool isWrite = readPct == 0 || (readPct < 100 && StorageBench_Rand(pCtx) % 100 >= readPct);
+		StorageBench_Op(pCtx, isWrite, StorageBench_NextOffset(pCtx, i));
+	}
+
+	StorageBench_AsyncDrain(pCtx);
+	bool hasWrites = pCtx->pRes->Write.Ops != writes;
+	if (hasWrites && !StorageBench_Sync(pCtx))
+		pCtx->pRes->Write.Errors++;
+
+	u32 us = (u32)(PL_GET_US_CNT() - startUs);
+	if (readPct != 0)
+		pCtx->pRes->Read.TimeUs += us;
+	if (readPct != 100)
+		pCtx->pRes->Write.TimeUs += us;
+}
+
+/**
+ * @brief Writes the whole file sequentially, not measured
+ */
+static RET_STATE_t StorageBench_Fill(StorageBench_Ctx_t* pCtx) {
+	u32 size = pCtx->pCfg->BlockSize;
+	for (u32 i = 0; i < pCtx->BlockNum; i++) {
+		u32 done		= 0;
+		RET_STATE_t res = FsWrap_Write(&pCtx->File, pCtx->pBuff, size, &done);
+		if (res != RET_STATE_SUCCESS || done != size)
+			return RET_STATE_ERROR;
+	}
+
+	pCtx->FilePos = pCtx->BlockNum * size;
+	return FsWrap_Sync(&pCtx->File);
+}
+
+static RET_STATE_t StorageBench_Exec(StorageBench_Ctx_t* pCtx) {
+	const StorageBench_Cfg_t* pCfg = pCtx->pCfg;
+
+	bool needFill = pCfg->Op == STORAGE_BENCH_OP_READ || pCfg->Op == STORAGE_BENCH_OP_MIXED ||
+					pCfg->Pattern == STORAGE_BENCH_PATTERN_RAND;
+	if (needFill && StorageBench_Fill(pCtx) != RET_STATE_SUCCESS)
+		return RET_STATE_ERROR;
+
+	switch (pCfg->Op) {
+		case STORAGE_BENCH_OP_WRITE_READ:
+			StorageBench_Phase(pCtx, 0);
+			StorageBench_Phase(pCtx, 100);
+			break;
+		case STORAGE_BENCH_OP_WRITE:
+			StorageBench_Phase(pCtx, 0);
+			break;
+		case STORAGE_BENCH_OP_READ:
+			StorageBench_Phase(pCtx, 100);
+			break;
+		case STORAGE_BENCH_OP_MIXED:
+			StorageBench_Phase(pCtx, pCfg->ReadPct);
+			break;
+		default:
+			return RET_STATE_ERR_PARAM;
+	}
+
+	if (pCtx->pRes->Write.Errors || pCtx->pRes->Read.Errors)
+		return RET_STATE_ERROR;
+
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t StorageBench_Run(const char* pDrivePath, const StorageBench_Cfg_t* pCfg,
+							 StorageBench_Result_t* pRes) {
+	if (pDrivePath == NULL || pCfg == NULL || pRes == NULL)
+		return RET_STATE_ERR_PARAM;
+
+	if (pCfg->BlockSize == 0 || pCfg->FileSize < pCfg->BlockSize || pCfg->ReadPct > 100 ||
+		pCfg->QueueDepth > STORAGE_BENCH_QD_MAX)
+		return RET_STATE_ERR_PARAM;
+
+	if (pCfg->Op >= STORAGE_BENCH_OP_ENUM_SIZE || pCfg->Pattern >= STORAGE_BENCH_PATTERN_ENUM_SIZE)
+		return RET_STATE_ERR_PARAM;
+
+	memset(pRes, 0, sizeof(StorageBench_Result_t));
+
+	u32 reqNum = pCfg->QueueDepth > 1 ? pCfg->QueueDepth : 1;
+	StorageBench_Ctx_t* pCtx =
+		MemWrap_Malloc(sizeof(StorageBench_Ctx_t), __FILENAME__, __LINE__, DELAY_1_SECOND * 5);
+	u8* pBuff = MemWrap_Malloc(pCfg->BlockSize * reqNum, __FILENAME__, __LINE__,
+							   DELAY_1_SECOND * 5);
+	if (!pCtx || !pBuff) {
+		MemWrap_Free(pCtx);
+		MemWrap_Free(pBuff);
+		return RET_STATE_ERR_MEMORY;
+	}
+
+	memset(pCtx, 0, sizeof(StorageBench_Ctx_t));
+	pCtx->pCfg	   = pCfg;
+	pCtx->pRes	   = pRes;
+	pCtx->pBuff	   = pBuff;
+	pCtx->BlockNum = pCfg->FileSize / pCfg->BlockSize;
+	pCtx->Rand	   = pCfg->Seed ? pCfg->Seed : 1;
+	for (u32 i = 0; i < pCfg->BlockSize * reqNum; i++) {
+		pBuff[i] = i % 256;
+	}
+
+	char path[BENCH_PATH_LEN];
+	snprintf(path, sizeof(path), "%s%s", pDrivePath, STORAGE_BENCH_FILE_NAME);
+
+	u32 flags		= FS_MODE_CREATE_ALWAYS | FS_MODE_WRITE | FS_MODE_READ;
+	RET_STATE_t res = FsWrap_Open(&pCtx->File, path, flags);
+	if (res == RET_STATE_SUCCESS) {
+		res = StorageBench_Exec(pCtx);
+
+		if (FsWrap_Close(&pCtx->File) != RET_STATE_SUCCESS)
+			res = RET_STATE_ERROR;
+		if (FsWrap_Unlink(path) != RET_STATE_SUCCESS)
+			res = RET_STATE_ERROR;
+	} else {
+		LOCAL_DEBUG_LOG_PRINT("Open '%s' failed, %s\r\n", path, RetState_GetStr(res));
+		res = RET_STATE_ERROR;
+	}
+
+	MemWrap_Free(pBuff);
+	MemWrap_Free(pCtx);
+	return res;
+}
+
+float StorageBench_GetSpeed(const StorageBench_Stat_t* pStat) {
+	if (pStat == NULL || pStat->TimeUs == 0)
+		return 0.0f;
+
+	return (float)pStat->Bytes * 1000000.0f / (float)DATA_1_MBYTE / (float)pStat->TimeUs;
+}
+
+u32 StorageBench_GetPercentile(const StorageBench_Stat_t* pStat, u32 pct) {
+	if (pStat == NULL || pStat->Ops == 0)
+		return 0;
+
+	/* rank of the sample, rounded up */
+	u32 rank = (u32)(((u64)pStat->Ops * pct + 99) / 100);
+	if (rank == 0)
+		rank = 1;
+
+	u32 cnt = 0;
+	for (u32 i = 0; i < STORAGE_BENCH_HIST_SIZE; i++) {
+		cnt += pStat->Hist[i];
+		if (cnt >= rank) {
+			u32 upper = StorageBench_HistUpper(i);
+			return upper < pStat->LatMaxUs ? upper : pStat->LatMaxUs;
+		}
+	}
+
+	return pStat->LatMaxUs;
+}
+
+const char* StorageBench_GetOpStr(STORAGE_BENCH_OP_t op) {
+	return op < STORAGE_BENCH_OP_ENUM_SIZE ? StorageBench_OpStr[op] : "unknown";
+}
+
+const char* StorageBench_GetPatternStr(STORAGE_BENCH_PATTERN_t pattern) {
+	return pattern < STORAGE_BENCH_PATTERN_ENUM_SIZE ? StorageBench_PatternStr[pattern] : "unknown";
+}
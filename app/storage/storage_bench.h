@@ -0,0 +1,102 @@
+#ifndef __STORAGE_BENCH_H
+#define __STORAGE_BENCH_H
+
+#include "main.h"
+
+#define STORAGE_BENCH_FILE_NAME		"bench_file"
+#define STORAGE_BENCH_QD_MAX		16 // not above FS_ASYNC_QUEUE_SIZE
+#define STORAGE_BENCH_WAIT_TMO		(DELAY_1_SECOND * 10)
+/* Latency histogram: 4 linear sub-buckets per power of two of microseconds */
+#define STORAGE_BENCH_HIST_SUB_BITS 2
+#define STORAGE_BENCH_HIST_SIZE		96
+
+typedef enum {
+	STORAGE_BENCH_OP_WRITE_READ = 0, // write the file, then read it back
+	STORAGE_BENCH_OP_WRITE,
+	STORAGE_BENCH_OP_READ,
+	STORAGE_BENCH_OP_MIXED,
+
+	STORAGE_BENCH_OP_ENUM_SIZE
+} STORAGE_BENCH_OP_t;
+
+typedef enum {
+	STORAGE_BENCH_PATTERN_SEQ = 0,
+	STORAGE_BENCH_PATTERN_RAND,
+
+	STORAGE_BENCH_PATTERN_ENUM_SIZE
+} STORAGE_BENCH_PATTERN_t;
+
+typedef struct {
+	u32 BlockSize; // bytes per request
+	u32 FileSize;  // rounded down to BlockSize
+	STORAGE_BENCH_OP_t Op;
+	STORAGE_BENCH_PATTERN_t Pattern;
+	u32 ReadPct;	// share of reads for STORAGE_BENCH_OP_MIXED
+	u32 SyncEvery;	// sync after this many writes, 0 for the end of the phase only
+	u32 QueueDepth; // above 1 requests go through fs_async
+	u32 Seed;		// random offsets and the mix are repeatable for one seed
+} StorageBench_Cfg_t;
+
+#define STORAGE_BENCH_CFG_DEF                      \
+	{                                              \
+		.BlockSize  = PL_SDMMC_SECTOR_SIZE * 4,    \
+		.FileSize   = PL_SDMMC_SECTOR_SIZE * 160,  \
+		.Op         = STORAGE_BENCH_OP_WRITE_READ, \
+		.Pattern    = STORAGE_BENCH_PATTERN_SEQ,   \
+		.ReadPct    = 50,                          \
+		.SyncEvery  = 0,                           \
+		.QueueDepth = 1,                           \
+		.Seed       = 1,                           \
+	}
+
+typedef struct {
+	u32 Ops;
+	u32 Errors; // failed or short transfers
+	u32 Bytes;
+	u32 TimeUs; // whole phase including syncs
+	u32 LatMaxUs;
+	u32 Hist[STORAGE_BENCH_HIST_SIZE];
+} StorageBench_Stat_t;
+
+typedef struct {
+	StorageBench_Stat_t Write;
+	StorageBench_Stat_t Read;
+	u32 Syncs;
+	u32 SyncMaxUs;
+} StorageBench_Result_t;
+
+/**
+ * @brief Run a benchmark on a drive
+ *
+ * Creates STORAGE_BENCH_FILE_NAME on the drive, runs the configured phases
+ * and removes the file. Files read or written at random offsets are filled
+ * first, the fill is not measured. Every request is timed in microseconds
+ * from the call (or the submission to the async queue) to its completion.
+ *
+ * @param pDrivePath Root path of the drive, e.g. "0:"
+ * @param pCfg Pointer to the benchmark configuration
+ * @param pRes Pointer to the result, cleared by the call
+ *
+ * @retval RET_STATE_SUCCESS when every request succeeded;
+ * @retval RET_STATE_ERR_PARAM on a bad configuration;
+ * @retval RET_STATE_ERR_MEMORY when the buffers can't be allocated;
+ * @retval RET_STATE_ERROR when the file can't be created or a request failed.
+ */
+RET_STATE_t StorageBench_Run(const char* pDrivePath, const StorageBench_Cfg_t* pCfg,
+							 StorageBench_Result_t* pRes);
+
+/**
+ * @brief Phase throughput in MB/s
+ */
+float StorageBench_GetSpeed(const StorageBench_Stat_t* pStat);
+
+/**
+ * @brief Latency percentile in microseconds, the upper bound of the
+ * histogram bucket it falls into, never above the measured maximum
+ */
+u32 StorageBench_GetPercentile(const StorageBench_Stat_t* pStat, u32 pct);
+
+const char* StorageBench_GetOpStr(STORAGE_BENCH_OP_t op);
+const char* StorageBench_GetPatternStr(STORAGE_BENCH_PATTERN_t pattern);
+
+#endif /* __STORAGE_BENCH_H */
@@ -0,0 +1,669 @@
+#define DEBUG_MODULE DBG_MOD_STORAGE
+
+#include "storage_cache.h"
+#include "debug.h"
+#include "rtos_analyzer.h"
+#include "storage.h"
+#include "storage_cfg.h"
+
+#define LOCAL_DEBUG_PRINT(_f_, ...)		DEBUG_TRACE_DO(DEBUG_PRINT_NL(_f_, ##__VA_ARGS__))
+#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)	DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
+
+#define CACHE_SECTOR_SIZE PL_SDMMC_SECTOR_SIZE
+
+typedef struct {
+	u32 BlockIdx;
+	u32 LastUse;
+	bool Valid;
+	bool Dirty;
+} StorageCache_Entry_t;
+
+typedef struct {
+	u32 BlockIdx;
+	u32 BlockNum;
+} StorageCache_TrimRange_t;
+
+static TaskHandle_t StorageFlush_Handle;
+static SemaphoreHandle_t StorageCache_Mutex;
+static StorageCache_Entry_t StorageCache_Entries[STORAGE_CACHE_ENTRIES];
+/* .bss is placed in AXI SRAM, line aligned sectors go to SDMMC IDMA without bounce */
+static u8 StorageCache_Data[STORAGE_CACHE_ENTRIES][CACHE_SECTOR_SIZE]
+	__attribute__((aligned(PL_DCACHE_LINE_SIZE)));
+static u8 StorageCache_RaData[STORAGE_CACHE_READ_AHEAD_BLOCKS * CACHE_SECTOR_SIZE]
+	__attribute__((aligned(PL_DCACHE_LINE_SIZE)));
+static u8 StorageCache_WrData[STORAGE_CACHE_COALESCE_BLOCKS * CACHE_SECTOR_SIZE]
+	__attribute__((aligned(PL_DCACHE_LINE_SIZE)));
+static u32 StorageCache_RaIdx;
+static u32 StorageCache_RaNum;
+static u32 StorageCache_NextSeqIdx;
+static u32 StorageCache_BlockNbr;
+static u32 StorageCache_UseCnt;
+static u32 StorageCache_DirtyNum;
+static u32 StorageCache_DirtySince;
+static StorageCache_TrimRange_t StorageCache_TrimQueue[STORAGE_TRIM_QUEUE_SIZE];
+static u32 StorageCache_TrimNum;
+static StorageCache_Stats_t StorageCache_Stats;
+
+/**
+ * @brief every user is a task, USB MSC callbacks included, as the OTG IRQ
+ * is served by the usb-msc task. During `fs -m` the FAT volumes are
+ * locked, so besides the host only the flush task comes here. Before
+ * the scheduler starts only init touches the cache
+ */
+static bool StorageCache_Lock(void) {
+	ASSERT_CHECK(!xPortIsInsideInterrupt());
+
+	if (StorageCache_Mutex == NULL || !SYS_OS_IS_RUNNING())
+		return false;
+
+	xSemaphoreTake(StorageCache_Mutex, SYS_MAX_TIMEOUT);
+	return true;
+}
+
+static void StorageCache_Unlock(bool isLocked) {
+	if (isLocked)
+		xSemaphoreGive(StorageCache_Mutex);
+}
+
+static s32 StorageCache_Find(u32 blockIdx) {
+	for (u32 i = 0; i < STORAGE_CACHE_ENTRIES; i++) {
+		if (StorageCache_Entries[i].Valid && StorageCache_Entries[i].BlockIdx == blockIdx)
+			return (s32)i;
+	}
+
+	return -1;
+}
+
+static void StorageCache_Touch(u32 entryIdx) {
+	StorageCache_Entries[entryIdx].LastUse = ++StorageCache_UseCnt;
+}
+
+static bool StorageCache_FlushLocked(void);
+static bool StorageCache_FlushVictim(u32 entryIdx);
+
+static void StorageCache_MarkDirty(u32 entryIdx) {
+	if (!StorageCache_Entries[entryIdx].Dirty) {
+		if (StorageCache_DirtyNum == 0)
+			StorageCache_DirtySince = PL_GET_MS_CNT();
+
+		StorageCache_Entries[entryIdx].Dirty = true;
+		StorageCache_DirtyNum++;
+	}
+}
+
+static void StorageCache_MarkClean(u32 entryIdx) {
+	if (StorageCache_Entries[entryIdx].Dirty) {
+		StorageCache_Entries[entryIdx].Dirty = false;
+		StorageCache_DirtyNum--;
+	}
+}
+
+/**
+ * @brief takes a free entry or the least recently used one, a dirty
+ * victim is written back with the dirty run it belongs to, other dirty
+ * sectors stay in the cache
+ */
+static s32 StorageCache_Alloc(u32 blockIdx) {
+	u32 victim = 0;
+	for (u32 i = 0; i < STORAGE_CACHE_ENTRIES; i++) {
+		if (!StorageCache_Entries[i].Valid) {
+			victim = i;
+			break;
+		}
+
+		if (StorageCache_Entries[i].LastUse < StorageCache_Entries[victim].LastUse)
+			victim = i;
+	}
+
+	StorageCache_Entry_t* pEntry = &StorageCache_Entries[victim];
+	if (pEntry->Valid) {
+		if (pEntry->Dirty && !StorageCache_FlushVictim(victim))
+			return -1;
+
+		StorageCache_Stats.Evictions++;
+	}
+
+	pEntry->BlockIdx = blockIdx;
+	pEntry->Valid	 = false;
+	pEntry->Dirty	 = false;
+	return (s32)victim;
+}
+
+/**
+ * @brief dirty sectors are newer than the card content
+ */
+static void StorageCache_OverlayDirty(u8* pData, u32 blockIdx, u32 blockNum) {
+	for (u32 i = 0; i < STORAGE_CACHE_ENTRIES; i++) {
+		StorageCache_Entry_t* pEntry = &StorageCache_Entries[i];
+		if (!pEntry->Valid || !pEntry->Dirty)
+			continue;
+
+		if (pEntry->BlockIdx >= blockIdx && pEntry->BlockIdx < blockIdx + blockNum) {
+			memcpy(&pData[(pEntry->BlockIdx - blockIdx) * CACHE_SECTOR_SIZE],
+				   StorageCache_Data[i], CACHE_SECTOR_SIZE);
+		}
+	}
+}
+
+static void StorageCache_UpdateClean(const u8* pData, u32 blockIdx, u32 blockNum) {
+	for (u32 i = 0; i < STORAGE_CACHE_ENTRIES; i++) {
+		StorageCache_Entry_t* pEntry = &StorageCache_Entries[i];
+		if (!pEntry->Valid)
+			continue;
+
+		if (pEntry->BlockIdx >= blockIdx && pEntry->BlockIdx < blockIdx + blockNum) {
+			memcpy(StorageCache_Data[i], &pData[(pEntry->BlockIdx - blockIdx) * CACHE_SECTOR_SIZE],
+				   CACHE_SECTOR_SIZE);
+			StorageCache_MarkClean(i);
+		}
+	}
+}
+
+static void StorageCache_RaUpdate(const u8* pData, u32 blockIdx, u32 blockNum) {
+	for (u32 i = 0; i < blockNum; i++) {
+		u32 currIdx = blockIdx + i;
+		if (currIdx >= StorageCache_RaIdx && currIdx < StorageCache_RaIdx + StorageCache_RaNum) {
+			memcpy(&StorageCache_RaData[(currIdx - StorageCache_RaIdx) * CACHE_SECTOR_SIZE],
+				   &pData[i * CACHE_SECTOR_SIZE], CACHE_SECTOR_SIZE);
+		}
+	}
+}
+
+static bool StorageCache_ReadOne(u8* pData, u32 blockIdx, bool isSequential) {
+	s32 entryIdx = StorageCache_Find(blockIdx);
+	if (entryIdx >= 0) {
+		StorageCache_Stats.Hits++;
+		StorageCache_Touch(entryIdx);
+		memcpy(pData, StorageCache_Data[entryIdx], CACHE_SECTOR_SIZE);
+		return true;
+	}
+
+	/* streamed sectors are not promoted to keep FAT and directory sectors in LRU */
+	if (blockIdx >= StorageCache_RaIdx && blockIdx < StorageCache_RaIdx + StorageCache_RaNum) {
+		StorageCache_Stats.ReadAheadHits++;
+		memcpy(pData, &StorageCache_RaData[(blockIdx - StorageCache_RaIdx) * CACHE_SECTOR_SIZE],
+			   CACHE_SECTOR_SIZE);
+		return true;
+	}
+
+	StorageCache_Stats.Misses++;
+
+	if (isSequential && blockIdx < StorageCache_BlockNbr) {
+		u32 raNum = GET_MIN(STORAGE_CACHE_READ_AHEAD_BLOCKS, StorageCache_BlockNbr - blockIdx);
+
+		StorageCache_RaNum = 0;
+		if (!Storage_Emmc_Read(StorageCache_RaData, blockIdx, raNum))
+			return false;
+
+		StorageCache_OverlayDirty(StorageCache_RaData, blockIdx, raNum);
+		StorageCache_RaIdx = blockIdx;
+		StorageCache_RaNum = raNum;
+		memcpy(pData, StorageCache_RaData, CACHE_SECTOR_SIZE);
+		return true;
+	}
+
+	entryIdx = StorageCache_Alloc(blockIdx);
+	if (entryIdx < 0)
+		return false;
+
+	if (!Storage_Emmc_Read(StorageCache_Data[entryIdx], blockIdx, 1))
+		return false;
+
+	StorageCache_Entries[entryIdx].Valid = true;
+	StorageCache_Touch(entryIdx);
+	memcpy(pData, StorageCache_Data[entryIdx], CACHE_SECTOR_SIZE);
+	return true;
+}
+
+static s32 StorageCache_FindDirty(u32 blockIdx) {
+	s32 entryIdx = StorageCache_Find(blockIdx);
+	if (entryIdx >= 0 && StorageCache_Entries[entryIdx].Dirty)
+		return entryIdx;
+
+	return -1;
+}
+
+static bool StorageCache_WriteCard(const u8* pData, u32 blockIdx, u32 blockNum) {
+	StorageCache_Stats.WriteCmds++;
+	StorageCache_Stats.WriteBlocks += blockNum;
+
+	return Storage_Emmc_Write(pData, blockIdx, blockNum);
+}
+
+/**
+ * @brief writes back dirty sectors with adjacent indexes from the entry
+ * up as one multi-block write, at most STORAGE_CACHE_COALESCE_BLOCKS
+ */
+static bool StorageCache_FlushRun(s32 firstIdx) {
+	u32 blockIdx = StorageCache_Entries[firstIdx].BlockIdx;
+	s32 runIdx[STORAGE_CACHE_COALESCE_BLOCKS];
+	u32 runNum = 0;
+
+	runIdx[runNum++] = firstIdx;
+	while (runNum < STORAGE_CACHE_COALESCE_BLOCKS) {
+		s32 nextIdx = StorageCache_FindDirty(blockIdx + runNum);
+		if (nextIdx < 0)
+			break;
+
+		runIdx[runNum++] = nextIdx;
+	}
+
+	bool res;
+	if (runNum == 1) {
+		res = StorageCache_WriteCard(StorageCache_Data[firstIdx], blockIdx, 1);
+	} else {
+		for (u32 i = 0; i < runNum; i++) {
+			memcpy(&StorageCache_WrData[i * CACHE_SECTOR_SIZE], StorageCache_Data[runIdx[i]],
+				   CACHE_SECTOR_SIZE);
+		}
+		res = StorageCache_WriteCard(StorageCache_WrData, blockIdx, runNum);
+	}
+
+	if (!res)
+		return false;
+
+	for (u32 i = 0; i < runNum; i++)
+		StorageCache_MarkClean(runIdx[i]);
+
+	StorageCache_Stats.WriteBacks += runNum;
+	return true;
+}
+
+/**
+ * @brief the run is started a few sectors below the victim when they
+ * are dirty too, so it still covers the victim
+ */
+static bool StorageCache_FlushVictim(u32 entryIdx) {
+	s32 firstIdx = (s32)entryIdx;
+	u32 blockIdx = StorageCache_Entries[entryIdx].BlockIdx;
+
+	for (u32 i = 1; i < STORAGE_CACHE_COALESCE_BLOCKS && blockIdx >= i; i++) {
+		s32 prevIdx = StorageCache_FindDirty(blockIdx - i);
+		if (prevIdx < 0)
+			break;
+
+		firstIdx = prevIdx;
+	}
+
+	return StorageCache_FlushRun(firstIdx);
+}
+
+/**
+ * @brief dirty sectors with adjacent indexes are merged into one
+ * multi-block write, runs go from the lowest index up
+ */
+static bool StorageCache_FlushLocked(void) {
+	StorageCache_Stats.Flushes++;
+
+	while (StorageCache_DirtyNum) {
+		s32 firstIdx = -1;
+		for (u32 i = 0; i < STORAGE_CACHE_ENTRIES; i++) {
+			StorageCache_Entry_t* pEntry = &StorageCache_Entries[i];
+			if (!pEntry->Valid || !pEntry->Dirty)
+				continue;
+
+			if (firstIdx < 0 || pEntry->BlockIdx < StorageCache_Entries[firstIdx].BlockIdx)
+				firstIdx = (s32)i;
+		}
+
+		if (firstIdx < 0)
+			break;
+
+		if (!StorageCache_FlushRun(firstIdx))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief freed sectors are not worth a write back, read-ahead window
+ * is dropped as a whole when touched
+ */
+static void StorageCache_Drop(u32 blockIdx, u32 blockNum) {
+	for (u32 i = 0; i < STORAGE_CACHE_ENTRIES; i++) {
+		StorageCache_Entry_t* pEntry = &StorageCache_Entries[i];
+		if (!pEntry->Valid)
+			continue;
+
+		if (pEntry->BlockIdx >= blockIdx && pEntry->BlockIdx < blockIdx + blockNum) {
+			StorageCache_MarkClean(i);
+			pEntry->Valid = false;
+		}
+	}
+
+	if (StorageCache_RaIdx < blockIdx + blockNum &&
+		blockIdx < StorageCache_RaIdx + StorageCache_RaNum)
+		StorageCache_RaNum = 0;
+}
+
+static void StorageCache_TrimRemove(u32 rangeIdx) {
+	StorageCache_TrimQueue[rangeIdx] = StorageCache_TrimQueue[--StorageCache_TrimNum];
+}
+
+/**
+ * @brief a pending range must not reach the card after the blocks are
+ * reused, so written blocks are cut out of it. A tail which doesn't fit
+ * into the queue is forgotten, trimming less is always safe
+ */
+static void StorageCache_TrimCancel(u32 blockIdx, u32 blockNum) {
+	u32 endIdx = blockIdx + blockNum;
+
+	for (u32 i = 0; i < StorageCache_TrimNum;) {
+		StorageCache_TrimRange_t* pRange = &StorageCache_TrimQueue[i];
+		u32 rangeEnd					 = pRange->BlockIdx + pRange->BlockNum;
+		if (rangeEnd <= blockIdx || pRange->BlockIdx >= endIdx) {
+			i++;
+			continue;
+		}
+
+		StorageCache_Stats.TrimCancels++;
+		u32 headNum = blockIdx > pRange->BlockIdx ? blockIdx - pRange->BlockIdx : 0;
+		u32 tailNum = rangeEnd > endIdx ? rangeEnd - endIdx : 0;
+
+		if (headNum) {
+			pRange->BlockNum = headNum;
+			if (tailNum && StorageCache_TrimNum < STORAGE_TRIM_QUEUE_SIZE) {
+				StorageCache_TrimQueue[StorageCache_TrimNum].BlockIdx = endIdx;
+				StorageCache_TrimQueue[StorageCache_TrimNum].BlockNum = tailNum;
+				StorageCache_TrimNum++;
+			}
+			i++;
+		} else if (tailNum) {
+			pRange->BlockIdx = endIdx;
+			pRange->BlockNum = tailNum;
+			i++;
+		} else {
+			StorageCache_TrimRemove(i);
+		}
+	}
+}
+
+/**
+ * @brief TRIM busy time is specified by EXT_CSD TRIM_MULT and may be
+ * longer than a program, so it is waited out here under the mutex
+ */
+static bool StorageCache_TrimChunk(u32 blockIdx, u32 blockNum) {
+	if (!Storage_Emmc_Discard(blockIdx, blockNum))
+		return false;
+
+	u32 startTime = PL_GET_MS_CNT();
+	while (!Storage_Emmc_AwaitReady()) {
+		if (PL_GET_MS_CNT() - startTime >= STORAGE_TRIM_READY_TMO)
+			return false;
+	}
+
+	return true;
+}
+
+static bool StorageCache_TrimRange(u32 blockIdx, u32 blockNum) {
+	while (blockNum) {
+		u32 chunkNum = GET_MIN(blockNum, STORAGE_TRIM_CHUNK_BLOCKS);
+		if (!StorageCache_TrimChunk(blockIdx, chunkNum))
+			return false;
+
+		blockIdx += chunkNum;
+		blockNum -= chunkNum;
+	}
+
+	return true;
+}
+
+/**
+ * @brief overlapping and adjacent ranges are merged, so a chain freed
+ * cluster run by cluster run goes to the card as one command
+ */
+static bool StorageCache_TrimQueueAdd(u32 blockIdx, u32 blockNum) {
+	u32 endIdx = blockIdx + blockNum;
+
+	for (u32 i = 0; i < StorageCache_TrimNum;) {
+		StorageCache_TrimRange_t* pRange = &StorageCache_TrimQueue[i];
+		u32 rangeEnd					 = pRange->BlockIdx + pRange->BlockNum;
+		if (pRange->BlockIdx > endIdx || rangeEnd < blockIdx) {
+			i++;
+			continue;
+		}
+
+		blockIdx = GET_MIN(blockIdx, pRange->BlockIdx);
+		endIdx	 = GET_MAX(endIdx, rangeEnd);
+		StorageCache_TrimRemove(i);
+	}
+
+	if (StorageCache_TrimNum == STORAGE_TRIM_QUEUE_SIZE) {
+		StorageCache_Stats.TrimSyncs++;
+		return StorageCache_TrimRange(blockIdx, endIdx - blockIdx);
+	}
+
+	StorageCache_TrimQueue[StorageCache_TrimNum].BlockIdx = blockIdx;
+	StorageCache_TrimQueue[StorageCache_TrimNum].BlockNum = endIdx - blockIdx;
+	StorageCache_TrimNum++;
+	return true;
+}
+
+/**
+ * @brief issues a few chunks per call from the first pending range,
+ * a volume wide range after f_mkfs is spread over several periods
+ */
+static bool StorageCache_TrimProcessLocked(void) {
+	for (u32 i = 0; i < STORAGE_TRIM_CHUNKS_MAX && StorageCache_TrimNum; i++) {
+		StorageCache_TrimRange_t* pRange = &StorageCache_TrimQueue[0];
+		u32 chunkNum					 = GET_MIN(pRange->BlockNum, STORAGE_TRIM_CHUNK_BLOCKS);
+
+		bool res = StorageCache_TrimChunk(pRange->BlockIdx, chunkNum);
+
+		pRange->BlockIdx += chunkNum;
+		pRange->BlockNum -= chunkNum;
+		if (pRange->BlockNum == 0)
+			StorageCache_TrimRemove(0);
+
+		if (!res)
+			return false;
+	}
+
+	return true;
+}
+
+static bool StorageCache_WriteExt(const u8* pData, u32 blockIdx, u32 blockNum,
+								  bool isWriteThrough) {
+	bool res = true;
+
+	bool isLocked = StorageCache_Lock();
+	StorageCache_RaUpdate(pData, blockIdx, blockNum);
+	StorageCache_TrimCancel(blockIdx, blockNum);
+
+	if (isWriteThrough || blockNum >= STORAGE_CACHE_BYPASS_BLOCKS) {
+		res = StorageCache_WriteCard(pData, blockIdx, blockNum);
+		if (res)
+			StorageCache_UpdateClean(pData, blockIdx, blockNum);
+
+		StorageCache_Stats.Bypasses++;
+		StorageCache_Unlock(isLocked);
+		return res;
+	}
+
+	for (u32 i = 0; i < blockNum; i++) {
+		s32 entryIdx = StorageCache_Find(blockIdx + i);
+		if (entryIdx < 0) {
+			StorageCache_Stats.Misses++;
+			entryIdx = StorageCache_Alloc(blockIdx + i);
+			if (entryIdx < 0) {
+				res = false;
+				break;
+			}
+			StorageCache_Entries[entryIdx].Valid = true;
+		} else {
+			StorageCache_Stats.Hits++;
+		}
+
+		memcpy(StorageCache_Data[entryIdx], &pData[i * CACHE_SECTOR_SIZE], CACHE_SECTOR_SIZE);
+		StorageCache_MarkDirty(entryIdx);
+		StorageCache_Touch(entryIdx);
+	}
+
+	if (res && StorageCache_DirtyNum >= STORAGE_CACHE_DIRTY_MAX)
+		res = StorageCache_FlushLocked();
+
+	StorageCache_Unlock(isLocked);
+	return res;
+}
+
+void StorageCache_Init(u32 blockNbr) {
+	bool isLocked = StorageCache_Lock();
+
+	memset(StorageCache_Entries, 0, sizeof(StorageCache_Entries));
+	memset(&StorageCache_Stats, 0, sizeof(StorageCache_Stats));
+	StorageCache_RaNum		= 0;
+	StorageCache_NextSeqIdx = 0;
+	StorageCache_UseCnt		= 0;
+	StorageCache_DirtyNum	= 0;
+	StorageCache_TrimNum	= 0;
+	StorageCache_BlockNbr	= blockNbr;
+
+	StorageCache_Unlock(isLocked);
+}
+
+bool StorageCache_Read(u8* pData, u32 blockIdx, u32 blockNum) {
+#if STORAGE_CACHE_ENABLE
+	bool res = true;
+
+	bool isLocked = StorageCache_Lock();
+
+	if (blockNum >= STORAGE_CACHE_BYPASS_BLOCKS) {
+		res = Storage_Emmc_Read(pData, blockIdx, blockNum);
+		if (res)
+			StorageCache_OverlayDirty(pData, blockIdx, blockNum);
+
+		StorageCache_Stats.Bypasses++;
+	} else {
+		bool isSequential = blockIdx == StorageCache_NextSeqIdx;
+		for (u32 i = 0; i < blockNum && res; i++)
+			res = StorageCache_ReadOne(&pData[i * CACHE_SECTOR_SIZE], blockIdx + i, isSequential);
+	}
+
+	StorageCache_NextSeqIdx = blockIdx + blockNum;
+	LOCAL_DEBUG_LOG_PRINT("R: from %d with len %d, res %d\r\n", blockIdx, blockNum, res);
+
+	StorageCache_Unlock(isLocked);
+	return res;
+#else  /* STORAGE_CACHE_ENABLE */
+	return Storage_Emmc_Read(pData, blockIdx, blockNum);
+#endif /* STORAGE_CACHE_ENABLE */
+}
+
+bool StorageCache_Write(const u8* pData, u32 blockIdx, u32 blockNum) {
+#if STORAGE_CACHE_ENABLE
+	LOCAL_DEBUG_LOG_PRINT("W: to %d with len %d\r\n", blockIdx, blockNum);
+	return StorageCache_WriteExt(pData, blockIdx, blockNum, false);
+#else  /* STORAGE_CACHE_ENABLE */
+	return Storage_Emmc_Write(pData, blockIdx, blockNum);
+#endif /* STORAGE_CACHE_ENABLE */
+}
+
+bool StorageCache_WriteThrough(const u8* pData, u32 blockIdx, u32 blockNum) {
+#if STORAGE_CACHE_ENABLE
+	LOCAL_DEBUG_LOG_PRINT("WT: to %d with len %d\r\n", blockIdx, blockNum);
+	return StorageCache_WriteExt(pData, blockIdx, blockNum, true);
+#else  /* STORAGE_CACHE_ENABLE */
+	return Storage_Emmc_Write(pData, blockIdx, blockNum);
+#endif /* STORAGE_CACHE_ENABLE */
+}
+
+/**
+ * @brief the blocks were written around the cache, cached copies and
+ * pending discards of them are dropped
+ */
+void StorageCache_Invalidate(u32 blockIdx, u32 blockNum) {
+#if STORAGE_CACHE_ENABLE
+	bool isLocked = StorageCache_Lock();
+	StorageCache_Drop(blockIdx, blockNum);
+	StorageCache_TrimCancel(blockIdx, blockNum);
+	StorageCache_Unlock(isLocked);
+#endif /* STORAGE_CACHE_ENABLE */
+}
+
+bool StorageCache_Flush(void) {
+	bool isLocked = StorageCache_Lock();
+	bool res	  = StorageCache_FlushLocked();
+	StorageCache_Unlock(isLocked);
+
+	return res;
+}
+
+/**
+ * @brief the blocks are freed by the file system, cached copies are
+ * dropped at once and the discard itself is deferred to idle time.
+ * A failed discard is not an error for the caller, the blocks just
+ * stay mapped in the card FTL
+ */
+bool StorageCache_Trim(u32 blockIdx, u32 blockNum) {
+	if (blockNum == 0 || blockIdx >= StorageCache_BlockNbr)
+		return false;
+
+	blockNum = GET_MIN(blockNum, StorageCache_BlockNbr - blockIdx);
+	LOCAL_DEBUG_LOG_PRINT("T: from %d with len %d\r\n", blockIdx, blockNum);
+
+#if STORAGE_CACHE_ENABLE
+	bool isLocked = StorageCache_Lock();
+
+	StorageCache_Drop(blockIdx, blockNum);
+	StorageCache_Stats.TrimQueued++;
+	bool res = StorageCache_TrimQueueAdd(blockIdx, blockNum);
+
+	StorageCache_Unlock(isLocked);
+	return res;
+#else  /* STORAGE_CACHE_ENABLE */
+	return StorageCache_TrimRange(blockIdx, blockNum);
+#endif /* STORAGE_CACHE_ENABLE */
+}
+
+StorageCache_Stats_t StorageCache_GetStats(void) {
+	StorageCache_Stats_t stats = StorageCache_Stats;
+	stats.Dirty				   = StorageCache_DirtyNum;
+
+	stats.TrimPending = 0;
+	for (u32 i = 0; i < StorageCache_TrimNum; i++)
+		stats.TrimPending += StorageCache_TrimQueue[i].BlockNum;
+
+	return stats;
+}
+
+/**
+ * @brief drains dirty sectors which are not synced by FatFS in time,
+ * e.g. a log file kept open between appends. Pending discards go out
+ * when the card is idle and not exported over USB MSC
+ */
+static void vTask_StorageFlush_Process(void* pvParameters) {
+	for (;;) {
+		SYS_DELAY_MS(STORAGE_CACHE_FLUSH_PERIOD);
+
+		xSemaphoreTake(StorageCache_Mutex, SYS_MAX_TIMEOUT);
+		if (StorageCache_DirtyNum &&
+			PL_GET_MS_CNT() - StorageCache_DirtySince >= STORAGE_CACHE_FLUSH_AGE) {
+			bool res = StorageCache_FlushLocked();
+			LOCAL_DEBUG_LOG_PRINT("Aged flush, res %d\r\n", res);
+			DISCARD_UNUSED(res);
+		}
+
+		if (StorageCache_TrimNum && !Pl_USB_IsClassMSC() &&
+			PL_GET_MS_CNT() - Storage_GetReadWriteOps_LastTime() >= STORAGE_TRIM_IDLE_TIME) {
+			bool res = StorageCache_TrimProcessLocked();
+			LOCAL_DEBUG_LOG_PRINT("Idle trim, res %d, pending %d\r\n", res, StorageCache_TrimNum);
+			DISCARD_UNUSED(res);
+		}
+		xSemaphoreGive(StorageCache_Mutex);
+	}
+}
+
+void FreeRTOS_StorageCache_InitComponents(bool resources, bool tasks) {
+	if (resources) {
+		StorageCache_Mutex = xSemaphoreCreateMutex();
+	}
+
+	if (tasks) {
+#if STORAGE_CACHE_ENABLE
+		RTOS_Analyzer_CreateTask(vTask_StorageFlush_Process, "storage-flush",
+								 STORAGE_FLUSH_TASK_STACK, NULL, STORAGE_FLUSH_TASK_PRIORITY,
+								 &StorageFlush_Handle);
+#endif /* STORAGE_CACHE_ENABLE */
+	}
+}
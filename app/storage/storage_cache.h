@@ -0,0 +1,37 @@
+#ifndef __STORAGE_CACHE_H
+#define __STORAGE_CACHE_H
+
+#include "main.h"
+#include "platform.h"
+
+typedef struct {
+	u32 Hits;
+	u32 Misses;
+	u32 ReadAheadHits;
+	u32 Evictions;
+	u32 WriteBacks;
+	u32 Bypasses;
+	u32 Flushes;
+	u32 WriteCmds;
+	u32 WriteBlocks;
+	u32 Dirty;
+	u32 TrimQueued;
+	u32 TrimCancels; // pending ranges cut by a later write
+	u32 TrimSyncs;	 // issued at once on a full queue
+	u32 TrimPending; // blocks
+} StorageCache_Stats_t;
+
+void StorageCache_Init(u32 blockNbr);
+
+bool StorageCache_Read(u8* pData, u32 blockIdx, u32 blockNum);
+bool StorageCache_Write(const u8* pData, u32 blockIdx, u32 blockNum);
+bool StorageCache_WriteThrough(const u8* pData, u32 blockIdx, u32 blockNum);
+bool StorageCache_Flush(void);
+void StorageCache_Invalidate(u32 blockIdx, u32 blockNum);
+bool StorageCache_Trim(u32 blockIdx, u32 blockNum);
+
+StorageCache_Stats_t StorageCache_GetStats(void);
+
+void FreeRTOS_StorageCache_InitComponents(bool resources, bool tasks);
+
+#endif /* __STORAGE_CACHE_H */
@@ -0,0 +1,54 @@
+#ifndef __STORAGE_CFG
+#define __STORAGE_CFG
+
+#include "fs_wrapper.h"
+
+#define STORAGE_EMMC_DMA_ENABLE		   1
+#define STORAGE_EMMC_DMA_BUFF_BLOCKS   8   // bounce buffer for not DMA-capable buffers
+#define STORAGE_EMMC_DMA_TMO_PER_BLOCK PL_SD_EMMC_DEF_TMO
+#define STORAGE_EMMC_XFER_NOTIFY_IDX   1   // see configTASK_NOTIFICATION_ARRAY_ENTRIES
+#define STORAGE_EMMC_READY_TMO		   250 // ms, covers worst case program/erase busy
+#define STORAGE_EMMC_READY_SPIN_TMO	   10  // ms, when called not from a task
+#define STORAGE_EMMC_READY_STEP_MIN_US 20
+#define STORAGE_EMMC_READY_STEP_MAX_US 4000
+#define STORAGE_EMMC_CRC_RETRIES	   3
+#define STORAGE_EMMC_CRC_ERRORS_MAX	   2   // in a row, then the bus steps down a mode
+
+#define STORAGE_CACHE_ENABLE			1
+#define STORAGE_CACHE_ENTRIES			32
+#define STORAGE_CACHE_BYPASS_BLOCKS		8  // longer transfers go straight to the card
+#define STORAGE_CACHE_READ_AHEAD_BLOCKS 8
+#define STORAGE_CACHE_DIRTY_MAX			16 // write back all dirty sectors when reached
+#define STORAGE_CACHE_COALESCE_BLOCKS	STORAGE_CACHE_DIRTY_MAX
+#define STORAGE_CACHE_FLUSH_AGE			(DELAY_1_SECOND / 2)
+#define STORAGE_CACHE_FLUSH_PERIOD		(DELAY_1_SECOND / 10)
+
+#define STORAGE_TRIM_QUEUE_SIZE	  16
+#define STORAGE_TRIM_CHUNK_BLOCKS 8192			 // 4MB per discard command
+#define STORAGE_TRIM_CHUNKS_MAX	  4				 // per flush period, bounds mutex hold time
+#define STORAGE_TRIM_IDLE_TIME	  DELAY_1_SECOND // since the last transfer
+#define STORAGE_TRIM_READY_TMO	  (2 * DELAY_1_SECOND)
+
+#define STORAGE_PIPE_ENABLE		 1	 // USB MSC eMMC LUN goes through the transfer pipeline
+#define STORAGE_PIPE_BUFF_BLOCKS 32	 // per buffer, there are two of them
+#define STORAGE_PIPE_XFER_TMO	 500 // ms, covers a transfer plus the card busy time
+#define STORAGE_PIPE_IDLE_TIME	 20	 // ms without USB events, then the card is released
+
+/* RAM drive backing region, one of STORAGE_RAM_REGION_x from storage_ram.h */
+#ifdef FW_PLATFORM_M0
+#define STORAGE_RAM_REGION STORAGE_RAM_REGION_AXI
+#else /* FW_PLATFORM_M0 */
+#define STORAGE_RAM_REGION STORAGE_RAM_REGION_HEAP
+#endif /* FW_PLATFORM_M0 */
+#define STORAGE_RAM_AXI_SIZE		(256 * DATA_1_KBYTE) // upper bound of the drive, half of D1
+#define STORAGE_RAM_D2_SIZE			(128 * DATA_1_KBYTE)
+#define STORAGE_RAM_SDRAM_BASE		0xC0000000 // FMC and a normal memory MPU region set by BSP
+#define STORAGE_RAM_SDRAM_SIZE		(8 * DATA_1_MBYTE)
+#define STORAGE_RAM_HEAP_SIZE		(256 * DATA_1_KBYTE)
+#define STORAGE_RAM_CAPACITY_MIN	(64 * DATA_1_KBYTE) // 128 sectors, f_mkfs() minimum
+#define STORAGE_RAM_CAPACITY_DEF	APP_RAM_STORAGE_CAPACITY
+#define STORAGE_RAM_SNAPSHOT_ENABLE 1
+#define STORAGE_RAM_SNAPSHOT_PATH	STORAGE_EMMC_ROOT_PATH "/ramdisk.snp"
+#define STORAGE_RAM_SNAP_RUN_MAX	64 // sectors of one raw run, its CRC is taken at once
+
+#endif /* __STORAGE_CFG */
@@ -0,0 +1,270 @@
+#define DEBUG_MODULE DBG_MOD_STORAGE
+
+#include "storage_pipe.h"
+#include "debug.h"
+#include "storage_cfg.h"
+
+#define LOCAL_DEBUG_PRINT(_f_, ...)		DEBUG_TRACE_DO(DEBUG_PRINT_NL(_f_, ##__VA_ARGS__))
+#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)	DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
+
+#define PIPE_SECTOR_SIZE PL_SDMMC_SECTOR_SIZE
+#define PIPE_BUFF_NUM	 2
+
+typedef enum {
+	PIPE_BUFF_FREE = 0,
+	PIPE_BUFF_READING,
+	PIPE_BUFF_READY, // holds a valid copy of the blocks
+	PIPE_BUFF_WRITING,
+} StoragePipe_BuffState_t;
+
+typedef struct {
+	u8* pData;
+	u32 BlockIdx;
+	u32 BlockNum;
+	StoragePipe_BuffState_t State;
+} StoragePipe_Buff_t;
+
+static const StoragePipe_Dev_t* StoragePipe_pDev;
+/* .bss is placed in AXI SRAM, which is reachable by SDMMC1 IDMA */
+static u8 StoragePipe_Data[PIPE_BUFF_NUM][STORAGE_PIPE_BUFF_BLOCKS * PIPE_SECTOR_SIZE]
+	__attribute__((aligned(PL_DCACHE_LINE_SIZE)));
+static StoragePipe_Buff_t StoragePipe_Buffs[PIPE_BUFF_NUM];
+static StoragePipe_Buff_t* StoragePipe_pInFlight;
+static StoragePipe_Buff_t* StoragePipe_pLastUsed;
+static u32 StoragePipe_BlockNbr;
+static u32 StoragePipe_NextSeqIdx;
+static bool StoragePipe_WriteFailed;
+static StoragePipe_Stats_t StoragePipe_Stats;
+
+/**
+ * @brief waits for the transfer in flight. A read buffer becomes valid, a
+ * written one stays valid too, the result of a write is kept until the
+ * next write or drain reports it
+ */
+static bool StoragePipe_Wait(void) {
+	StoragePipe_Buff_t* pBuff = StoragePipe_pInFlight;
+	if (pBuff == NULL)
+		return true;
+
+	u64 startTime = PL_GET_US_CNT();
+	bool isOk	  = false;
+	bool isStall  = !StoragePipe_pDev->XferWait(&isOk, 0);
+
+	if (isStall && !StoragePipe_pDev->XferWait(&isOk, STORAGE_PIPE_XFER_TMO)) {
+		StoragePipe_pDev->XferAbort();
+		StoragePipe_Stats.Timeouts++;
+		isOk = false;
+	}
+
+	if (isStall) {
+		u32 stallUs = (u32)(PL_GET_US_CNT() - startTime);
+		StoragePipe_Stats.Stalls++;
+		StoragePipe_Stats.StallTimeUs += stallUs;
+		if (stallUs > StoragePipe_Stats.StallMaxUs)
+			StoragePipe_Stats.StallMaxUs = stallUs;
+	}
+
+	if (pBuff->State == PIPE_BUFF_WRITING && !isOk) {
+		StoragePipe_WriteFailed = true;
+		StoragePipe_Stats.WriteErrors++;
+	}
+
+	pBuff->State		  = isOk ? PIPE_BUFF_READY : PIPE_BUFF_FREE;
+	StoragePipe_pInFlight = NULL;
+	LOCAL_DEBUG_LOG_PRINT("Done: from %d with len %d, res %d\r\n", pBuff->BlockIdx,
+						  pBuff->BlockNum, isOk);
+	return isOk;
+}
+
+static bool StoragePipe_Start(StoragePipe_Buff_t* pBuff, u32 blockIdx, u32 blockNum,
+							  bool isWrite) {
+	pBuff->BlockIdx = blockIdx;
+	pBuff->BlockNum = blockNum;
+	pBuff->State	= isWrite ? PIPE_BUFF_WRITING : PIPE_BUFF_READING;
+
+	if (!StoragePipe_pDev->XferStart(pBuff->pData, blockIdx, blockNum, isWrite)) {
+		pBuff->State = PIPE_BUFF_FREE;
+		return false;
+	}
+
+	StoragePipe_pInFlight = pBuff;
+	return true;
+}
+
+static StoragePipe_Buff_t* StoragePipe_Find(u32 blockIdx, u32 blockNum) {
+	for (u32 i = 0; i < PIPE_BUFF_NUM; i++) {
+		StoragePipe_Buff_t* pBuff = &StoragePipe_Buffs[i];
+		if (pBuff->State != PIPE_BUFF_FREE && blockIdx >= pBuff->BlockIdx &&
+			blockIdx + blockNum <= pBuff->BlockIdx + pBuff->BlockNum)
+			return pBuff;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief the buffer to be reused, never the one in flight and preferably
+ * not the last used one
+ */
+static StoragePipe_Buff_t* StoragePipe_GetVictim(void) {
+	for (u32 i = 0; i < PIPE_BUFF_NUM; i++) {
+		StoragePipe_Buff_t* pBuff = &StoragePipe_Buffs[i];
+		if (pBuff != StoragePipe_pInFlight && pBuff != StoragePipe_pLastUsed)
+			return pBuff;
+	}
+
+	return StoragePipe_pLastUsed;
+}
+
+/**
+ * @brief starts reading the blocks following @p pCur into the other buffer,
+ * the USB transfer of the current data overlaps with the card access
+ */
+static void StoragePipe_Prefetch(const StoragePipe_Buff_t* pCur) {
+	u32 nextIdx = pCur->BlockIdx + pCur->BlockNum;
+	if (nextIdx >= StoragePipe_BlockNbr || StoragePipe_pInFlight != NULL)
+		return;
+
+	if (StoragePipe_Find(nextIdx, 1) != NULL)
+		return;
+
+	u32 num = GET_MIN(STORAGE_PIPE_BUFF_BLOCKS, StoragePipe_BlockNbr - nextIdx);
+	if (StoragePipe_Start(StoragePipe_GetVictim(), nextIdx, num, false))
+		StoragePipe_Stats.Prefetches++;
+}
+
+static bool StoragePipe_ReadChunk(u8* pData, u32 blockIdx, u32 blockNum) {
+	StoragePipe_Buff_t* pBuff = StoragePipe_Find(blockIdx, blockNum);
+	if (pBuff != NULL && pBuff->State != PIPE_BUFF_READY) {
+		StoragePipe_Wait();
+		if (pBuff->State != PIPE_BUFF_READY)
+			pBuff = NULL;
+	}
+
+	if (pBuff != NULL) {
+		StoragePipe_Stats.ReadHits++;
+	} else {
+		StoragePipe_Wait();
+
+		u32 num = GET_MIN(STORAGE_PIPE_BUFF_BLOCKS, StoragePipe_BlockNbr - blockIdx);
+		pBuff	= StoragePipe_GetVictim();
+		if (!StoragePipe_Start(pBuff, blockIdx, num, false) || !StoragePipe_Wait())
+			return false;
+	}
+
+	u32 offset = (blockIdx - pBuff->BlockIdx) * PIPE_SECTOR_SIZE;
+	memcpy(pData, pBuff->pData + offset, blockNum * PIPE_SECTOR_SIZE);
+	StoragePipe_pLastUsed = pBuff;
+
+	bool isSeq			   = blockIdx == StoragePipe_NextSeqIdx;
+	StoragePipe_NextSeqIdx = blockIdx + blockNum;
+	if (isSeq)
+		StoragePipe_Prefetch(pBuff);
+
+	return true;
+}
+
+static bool StoragePipe_WriteChunk(const u8* pData, u32 blockIdx, u32 blockNum) {
+	/* one transfer at a time, this waits for the previous write. The card
+	 * is released before Invalidate takes the cache mutex, which is always
+	 * taken before the transfer one */
+	StoragePipe_Wait();
+
+	for (u32 i = 0; i < PIPE_BUFF_NUM; i++) {
+		StoragePipe_Buff_t* pBuff = &StoragePipe_Buffs[i];
+		if (blockIdx < pBuff->BlockIdx + pBuff->BlockNum &&
+			pBuff->BlockIdx < blockIdx + blockNum)
+			pBuff->State = PIPE_BUFF_FREE;
+	}
+	StoragePipe_pDev->Invalidate(blockIdx, blockNum);
+
+	StoragePipe_Buff_t* pBuff = StoragePipe_GetVictim();
+	memcpy(pBuff->pData, pData, blockNum * PIPE_SECTOR_SIZE);
+	if (!StoragePipe_Start(pBuff, blockIdx, blockNum, true))
+		return false;
+
+	StoragePipe_NextSeqIdx = blockIdx + blockNum;
+
+	/* completion is deferred, a failure of the previous write is reported now */
+	bool res				= !StoragePipe_WriteFailed;
+	StoragePipe_WriteFailed = false;
+	return res;
+}
+
+void StoragePipe_Init(const StoragePipe_Dev_t* pDev, u32 blockNbr) {
+	if (StoragePipe_pDev != NULL)
+		StoragePipe_Wait();
+
+	StoragePipe_pDev		= pDev;
+	StoragePipe_BlockNbr	= blockNbr;
+	StoragePipe_pInFlight	= NULL;
+	StoragePipe_pLastUsed	= NULL;
+	StoragePipe_NextSeqIdx	= 0;
+	StoragePipe_WriteFailed = false;
+
+	for (u32 i = 0; i < PIPE_BUFF_NUM; i++) {
+		StoragePipe_Buffs[i].pData = StoragePipe_Data[i];
+		StoragePipe_Buffs[i].State = PIPE_BUFF_FREE;
+	}
+}
+
+bool StoragePipe_Read(u8* pData, u32 blockIdx, u32 blockNum) {
+	LOCAL_DEBUG_LOG_PRINT("R: from %d with len %d\r\n", blockIdx, blockNum);
+
+	if (StoragePipe_pDev == NULL || blockIdx + blockNum > StoragePipe_BlockNbr)
+		return false;
+
+	StoragePipe_Stats.Reads++;
+	while (blockNum) {
+		u32 chunkNum = GET_MIN(blockNum, STORAGE_PIPE_BUFF_BLOCKS);
+		if (!StoragePipe_ReadChunk(pData, blockIdx, chunkNum))
+			return false;
+
+		pData += chunkNum * PIPE_SECTOR_SIZE;
+		blockIdx += chunkNum;
+		blockNum -= chunkNum;
+	}
+
+	return true;
+}
+
+bool StoragePipe_Write(const u8* pData, u32 blockIdx, u32 blockNum) {
+	LOCAL_DEBUG_LOG_PRINT("W: to %d with len %d\r\n", blockIdx, blockNum);
+
+	if (StoragePipe_pDev == NULL || blockIdx + blockNum > StoragePipe_BlockNbr)
+		return false;
+
+	StoragePipe_Stats.Writes++;
+	bool res = true;
+	while (blockNum) {
+		u32 chunkNum = GET_MIN(blockNum, STORAGE_PIPE_BUFF_BLOCKS);
+		res			 = StoragePipe_WriteChunk(pData, blockIdx, chunkNum) && res;
+
+		pData += chunkNum * PIPE_SECTOR_SIZE;
+		blockIdx += chunkNum;
+		blockNum -= chunkNum;
+	}
+
+	return res;
+}
+
+/**
+ * @brief waits until the card is not accessed by the pipeline, from the
+ * task running it. Once the pipeline is idle any task may ask for the result
+ * @retval false if a deferred write failed and was not reported yet
+ */
+bool StoragePipe_Drain(void) {
+	if (StoragePipe_pDev == NULL)
+		return true;
+
+	StoragePipe_Wait();
+	return !StoragePipe_WriteFailed;
+}
+
+bool StoragePipe_IsBusy(void) {
+	return StoragePipe_pInFlight != NULL;
+}
+
+StoragePipe_Stats_t StoragePipe_GetStats(void) {
+	return StoragePipe_Stats;
+}
@@ -0,0 +1,39 @@
+#ifndef __STORAGE_PIPE_H
+#define __STORAGE_PIPE_H
+
+#include "main.h"
+#include "platform.h"
+
+/**
+ * @brief Block device under the pipeline, the transfer is started and then
+ * waited for with a timeout, all calls come from one task which owns the
+ * device while a transfer is in flight
+ */
+typedef struct {
+	bool (*XferStart)(u8* pData, u32 blockIdx, u32 blockNum, bool isWrite);
+	bool (*XferWait)(bool* pIsOk, u32 tmoMs);
+	void (*XferAbort)(void);
+	void (*Invalidate)(u32 blockIdx, u32 blockNum); // copies cached above the pipeline
+} StoragePipe_Dev_t;
+
+typedef struct {
+	u32 Reads;
+	u32 ReadHits;
+	u32 Prefetches;
+	u32 Writes;
+	u32 WriteErrors; // deferred, reported by the next write or drain
+	u32 Stalls;		 // waits for a transfer in flight
+	u32 StallTimeUs;
+	u32 StallMaxUs;
+	u32 Timeouts;
+} StoragePipe_Stats_t;
+
+void StoragePipe_Init(const StoragePipe_Dev_t* pDev, u32 blockNbr);
+bool StoragePipe_Read(u8* pData, u32 blockIdx, u32 blockNum);
+bool StoragePipe_Write(const u8* pData, u32 blockIdx, u32 blockNum);
+bool StoragePipe_Drain(void);
+bool StoragePipe_IsBusy(void);
+
+StoragePipe_Stats_t StoragePipe_GetStats(void);
+
+#endif /* __STORAGE_PIPE_H */
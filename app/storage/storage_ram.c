@@ -0,0 +1,392 @@
+#define DEBUG_MODULE DBG_MOD_STORAGE
+
+#include "storage_ram.h"
+#include "debug.h"
+#include "ff.h"
+#include "fs_wrapper.h"
+#include "mem_wrapper.h"
+#include "storage_cfg.h"
+
+#define LOCAL_DEBUG_PRINT(_f_, ...)		DEBUG_TRACE_DO(DEBUG_PRINT_NL(_f_, ##__VA_ARGS__))
+#define LOCAL_DEBUG_LOG_PRINT(_f_, ...)	DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
+
+#define STORAGE_RAM_SECTOR_SIZE FF_MAX_SS
+#define STORAGE_RAM_SNAP_MAGIC	0x4E534452 // "RDSN"
+
+typedef enum {
+	STORAGE_RAM_RUN_ZERO = 0, // not stored, the drive is cleared before a load
+	STORAGE_RAM_RUN_FILL,	  // sectors filled with one byte value
+	STORAGE_RAM_RUN_RAW,
+} StorageRam_RunKind_t;
+
+typedef struct __attribute__((packed)) {
+	u32 Magic;
+	u32 Capacity;
+	u32 Runs;
+	u32 Crc; // of the fields above
+} StorageRam_SnapHdr_t;
+
+typedef struct __attribute__((packed)) {
+	u32 Sector;
+	u16 Count;
+	u8 Kind;
+	u8 Fill;
+	u32 Crc; // of the raw data, 0 for a fill run
+} StorageRam_SnapRun_t;
+
+#if STORAGE_RAM_REGION == STORAGE_RAM_REGION_AXI
+static u8 PL_STORAGE_IN_RAM_DATA StorageRam_Buff[STORAGE_RAM_AXI_SIZE]
+	__attribute__((aligned(PL_DCACHE_LINE_SIZE)));
+#elif STORAGE_RAM_REGION == STORAGE_RAM_REGION_D2
+static u8 PL_STORAGE_IN_D2_DATA StorageRam_Buff[STORAGE_RAM_D2_SIZE]
+	__attribute__((aligned(PL_DCACHE_LINE_SIZE)));
+#endif /* STORAGE_RAM_REGION */
+
+static const char* StorageRam_RegionStr[] = {
+	[STORAGE_RAM_REGION_AXI]   = "AXI",
+	[STORAGE_RAM_REGION_D2]	   = "D2",
+	[STORAGE_RAM_REGION_SDRAM] = "SDRAM",
+	[STORAGE_RAM_REGION_HEAP]  = "heap",
+};
+
+static u8* StorageRam_pBase;
+static u32 StorageRam_Capacity;
+static u32 StorageRam_OpsLastTime;
+static StorageRam_Stats_t StorageRam_Stats;
+static Storage_TrimStats_t StorageRam_TrimStats;
+
+/**
+ * @brief the CRC unit has no lock of its own, the scheduler is suspended
+ * for the time of one run
+ */
+static u32 StorageRam_Crc(const u8* pBuff, u32 size) {
+	vTaskSuspendAll();
+	u32 crc = Pl_Crc32_CheckBuff(pBuff, size);
+	xTaskResumeAll();
+	return crc;
+}
+
+static bool StorageRam_IsInRange(u32 offset, u32 len) {
+	return StorageRam_pBase != NULL && offset <= StorageRam_Capacity &&
+		   len <= StorageRam_Capacity - offset;
+}
+
+static StorageRam_RunKind_t StorageRam_SectorKind(const u8* pSector, u8* pFill) {
+	*pFill = pSector[0];
+	if (memcmp(pSector, pSector + 1, STORAGE_RAM_SECTOR_SIZE - 1) != 0)
+		return STORAGE_RAM_RUN_RAW;
+
+	return *pFill == 0 ? STORAGE_RAM_RUN_ZERO : STORAGE_RAM_RUN_FILL;
+}
+
+/**
+ * @brief sets the drive size up and clears it, so the next mount formats
+ * it. The static regions can't grow above their size, the heap one is
+ * allocated again
+ * @param capacity in bytes, rounded down to the sector size, 0 for the default
+ */
+bool StorageRam_Init(u32 capacity) {
+	if (capacity == 0)
+		capacity = STORAGE_RAM_CAPACITY_DEF;
+
+	capacity -= capacity % STORAGE_RAM_SECTOR_SIZE;
+	if (capacity < STORAGE_RAM_CAPACITY_MIN || capacity > StorageRam_GetCapacityMax())
+		return false;
+
+#if STORAGE_RAM_REGION == STORAGE_RAM_REGION_AXI || STORAGE_RAM_REGION == STORAGE_RAM_REGION_D2
+	StorageRam_pBase = StorageRam_Buff;
+#elif STORAGE_RAM_REGION == STORAGE_RAM_REGION_SDRAM
+	StorageRam_pBase = (u8*)STORAGE_RAM_SDRAM_BASE;
+#elif STORAGE_RAM_REGION == STORAGE_RAM_REGION_HEAP
+	if (StorageRam_pBase != NULL && capacity != StorageRam_Capacity) {
+		MemWrap_Free(StorageRam_pBase);
+		StorageRam_pBase = NULL;
+	}
+	if (StorageRam_pBase == NULL)
+		StorageRam_pBase =
+			MemWrap_Malloc(capacity, __FILENAME__, __LINE__, MEM_ALLOC_DEF_TMO);
+	if (StorageRam_pBase == NULL) {
+		StorageRam_Capacity = 0;
+		return false;
+	}
+#else  /* STORAGE_RAM_REGION */
+#error Unknown STORAGE_RAM_REGION
+#endif /* STORAGE_RAM_REGION */
+
+	StorageRam_Capacity = capacity;
+	memset(StorageRam_pBase, 0, StorageRam_Capacity);
+	return true;
+}
+
+const char* StorageRam_GetRegionStr(void) {
+	return StorageRam_RegionStr[STORAGE_RAM_REGION];
+}
+
+u32 StorageRam_GetCapacity(void) {
+	return StorageRam_Capacity;
+}
+
+u32 StorageRam_GetCapacityMax(void) {
+#if STORAGE_RAM_REGION == STORAGE_RAM_REGION_AXI || STORAGE_RAM_REGION == STORAGE_RAM_REGION_D2
+	return sizeof(StorageRam_Buff);
+#elif STORAGE_RAM_REGION == STORAGE_RAM_REGION_SDRAM
+	return STORAGE_RAM_SDRAM_SIZE;
+#else  /* STORAGE_RAM_REGION */
+	return STORAGE_RAM_HEAP_SIZE;
+#endif /* STORAGE_RAM_REGION */
+}
+
+u32 StorageRam_GetOpsLastTime(void) {
+	return StorageRam_OpsLastTime;
+}
+
+bool StorageRam_Read(u8* pDst, u32 offset, u32 len) {
+	StorageRam_OpsLastTime = PL_GET_MS_CNT();
+	LOCAL_DEBUG_LOG_PRINT("R: from %d with len %d\r\n", offset, len);
+
+	if (!StorageRam_IsInRange(offset, len)) {
+		StorageRam_Stats.Errors++;
+		return false;
+	}
+
+	memcpy(pDst, StorageRam_pBase + offset, len);
+	StorageRam_Stats.Reads++;
+	return true;
+}
+
+bool StorageRam_Write(const u8* pSrc, u32 offset, u32 len) {
+	StorageRam_OpsLastTime = PL_GET_MS_CNT();
+	LOCAL_DEBUG_LOG_PRINT("W: to %d with len %d\r\n", offset, len);
+
+	if (!StorageRam_IsInRange(offset, len)) {
+		StorageRam_Stats.Errors++;
+		return false;
+	}
+
+	memcpy(StorageRam_pBase + offset, pSrc, len);
+	StorageRam_Stats.Writes++;
+	return true;
+}
+
+/**
+ * @brief zero-copy read, the returned pointer stays valid until the
+ * drive is resized. The caller must not hold it over a write to the
+ * same range it doesn't own
+ * @retval NULL when the range is out of the drive
+ */
+const u8* StorageRam_Map(u32 offset, u32 len) {
+	StorageRam_OpsLastTime = PL_GET_MS_CNT();
+	LOCAL_DEBUG_LOG_PRINT("M: from %d with len %d\r\n", offset, len);
+
+	if (!StorageRam_IsInRange(offset, len)) {
+		StorageRam_Stats.Errors++;
+		return NULL;
+	}
+
+	StorageRam_Stats.Maps++;
+	return StorageRam_pBase + offset;
+}
+
+/**
+ * @brief freed sectors read back as zeroes, the same as a card with
+ * TRIM, so the discard path can be checked without the eMMC. Zeroed
+ * sectors also take no space in the snapshot
+ */
+bool StorageRam_Trim(u32 offset, u32 len) {
+	LOCAL_DEBUG_LOG_PRINT("D: from %d with len %d\r\n", offset, len);
+
+	if (!StorageRam_IsInRange(offset, len)) {
+		StorageRam_TrimStats.Errors++;
+		return false;
+	}
+
+	memset(StorageRam_pBase + offset, 0, len);
+	StorageRam_TrimStats.Cmds++;
+	StorageRam_TrimStats.Blocks += len / STORAGE_RAM_SECTOR_SIZE;
+	return true;
+}
+
+static bool StorageRam_SnapWriteRun(FsWrap_File_t* pFile, StorageRam_SnapRun_t* pRun) {
+	u32 done		= 0;
+	const u8* pData = StorageRam_pBase + pRun->Sector * STORAGE_RAM_SECTOR_SIZE;
+	u32 len			= pRun->Count * STORAGE_RAM_SECTOR_SIZE;
+
+	pRun->Crc = pRun->Kind == STORAGE_RAM_RUN_RAW ? StorageRam_Crc(pData, len) : 0;
+	if (FsWrap_Write(pFile, pRun, sizeof(*pRun), &done) != RET_STATE_SUCCESS ||
+		done != sizeof(*pRun))
+		return false;
+
+	if (pRun->Kind != STORAGE_RAM_RUN_RAW)
+		return true;
+
+	/* straight from the drive, no staging buffer */
+	return FsWrap_Write(pFile, pData, len, &done) == RET_STATE_SUCCESS && done == len;
+}
+
+/**
+ * @brief saves the drive to a file, zeroed sectors are skipped and
+ * sectors of one byte value are stored as a fill run. The header is
+ * written last, so a save cut by a reset leaves no valid snapshot.
+ * The RAM volume must be locked by the caller
+ */
+bool StorageRam_SnapshotSave(const char* pPath) {
+	if (StorageRam_pBase == NULL)
+		return false;
+
+	u32 startTime			 = PL_GET_MS_CNT();
+	FsWrap_File_t file		 = {0};
+	StorageRam_SnapHdr_t hdr = {0};
+	u32 done				 = 0;
+
+	RET_STATE_t res = FsWrap_Open(&file, pPath, FS_MODE_CREATE_ALWAYS | FS_MODE_WRITE);
+	if (res != RET_STATE_SUCCESS) {
+		StorageRam_Stats.SnapErrors++;
+		return false;
+	}
+
+	bool isOk = FsWrap_Write(&file, &hdr, sizeof(hdr), &done) == RET_STATE_SUCCESS &&
+				done == sizeof(hdr);
+
+	u32 sectorNum			 = StorageRam_Capacity / STORAGE_RAM_SECTOR_SIZE;
+	StorageRam_SnapRun_t run = {0};
+	run.Kind				 = STORAGE_RAM_RUN_ZERO;
+
+	for (u32 sector = 0; sector < sectorNum && isOk; sector++) {
+		u8 fill = 0;
+		StorageRam_RunKind_t kind =
+			StorageRam_SectorKind(StorageRam_pBase + sector * STORAGE_RAM_SECTOR_SIZE, &fill);
+
+		u32 countMax   = kind == STORAGE_RAM_RUN_RAW ? STORAGE_RAM_SNAP_RUN_MAX : UINT16_MAX;
+		bool isSameRun = kind == run.Kind && run.Count < countMax &&
+						 (kind != STORAGE_RAM_RUN_FILL || fill == run.Fill);
+		if (run.Count != 0 && isSameRun) {
+			run.Count++;
+			continue;
+		}
+
+		if (run.Count != 0 && run.Kind != STORAGE_RAM_RUN_ZERO) {
+			isOk = StorageRam_SnapWriteRun(&file, &run);
+			hdr.Runs++;
+		}
+
+		run.Sector = sector;
+		run.Count  = 1;
+		run.Kind   = kind;
+		run.Fill   = fill;
+	}
+
+	if (isOk && run.Count != 0 && run.Kind != STORAGE_RAM_RUN_ZERO) {
+		isOk = StorageRam_SnapWriteRun(&file, &run);
+		hdr.Runs++;
+	}
+
+	if (isOk) {
+		isOk = FsWrap_Sync(&file) == RET_STATE_SUCCESS;
+		FsWrap_Size(&file, &StorageRam_Stats.SnapSize);
+	}
+
+	if (isOk) {
+		hdr.Magic	 = STORAGE_RAM_SNAP_MAGIC;
+		hdr.Capacity = StorageRam_Capacity;
+		hdr.Crc		 = StorageRam_Crc((u8*)&hdr, offsetof(StorageRam_SnapHdr_t, Crc));
+		isOk		 = FsWrap_Seek(&file, 0, FS_SEEK_START) == RET_STATE_SUCCESS &&
+				FsWrap_Write(&file, &hdr, sizeof(hdr), &done) == RET_STATE_SUCCESS &&
+				done == sizeof(hdr);
+	}
+
+	if (FsWrap_Close(&file) != RET_STATE_SUCCESS)
+		isOk = false;
+
+	StorageRam_Stats.SnapTimeMs = PL_GET_MS_CNT() - startTime;
+	if (isOk)
+		StorageRam_Stats.SnapSaves++;
+	else
+		StorageRam_Stats.SnapErrors++;
+
+	LOCAL_DEBUG_LOG_PRINT("Snapshot save: runs %d, size %d, time %d ms, res %d\r\n", hdr.Runs,
+						  StorageRam_Stats.SnapSize, StorageRam_Stats.SnapTimeMs, isOk);
+	return isOk;
+}
+
+static bool StorageRam_SnapReadRun(FsWrap_File_t* pFile) {
+	StorageRam_SnapRun_t run;
+	u32 done = 0;
+
+	if (FsWrap_Read(pFile, &run, sizeof(run), &done) != RET_STATE_SUCCESS || done != sizeof(run))
+		return false;
+
+	u32 sectorNum = StorageRam_Capacity / STORAGE_RAM_SECTOR_SIZE;
+	if (run.Count == 0 || run.Sector >= sectorNum || run.Count > sectorNum - run.Sector)
+		return false;
+
+	u8* pData = StorageRam_pBase + run.Sector * STORAGE_RAM_SECTOR_SIZE;
+	u32 len	  = run.Count * STORAGE_RAM_SECTOR_SIZE;
+
+	switch (run.Kind) {
+		case STORAGE_RAM_RUN_FILL:
+			memset(pData, run.Fill, len);
+			return true;
+
+		case STORAGE_RAM_RUN_RAW:
+			if (FsWrap_Read(pFile, pData, len, &done) != RET_STATE_SUCCESS || done != len)
+				return false;
+			return StorageRam_Crc(pData, len) == run.Crc;
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * @brief restores the drive from a snapshot taken with the same capacity.
+ * A snapshot that can't be used leaves the drive cleared, so the next
+ * mount formats it
+ */
+bool StorageRam_SnapshotLoad(const char* pPath) {
+	if (StorageRam_pBase == NULL)
+		return false;
+
+	u32 startTime			 = PL_GET_MS_CNT();
+	FsWrap_File_t file		 = {0};
+	StorageRam_SnapHdr_t hdr = {0};
+	u32 done				 = 0;
+
+	RET_STATE_t res = FsWrap_Open(&file, pPath, FS_MODE_READ);
+	if (res != RET_STATE_SUCCESS)
+		return false; // no snapshot is not an error
+
+	bool isOk = FsWrap_Read(&file, &hdr, sizeof(hdr), &done) == RET_STATE_SUCCESS &&
+				done == sizeof(hdr) && hdr.Magic == STORAGE_RAM_SNAP_MAGIC &&
+				hdr.Capacity == StorageRam_Capacity &&
+				hdr.Crc == StorageRam_Crc((u8*)&hdr, offsetof(StorageRam_SnapHdr_t, Crc));
+
+	memset(StorageRam_pBase, 0, StorageRam_Capacity);
+	for (u32 i = 0; i < hdr.Runs && isOk; i++) {
+		isOk = StorageRam_SnapReadRun(&file);
+	}
+
+	if (isOk)
+		FsWrap_Size(&file, &StorageRam_Stats.SnapSize);
+
+	FsWrap_Close(&file);
+
+	StorageRam_Stats.SnapTimeMs = PL_GET_MS_CNT() - startTime;
+	if (isOk) {
+		StorageRam_Stats.SnapLoads++;
+	} else {
+		memset(StorageRam_pBase, 0, StorageRam_Capacity);
+		StorageRam_Stats.SnapErrors++;
+	}
+
+	LOCAL_DEBUG_LOG_PRINT("Snapshot load: runs %d, time %d ms, res %d\r\n", hdr.Runs,
+						  StorageRam_Stats.SnapTimeMs, isOk);
+	return isOk;
+}
+
+StorageRam_Stats_t StorageRam_GetStats(void) {
+	return StorageRam_Stats;
+}
+
+Storage_TrimStats_t StorageRam_GetTrimStats(void) {
+	return StorageRam_TrimStats;
+}
@@ -0,0 +1,42 @@
+#ifndef __STORAGE_RAM_H
+#define __STORAGE_RAM_H
+
+#include "main.h"
+#include "platform.h"
+#include "storage.h"
+
+#define STORAGE_RAM_REGION_AXI	 0 // D1 AXI SRAM, static buffer
+#define STORAGE_RAM_REGION_D2	 1 // D2 SRAM, static buffer
+#define STORAGE_RAM_REGION_SDRAM 2 // external SDRAM at a fixed address
+#define STORAGE_RAM_REGION_HEAP	 3 // heap buffer, for the host build
+
+typedef struct {
+	u32 Reads;
+	u32 Writes;
+	u32 Maps; // reads served by a pointer into the drive, without a copy
+	u32 Errors;
+	u32 SnapSaves;
+	u32 SnapLoads;
+	u32 SnapErrors;
+	u32 SnapSize;	// bytes of the last saved or loaded snapshot
+	u32 SnapTimeMs; // of the last save or load
+} StorageRam_Stats_t;
+
+bool StorageRam_Init(u32 capacity);
+const char* StorageRam_GetRegionStr(void);
+u32 StorageRam_GetCapacity(void);
+u32 StorageRam_GetCapacityMax(void);
+u32 StorageRam_GetOpsLastTime(void);
+
+bool StorageRam_Read(u8* pDst, u32 offset, u32 len);
+bool StorageRam_Write(const u8* pSrc, u32 offset, u32 len);
+const u8* StorageRam_Map(u32 offset, u32 len);
+bool StorageRam_Trim(u32 offset, u32 len);
+
+bool StorageRam_SnapshotSave(const char* pPath);
+bool StorageRam_SnapshotLoad(const char* pPath);
+
+StorageRam_Stats_t StorageRam_GetStats(void);
+Storage_TrimStats_t StorageRam_GetTrimStats(void);
+
+#endif /* __STORAGE_RAM_H */
@@ -2,13 +2,22 @@
 #define __STORAGE_UTILS_H
 
 #include "main.h"
+#include "storage_bench.h"
 
 #define FS_TEST_SPEED_WRITE_MIN (0.25f)
 #define FS_TEST_SPEED_READ_MIN	(2.0f)
-#define FS_TEST_BUFF_SIZE		(PL_SDMMC_SECTOR_SIZE * 4)
-#define FS_TEST_FILE_SIZE		(FS_TEST_BUFF_SIZE * 40)
-#define FS_TEST_FILE_NAME_LEN	(64)
 
-RET_STATE_t StorageUtils_FsSpeedTest(const char* pPath, float* pReadSpeed, float* pWriteSpeed);
+/**
+ * @brief Run a benchmark on a drive and check the measured speeds
+ *
+ * @param pPath Root path of the drive
+ * @param pCfg Pointer to the benchmark configuration, STORAGE_BENCH_CFG_DEF for a quick test
+ * @param pRes Pointer to the result
+ *
+ * @retval RET_STATE_WARNING if a speed is below FS_TEST_SPEED_WRITE_MIN/FS_TEST_SPEED_READ_MIN;
+ * @retval See StorageBench_Run() otherwise.
+ */
+RET_STATE_t StorageUtils_FsSpeedTest(const char* pPath, const StorageBench_Cfg_t* pCfg,
+									 StorageBench_Result_t* pRes);
 
 #endif /* __STORAGE_UTILS_H */
@@ -7,6 +7,8 @@ SRC += $(SRC_LIB_C)
 
 COMPILER_FLAGS += -Ilib
 COMPILER_FLAGS += -Ilib/collections
+COMPILER_FLAGS += -Ilib/collections/byte_ring
+COMPILER_FLAGS += -Ilib/collections/dma_rx_ring
 COMPILER_FLAGS += -Ilib/collections/linked_list
 COMPILER_FLAGS += -Ilib/collections/shared_mutex
 COMPILER_FLAGS += -Ilib/fatfs
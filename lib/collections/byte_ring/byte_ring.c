@@ -0,0 +1,193 @@
+#include "byte_ring.h"
+
+#if DEBUG_ENABLE
+#include "debug.h"
+#endif /* DEBUG_ENABLE */
+
+/**
+ * Multi-producer single-consumer byte ring without locks.
+ * Producers reserve space with one CAS on the State word, copy their data
+ * and commit with another CAS. The last producer leaving the ring publishes
+ * the reserve head as CommitHead, so the consumer never sees a region that
+ * is still being copied. Positions are monotonic counters modulo 2^24,
+ * which is why the ring size is limited to the half of that range.
+ */
+
+#define BYTE_RING_STATE_MAKE(head, writers) \
+	(((head) & BYTE_RING_POS_MASK) | ((u32)(writers) << BYTE_RING_POS_BITS))
+#define BYTE_RING_STATE_HEAD(s)	   ((s) & BYTE_RING_POS_MASK)
+#define BYTE_RING_STATE_WRITERS(s) ((s) >> BYTE_RING_POS_BITS)
+#define BYTE_RING_DIST(to, from)   (((to) - (from)) & BYTE_RING_POS_MASK)
+
+static void ByteRing_Overflow(ByteRing_t* pRing, u32 len) {
+	__atomic_fetch_add(&pRing->Stats.Overflows, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&pRing->Stats.OverflowBytes, len, __ATOMIC_RELAXED);
+}
+
+/**
+ * Moves CommitHead forward to the head, never backwards: a producer can be
+ * preempted between its commit and this store while others move it further.
+ * A CommitHead behind the tail is stale (the consumer followed the State head)
+ * and is always replaced
+ */
+static void ByteRing_CommitHeadAdvance(ByteRing_t* pRing, u32 head) {
+	u32 tail	 = __atomic_load_n(&pRing->Tail, __ATOMIC_ACQUIRE);
+	u32 headDist = BYTE_RING_DIST(head, tail);
+	if (headDist > pRing->Size)
+		return;
+
+	u32 curr = __atomic_load_n(&pRing->CommitHead, __ATOMIC_RELAXED);
+	do {
+		u32 currDist = BYTE_RING_DIST(curr, tail);
+		if (currDist <= pRing->Size && headDist <= currDist)
+			return;
+	} while (!__atomic_compare_exchange_n(&pRing->CommitHead, &curr, head, true,
+										  __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+void ByteRing_Init(ByteRing_t* pRing, u8* pBuff, u32 size) {
+	ASSERT_CHECK(pRing);
+	ASSERT_CHECK(pBuff);
+	ASSERT_CHECK(BYTE_RING_SIZE_IS_VALID(size));
+
+	*pRing = (ByteRing_t){
+		.pBuff		= pBuff,
+		.Size		= size,
+		.State		= 0,
+		.CommitHead = 0,
+		.Tail		= 0,
+	};
+}
+
+/**
+ * @brief Reserves len bytes for the caller, safe from any task or ISR
+ *
+ * @param[in] pRing pointer on ByteRing object
+ * @param[in] len number of bytes to reserve
+ * @param[out] pSpan reserved region, must be committed by ByteRing_Commit()
+ * @retval true region reserved
+ * @retval false not enough free space, the write is counted as an overflow
+ */
+bool ByteRing_Reserve(ByteRing_t* pRing, u32 len, ByteRing_Span_t* pSpan) {
+	ASSERT_CHECK(pRing);
+	ASSERT_CHECK(pSpan);
+
+	if (!len || len > pRing->Size) {
+		ByteRing_Overflow(pRing, len);
+		return false;
+	}
+
+	u32 state = __atomic_load_n(&pRing->State, __ATOMIC_RELAXED);
+	u32 head, used, newState;
+
+	do {
+		head		= BYTE_RING_STATE_HEAD(state);
+		u32 writers = BYTE_RING_STATE_WRITERS(state);
+		// a stale tail only makes the free space look smaller
+		used = BYTE_RING_DIST(head, __atomic_load_n(&pRing->Tail, __ATOMIC_ACQUIRE));
+
+		if (writers >= BYTE_RING_WRITERS_MAX || len > pRing->Size - used) {
+			ByteRing_Overflow(pRing, len);
+			return false;
+		}
+
+		newState = BYTE_RING_STATE_MAKE(head + len, writers + 1);
+	} while (!__atomic_compare_exchange_n(&pRing->State, &state, newState, true,
+										  __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+	// statistics only, a lost update is fine here
+	if (used + len > pRing->Stats.Peak)
+		pRing->Stats.Peak = used + len;
+
+	u32 idx			= head & (pRing->Size - 1);
+	u32 firstLen	= GET_MIN(len, pRing->Size - idx);
+	pSpan->pPart[0] = &pRing->pBuff[idx];
+	pSpan->Len[0]	= firstLen;
+	pSpan->pPart[1] = pRing->pBuff;
+	pSpan->Len[1]	= len - firstLen;
+
+	return true;
+}
+
+void ByteRing_Commit(ByteRing_t* pRing, const ByteRing_Span_t* pSpan) {
+	ASSERT_CHECK(pRing);
+	ASSERT_CHECK(pSpan);
+
+	u32 state = __atomic_load_n(&pRing->State, __ATOMIC_RELAXED);
+	u32 newState;
+
+	do {
+		ASSERT_CHECK(BYTE_RING_STATE_WRITERS(state) > 0);
+		newState = state - (1UL << BYTE_RING_POS_BITS);
+	} while (!__atomic_compare_exchange_n(&pRing->State, &state, newState, true,
+										  __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+	__atomic_fetch_add(&pRing->Stats.Written, pSpan->Len[0] + pSpan->Len[1], __ATOMIC_RELAXED);
+
+	if (BYTE_RING_STATE_WRITERS(newState) == 0)
+		ByteRing_CommitHeadAdvance(pRing, BYTE_RING_STATE_HEAD(newState));
+}
+
+/**
+ * @brief Reserve, copy and commit in one call
+ *
+ * @retval true all bytes are in the ring
+ * @retval false nothing written, the ring is full
+ */
+bool ByteRing_Write(ByteRing_t* pRing, const void* pData, u32 len) {
+	ByteRing_Span_t span;
+	if (!ByteRing_Reserve(pRing, len, &span))
+		return false;
+
+	memcpy(span.pPart[0], pData, span.Len[0]);
+	if (span.Len[1])
+		memcpy(span.pPart[1], (const u8*)pData + span.Len[0], span.Len[1]);
+
+	ByteRing_Commit(pRing, &span);
+	return true;
+}
+
+/**
+ * @brief Returns the longest committed contiguous block at the tail.
+ * Consumer side only, the block stays in the ring until ByteRing_Release()
+ *
+ * @param[in] pRing pointer on ByteRing object
+ * @param[out] ppData start of the block
+ * @return block length, 0 if there is nothing to read
+ */
+u32 ByteRing_Peek(ByteRing_t* pRing, const u8** ppData) {
+	ASSERT_CHECK(pRing);
+	ASSERT_CHECK(ppData);
+
+	u32 state	  = __atomic_load_n(&pRing->State, __ATOMIC_ACQUIRE);
+	u32 committed = BYTE_RING_STATE_WRITERS(state) == 0
+						? BYTE_RING_STATE_HEAD(state)
+						: __atomic_load_n(&pRing->CommitHead, __ATOMIC_ACQUIRE);
+
+	u32 tail  = pRing->Tail;
+	u32 avail = BYTE_RING_DIST(committed, tail);
+	u32 idx	  = tail & (pRing->Size - 1);
+
+	// CommitHead left behind the tail by a preempted producer
+	if (avail > pRing->Size)
+		avail = 0;
+
+	*ppData = &pRing->pBuff[idx];
+	return GET_MIN(avail, pRing->Size - idx);
+}
+
+void ByteRing_Release(ByteRing_t* pRing, u32 len) {
+	ASSERT_CHECK(pRing);
+
+	// the block has to be read out before producers may reuse it
+	__atomic_store_n(&pRing->Tail, (pRing->Tail + len) & BYTE_RING_POS_MASK, __ATOMIC_RELEASE);
+}
+
+u32 ByteRing_GetUsed(ByteRing_t* pRing) {
+	u32 state = __atomic_load_n(&pRing->State, __ATOMIC_RELAXED);
+	return BYTE_RING_DIST(BYTE_RING_STATE_HEAD(state), pRing->Tail);
+}
+
+ByteRing_Stats_t ByteRing_GetStats(ByteRing_t* pRing) {
+	return pRing->Stats;
+}
@@ -0,0 +1,49 @@
+#ifndef BYTE_RING_H
+#define BYTE_RING_H
+
+#include "main.h"
+
+#define BYTE_RING_POS_BITS		24
+#define BYTE_RING_POS_MASK		((1UL << BYTE_RING_POS_BITS) - 1)
+#define BYTE_RING_WRITERS_MAX	0xFF
+#define BYTE_RING_SIZE_MAX		(1UL << (BYTE_RING_POS_BITS - 1))
+#define BYTE_RING_SIZE_IS_VALID(s) ((s) != 0 && ((s) & ((s) - 1)) == 0 && (s) <= BYTE_RING_SIZE_MAX)
+
+typedef struct {
+	u32 Written;	   // bytes committed by producers
+	u32 Overflows;	   // writes dropped because the ring was full
+	u32 OverflowBytes; // bytes of the dropped writes
+	u32 Peak;		   // max bytes held by the ring at once
+} ByteRing_Stats_t;
+
+typedef struct {
+	u8* pBuff;
+	u32 Size; // power of two, not more than BYTE_RING_SIZE_MAX
+	/**
+	 * Reserve head in the low BYTE_RING_POS_BITS and the number of
+	 * producers between reserve and commit in the high bits
+	 */
+	volatile u32 State;
+	volatile u32 CommitHead; // everything before it is committed
+	volatile u32 Tail;		 // written by the consumer only
+	ByteRing_Stats_t Stats;
+} ByteRing_t;
+
+/**
+ * Reserved region of the ring, split in two parts when it wraps
+ */
+typedef struct {
+	u8* pPart[2];
+	u32 Len[2];
+} ByteRing_Span_t;
+
+void ByteRing_Init(ByteRing_t* pRing, u8* pBuff, u32 size);
+bool ByteRing_Reserve(ByteRing_t* pRing, u32 len, ByteRing_Span_t* pSpan);
+void ByteRing_Commit(ByteRing_t* pRing, const ByteRing_Span_t* pSpan);
+bool ByteRing_Write(ByteRing_t* pRing, const void* pData, u32 len);
+u32 ByteRing_Peek(ByteRing_t* pRing, const u8** ppData);
+void ByteRing_Release(ByteRing_t* pRing, u32 len);
+u32 ByteRing_GetUsed(ByteRing_t* pRing);
+ByteRing_Stats_t ByteRing_GetStats(ByteRing_t* pRing);
+
+#endif /* BYTE_RING_H */
@@ -0,0 +1,58 @@
+#include "dma_rx_ring.h"
+
+/**
+ * Reader side of a circular DMA receive buffer. The DMA owns the write
+ * position and reports it as the number of transfers left to the buffer
+ * end. The reader is called on the half, full and idle line events and
+ * turns the bytes received since the last call into one or two chunks.
+ * Each event comes at most half a buffer after the previous one, so the
+ * DMA can't lap the reader unless the interrupt is held for that long
+ */
+
+void DmaRxRing_Init(DmaRxRing_t* pRing, const u8* pBuff, u32 size) {
+	ASSERT_CHECK(pRing);
+	ASSERT_CHECK(pBuff);
+	ASSERT_CHECK(size);
+
+	*pRing = (DmaRxRing_t){
+		.pBuff	 = pBuff,
+		.Size	 = size,
+		.ReadPos = 0,
+	};
+}
+
+/**
+ * @brief Collects the bytes written by the DMA since the last call
+ *
+ * @param[in] pRing pointer on DmaRxRing object
+ * @param[in] remaining DMA counter, transfers left to the buffer end
+ * @param[out] chunks new data in order, the second one after a wrap
+ * @return number of chunks, 0 if nothing was received
+ */
+u32 DmaRxRing_Update(DmaRxRing_t* pRing, u32 remaining,
+					 DmaRxRing_Chunk_t chunks[DMA_RX_RING_CHUNKS_MAX]) {
+	ASSERT_CHECK(pRing);
+	ASSERT_CHECK(chunks);
+
+	// at the wrap the counter may read 0 or already reloaded Size, both are 0
+	u32 writePos = remaining && remaining < pRing->Size ? pRing->Size - remaining : 0;
+	u32 readPos	 = pRing->ReadPos;
+	u32 num		 = 0;
+
+	if (writePos == readPos)
+		return 0;
+
+	if (writePos > readPos) {
+		chunks[num++] = (DmaRxRing_Chunk_t){&pRing->pBuff[readPos], writePos - readPos};
+	} else {
+		chunks[num++] = (DmaRxRing_Chunk_t){&pRing->pBuff[readPos], pRing->Size - readPos};
+		if (writePos)
+			chunks[num++] = (DmaRxRing_Chunk_t){pRing->pBuff, writePos};
+	}
+
+	pRing->ReadPos = writePos;
+	pRing->Chunks += num;
+	pRing->Bytes += (writePos - readPos + pRing->Size) % pRing->Size;
+
+	return num;
+}
@@ -0,0 +1,25 @@
+#ifndef DMA_RX_RING_H
+#define DMA_RX_RING_H
+
+#include "main.h"
+
+#define DMA_RX_RING_CHUNKS_MAX 2
+
+typedef struct {
+	const u8* pData;
+	u32 Len;
+} DmaRxRing_Chunk_t;
+
+typedef struct {
+	const u8* pBuff;
+	u32 Size;
+	u32 ReadPos; // next byte to hand out
+	u32 Chunks;	 // handed out, statistics only
+	u32 Bytes;
+} DmaRxRing_t;
+
+void DmaRxRing_Init(DmaRxRing_t* pRing, const u8* pBuff, u32 size);
+u32 DmaRxRing_Update(DmaRxRing_t* pRing, u32 remaining,
+					 DmaRxRing_Chunk_t chunks[DMA_RX_RING_CHUNKS_MAX]);
+
+#endif /* DMA_RX_RING_H */
@@ -1,3 +1,5 @@
+#define DEBUG_MODULE DBG_MOD_COLL
+
 #include "linked_list.h"
 #include "stringlib.h"
 
@@ -35,19 +37,13 @@
 #endif /* LL_GET_FREE_HEAP */
 #endif /* LINKED_LIST_CUSTOM_ALLOCS */
 
-#if DEBUG_ENABLE
 #include "debug.h"
 
-#define LOCAL_DEBUG_PRINT_ENABLE 0	//default 0
-#define LOCAL_DEBUG_TEST_ENABLE	 0
+#if DEBUG_ENABLE
+#define LOCAL_DEBUG_TEST_ENABLE 0
 #endif /* DEBUG_ENABLE */
 
-#if LOCAL_DEBUG_PRINT_ENABLE
-#warning LOCAL_DEBUG_PRINT_ENABLE
-#define LOCAL_DEBUG_PRINT DEBUG_LOG_PRINT
-#else /* LOCAL_DEBUG_PRINT_ENABLE */
-#define LOCAL_DEBUG_PRINT(_f_, ...)
-#endif /* LOCAL_DEBUG_PRINT_ENABLE */
+#define LOCAL_DEBUG_PRINT(_f_, ...) DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
 
 #if LOCAL_DEBUG_TEST_ENABLE
 #warning LOCAL_DEBUG_TEST_ENABLE
@@ -548,9 +544,9 @@ static RET_STATE_t __LinkedList_Extract(LinkedList_Handle_t* const pcHandle, voi
 		LinkedList_Node_t* nodeToRemove = llObj->Rear;
 		llObj->Rear						= llObj->Rear->Next;
 
-		LinkedList_SaveDataCleanMem(nodeToRemove, pData, pDSize);
 		llObj->Metrics.NodesNum--;
 		llObj->Metrics.BytesNum -= nodeToRemove->Data.Size;
+		LinkedList_SaveDataCleanMem(nodeToRemove, pData, pDSize);
 
 		LOCAL_DEBUG_PRINT(
 			"Remove node 0x%08x from pos %d; "
@@ -573,9 +569,9 @@ static RET_STATE_t __LinkedList_Extract(LinkedList_Handle_t* const pcHandle, voi
 			LinkedList_Node_t* nodeToRemove = pCurrNode->Next;
 			pCurrNode->Next					= pCurrNode->Next->Next;
 
-			LinkedList_SaveDataCleanMem(nodeToRemove, pData, pDSize);
 			llObj->Metrics.NodesNum--;
 			llObj->Metrics.BytesNum -= nodeToRemove->Data.Size;
+			LinkedList_SaveDataCleanMem(nodeToRemove, pData, pDSize);
 
 			LOCAL_DEBUG_PRINT(
 				"Remove node 0x%08x from pos %d; "
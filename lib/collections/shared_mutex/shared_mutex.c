@@ -1,19 +1,12 @@
+#define DEBUG_MODULE DBG_MOD_COLL
+
 #include "shared_mutex.h"
 
-#if DEBUG_ENABLE
 #include "debug.h"
 
-#define LOCAL_DEBUG_PRINT_ENABLE 0
-#endif /* DEBUG_ENABLE */
-
-#if LOCAL_DEBUG_PRINT_ENABLE
-#warning LOCAL_DEBUG_PRINT_ENABLE
-#define LOCAL_DEBUG_PRINT		DEBUG_LOG_PRINT
-#define LOCAL_DEBUG_COLOR_PRINT DEBUG_LOG_COLOR_PRINT
-#else /* LOCAL_DEBUG_PRINT_ENABLE */
-#define LOCAL_DEBUG_PRINT(_f_, ...)
-#define LOCAL_DEBUG_COLOR_PRINT(c, _f_, ...)
-#endif /* LOCAL_DEBUG_PRINT_ENABLE */
+#define LOCAL_DEBUG_PRINT(_f_, ...) DEBUG_TRACE_DO(DEBUG_LOG_PRINT(_f_, ##__VA_ARGS__))
+#define LOCAL_DEBUG_COLOR_PRINT(c, _f_, ...) \
+	DEBUG_TRACE_DO(DEBUG_LOG_COLOR_PRINT(c, _f_, ##__VA_ARGS__))
 
 #ifndef SHARED_MUTEX_CUSTOM_RAND
 #include "rand.h"
@@ -230,6 +230,11 @@
 #define GPTE_Name			56		/* GPT PTE: Partition name */
 
 
+#if FF_USE_DIR_CACHE && !FF_USE_LFN
+#error Directory lookup cache needs LFN enabled
+#endif
+
+
 /* Post process on fatal error in the file operations */
 #define ABORT(fs, res)		{ fp->err = (BYTE)(res); LEAVE_FF(fs, res); }
 
@@ -544,6 +549,10 @@ static WCHAR LfnBuf[FF_MAX_LFN + 1];		/* LFN working buffer */
 #define DEF_NAMEBUFF		WCHAR *lfn;	/* Pointer to LFN working buffer and directory entry block scratchpad buffer */
 #define INIT_NAMEBUFF(fs)	{ lfn = ff_memalloc((FF_MAX_LFN+1)*2 + MAXDIRB(FF_MAX_LFN)); if (!lfn) LEAVE_FF(fs, FR_NOT_ENOUGH_CORE); (fs)->lfnbuf = lfn; (fs)->dirbuf = (BYTE*)(lfn+FF_MAX_LFN+1); }
 #define FREE_NAMEBUFF()	ff_memfree(lfn)
+#elif FF_LFN_VOLUME_BUF
+#define DEF_NAMEBUFF
+#define INIT_NAMEBUFF(fs)	{ (fs)->lfnbuf = (fs)->lfnvol; }	/* LFN working buffer of the volume, guarded by the volume lock */
+#define FREE_NAMEBUFF()
 #else
 #define DEF_NAMEBUFF		WCHAR *lfn;	/* Pointer to LFN working buffer */
 #define INIT_NAMEBUFF(fs)	{ lfn = ff_memalloc((FF_MAX_LFN+1)*2); if (!lfn) LEAVE_FF(fs, FR_NOT_ENOUGH_CORE); (fs)->lfnbuf = lfn; }
@@ -2485,6 +2494,43 @@ static FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 
 
 
+#if FF_USE_DIR_CACHE
+/*-----------------------------------------------------------------------*/
+/* Directory handling - Find an object with the lookup cache             */
+/*-----------------------------------------------------------------------*/
+
+static FRESULT dir_find_cached (	/* FR_OK(0):succeeded, !=0:error */
+	DIR* dp					/* Pointer to the directory object with the file name */
+)
+{
+	FRESULT res;
+	FATFS *fs = dp->obj.fs;
+	DWORD dptr, blk_ofs;
+	BYTE sfn[11];
+
+
+	if (fs->fs_type == FS_EXFAT || (dp->fn[NSFLAG] & NS_DOT)) return dir_find(dp);	/* Not cached */
+
+	if (ff_dircache_find(fs, dp->obj.sclust, fs->lfnbuf, &dptr, &blk_ofs, sfn)) {
+		res = dir_sdi(dp, dptr);	/* Go to the cached entry */
+		if (res == FR_OK) res = move_window(fs, dp->sect);
+		if (res == FR_OK && !memcmp(dp->dir, sfn, 11)) {	/* Is it still the same SFN entry? */
+			dp->obj.attr = dp->dir[DIR_Attr] & AM_MASK;
+			dp->blk_ofs = blk_ofs;
+			return FR_OK;
+		}
+		/* The entry has gone, scan the directory */
+	}
+
+	res = dir_find(dp);
+	if (res == FR_OK) ff_dircache_store(fs, dp->obj.sclust, fs->lfnbuf, dp->dptr, dp->blk_ofs, dp->dir);
+
+	return res;
+}
+#endif
+
+
+
 
 #if !FF_FS_READONLY
 /*-----------------------------------------------------------------------*/
@@ -3168,7 +3214,11 @@ static FRESULT follow_path (	/* FR_OK(0): successful, !=0: error code */
 				continue;		/* Follow next segment */
 			}
 #endif
+#if FF_USE_DIR_CACHE
+			res = dir_find_cached(dp);		/* Find an object with the segment name */
+#else
 			res = dir_find(dp);				/* Find an object with the segment name */
+#endif
 			if (res != FR_OK) {				/* Failed to find the object */
 				if (res == FR_NO_FILE) {	/* Object is not found */
 					if (FF_FS_RPATH && (ns & NS_DOT)) {	/* If dot entry is not exist, stay there (may be root dir in FAT volume) */
@@ -3499,6 +3549,9 @@ static FRESULT mount_volume (	/* FR_OK(0): successful, !=0: an error occurred */
 	/* Following code attempts to mount the volume. (find an FAT volume, analyze the BPB and initialize the filesystem object) */
 
 	fs->fs_type = 0;					/* Invalidate the filesystem object */
+#if FF_USE_DIR_CACHE
+	ff_dircache_drop(fs);				/* The volume may have been changed */
+#endif
 	stat = disk_initialize(fs->pdrv);	/* Initialize the volume hosting physical drive */
 	if (stat & STA_NOINIT) { 			/* Check if the initialization succeeded */
 		return FR_NOT_READY;			/* Failed to initialize due to no medium or hard error */
@@ -5151,6 +5204,9 @@ FRESULT f_unlink (
 		}
 		if (res == FR_OK) {		/* It is ready to remove the object */
 			res = dir_remove(&dj);				/* Remove the directory entry */
+#if FF_USE_DIR_CACHE
+			ff_dircache_drop(fs);				/* Forget the cached entries */
+#endif
 			if (res == FR_OK && dclst != 0) {	/* Remove the cluster chain if exist */
 #if FF_FS_EXFAT
 				res = remove_chain(&obj, dclst, 0);
@@ -5358,6 +5414,9 @@ FRESULT f_rename (
 			}
 			if (res == FR_OK) {		/* New entry has been created */
 				res = dir_remove(&djo);	/* Remove old entry */
+#if FF_USE_DIR_CACHE
+				ff_dircache_drop(fs);	/* Forget the cached entries */
+#endif
 				if (res == FR_OK) {
 					res = sync_fs(fs);
 				}
@@ -186,6 +186,9 @@ typedef struct {
 #endif
 #endif
 	BYTE	win[FF_MAX_SS];	/* Disk access window for directory, FAT (and file data in tiny cfg) */
+#if FF_USE_LFN == 3 && FF_LFN_VOLUME_BUF
+	WCHAR	lfnvol[FF_MAX_LFN + 1];	/* LFN working buffer of the volume */
+#endif
 } FATFS;
 
 
@@ -394,6 +397,11 @@ DWORD ff_wtoupper (DWORD uni);			/* Unicode upper-case conversion */
 void* ff_memalloc (UINT msize);		/* Allocate memory block */
 void ff_memfree (void* mblock);		/* Free memory block */
 #endif
+#if FF_USE_DIR_CACHE	/* Directory lookup cache functions, called with the volume locked */
+int ff_dircache_find (FATFS* fs, DWORD dclst, const WCHAR* name, DWORD* dptr, DWORD* blk_ofs, BYTE* sfn);	/* Find the entry of the name in the directory */
+void ff_dircache_store (FATFS* fs, DWORD dclst, const WCHAR* name, DWORD dptr, DWORD blk_ofs, const BYTE* sfn);	/* Record a found entry */
+void ff_dircache_drop (FATFS* fs);	/* Forget all entries of the volume */
+#endif
 #if FF_FS_REENTRANT		/* Sync functions */
 int ff_mutex_create (int vol);		/* Create a sync object */
 void ff_mutex_delete (int vol);		/* Delete a sync object */
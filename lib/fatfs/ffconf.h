@@ -33,7 +33,7 @@
 #define FF_USE_FASTSEEK 1
 /* This option switches fast seek feature. (0:Disable or 1:Enable) */
 
-#define FF_USE_EXPAND 0
+#define FF_USE_EXPAND 1
 /* This option switches f_expand(). (0:Disable or 1:Enable) */
 
 #define FF_USE_CHMOD 0
@@ -121,6 +121,23 @@
 /  memory for the working buffer, memory management functions, ff_memalloc() and
 /  ff_memfree() exemplified in ffsystem.c, need to be added to the project. */
 
+#define FF_LFN_VOLUME_BUF 1
+/* This option is effective when FF_USE_LFN == 3. When set 1, the LFN working
+/  buffer is a member of the filesystem object, and the functions working on a
+/  volume use it instead of allocating one from the heap on every call. The volume
+/  lock makes it safe when FF_FS_REENTRANT == 1. f_mkfs() still takes its work
+/  area from the heap. */
+
+#define FF_USE_DIR_CACHE 1
+/* This option switches the directory lookup cache (0:Disable or 1:Enable).
+/  When enabled, the path resolution asks ff_dircache_find() for the location
+/  of a name in a directory before scanning the directory and passes the found
+/  entries to ff_dircache_store(). A cached location is used only when the SFN
+/  entry there still matches. ff_dircache_drop() is called under the volume lock
+/  when entries are removed or moved and when the volume is mounted. These user
+/  functions need to be added to the project. It requires LFN enabled and has no
+/  effect on the exFAT volume. */
+
 #define FF_LFN_UNICODE 0
 /* This option switches the character encoding on the API when LFN is enabled.
 /
@@ -161,8 +178,9 @@
 / Drive/Volume Configurations
 /---------------------------------------------------------------------------*/
 
-#define FF_VOLUMES 1
+#define FF_VOLUMES 2
 /* Number of volumes (logical drives) to be used. (1-10) */
+/* Covers the FATFS_DRV_* drives of io_fatfs.c, each volume has own mutex and window. */
 
 #define FF_STR_VOLUME_ID 0
 #define FF_VOLUME_STRS	 "RAM", "NAND", "CF", "SD", "SD2", "USB", "USB2", "USB3"
@@ -202,7 +220,7 @@
 /* Minimum number of sectors to switch GPT as partitioning format in f_mkfs() and 
 /  f_fdisk(). 2^32 sectors maximum. This option has no effect when FF_LBA64 == 0. */
 
-#define FF_USE_TRIM 0
+#define FF_USE_TRIM 1
 /* This option switches support for ATA-TRIM. (0:Disable or 1:Enable)
 /  To enable this feature, also CTRL_TRIM command should be implemented to
 /  the disk_ioctl(). */
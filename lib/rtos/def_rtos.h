@@ -2,6 +2,7 @@
 #include "event_groups.h"
 #include "queue.h"
 #include "semphr.h"
+#include "stream_buffer.h"
 #include "task.h"
 #include "timers.h"
 
@@ -1,8 +1,88 @@
 #include "mmc.h"
+#include "mmc_bus.h"
+
+#define MMC_EXT_CSD_WORDS		  (MMC_BUS_EXT_CSD_SIZE / sizeof(u32))
+#define MMC_EXT_CSD_DATA_SEC_SIZE 61
+#define MMC_EXT_CSD_REV			  192
+#define MMC_EXT_CSD_SEC_FEATURE	  231
+#define MMC_EXT_CSD_REV_4_5		  6	   // DISCARD is defined since eMMC 4.5
+#define MMC_SEC_FEATURE_GB_CL_EN  0x10 // TRIM is supported
+
+static const u32 MMC_SpeedModeList[] = {
+	[PL_SD_EMMC_TIMING_LEGACY] = SDMMC_SPEED_MODE_DEFAULT,
+	[PL_SD_EMMC_TIMING_HS]	   = SDMMC_SPEED_MODE_HIGH,
+	[PL_SD_EMMC_TIMING_DDR52]  = SDMMC_SPEED_MODE_DDR,
+};
 
 static MMC_HandleTypeDef EMMC_Handle;
+static Pl_Emmc_XferClbk_t XferClbk_Emmc = Pl_Stub_StateClbk;
+/* read on the 1-bit legacy bus, the readbacks of the later switches go to MMC_ExtCsdCheck */
+static u32 MMC_ExtCsd[MMC_EXT_CSD_WORDS];
+static u32 MMC_ExtCsdCheck[MMC_EXT_CSD_WORDS];
+static MMC_BusMode_t MMC_Mode = {.BusWidth = 1, .Timing = PL_SD_EMMC_TIMING_LEGACY};
+
+/**
+ * @brief EXT_CSD is a 512 bytes data block read, so CRC errors
+ * of the new bus mode show up here
+ */
+static bool MMC_Emmc_ReadExtCsd(u32* pExtCsd) {
+	EMMC_Handle.ErrorCode = HAL_MMC_ERROR_NONE;
+	if (HAL_MMC_GetCardExtCSD(&EMMC_Handle, pExtCsd, PL_SD_EMMC_DEF_TMO) != HAL_OK)
+		return false;
+
+	return EMMC_Handle.ErrorCode == HAL_MMC_ERROR_NONE;
+}
+
+/* the readback has to come without errors and show the timing the card runs at */
+static bool MMC_Emmc_IsBusValid(Pl_SdEmmcTiming_t timing) {
+	return MMC_Emmc_ReadExtCsd(MMC_ExtCsdCheck) &&
+		   MMC_Bus_IsTimingSet((const u8*)MMC_ExtCsdCheck, timing);
+}
+
+static u32 MMC_Emmc_GetBusWide(u32 busWidth) {
+	switch (busWidth) {
+		case 8:
+			return SDMMC_BUS_WIDE_8B;
+		case 4:
+			return SDMMC_BUS_WIDE_4B;
+		default:
+			return SDMMC_BUS_WIDE_1B;
+	}
+}
+
+/**
+ * @brief a failed CMD6 switch still gives HAL_OK and is reported through
+ * ErrorCode only, so it is checked before the readback clears it
+ */
+static bool MMC_Emmc_TryBusWide(u32 busWidth) {
+	EMMC_Handle.ErrorCode = HAL_MMC_ERROR_NONE;
+	if (HAL_MMC_ConfigWideBusOperation(&EMMC_Handle, MMC_Emmc_GetBusWide(busWidth)) != HAL_OK ||
+		EMMC_Handle.ErrorCode != HAL_MMC_ERROR_NONE || !MMC_Emmc_IsBusValid(MMC_Mode.Timing))
+		return false;
+
+	MMC_Mode.BusWidth = busWidth;
+	return true;
+}
+
+/**
+ * @brief a rejected timing is switched back to legacy, so the next one
+ * is tried from there
+ */
+static bool MMC_Emmc_TrySpeed(Pl_SdEmmcTiming_t timing) {
+	EMMC_Handle.ErrorCode = HAL_MMC_ERROR_NONE;
+	if (HAL_MMC_ConfigSpeedBusOperation(&EMMC_Handle, MMC_SpeedModeList[timing]) != HAL_OK ||
+		EMMC_Handle.ErrorCode != HAL_MMC_ERROR_NONE || !MMC_Emmc_IsBusValid(timing)) {
+		HAL_MMC_ConfigSpeedBusOperation(&EMMC_Handle, SDMMC_SPEED_MODE_DEFAULT);
+		MMC_Mode.Timing = PL_SD_EMMC_TIMING_LEGACY;
+		return false;
+	}
 
-bool MMC_Emmc_Init(u32* pMfgId, char* pProdName, u32* pProdRev, u32* pProdSn) {
+	MMC_Mode.Timing = timing;
+	return true;
+}
+
+bool MMC_Emmc_Init(u32* pMfgId, char* pProdName, u32* pProdRev, u32* pProdSn,
+				   Pl_Emmc_XferClbk_t pXferClbk) {
 	if (!Pl_IsInit.Sys || !Pl_IsInit.DelayMs) {
 		PANIC();
 		return false;
@@ -10,10 +90,11 @@ bool MMC_Emmc_Init(u32* pMfgId, char* pProdName, u32* pProdRev, u32* pProdSn) {
 
 	// EMMC_Handle.Instance = SDMMC1;
 	// HAL_MMC_DeInit(&EMMC_Handle);
+	ASSIGN_NOT_NULL_VAL_TO_PTR(XferClbk_Emmc, pXferClbk);
 	LL_AHB3_GRP1_EnableClock(LL_AHB3_GRP1_PERIPH_SDMMC1);
 
 	EMMC_Handle.Instance				 = SDMMC1;
-	EMMC_Handle.Init.ClockDiv			 = 8;  // 200Mhz / (2 * ClockDiv)
+	EMMC_Handle.Init.ClockDiv			 = 4;  // 200Mhz / (2 * ClockDiv), legacy timing <= 26MHz
 	EMMC_Handle.Init.ClockPowerSave		 = SDMMC_CLOCK_POWER_SAVE_DISABLE;
 	EMMC_Handle.Init.ClockEdge			 = SDMMC_CLOCK_EDGE_RISING;
 	EMMC_Handle.Init.HardwareFlowControl = SDMMC_HARDWARE_FLOW_CONTROL_DISABLE;
@@ -22,14 +103,6 @@ bool MMC_Emmc_Init(u32* pMfgId, char* pProdName, u32* pProdRev, u32* pProdSn) {
 	if (HAL_MMC_Init(&EMMC_Handle) != HAL_OK)
 		return false;
 
-	// if (HAL_MMC_ConfigWideBusOperation(&EMMC_Handle, SDMMC_BUS_WIDE_4B) != HAL_OK) {
-	// 	return false;
-	// }
-
-	// if (HAL_MMC_ConfigSpeedBusOperation(&EMMC_Handle, SDMMC_SPEED_MODE_DEFAULT) != HAL_OK) {
-	// 	return false;
-	// }
-
 	HAL_MMC_CardCIDTypeDef cid = {0};
 	HAL_MMC_GetCardCID(&EMMC_Handle, &cid);
 	*pMfgId		 = cid.ManufacturerID;
@@ -48,6 +121,76 @@ bool MMC_Emmc_Init(u32* pMfgId, char* pProdName, u32* pProdRev, u32* pProdSn) {
 	return true;
 }
 
+bool MMC_Emmc_ConfigBus(u32* pBusWidth, Pl_SdEmmcTiming_t* pTiming, u32* pFallbacks) {
+	MMC_Mode	= (MMC_BusMode_t){.BusWidth = 1, .Timing = PL_SD_EMMC_TIMING_LEGACY};
+	*pBusWidth	= MMC_Mode.BusWidth;
+	*pTiming	= MMC_Mode.Timing;
+	*pFallbacks = 0;
+
+	if (!MMC_Emmc_ReadExtCsd(MMC_ExtCsd))
+		return false;
+
+	/* the widest bus first, the readback of a wrong one fails */
+	MMC_BusMode_t mode = {.BusWidth = MMC_BUS_WIDTH_MAX, .Timing = PL_SD_EMMC_TIMING_LEGACY};
+	while (!MMC_Emmc_TryBusWide(mode.BusWidth)) {
+		(*pFallbacks)++;
+		if (!MMC_Bus_NextMode((const u8*)MMC_ExtCsd, &mode))
+			break;
+	}
+
+	Pl_SdEmmcTiming_t timings[MMC_BUS_TIMINGS_MAX];
+	u32 timingNum = MMC_Bus_GetTimings((const u8*)MMC_ExtCsd, MMC_Mode.BusWidth, timings);
+	for (u32 i = 0; i < timingNum && !MMC_Emmc_TrySpeed(timings[i]); i++)
+		(*pFallbacks)++;
+
+	*pBusWidth = MMC_Mode.BusWidth;
+	*pTiming   = MMC_Mode.Timing;
+	return EMMC_Handle.ErrorCode == HAL_MMC_ERROR_NONE;
+}
+
+/**
+ * @brief the last transfer failed on a data or command CRC, the bus mode
+ * is marginal rather than the card broken
+ */
+bool MMC_Emmc_IsCrcError(void) {
+	return (EMMC_Handle.ErrorCode & (HAL_MMC_ERROR_DATA_CRC_FAIL | HAL_MMC_ERROR_CMD_CRC_FAIL)) !=
+		   0;
+}
+
+/**
+ * @brief runtime fallback after CRC errors on the negotiated mode, the
+ * next modes come from MMC_Bus_NextMode(). HS can't be enabled on top
+ * of DDR, so the switch goes through legacy
+ */
+bool MMC_Emmc_StepDownBus(u32* pBusWidth, Pl_SdEmmcTiming_t* pTiming, u32* pFallbacks) {
+	MMC_BusMode_t mode = MMC_Mode;
+	bool res		   = false;
+
+	(*pFallbacks)++;
+	if (MMC_Mode.Timing != PL_SD_EMMC_TIMING_LEGACY) {
+		HAL_MMC_ConfigSpeedBusOperation(&EMMC_Handle, SDMMC_SPEED_MODE_DEFAULT);
+		MMC_Mode.Timing = PL_SD_EMMC_TIMING_LEGACY;
+	}
+
+	while (!res && MMC_Bus_NextMode((const u8*)MMC_ExtCsd, &mode)) {
+		res = mode.BusWidth == MMC_Mode.BusWidth ? MMC_Emmc_TrySpeed(mode.Timing)
+												 : MMC_Emmc_TryBusWide(mode.BusWidth);
+		if (!res)
+			(*pFallbacks)++;
+	}
+
+	*pBusWidth = MMC_Mode.BusWidth;
+	*pTiming   = MMC_Mode.Timing;
+	return res;
+}
+
+u32 MMC_Emmc_GetBusClk(void) {
+	u32 kernelClk = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_SDMMC);
+	u32 clkDiv	  = EMMC_Handle.Instance->CLKCR & SDMMC_CLKCR_CLKDIV;
+
+	return clkDiv ? kernelClk / (2 * clkDiv) : kernelClk;
+}
+
 bool MMC_Emmc_ReadBlocks(u8* pData, u32 blockIdx, u32 blockNum, u32 tmo) {
 	u32 timeout = tmo * blockNum;
 	if (HAL_MMC_ReadBlocks(&EMMC_Handle, (u8*)pData, blockIdx, blockNum, timeout) != HAL_OK) {
@@ -74,12 +217,34 @@ bool MMC_Emmc_ReadBlocksDMA(u8* pData, u32 blockIdx, u32 blockNum) {
 	return true;
 }
 
+/**
+ * @brief a multi-block write is predefined with CMD23, the card knows the
+ * run length before the data and programs it without a CMD12. The HAL
+ * sends CMD12 on DATAEND of a multi-block context, so the context is set
+ * to the single block one before the SDMMC interrupt can see it. An error
+ * still ends the write with CMD12, the card is in the receive state then
+ */
 bool MMC_Emmc_WriteBlocksDMA(const u8* pData, u32 blockIdx, u32 blockNum) {
-	if (HAL_MMC_WriteBlocks_DMA(&EMMC_Handle, (u8*)pData, blockIdx, blockNum) != HAL_OK) {
-		return false;
+	if (blockNum == 1)
+		return HAL_MMC_WriteBlocks_DMA(&EMMC_Handle, (u8*)pData, blockIdx, blockNum) == HAL_OK;
+
+	NVIC_DisableIRQ(EMMC_IRQ);
+	u32 errorState = SDMMC_CmdBlockCount(EMMC_Handle.Instance, blockNum);
+	bool isOk	   = errorState == HAL_MMC_ERROR_NONE &&
+				HAL_MMC_WriteBlocks_DMA(&EMMC_Handle, (u8*)pData, blockIdx, blockNum) == HAL_OK;
+	if (isOk) {
+		EMMC_Handle.Context &= ~MMC_CONTEXT_WRITE_MULTIPLE_BLOCK;
+		EMMC_Handle.Context |= MMC_CONTEXT_WRITE_SINGLE_BLOCK;
+	} else {
+		EMMC_Handle.ErrorCode |= errorState;
 	}
+	NVIC_EnableIRQ(EMMC_IRQ);
 
-	return true;
+	return isOk;
+}
+
+void MMC_Emmc_Abort(void) {
+	HAL_MMC_Abort(&EMMC_Handle);
 }
 
 bool MMC_Emmc_Erase(u32 startAddr, u32 endAddr) {
@@ -90,6 +255,50 @@ bool MMC_Emmc_Erase(u32 startAddr, u32 endAddr) {
 	return true;
 }
 
+/**
+ * @brief DISCARD only unmaps the blocks, TRIM also makes them read
+ * as erased, both work on write blocks instead of erase groups
+ */
+static bool MMC_Emmc_GetDiscardType(u32* pEraseType) {
+	const u8* pExtCsd = (const u8*)MMC_ExtCsd;
+
+	if (pExtCsd[MMC_EXT_CSD_REV] >= MMC_EXT_CSD_REV_4_5) {
+		*pEraseType = HAL_MMC_DISCARD;
+		return true;
+	}
+
+	if (pExtCsd[MMC_EXT_CSD_SEC_FEATURE] & MMC_SEC_FEATURE_GB_CL_EN) {
+		*pEraseType = HAL_MMC_TRIM;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief returns discard granularity in blocks, 0 if not supported.
+ * Native 4kB sector devices take 8 aligned blocks only
+ */
+u32 MMC_Emmc_GetDiscardAlign(void) {
+	u32 eraseType;
+	if (!MMC_Emmc_GetDiscardType(&eraseType))
+		return 0;
+
+	return ((const u8*)MMC_ExtCsd)[MMC_EXT_CSD_DATA_SEC_SIZE] ? 8 : 1;
+}
+
+bool MMC_Emmc_Discard(u32 startBlock, u32 endBlock) {
+	u32 eraseType;
+	if (!MMC_Emmc_GetDiscardType(&eraseType))
+		return false;
+
+	if (HAL_MMC_EraseSequence(&EMMC_Handle, eraseType, startBlock, endBlock) != HAL_OK) {
+		return false;
+	}
+
+	return true;
+}
+
 u32 MMC_Emmc_GetCardState(void) {
 	return HAL_MMC_GetCardState(&EMMC_Handle);
 }
@@ -106,6 +315,21 @@ bool MMC_Emmc_GetDeviceInfo(HAL_MMC_CardInfoTypeDef* pDeviceInfo) {
 	return true;
 }
 
+void HAL_MMC_TxCpltCallback(MMC_HandleTypeDef* hmmc) {
+	DISCARD_UNUSED(hmmc);
+	XferClbk_Emmc(true);
+}
+
+void HAL_MMC_RxCpltCallback(MMC_HandleTypeDef* hmmc) {
+	DISCARD_UNUSED(hmmc);
+	XferClbk_Emmc(true);
+}
+
+void HAL_MMC_ErrorCallback(MMC_HandleTypeDef* hmmc) {
+	DISCARD_UNUSED(hmmc);
+	XferClbk_Emmc(false);
+}
+
 void SDMMC1_IRQHandler(void) {
 	HAL_MMC_IRQHandler(&EMMC_Handle);
 }
@@ -7,12 +7,20 @@
 
 #define EMMC_IRQ SDMMC1_IRQn
 
-bool MMC_Emmc_Init(u32* pMfgId, char* pProdName, u32* pProdRev, u32* pProdSn);
+bool MMC_Emmc_Init(u32* pMfgId, char* pProdName, u32* pProdRev, u32* pProdSn,
+				   Pl_Emmc_XferClbk_t pXferClbk);
+bool MMC_Emmc_ConfigBus(u32* pBusWidth, Pl_SdEmmcTiming_t* pTiming, u32* pFallbacks);
+bool MMC_Emmc_IsCrcError(void);
+bool MMC_Emmc_StepDownBus(u32* pBusWidth, Pl_SdEmmcTiming_t* pTiming, u32* pFallbacks);
+u32 MMC_Emmc_GetBusClk(void);
 bool MMC_Emmc_ReadBlocks(u8* pData, u32 blockIdx, u32 blockNum, u32 tmo);
 bool MMC_Emmc_WriteBlocks(const u8* pData, u32 blockIdx, u32 blockNum, u32 tmo);
 bool MMC_Emmc_ReadBlocksDMA(u8* pData, u32 blockIdx, u32 blockNum);
 bool MMC_Emmc_WriteBlocksDMA(const u8* pData, u32 blockIdx, u32 blockNum);
+void MMC_Emmc_Abort(void);
 bool MMC_Emmc_Erase(u32 startAddr, u32 endAddr);
+u32 MMC_Emmc_GetDiscardAlign(void);
+bool MMC_Emmc_Discard(u32 startBlock, u32 endBlock);
 u32 MMC_Emmc_GetCardState(void);
 bool MMC_Emmc_IsCardInTransfer(void);
 bool MMC_Emmc_GetDeviceInfo(HAL_MMC_CardInfoTypeDef* pDeviceInfo);
@@ -0,0 +1,94 @@
+#include "mmc_bus.h"
+
+#define MMC_EXT_CSD_HS_TIMING	 185
+#define MMC_EXT_CSD_DEVICE_TYPE	 196
+#define MMC_DEVICE_TYPE_HS52	 0x02
+#define MMC_DEVICE_TYPE_DDR52_3V 0x04 // 1.8V or 3V I/O, the 1.2V one is no use at 3.3V
+#define MMC_HS_TIMING_MASK		 0x0F // the upper half is the driver strength
+#define MMC_HS_TIMING_LEGACY	 0
+#define MMC_HS_TIMING_HS		 1
+
+/* from the fastest one, the last entry is always supported */
+static const u32 MMC_Bus_WidthList[] = {8, 4, 1};
+static const Pl_SdEmmcTiming_t MMC_Bus_TimingList[] = {
+	PL_SD_EMMC_TIMING_DDR52,
+	PL_SD_EMMC_TIMING_HS,
+	PL_SD_EMMC_TIMING_LEGACY,
+};
+
+/**
+ * @brief checks timing against EXT_CSD DEVICE_TYPE, DDR52 is specified
+ * for 4/8-bit bus only
+ */
+static bool MMC_Bus_IsTimingSupported(const u8* pExtCsd, Pl_SdEmmcTiming_t timing, u32 busWidth) {
+	u8 deviceType = pExtCsd[MMC_EXT_CSD_DEVICE_TYPE];
+
+	switch (timing) {
+		case PL_SD_EMMC_TIMING_DDR52:
+			return (deviceType & MMC_DEVICE_TYPE_DDR52_3V) && busWidth > 1;
+		case PL_SD_EMMC_TIMING_HS:
+			return (deviceType & MMC_DEVICE_TYPE_HS52);
+		default:
+			return true;
+	}
+}
+
+/**
+ * @brief the timings to try on a bus of @p busWidth, from the fastest one
+ * @param pTimings MMC_BUS_TIMINGS_MAX entries, the last one filled is legacy
+ * @retval number of timings
+ */
+u32 MMC_Bus_GetTimings(const u8* pExtCsd, u32 busWidth, Pl_SdEmmcTiming_t* pTimings) {
+	u32 num = 0;
+
+	for (u32 i = 0; i < NUM_ELEMENTS(MMC_Bus_TimingList); i++) {
+		if (MMC_Bus_IsTimingSupported(pExtCsd, MMC_Bus_TimingList[i], busWidth))
+			pTimings[num++] = MMC_Bus_TimingList[i];
+	}
+
+	return num;
+}
+
+/**
+ * @brief the mode to fall back to from @p pMode: the timing goes one step
+ * down first, the bus width only at legacy timing
+ * @retval false when @p pMode is 1-bit legacy already
+ */
+bool MMC_Bus_NextMode(const u8* pExtCsd, MMC_BusMode_t* pMode) {
+	if (pMode->Timing != PL_SD_EMMC_TIMING_LEGACY) {
+		Pl_SdEmmcTiming_t timings[MMC_BUS_TIMINGS_MAX];
+		u32 num = MMC_Bus_GetTimings(pExtCsd, pMode->BusWidth, timings);
+
+		/* Pl_SdEmmcTiming_t goes from the slowest one */
+		for (u32 i = 0; i < num; i++) {
+			if (timings[i] < pMode->Timing) {
+				pMode->Timing = timings[i];
+				return true;
+			}
+		}
+	}
+
+	for (u32 i = 0; i < NUM_ELEMENTS(MMC_Bus_WidthList); i++) {
+		if (MMC_Bus_WidthList[i] < pMode->BusWidth) {
+			pMode->BusWidth = MMC_Bus_WidthList[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief checks the EXT_CSD read back after a switch: HS_TIMING tells if
+ * the card took the timing. BUS_WIDTH is not readable, a wrong width shows
+ * up as a CRC error of the readback itself
+ */
+bool MMC_Bus_IsTimingSet(const u8* pExtCsd, Pl_SdEmmcTiming_t timing) {
+	u8 hsTiming = pExtCsd[MMC_EXT_CSD_HS_TIMING] & MMC_HS_TIMING_MASK;
+
+	/* DDR52 runs on HS timing, the data rate is set in BUS_WIDTH */
+	if (timing == PL_SD_EMMC_TIMING_LEGACY)
+		return hsTiming == MMC_HS_TIMING_LEGACY;
+
+	return hsTiming == MMC_HS_TIMING_HS;
+}
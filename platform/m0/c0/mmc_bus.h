@@ -0,0 +1,25 @@
+#ifndef __MMC_BUS_H
+#define __MMC_BUS_H
+
+#include "main.h"
+#include "platform.h"
+
+/**
+ * The choice of the eMMC bus mode from EXT_CSD, kept apart from the HAL
+ * driver in mmc.c so it runs on the host as well
+ */
+
+#define MMC_BUS_EXT_CSD_SIZE 512
+#define MMC_BUS_WIDTH_MAX	 8
+#define MMC_BUS_TIMINGS_MAX	 3
+
+typedef struct {
+	u32 BusWidth;
+	Pl_SdEmmcTiming_t Timing;
+} MMC_BusMode_t;
+
+u32 MMC_Bus_GetTimings(const u8* pExtCsd, u32 busWidth, Pl_SdEmmcTiming_t* pTimings);
+bool MMC_Bus_NextMode(const u8* pExtCsd, MMC_BusMode_t* pMode);
+bool MMC_Bus_IsTimingSet(const u8* pExtCsd, Pl_SdEmmcTiming_t timing);
+
+#endif /* __MMC_BUS_H */
@@ -1,22 +1,33 @@
 #include "usart.h"
+#include "dma_rx_ring.h"
 
 // clang-format off
 #define DEBUG_USART					USART1
 #define DEBUG_USART_IRQ_HDL			USART1_IRQHandler
 #define DEBUG_USART_CLK_EN()		LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_USART1);
+
+#define DEBUG_USART_DMA				DMA1 // clock is on since Sys_PerifClock_Config()
+#define DEBUG_USART_DMA_RX			LL_DMA_STREAM_0
+#define DEBUG_USART_DMA_TX			LL_DMA_STREAM_1
+#define DEBUG_USART_DMA_RX_IRQ_HDL	DMA1_Stream0_IRQHandler
+#define DEBUG_USART_DMA_TX_IRQ_HDL	DMA1_Stream1_IRQHandler
 // clang-format on
 
 USART_TypeDef* USART_Debug_GetInterface(void) {
 	return DEBUG_USART;
 }
 
-static Pl_UartExtra_RxClbk_t RxClbk_Debug = Pl_Stub_ParamClbk;
+static Pl_UartDma_RxClbk_t RxClbk_Debug = Pl_Stub_BuffClbk;
+static Pl_Dma_TxClbk_t TxClbk_Debug		= Pl_Stub_CommonClbk;
+
+static DmaRxRing_t USART_Debug_RxRing;
+static volatile bool USART_Debug_TxBusy; // owned by a DMA transfer or a polled print
 
 static bool USART_WaitFlag(USART_TypeDef* pcUsart, u32 tmo,
 						   u32 (*flagFunc)(const USART_TypeDef* pcUsart)) {
-	u32 endTime = PL_GET_MS_CNT() + tmo;
+	u32 startTime = PL_GET_MS_CNT();
 	while (!flagFunc(pcUsart)) {
-		if (PL_GET_MS_CNT() > endTime) {
+		if (PL_GET_MS_CNT() - startTime >= tmo) {
 			PANIC();
 			return false;
 		}
@@ -45,12 +56,73 @@ static u8 USART_RxByte(USART_TypeDef* pcUsart) {
 	return LL_USART_ReceiveData8(pcUsart);
 }
 
-bool USART_Debug_Init(u32 baudRate, Pl_UartExtra_RxClbk_t pRxClbk) {
+/**
+ * Circular RX: the DMA never stops, the half, full and idle line events
+ * hand out what came since the last one
+ */
+static void USART_Debug_DmaRxInit(u8* pRxBuff, u32 rxBuffLen) {
+	DmaRxRing_Init(&USART_Debug_RxRing, pRxBuff, rxBuffLen);
+
+	LL_DMA_SetPeriphRequest(DEBUG_USART_DMA, DEBUG_USART_DMA_RX, LL_DMAMUX1_REQ_USART1_RX);
+	LL_DMA_ConfigTransfer(DEBUG_USART_DMA, DEBUG_USART_DMA_RX,
+						  LL_DMA_DIRECTION_PERIPH_TO_MEMORY | LL_DMA_MODE_CIRCULAR |
+							  LL_DMA_PERIPH_NOINCREMENT | LL_DMA_MEMORY_INCREMENT |
+							  LL_DMA_PDATAALIGN_BYTE | LL_DMA_MDATAALIGN_BYTE |
+							  LL_DMA_PRIORITY_HIGH);
+	LL_DMA_DisableFifoMode(DEBUG_USART_DMA, DEBUG_USART_DMA_RX);
+	LL_DMA_SetPeriphAddress(DEBUG_USART_DMA, DEBUG_USART_DMA_RX,
+							LL_USART_DMA_GetRegAddr(DEBUG_USART, LL_USART_DMA_REG_DATA_RECEIVE));
+	LL_DMA_SetMemoryAddress(DEBUG_USART_DMA, DEBUG_USART_DMA_RX, (u32)pRxBuff);
+	LL_DMA_SetDataLength(DEBUG_USART_DMA, DEBUG_USART_DMA_RX, rxBuffLen);
+
+	LL_DMA_EnableIT_HT(DEBUG_USART_DMA, DEBUG_USART_DMA_RX);
+	LL_DMA_EnableIT_TC(DEBUG_USART_DMA, DEBUG_USART_DMA_RX);
+	LL_DMA_EnableIT_TE(DEBUG_USART_DMA, DEBUG_USART_DMA_RX);
+
+	LL_USART_EnableDMAReq_RX(DEBUG_USART);
+	LL_DMA_EnableStream(DEBUG_USART_DMA, DEBUG_USART_DMA_RX);
+}
+
+static void USART_Debug_DmaTxInit(void) {
+	LL_DMA_SetPeriphRequest(DEBUG_USART_DMA, DEBUG_USART_DMA_TX, LL_DMAMUX1_REQ_USART1_TX);
+	LL_DMA_ConfigTransfer(DEBUG_USART_DMA, DEBUG_USART_DMA_TX,
+						  LL_DMA_DIRECTION_MEMORY_TO_PERIPH | LL_DMA_MODE_NORMAL |
+							  LL_DMA_PERIPH_NOINCREMENT | LL_DMA_MEMORY_INCREMENT |
+							  LL_DMA_PDATAALIGN_BYTE | LL_DMA_MDATAALIGN_BYTE |
+							  LL_DMA_PRIORITY_LOW);
+	LL_DMA_DisableFifoMode(DEBUG_USART_DMA, DEBUG_USART_DMA_TX);
+	LL_DMA_SetPeriphAddress(DEBUG_USART_DMA, DEBUG_USART_DMA_TX,
+							LL_USART_DMA_GetRegAddr(DEBUG_USART, LL_USART_DMA_REG_DATA_TRANSMIT));
+
+	LL_DMA_EnableIT_TC(DEBUG_USART_DMA, DEBUG_USART_DMA_TX);
+	LL_DMA_EnableIT_TE(DEBUG_USART_DMA, DEBUG_USART_DMA_TX);
+
+	LL_USART_EnableDMAReq_TX(DEBUG_USART);
+}
+
+static void USART_Debug_DmaRxPoll(void) {
+	DmaRxRing_Chunk_t chunks[DMA_RX_RING_CHUNKS_MAX];
+	u32 remaining = LL_DMA_GetDataLength(DEBUG_USART_DMA, DEBUG_USART_DMA_RX);
+	u32 num		  = DmaRxRing_Update(&USART_Debug_RxRing, remaining, chunks);
+
+	for (u32 i = 0; i < num; i++)
+		RxClbk_Debug((u8*)chunks[i].pData, chunks[i].Len);
+}
+
+bool USART_Debug_Init(u32 baudRate, u8* pRxBuff, u32 rxBuffLen, Pl_UartDma_RxClbk_t pRxClbk,
+					  Pl_Dma_TxClbk_t pTxClbk) {
 	if (!Pl_IsInit.Sys || !Pl_IsInit.DelayMs) {
 		PANIC();
 		return false;
 	}
+
+	if (!pRxBuff || !rxBuffLen || rxBuffLen > USART_DMA_XFER_MAX) {
+		PANIC();
+		return false;
+	}
+
 	ASSIGN_NOT_NULL_VAL_TO_PTR(RxClbk_Debug, pRxClbk);
+	ASSIGN_NOT_NULL_VAL_TO_PTR(TxClbk_Debug, pTxClbk);
 
 	DEBUG_USART_CLK_EN();
 
@@ -68,7 +140,10 @@ bool USART_Debug_Init(u32 baudRate, Pl_UartExtra_RxClbk_t pRxClbk) {
 	LL_USART_Init(DEBUG_USART, &USART_InitStruct);
 
 	LL_USART_ConfigAsyncMode(DEBUG_USART);
-	LL_USART_EnableIT_RXNE(DEBUG_USART);
+	LL_USART_EnableIT_IDLE(DEBUG_USART);
+
+	USART_Debug_DmaRxInit(pRxBuff, rxBuffLen);
+	USART_Debug_DmaTxInit();
 
 	LL_USART_Enable(DEBUG_USART);
 	while (!LL_USART_IsActiveFlag_TEACK(DEBUG_USART) || !LL_USART_IsActiveFlag_REACK(DEBUG_USART)) {
@@ -77,8 +152,60 @@ bool USART_Debug_Init(u32 baudRate, Pl_UartExtra_RxClbk_t pRxClbk) {
 	return true;
 }
 
+/**
+ * The transmitter is taken with the IRQs masked, so a DMA start from an IRQ
+ * or another task can't come between the check and the claim
+ */
+static bool USART_Debug_TxClaim(void) {
+	u32 primask = __get_PRIMASK();
+	__disable_irq();
+
+	bool isFree = !USART_Debug_TxBusy;
+	if (isFree)
+		USART_Debug_TxBusy = true;
+
+	__set_PRIMASK(primask);
+	return isFree;
+}
+
+/**
+ * Polling transmit for the direct prints. A DMA transfer in progress is
+ * waited for, but a long one only makes the print fail, not panic. A DMA
+ * start during the print is refused and retried by the sender
+ */
 bool USART_Debug_TxData(u8* pBuff, u16 buffSize, u32 tmo) {
-	return USART_TxData(DEBUG_USART, pBuff, buffSize, tmo);
+	u32 startTime = PL_GET_MS_CNT();
+	while (!USART_Debug_TxClaim()) {
+		if (PL_GET_MS_CNT() - startTime >= tmo)
+			return false;
+	}
+
+	bool res		   = USART_TxData(DEBUG_USART, pBuff, buffSize, tmo);
+	USART_Debug_TxBusy = false;
+	return res;
+}
+
+/**
+ * @brief Starts a DMA transmit and returns, the TX callback reports the end
+ *
+ * @retval true transfer started
+ * @retval false a transfer is in progress or the length is out of range
+ */
+bool USART_Debug_TxDataDMA(const u8* pBuff, u32 len) {
+	if (!len || len > USART_DMA_XFER_MAX || !USART_Debug_TxClaim())
+		return false;
+
+	LL_DMA_ClearFlag_TC1(DEBUG_USART_DMA);
+	LL_DMA_ClearFlag_HT1(DEBUG_USART_DMA);
+	LL_DMA_ClearFlag_TE1(DEBUG_USART_DMA);
+	LL_DMA_ClearFlag_DME1(DEBUG_USART_DMA);
+	LL_DMA_ClearFlag_FE1(DEBUG_USART_DMA);
+
+	LL_DMA_SetMemoryAddress(DEBUG_USART_DMA, DEBUG_USART_DMA_TX, (u32)pBuff);
+	LL_DMA_SetDataLength(DEBUG_USART_DMA, DEBUG_USART_DMA_TX, len);
+	LL_DMA_EnableStream(DEBUG_USART_DMA, DEBUG_USART_DMA_TX);
+
+	return true;
 }
 
 u8 USART_Debug_RxByte(void) {
@@ -86,16 +213,10 @@ u8 USART_Debug_RxByte(void) {
 }
 
 void DEBUG_USART_IRQ_HDL(void) {
-	if (LL_USART_IsEnabledIT_RXNE_RXFNE(DEBUG_USART) &&
-		LL_USART_IsActiveFlag_RXNE_RXFNE(DEBUG_USART)) {
-		// LL_USART_ClearFlag_RXNE(DEBUG_USART);
-
-		u8 byte = USART_Debug_RxByte();
-		RxClbk_Debug((void*)&byte);
-	}
-
+	// the line went quiet, hand out the tail of the message without waiting for HT/TC
 	if (LL_USART_IsEnabledIT_IDLE(DEBUG_USART) && LL_USART_IsActiveFlag_IDLE(DEBUG_USART)) {
 		LL_USART_ClearFlag_IDLE(DEBUG_USART);
+		USART_Debug_DmaRxPoll();
 	}
 
 	if (LL_USART_IsEnabledIT_ERROR(DEBUG_USART)) {
@@ -120,3 +241,40 @@ void DEBUG_USART_IRQ_HDL(void) {
 		PANIC();
 	}
 }
+
+void DEBUG_USART_DMA_RX_IRQ_HDL(void) {
+	if (LL_DMA_IsActiveFlag_HT0(DEBUG_USART_DMA)) {
+		LL_DMA_ClearFlag_HT0(DEBUG_USART_DMA);
+		USART_Debug_DmaRxPoll();
+	}
+
+	if (LL_DMA_IsActiveFlag_TC0(DEBUG_USART_DMA)) {
+		LL_DMA_ClearFlag_TC0(DEBUG_USART_DMA);
+		USART_Debug_DmaRxPoll();
+	}
+
+	if (LL_DMA_IsActiveFlag_TE0(DEBUG_USART_DMA)) {
+		LL_DMA_ClearFlag_TE0(DEBUG_USART_DMA);
+		PANIC();
+	}
+}
+
+void DEBUG_USART_DMA_TX_IRQ_HDL(void) {
+	bool isDone = false;
+
+	if (LL_DMA_IsActiveFlag_TC1(DEBUG_USART_DMA)) {
+		LL_DMA_ClearFlag_TC1(DEBUG_USART_DMA);
+		isDone = true;
+	}
+
+	// the data is lost, but the sender must not wait forever
+	if (LL_DMA_IsActiveFlag_TE1(DEBUG_USART_DMA)) {
+		LL_DMA_ClearFlag_TE1(DEBUG_USART_DMA);
+		isDone = true;
+	}
+
+	if (isDone) {
+		USART_Debug_TxBusy = false;
+		TxClbk_Debug();
+	}
+}
@@ -5,12 +5,18 @@
 #include "platform.h"
 #include "platform_inc_m0.h"
 
-#define USART_DEBUG_IRQ	   USART1_IRQn
+#define USART_DEBUG_IRQ		   USART1_IRQn
+#define USART_DEBUG_DMA_RX_IRQ DMA1_Stream0_IRQn
+#define USART_DEBUG_DMA_TX_IRQ DMA1_Stream1_IRQn
+
+#define USART_DMA_XFER_MAX 0xFFFF // DMA stream NDTR width
 
 USART_TypeDef* USART_Debug_GetInterface(void);
 
-bool USART_Debug_Init(u32 baudRate, Pl_UartExtra_RxClbk_t pRxClbk);
+bool USART_Debug_Init(u32 baudRate, u8* pRxBuff, u32 rxBuffLen, Pl_UartDma_RxClbk_t pRxClbk,
+					  Pl_Dma_TxClbk_t pTxClbk);
 bool USART_Debug_TxData(u8* pBuff, u16 buffSize, u32 tmo);
+bool USART_Debug_TxDataDMA(const u8* pBuff, u32 len);
 u8 USART_Debug_RxByte(void);
 
 #endif /* __USART_H */
@@ -40,6 +40,15 @@ void Pl_Stub_HardFaultClbk(u32 pcVal) {
 	DISCARD_UNUSED(pcVal);
 }
 
+void Pl_Stub_StateClbk(bool state) {
+	DISCARD_UNUSED(state);
+}
+
+void Pl_Stub_BuffClbk(u8* pBuff, u32 len) {
+	DISCARD_UNUSED(pBuff);
+	DISCARD_UNUSED(len);
+}
+
 Pl_IsInit_t Pl_IsInit;
 Pl_SysClock_t Pl_SysClk;
 
@@ -180,6 +189,32 @@ u32 Pl_SysCpuCnt_Get(void) {
 	return Sys_CounterCPU_Get();
 }
 
+/**
+ * @brief D-cache maintenance for buffers shared with DMA masters,
+ * the MPU non-cacheable region is skipped
+ */
+static bool Pl_DCache_IsCacheable(const void* pBuff) {
+	extern u32 __start_no_cache_data[];
+	extern u32 __end_no_cache_data[];
+
+	u32 addr = (u32)pBuff;
+	return !(addr >= (u32)__start_no_cache_data && addr < (u32)__end_no_cache_data);
+}
+
+void Pl_DCache_Clean(const void* pBuff, u32 len) {
+	if (len == 0 || !Pl_DCache_IsCacheable(pBuff))
+		return;
+
+	SCB_CleanDCache_by_Addr((u32*)pBuff, (s32)len);
+}
+
+void Pl_DCache_Invalidate(void* pBuff, u32 len) {
+	if (len == 0 || !Pl_DCache_IsCacheable(pBuff))
+		return;
+
+	SCB_InvalidateDCache_by_Addr((u32*)pBuff, (s32)len);
+}
+
 void Pl_SoftReset(void) {
 	Sys_MCU_Reset();
 }
@@ -224,10 +259,19 @@ u32 Pl_TrueRand_GenerateOne(void) {
 	return rngVal;
 }
 
-bool Pl_DebugUart_Init(u32 baudRate, u8* pRxBuff, u32 rxBuffLen, Pl_UartExtra_RxClbk_t pRxClbk) {
+/**
+ * @param[in] pRxBuff circular DMA buffer, must be reachable by DMA1 (not DTCM)
+ * and non-cacheable, see PL_NO_CACHE_DMA_DATA
+ * @param[in] pRxClbk gets the received chunks from the USART IRQ priority
+ * @param[in] pTxClbk called when Pl_DebugUart_SendBuffDMA() is done with the buffer
+ */
+bool Pl_DebugUart_Init(u32 baudRate, u8* pRxBuff, u32 rxBuffLen, Pl_UartDma_RxClbk_t pRxClbk,
+					   Pl_Dma_TxClbk_t pTxClbk) {
 	GPIO_UartDebug_Init();
-	Pl_IsInit.SerialDebug = USART_Debug_Init(baudRate, pRxClbk);
+	Pl_IsInit.SerialDebug = USART_Debug_Init(baudRate, pRxBuff, rxBuffLen, pRxClbk, pTxClbk);
 	Sys_NVIC_SetPrioEnable(USART_DEBUG_IRQ, NVIC_IRQ_PRIO_USART_DEBUG);
+	Sys_NVIC_SetPrioEnable(USART_DEBUG_DMA_RX_IRQ, NVIC_IRQ_PRIO_USART_DEBUG);
+	Sys_NVIC_SetPrioEnable(USART_DEBUG_DMA_TX_IRQ, NVIC_IRQ_PRIO_USART_DEBUG);
 	return Pl_IsInit.SerialDebug;
 }
 
@@ -239,6 +283,17 @@ bool Pl_DebugUart_SendBuff(u8* pBuff, u32 size) {
 	return txState;
 }
 
+/**
+ * Starts the transfer and returns, false if one is in progress already.
+ * The buffer must stay untouched until the TX callback
+ */
+bool Pl_DebugUart_SendBuffDMA(const u8* pBuff, u32 size) {
+	ASSERT_CHECK(pBuff);
+
+	Pl_DCache_Clean(pBuff, size);
+	return USART_Debug_TxDataDMA(pBuff, size);
+}
+
 u8 Pl_DebugUart_ReceiveByte(void) {
 	return USART_Debug_RxByte();
 }
@@ -328,8 +383,8 @@ void Pl_Sys_DebugInit(void) {
 	LL_DBGMCU_APB4_GRP1_FreezePeriph(LL_DBGMCU_APB4_GRP1_IWDG1_STOP);
 }
 
-bool Pl_USB_CDC_Init(Pl_Usb_RxClbk_t pRxClbk_USB, u8* pRxBuff) {
-	Pl_IsInit.Usb = USB_Init(USBD_CLASS_CDC, pRxClbk_USB, pRxBuff);
+bool Pl_USB_CDC_Init(Pl_Usb_RxClbk_t pRxClbk_USB, u8* pRxBuff, Pl_Usb_TxCpltClbk_t pTxCpltClbk) {
+	Pl_IsInit.Usb = USB_Init(USBD_CLASS_CDC, pRxClbk_USB, pRxBuff, pTxCpltClbk, NULL);
 	Sys_NVIC_SetPrioEnable(OTG_HS_IRQn, NVIC_IRQ_PRIO_USB_HS);
 	return Pl_IsInit.Usb;
 }
@@ -338,6 +393,10 @@ RET_STATE_t Pl_USB_CDC_Transmit(char* pBuff, u16 len) {
 	return USB_SerialTransmit(pBuff, len);
 }
 
+u32 Pl_USB_CDC_GetPacketSize(void) {
+	return USB_CDC_GetPacketSize();
+}
+
 bool Pl_USB_CDC_IsReady(void) {
 	return USB_CDC_IsReady();
 }
@@ -346,8 +405,12 @@ bool Pl_USB_IsClassCDC(void) {
 	return USB_GetDeviceClass() == USBD_CLASS_CDC ? true : false;
 }
 
-bool Pl_USB_MSC_Init(void) {
-	Pl_IsInit.Usb = USB_Init(USBD_CLASS_MSC, NULL, NULL);
+/**
+ * @brief with @p pIrqClbk set the OTG IRQ only masks itself and calls it,
+ * the device stack then runs from Pl_USB_IrqProcess() in a task
+ */
+bool Pl_USB_MSC_Init(Pl_Usb_IrqClbk_t pIrqClbk) {
+	Pl_IsInit.Usb = USB_Init(USBD_CLASS_MSC, NULL, NULL, NULL, pIrqClbk);
 	Sys_NVIC_SetPrioEnable(OTG_HS_IRQn, NVIC_IRQ_PRIO_USB_HS);
 	return Pl_IsInit.Usb;
 }
@@ -360,15 +423,23 @@ bool Pl_USB_DeInit(void) {
 	return USB_DeInit();
 }
 
+void Pl_USB_IrqProcess(void) {
+	USB_IrqProcess();
+}
+
 
-bool Pl_Emmc_Init(Pl_SdEmmcInfo_t* pSdEmmcInfo) {
+bool Pl_Emmc_Init(Pl_SdEmmcInfo_t* pSdEmmcInfo, Pl_Emmc_XferClbk_t pXferClbk) {
 	ASSERT_CHECK(pSdEmmcInfo != NULL);
 
 	memset((void*)pSdEmmcInfo, 0, sizeof(Pl_SdEmmcInfo_t));
 
 	GPIO_Emmc_Init();
 	Pl_IsInit.SdEmmc = MMC_Emmc_Init(&pSdEmmcInfo->MfgID, pSdEmmcInfo->ProdName,
-									 &pSdEmmcInfo->ProdRev, &pSdEmmcInfo->ProdSN);
+									 &pSdEmmcInfo->ProdRev, &pSdEmmcInfo->ProdSN, pXferClbk);
+	if (Pl_IsInit.SdEmmc) {
+		MMC_Emmc_ConfigBus(&pSdEmmcInfo->BusWidth, &pSdEmmcInfo->Timing,
+						   &pSdEmmcInfo->BusFallbacks);
+	}
 	Sys_NVIC_SetPrioEnable(EMMC_IRQ, NVIC_IRQ_PRIO_EMMC);
 
 	Pl_Emmc_GetDeviceInfo(pSdEmmcInfo);
@@ -395,9 +466,11 @@ bool Pl_Emmc_GetDeviceInfo(Pl_SdEmmcInfo_t* pSdEmmcInfo) {
 	pSdEmmcInfo->Class		  = deviceInfo.Class;
 	pSdEmmcInfo->RelCardAdd	  = deviceInfo.RelCardAdd;
 	pSdEmmcInfo->BlockNbr	  = deviceInfo.BlockNbr;
-	pSdEmmcInfo->BlockSize	  = deviceInfo.CardType;
+	pSdEmmcInfo->BlockSize	  = deviceInfo.BlockSize;
 	pSdEmmcInfo->LogBlockNbr  = deviceInfo.LogBlockNbr;
 	pSdEmmcInfo->LogBlockSize = deviceInfo.LogBlockSize;
+	pSdEmmcInfo->BusClk		  = MMC_Emmc_GetBusClk();
+	pSdEmmcInfo->DiscardAlign = MMC_Emmc_GetDiscardAlign();
 
 	return true;
 }
@@ -418,10 +491,61 @@ bool Pl_Emmc_WriteDMA(const u8* pData, u32 blockIdx, u32 blockNum) {
 	return MMC_Emmc_WriteBlocksDMA(pData, blockIdx, blockNum);
 }
 
+void Pl_Emmc_AbortDMA(void) {
+	MMC_Emmc_Abort();
+}
+
+/**
+ * @brief SDMMC1 IDMA is an AXI master and reaches only D1 memories
+ * (AXI SRAM, FMC SDRAM), DTCM and D2 SRAM are not accessible.
+ * Start and length are kept cache line aligned so the invalidate after
+ * a read can't drop neighbour data
+ */
+bool Pl_Emmc_IsDmaBuff(const void* pBuff, u32 len) {
+	const u32 axiSramStart = 0x24000000UL;
+	const u32 axiSramEnd   = axiSramStart + 512 * DATA_1_KBYTE;
+	const u32 sdramStart   = 0xC0000000UL;
+	const u32 sdramEnd	   = sdramStart + 32 * DATA_1_MBYTE;
+
+	u32 addr = (u32)pBuff;
+	if ((addr % PL_DCACHE_LINE_SIZE) || (len % PL_DCACHE_LINE_SIZE))
+		return false;
+
+	if (addr >= axiSramStart && addr + len <= axiSramEnd)
+		return true;
+
+	if (addr >= sdramStart && addr + len <= sdramEnd)
+		return true;
+
+	return false;
+}
+
 bool Pl_Emmc_Erase(u32 startAddr, u32 endAddr) {
 	return MMC_Emmc_Erase(startAddr, endAddr);
 }
 
+bool Pl_Emmc_Discard(u32 startBlock, u32 endBlock) {
+	return MMC_Emmc_Discard(startBlock, endBlock);
+}
+
+bool Pl_Emmc_IsCrcError(void) {
+	return MMC_Emmc_IsCrcError();
+}
+
+/**
+ * @brief steps the bus mode down after CRC errors, see MMC_Emmc_StepDownBus
+ * @retval false if the card is at 1-bit legacy already
+ */
+bool Pl_Emmc_BusFallback(Pl_SdEmmcInfo_t* pSdEmmcInfo) {
+	ASSERT_CHECK(pSdEmmcInfo != NULL);
+
+	bool res = MMC_Emmc_StepDownBus(&pSdEmmcInfo->BusWidth, &pSdEmmcInfo->Timing,
+									&pSdEmmcInfo->BusFallbacks);
+	pSdEmmcInfo->BusClk = MMC_Emmc_GetBusClk();
+
+	return res;
+}
+
 u32 Pl_Emmc_GetCardState(void) {
 	return MMC_Emmc_GetCardState();
 }
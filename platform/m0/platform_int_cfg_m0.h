@@ -12,13 +12,13 @@
 #define NVIC_IRQ_PRIO_3							(NVIC_IRQ_PRIO_2 + 1)
 
 #define NVIC_IRQ_PRIO_4							(NVIC_IRQ_PRIO_3 + 1)
-#define NVIC_IRQ_PRIO_EMMC						NVIC_IRQ_PRIO_4
 
 /* Interrupts below are masked after entering critical section -
  * see configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY */
 
 #define NVIC_IRQ_PRIO_5							(NVIC_IRQ_PRIO_4 + 1)
 #define NVIC_IRQ_PRIO_USART_DEBUG				NVIC_IRQ_PRIO_5
+#define NVIC_IRQ_PRIO_EMMC						NVIC_IRQ_PRIO_5
 #define NVIC_IRQ_PRIO_USB_HS					NVIC_IRQ_PRIO_5
 
 #define NVIC_IRQ_PRIO_6							(NVIC_IRQ_PRIO_5 + 1)
@@ -47,6 +47,10 @@ extern "C" {
 #define MSC_MEDIA_PACKET             512U
 #endif /* MSC_MEDIA_PACKET */
 
+#ifndef MSC_MEDIA_MAP_PACKET
+#define MSC_MEDIA_MAP_PACKET         MSC_MEDIA_PACKET
+#endif /* MSC_MEDIA_MAP_PACKET */
+
 #define MSC_MAX_FS_PACKET            0x40U
 #define MSC_MAX_HS_PACKET            0x200U
 
@@ -79,6 +83,8 @@ typedef struct _USBD_STORAGE
   int8_t (* Write)(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
   int8_t (* GetMaxLun)(void);
   int8_t *pInquiry;
+  /* Optional, sets *buf to the data in place or leaves it NULL to use Read */
+  int8_t (* ReadPtr)(uint8_t lun, uint8_t **buf, uint32_t blk_addr, uint16_t blk_len);
 
 } USBD_StorageTypeDef;
 
@@ -1079,6 +1079,8 @@ static int8_t SCSI_CheckAddressRange(USBD_HandleTypeDef *pdev, uint8_t lun,
 static int8_t SCSI_ProcessRead(USBD_HandleTypeDef *pdev, uint8_t lun)
 {
   USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassDataCmsit[pdev->classId];
+  USBD_StorageTypeDef *pStorage;
+  uint8_t *pData;
   uint32_t len;
 
   if (hmsc == NULL)
@@ -1093,17 +1095,38 @@ static int8_t SCSI_ProcessRead(USBD_HandleTypeDef *pdev, uint8_t lun)
   MSCInEpAdd = USBD_CoreGetEPAdd(pdev, USBD_EP_IN, USBD_EP_TYPE_BULK, (uint8_t)pdev->classId);
 #endif /* USE_USBD_COMPOSITE */
 
-  len = MIN(len, MSC_MEDIA_PACKET);
+  pStorage = (USBD_StorageTypeDef *)pdev->pUserData[pdev->classId];
+  pData = NULL;
 
-  if (((USBD_StorageTypeDef *)pdev->pUserData[pdev->classId])->Read(lun, hmsc->bot_data,
-                                                                    hmsc->scsi_blk_addr,
-                                                                    (len / hmsc->scsi_blk_size)) < 0)
+  /* A storage that keeps the data in memory is sent from there without a copy */
+  if (pStorage->ReadPtr != NULL)
   {
-    SCSI_SenseCode(pdev, lun, HARDWARE_ERROR, UNRECOVERED_READ_ERROR);
-    return -1;
+    if (pStorage->ReadPtr(lun, &pData, hmsc->scsi_blk_addr,
+                          (MIN(len, MSC_MEDIA_MAP_PACKET) / hmsc->scsi_blk_size)) < 0)
+    {
+      SCSI_SenseCode(pdev, lun, HARDWARE_ERROR, UNRECOVERED_READ_ERROR);
+      return -1;
+    }
+  }
+
+  if (pData != NULL)
+  {
+    len = MIN(len, MSC_MEDIA_MAP_PACKET);
+  }
+  else
+  {
+    len = MIN(len, MSC_MEDIA_PACKET);
+    pData = hmsc->bot_data;
+
+    if (pStorage->Read(lun, hmsc->bot_data, hmsc->scsi_blk_addr,
+                       (len / hmsc->scsi_blk_size)) < 0)
+    {
+      SCSI_SenseCode(pdev, lun, HARDWARE_ERROR, UNRECOVERED_READ_ERROR);
+      return -1;
+    }
   }
 
-  (void)USBD_LL_Transmit(pdev, MSCInEpAdd, hmsc->bot_data, len);
+  (void)USBD_LL_Transmit(pdev, MSCInEpAdd, pData, len);
 
   hmsc->scsi_blk_addr += (len / hmsc->scsi_blk_size);
   hmsc->scsi_blk_len -= (len / hmsc->scsi_blk_size);
@@ -36,6 +36,13 @@ void UsbRxClbkStub(u8* pBuff, u32 len) {
 }
 static Pl_Usb_RxClbk_t RxClbk_USB = UsbRxClbkStub;
 
+void UsbTxCpltClbkStub(void) {
+}
+static Pl_Usb_TxCpltClbk_t TxCpltClbk_USB = UsbTxCpltClbkStub;
+
+/* set while the device is served by a task, see USB_IrqProcess() */
+static Pl_Usb_IrqClbk_t IrqClbk_USB;
+
 static USBD_StatusTypeDef USB_CDC_Init_HS(void) {
 	USBD_CDC_SetTxBuffer(&hUsbDeviceHS, USBD_TxBuffHS, 0);
 	USBD_CDC_SetRxBuffer(&hUsbDeviceHS, USBD_RxBuffHS);
@@ -45,6 +52,8 @@ static USBD_StatusTypeDef USB_CDC_Init_HS(void) {
 
 static USBD_StatusTypeDef USB_CDC_DeInit_HS(void) {
 	USB_CDC_ReadyState = false;
+	// The transfer in flight is dropped with the class, let the sender move on
+	TxCpltClbk_USB();
 	return USBD_OK;
 }
 
@@ -118,11 +127,17 @@ static USBD_StatusTypeDef USB_CDC_Transmit_HS(u8* pBuf, u16 len) {
 	return result;
 }
 
+/**
+ * Called from the USB IRQ when the whole transfer is on the bus,
+ * including the ZLP the class adds after a multiple of the packet size
+ */
 static USBD_StatusTypeDef USB_CDC_TransmitCplt_HS(u8* pBuf, u32* pLen, u8 epnum) {
 	DISCARD_UNUSED(pBuf);
 	DISCARD_UNUSED(pLen);
 	DISCARD_UNUSED(epnum);
 
+	TxCpltClbk_USB();
+
 	return USBD_OK;
 }
 
@@ -147,6 +162,11 @@ RET_STATE_t USB_SerialTransmit(char* pBuff, u16 len) {
 	return retState;
 }
 
+u32 USB_CDC_GetPacketSize(void) {
+	return hUsbDeviceHS.dev_speed == USBD_SPEED_HIGH ? CDC_DATA_HS_IN_PACKET_SIZE
+													 : CDC_DATA_FS_IN_PACKET_SIZE;
+}
+
 bool USB_CDC_IsReady(void) {
 	return USB_CDC_ReadyState;
 }
@@ -157,7 +177,8 @@ extern USBD_StorageTypeDef USBD_StorageInterface;
 
 // -----------------------------------------------------------------------------
 
-bool USB_Init(USBD_CLASS_t class, Pl_Usb_RxClbk_t pRxClbk_USB, u8* pRxBuff) {
+bool USB_Init(USBD_CLASS_t class, Pl_Usb_RxClbk_t pRxClbk_USB, u8* pRxBuff,
+			  Pl_Usb_TxCpltClbk_t pTxCpltClbk_USB, Pl_Usb_IrqClbk_t pIrqClbk_USB) {
 
 	if (!Pl_IsInit.Sys || !Pl_IsInit.Hsi48Clk) {
 		PANIC();
@@ -165,6 +186,8 @@ bool USB_Init(USBD_CLASS_t class, Pl_Usb_RxClbk_t pRxClbk_USB, u8* pRxBuff) {
 	}
 
 	ASSIGN_NOT_NULL_VAL_TO_PTR(RxClbk_USB, pRxClbk_USB);
+	ASSIGN_NOT_NULL_VAL_TO_PTR(TxCpltClbk_USB, pTxCpltClbk_USB);
+	IrqClbk_USB = pIrqClbk_USB;
 
 	if (class == USBD_CLASS_CDC && pRxBuff != NULL)
 		USB_CDC_RxBuffPtr = pRxBuff;
@@ -208,6 +231,7 @@ bool USB_DeInit(void) {
 	USBD_StatusTypeDef stat = USBD_DeInit(&hUsbDeviceHS);
 	if (stat == USBD_OK) {
 		USB_DeviceClass = USBD_CLASS_UNDEF;
+		IrqClbk_USB		= NULL;
 		return true;
 	}
 
@@ -218,6 +242,21 @@ USBD_CLASS_t USB_GetDeviceClass(void) {
 	return USB_DeviceClass;
 }
 
+/**
+ * @brief runs the device stack from the task the IRQ was deferred to,
+ * the IRQ stays masked from the deferral until the events are handled
+ */
+void USB_IrqProcess(void) {
+	HAL_PCD_IRQHandler(&hpcd_USB_OTG_HS);
+	NVIC_EnableIRQ(OTG_HS_IRQn);
+}
+
 void OTG_HS_IRQHandler(void) {
+	if (IrqClbk_USB != NULL) {
+		NVIC_DisableIRQ(OTG_HS_IRQn);
+		IrqClbk_USB();
+		return;
+	}
+
 	HAL_PCD_IRQHandler(&hpcd_USB_OTG_HS);
 }
\ No newline at end of file
@@ -33,9 +33,12 @@ typedef enum {
 	// USBD_CLASS_HID,
 } USBD_CLASS_t;
 
-bool USB_Init(USBD_CLASS_t class, Pl_Usb_RxClbk_t pRxClbk_USB, u8* pRxBuff);
+bool USB_Init(USBD_CLASS_t class, Pl_Usb_RxClbk_t pRxClbk_USB, u8* pRxBuff,
+			  Pl_Usb_TxCpltClbk_t pTxCpltClbk_USB, Pl_Usb_IrqClbk_t pIrqClbk_USB);
 bool USB_DeInit(void);
+void USB_IrqProcess(void);
 RET_STATE_t USB_SerialTransmit(char* pBuff, u16 len);
+u32 USB_CDC_GetPacketSize(void);
 bool USB_CDC_IsReady(void);
 USBD_CLASS_t USB_GetDeviceClass(void);
 
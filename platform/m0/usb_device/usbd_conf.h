@@ -74,6 +74,11 @@
 #define USBD_LPM_ENABLED     1U
 /*---------- -----------*/
 #define USBD_SELF_POWERED     1U
+/*---------- -----------*/
+/* MSC data per storage callback, several sectors go to the card at once */
+#define MSC_MEDIA_PACKET     8192U
+/* Mapped reads skip bot_data, below 1023 packets of the IN endpoint */
+#define MSC_MEDIA_MAP_PACKET     32768U
 
 /****************************************/
 /* #define for FS and HS identification */
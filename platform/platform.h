@@ -25,12 +25,16 @@ __STATIC_FORCEINLINE void PL_IrqOff(void) {
 #define PL_SHELL_HISTORY_DATA  __attribute__((section(".SHELL_HISTORY_DATA")))
 #define PL_BKP_STORAGE_DATA	   __attribute__((section(".BKP_STORAGE_DATA")))
 #define PL_STORAGE_IN_RAM_DATA __attribute__((section(".STORAGE_RAM_DATA")))
+#define PL_STORAGE_IN_D2_DATA  __attribute__((section(".STORAGE_D2_DATA")))
+#define PL_DEBUG_LOG_DATA	   __attribute__((section(".DEBUG_LOG_DATA")))
 #else /* FW_PLATFORM_M0 */
 #define PL_QUICKACCESS_DATA
 #define PL_NO_CACHE_DMA_DATA
 #define PL_SHELL_HISTORY_DATA
 #define PL_BKP_STORAGE_DATA
 #define PL_STORAGE_IN_RAM_DATA
+#define PL_STORAGE_IN_D2_DATA
+#define PL_DEBUG_LOG_DATA
 #endif /* FW_PLATFORM_M0 */
 
 #ifdef FW_PLATFORM_M0
@@ -38,6 +42,7 @@ __STATIC_FORCEINLINE void PL_IrqOff(void) {
 #define PL_SD_EMMC_DEF_TMO	   100
 #define PL_TRNG_MAX_ITER	   5
 #define PL_SDMMC_SECTOR_SIZE   512U
+#define PL_DCACHE_LINE_SIZE	   32U
 //LL_RTC_BKP_DR31 == 32
 #define PL_BKP_STORAGE_MAX_LEN 32
 #else /* FW_PLATFORM_M0 */
@@ -50,9 +55,13 @@ typedef void (*Pl_Uart_RxClbk_t)(void);
 typedef void (*Pl_UartExtra_RxClbk_t)(void*);
 typedef void (*Pl_Dma_TxClbk_t)(void);
 typedef void (*Pl_Dma_RxClbk_t)(void);
+typedef void (*Pl_UartDma_RxClbk_t)(u8* pBuff, u32 len);
 typedef void (*Pl_Spi_TxClbk_t)(void);
 typedef void (*Pl_Usb_RxClbk_t)(u8* pBuff, u32 len);
+typedef void (*Pl_Usb_TxCpltClbk_t)(void);
+typedef void (*Pl_Usb_IrqClbk_t)(void);
 typedef void (*Pl_Exti_Clbk_t)(void);
+typedef void (*Pl_Emmc_XferClbk_t)(bool isOk);
 //TODO add default callbacks to c file
 
 typedef struct {
@@ -101,6 +110,12 @@ typedef struct {
 
 extern Pl_SysClock_t Pl_SysClk;
 
+typedef enum {
+	PL_SD_EMMC_TIMING_LEGACY = 0,
+	PL_SD_EMMC_TIMING_HS,
+	PL_SD_EMMC_TIMING_DDR52,
+} Pl_SdEmmcTiming_t;
+
 typedef struct {
 	u32 CardType; /*!< Specifies the card Type                         */
 	// u32 CardVersion;  /*!< Specifies the card version                      */
@@ -114,11 +129,18 @@ typedef struct {
 	char ProdName[6];
 	u32 ProdRev;
 	u32 ProdSN;
+	u32 BusWidth;			  /*!< Negotiated data bus width in bits               */
+	u32 BusClk;				  /*!< Bus clock in Hz                                 */
+	Pl_SdEmmcTiming_t Timing; /*!< Negotiated bus timing                           */
+	u32 BusFallbacks;		  /*!< Bus modes rejected on switch or CRC errors      */
+	u32 DiscardAlign;		  /*!< Discard granularity in blocks, 0 if no support  */
 } Pl_SdEmmcInfo_t;
 
 void Pl_Stub_CommonClbk(void);
 void Pl_Stub_ParamClbk(void* pVal);
 void Pl_Stub_HardFaultClbk(u32 pcVal);
+void Pl_Stub_StateClbk(bool state);
+void Pl_Stub_BuffClbk(u8* pBuff, u32 len);
 
 bool Pl_Init(Pl_HardFault_Clbk_t hardFault_Clbk, u32 maxMaskedIntPrio);
 
@@ -142,6 +164,9 @@ u32 Pl_Crc32_CheckBuff(const u8* pBuff, u32 buffSize);
 void Pl_SysCpuCnt_Init(void);
 u32 Pl_SysCpuCnt_Get(void);
 
+void Pl_DCache_Clean(const void* pBuff, u32 len);
+void Pl_DCache_Invalidate(void* pBuff, u32 len);
+
 void Pl_SoftReset(void);
 const char* Pl_GetRstFlagStr(void);
 
@@ -149,8 +174,10 @@ bool Pl_TrueRand_Init(void);
 bool Pl_TrueRand_GenerateBuff(u32* pBuff, u32 maxNum);
 u32 Pl_TrueRand_GenerateOne(void);
 
-bool Pl_DebugUart_Init(u32 baudRate, u8* pRxBuff, u32 rxBuffLen, Pl_UartExtra_RxClbk_t pRxClbk);
+bool Pl_DebugUart_Init(u32 baudRate, u8* pRxBuff, u32 rxBuffLen, Pl_UartDma_RxClbk_t pRxClbk,
+					   Pl_Dma_TxClbk_t pTxClbk);
 bool Pl_DebugUart_SendBuff(u8* pBuff, u32 size);
+bool Pl_DebugUart_SendBuffDMA(const u8* pBuff, u32 size);
 u8 Pl_DebugUart_ReceiveByte(void);
 
 bool Pl_RTC_Init(bool isInit, u32* pRetRtcStateBits);
@@ -173,23 +200,30 @@ bool Pl_Wireless_Init(u32 baudRate, u8* pRxBuff, u32 rxBuffLen, Pl_Uart_RxClbk_t
 bool Pl_Wireless_Send(u8* pBuff, u32 size);
 u32 Pl_Wireless_GetDataCnt(void);
 
-bool Pl_USB_CDC_Init(Pl_Usb_RxClbk_t pRxClbk_USB, u8* pRxBuff);
+bool Pl_USB_CDC_Init(Pl_Usb_RxClbk_t pRxClbk_USB, u8* pRxBuff, Pl_Usb_TxCpltClbk_t pTxCpltClbk);
 RET_STATE_t Pl_USB_CDC_Transmit(char* pBuff, u16 len);
+u32 Pl_USB_CDC_GetPacketSize(void);
 bool Pl_USB_CDC_IsReady(void);
 bool Pl_USB_IsClassCDC(void);
 
-bool Pl_USB_MSC_Init(void);
+bool Pl_USB_MSC_Init(Pl_Usb_IrqClbk_t pIrqClbk);
 bool Pl_USB_IsClassMSC(void);
 
 bool Pl_USB_DeInit(void);
+void Pl_USB_IrqProcess(void);
 
-bool Pl_Emmc_Init(Pl_SdEmmcInfo_t* pSdEmmcInfo);
+bool Pl_Emmc_Init(Pl_SdEmmcInfo_t* pSdEmmcInfo, Pl_Emmc_XferClbk_t pXferClbk);
 bool Pl_Emmc_GetDeviceInfo(Pl_SdEmmcInfo_t* pSdEmmcInfo);
 bool Pl_Emmc_Read(u8* pData, u32 blockIdx, u32 blockNum);
 bool Pl_Emmc_ReadDMA(u8* pData, u32 blockIdx, u32 blockNum);
 bool Pl_Emmc_Write(const u8* pData, u32 blockIdx, u32 blockNum);
 bool Pl_Emmc_WriteDMA(const u8* pData, u32 blockIdx, u32 blockNum);
+void Pl_Emmc_AbortDMA(void);
+bool Pl_Emmc_IsDmaBuff(const void* pBuff, u32 len);
 bool Pl_Emmc_Erase(u32 startAddr, u32 endAddr);
+bool Pl_Emmc_Discard(u32 startBlock, u32 endBlock);
+bool Pl_Emmc_IsCrcError(void);
+bool Pl_Emmc_BusFallback(Pl_SdEmmcInfo_t* pSdEmmcInfo);
 u32 Pl_Emmc_GetCardState(void);
 bool Pl_Emmc_IsCardInTransfer(void);
 
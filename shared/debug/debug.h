@@ -1,7 +1,10 @@
 #ifndef __DEBUG_H
 #define __DEBUG_H
 
+#include "byte_ring.h"
+#include "debug_bin_log.h"
 #include "debug_cfg.h"
+#include "debug_tx.h"
 #include "main.h"
 // clang-format off
 
@@ -62,10 +65,49 @@ typedef struct {
 	char* Emoji;
 } LogLvl_t;
 
-typedef struct {
-	char* Ptr;
-	u32 Len;
-} DebugMsg_t;
+#define X_ENTRY(mod, mod_str, build_lvl) mod,
+typedef enum {
+	DEBUG_MODULE_TABLE()
+	DBG_MOD_ENUM_SIZE
+} DBG_MOD_t;
+#undef X_ENTRY
+
+#define X_ENTRY(mod, mod_str, build_lvl) mod##_BUILD_LVL = build_lvl,
+enum {
+	DEBUG_MODULE_TABLE()
+};
+#undef X_ENTRY
+
+#define DEBUG_MOD_LVL_INHERIT		0xFF // module follows the global level
+
+/**
+ * Module of the prints in a .c file, define it before the includes
+ */
+#ifndef DEBUG_MODULE
+#define DEBUG_MODULE				DBG_MOD_MAIN
+#endif /* DEBUG_MODULE */
+
+#define DEBUG_MOD_BUILD_LVL(mod)	DEBUG_MOD_BUILD_LVL_(mod)
+#define DEBUG_MOD_BUILD_LVL_(mod)	((int)mod##_BUILD_LVL)
+
+/**
+ * The build level check is a constant, so the compiler drops the prints
+ * below it. Others cost one lookup of the active module level, which
+ * already has the global level and the shell overrides applied
+ */
+#define DEBUG_MOD_LVL_IS_ON(mod, l)	((l) < LOG_LVL_DISABLE && (l) >= DEBUG_MOD_BUILD_LVL(mod) && \
+									 (l) >= Debug_ModLvl_Active[mod])
+#define DEBUG_LVL_IS_ON(l)			DEBUG_MOD_LVL_IS_ON(DEBUG_MODULE, l)
+
+#define DEBUG_LVL_DO(l, ...)		do { \
+										if(DEBUG_LVL_IS_ON(l)) { \
+											__VA_ARGS__; \
+										} \
+									} while(0)
+
+#define DEBUG_TRACE_DO(...)			DEBUG_LVL_DO(LOG_LVL_TRACE, __VA_ARGS__)
+
+extern u8 Debug_ModLvl_Active[DBG_MOD_ENUM_SIZE];
 
 #define DEBUG_PRINT_DIRECT(_f_, ...)				do { \
 														char _dbg_str[512] = ""; \
@@ -109,6 +151,17 @@ typedef struct {
 															__FUNCTION__, RetState_GetStr(rs)); \
 													} while(0)
 
+#if DBG_USE_BIN_LOG
+#define DEBUG_LOG_PRINT(_f_, ...)					DEBUG_BIN_LOG(DEBUG_BIN_LOG_LVL_NONE, _f_, ##__VA_ARGS__)
+
+#define DEBUG_LOG_COLOR_PRINT(c, _f_, ...)			DEBUG_BIN_LOG(DEBUG_BIN_LOG_LVL_NONE, c _f_ ESC_RESET_STYLE, ##__VA_ARGS__)
+
+#define DEBUG_LOG_LVL_PRINT_LOCAL(l, _f_, ...)		do { \
+														if(l >= LOG_LVL_DISABLE) \
+															break; \
+														DEBUG_BIN_LOG(l, _f_, ##__VA_ARGS__); \
+													} while(0)
+#else /* DBG_USE_BIN_LOG */
 #define DEBUG_LOG_PRINT(_f_, ...)					do { \
 														char _td_str[TD_STR_SIZE] = ""; \
 														DBG_TIME_DATE_STR_GET(_td_str, TD_STR_SIZE); \
@@ -128,29 +181,6 @@ typedef struct {
 														DEBUG_LOG_PRINT(c _f_ ESC_RESET_STYLE, ##__VA_ARGS__); \
 													} while(0)
 
-#define DEBUG_LOG_LVL_PRINT(l, _f_, ...)			do { \
-														if(l >= LOG_LVL_DISABLE) \
-															break; \
-														if(l >= Debug_LogLvl_Get()) \
-														{ \
-															char _td_str[TD_STR_SIZE] = ""; \
-															DBG_TIME_DATE_STR_GET(_td_str, TD_STR_SIZE); \
-															char _tn_str[TASK_NAME_STR_SIZE] = ""; \
-															DBG_TASK_NAME_STR_GET(_tn_str, TASK_NAME_STR_SIZE); \
-															DEBUG_PRINT("[%s%s%s] " ESC_COLOR_CYAN DEBUG_LOG_STR ESC_RESET_STYLE _f_ "\r\n", \
-																	Debug_LogLvl_GetColor(l), \
-																	Debug_LogLvl_GetStr(l), \
-																	ESC_RESET_STYLE, \
-																	_td_str, \
-																	DBG_TIMER_MILLISEC_GET(), \
-																	DBG_FILENAME, \
-																	_tn_str, \
-																	__FUNCTION__, \
-																	__LINE__, \
-																	##__VA_ARGS__); \
-														} \
-													} while(0)
-
 #define DEBUG_LOG_LVL_PRINT_LOCAL(l, _f_, ...)		do { \
 														if(l >= LOG_LVL_DISABLE) \
 															break; \
@@ -170,15 +200,21 @@ typedef struct {
 																__LINE__, \
 																##__VA_ARGS__); \
 													} while(0)
+#endif /* DBG_USE_BIN_LOG */
+
+#define DEBUG_LOG_LVL_PRINT(l, _f_, ...)			DEBUG_LVL_DO(l, DEBUG_LOG_LVL_PRINT_LOCAL(l, _f_, ##__VA_ARGS__))
 // clang-format on
 
 void Debug_Init(void);
 bool Debug_HardwareIsInit(void);
 bool Debug_SendChar(char ch, u32 waitTmo);
 bool Debug_SendCharFromISR(char ch, BaseType_t* pWoken);
+bool Debug_SendBuffFromISR(const char* pBuff, u32 len, BaseType_t* pWoken);
 bool Debug_SendString(char* pStr, u32 waitTmo);
 bool Debug_TransmitBuff(char* pBuff, u32 size);
+bool Debug_WriteRaw(const void* pData, u32 len);
 char Debug_ReceiveSymbol(u32 delay);
+u32 Debug_ReceiveBuff(char* pBuff, u32 size, u32 delay);
 
 void Debug_LogLvl_Set(LOG_LVL_t lvl);
 LOG_LVL_t Debug_LogLvl_Get(void);
@@ -187,6 +223,13 @@ char* Debug_LogLvl_GetStr(LOG_LVL_t lvl);
 char* Debug_LogLvl_GetColor(LOG_LVL_t lvl);
 char* Debug_LogLvl_GetEmoji(LOG_LVL_t lvl);
 
+const char* Debug_Mod_GetStr(DBG_MOD_t mod);
+DBG_MOD_t Debug_Mod_GetByStr(const char* pStr);
+LOG_LVL_t Debug_Mod_GetBuildLvl(DBG_MOD_t mod);
+void Debug_ModLvl_Set(DBG_MOD_t mod, u8 lvl);
+u8 Debug_ModLvl_Get(DBG_MOD_t mod);
+LOG_LVL_t Debug_ModLvl_GetActive(DBG_MOD_t mod);
+
 void Debug_PrintMainInfo(void);
 void Debug_PrintSysInfo(void);
 
@@ -196,6 +239,8 @@ void Debug_LedOn(void);
 void Debug_LedToggle(void);
 
 TaskHandle_t DebugSend_GetTaskHandle(void);
+ByteRing_Stats_t DebugSend_GetRingStats(void);
+DebugTx_Stats_t DebugSend_GetTxStats(void);
 void FreeRTOS_DebugSend_InitComponents(bool resources, bool tasks);
 
 #endif /* __DEBUG_H */
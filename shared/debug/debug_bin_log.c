@@ -0,0 +1,199 @@
+#include "debug_bin_log.h"
+#include "debug.h"
+
+/**
+ * Binary log record, little endian, decoded on the host by
+ * utils/fw_analyse/bin_log_decode.py with the firmware ELF:
+ *
+ *	u8	magic	DEBUG_BIN_LOG_MAGIC, never seen in UTF-8 text
+ *	u8	len		bytes that follow this field
+ *	u8	lvl		LOG_LVL_t or DEBUG_BIN_LOG_LVL_NONE, DEBUG_BIN_LOG_TRUNCATED flag
+ *	u32	site	address of the DebugBinSite_t in flash
+ *	u32	time	microseconds, low word
+ *	...	args	raw arguments in format string order
+ *
+ * Integer arguments take their C size, floating point ones 8 bytes,
+ * '*' widths 4 bytes, strings a u8 length and the bytes without the '\0'
+ */
+
+#define DEBUG_BIN_LOG_NULL_STR "(null)"
+
+typedef struct {
+	u8 Buff[DEBUG_BIN_LOG_REC_MAX];
+	u32 Pos;
+	bool Truncated;
+} DebugBinRec_t;
+
+static void DebugBin_Put(DebugBinRec_t* pRec, const void* pVal, u32 len) {
+	if (pRec->Truncated || pRec->Pos + len > sizeof(pRec->Buff)) {
+		pRec->Truncated = true;
+		return;
+	}
+
+	memcpy(&pRec->Buff[pRec->Pos], pVal, len);
+	pRec->Pos += len;
+}
+
+static void DebugBin_PutStr(DebugBinRec_t* pRec, const char* pStr) {
+	if (!pStr)
+		pStr = DEBUG_BIN_LOG_NULL_STR;
+
+	u32 room = sizeof(pRec->Buff) - pRec->Pos;
+	if (pRec->Truncated || room < 1) {
+		pRec->Truncated = true;
+		return;
+	}
+
+	// a cut string still decodes, only its tail is lost
+	u32 maxLen = GET_MIN(room - 1, UINT8_MAX);
+	u32 len	   = strnlen(pStr, maxLen + 1);
+	if (len > maxLen) {
+		len				= maxLen;
+		pRec->Truncated = true;
+	}
+
+	pRec->Buff[pRec->Pos++] = (u8)len;
+	memcpy(&pRec->Buff[pRec->Pos], pStr, len);
+	pRec->Pos += len;
+}
+
+#define DEBUG_BIN_PUT_ARG(rec, args, type)  \
+	do {                                    \
+		type _v = va_arg(args, type);       \
+		DebugBin_Put(rec, &_v, sizeof(_v)); \
+	} while (0)
+
+/**
+ * Walks the format string the same way printf() does, but instead of
+ * formatting copies every argument as is
+ */
+static void DebugBin_PutArgs(DebugBinRec_t* pRec, const char* pFmt, va_list args) {
+	for (const char* p = pFmt; *p; p++) {
+		if (*p != '%')
+			continue;
+
+		p++;
+		if (!*p)
+			break;
+		if (*p == '%')
+			continue;
+
+		while (*p && strchr("-+ #0", *p))
+			p++;
+
+		if (*p == '*') {
+			DEBUG_BIN_PUT_ARG(pRec, args, int);
+			p++;
+		}
+		while (*p >= '0' && *p <= '9')
+			p++;
+
+		if (*p == '.') {
+			p++;
+			if (*p == '*') {
+				DEBUG_BIN_PUT_ARG(pRec, args, int);
+				p++;
+			}
+			while (*p >= '0' && *p <= '9')
+				p++;
+		}
+
+		u32 lenMod = 0; // 1 - long, 2 - long long, 3 - size_t and co, 4 - long double
+		while (*p && strchr("hljztL", *p)) {
+			if (*p == 'l')
+				lenMod++;
+			else if (*p == 'j')
+				lenMod = 2;
+			else if (*p == 'z' || *p == 't')
+				lenMod = 3;
+			else if (*p == 'L')
+				lenMod = 4;
+			p++;
+		}
+
+		switch (*p) {
+			case 'd':
+			case 'i':
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X':
+				if (lenMod == 1)
+					DEBUG_BIN_PUT_ARG(pRec, args, long);
+				else if (lenMod == 2)
+					DEBUG_BIN_PUT_ARG(pRec, args, long long);
+				else if (lenMod == 3)
+					DEBUG_BIN_PUT_ARG(pRec, args, size_t);
+				else
+					DEBUG_BIN_PUT_ARG(pRec, args, int);
+				break;
+			case 'c':
+				DEBUG_BIN_PUT_ARG(pRec, args, int);
+				break;
+			case 'p':
+				DEBUG_BIN_PUT_ARG(pRec, args, void*);
+				break;
+			case 'f':
+			case 'F':
+			case 'e':
+			case 'E':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A':
+				if (lenMod == 4) {
+					double v = (double)va_arg(args, long double);
+					DebugBin_Put(pRec, &v, sizeof(v));
+				} else {
+					DEBUG_BIN_PUT_ARG(pRec, args, double);
+				}
+				break;
+			case 's':
+				DebugBin_PutStr(pRec, va_arg(args, const char*));
+				break;
+			default:
+				// %n or a broken format: the rest can't be walked safely
+				pRec->Truncated = true;
+				return;
+		}
+
+		if (pRec->Truncated)
+			return;
+	}
+}
+
+/**
+ * @brief Puts one binary log record to the debug output.
+ * Called by the DEBUG_LOG_xxx macros when DBG_USE_BIN_LOG is set
+ *
+ * @param[in] lvl LOG_LVL_t value or DEBUG_BIN_LOG_LVL_NONE
+ * @param[in] pSite call site description, its address is the record ID
+ */
+void Debug_BinLog(u8 lvl, const DebugBinSite_t* pSite, ...) {
+	// no initializer, zeroing the whole buffer on every call isn't needed
+	DebugBinRec_t rec;
+	rec.Pos		  = 0;
+	rec.Truncated = false;
+
+	u8 magic   = DEBUG_BIN_LOG_MAGIC;
+	u8 len	   = 0; // patched below
+	u32 site   = (u32)(uintptr_t)pSite;
+	u32 timeUs = (u32)DBG_TIMER_MICROSEC_GET();
+
+	DebugBin_Put(&rec, &magic, sizeof(magic));
+	DebugBin_Put(&rec, &len, sizeof(len));
+	DebugBin_Put(&rec, &lvl, sizeof(lvl));
+	DebugBin_Put(&rec, &site, sizeof(site));
+	DebugBin_Put(&rec, &timeUs, sizeof(timeUs));
+
+	va_list args;
+	va_start(args, pSite);
+	DebugBin_PutArgs(&rec, pSite->pFmt, args);
+	va_end(args);
+
+	if (rec.Truncated)
+		rec.Buff[2] |= DEBUG_BIN_LOG_TRUNCATED;
+	rec.Buff[1] = (u8)(rec.Pos - 2);
+
+	Debug_WriteRaw(rec.Buff, rec.Pos);
+}
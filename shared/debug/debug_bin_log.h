@@ -0,0 +1,36 @@
+#ifndef __DEBUG_BIN_LOG_H
+#define __DEBUG_BIN_LOG_H
+
+#include "main.h"
+
+// clang-format off
+#define DEBUG_BIN_LOG_MAGIC			0xFE
+#define DEBUG_BIN_LOG_LVL_NONE		0x7F // DEBUG_LOG_PRINT() without a level
+#define DEBUG_BIN_LOG_TRUNCATED		0x80 // flag in the level byte
+#define DEBUG_BIN_LOG_REC_MAX		128	 // record size on the stack, 257 at most
+
+/**
+ * Binary log call site, kept in flash. The host decoder finds it in the ELF
+ * by the address sent in the record
+ */
+typedef struct {
+	const char* pFmt;
+	const char* pFile;
+	const char* pFunc;
+	u32 Line;
+} DebugBinSite_t;
+
+#define DEBUG_BIN_LOG(l, _f_, ...)					do { \
+														static const DebugBinSite_t _dbg_site = { \
+															.pFmt = _f_, \
+															.pFile = __FILE__, \
+															.pFunc = __func__, \
+															.Line = __LINE__, \
+														}; \
+														Debug_BinLog(l, &_dbg_site, ##__VA_ARGS__); \
+													} while(0)
+// clang-format on
+
+void Debug_BinLog(u8 lvl, const DebugBinSite_t* pSite, ...);
+
+#endif /* __DEBUG_BIN_LOG_H */
@@ -5,6 +5,25 @@
 #define DBG_USE_SYS_TIMER 1
 #define DBG_USE_RTOS	  1
 #define DBG_USE_FILE_NAME 1
+#define DBG_USE_BIN_LOG	  0 // see debug_bin_log.c, decode with utils/fw_analyse
+
+/**
+ * Size of the printf() output ring, power of two.
+ * Must stay below 64K: the USB CDC transmit length is 16 bit
+ */
+#define DBG_LOG_RING_SIZE 8192
+
+/**
+ * Max USB CDC transfer taken from the ring at once. The block stays in the
+ * ring until the transfer completes, half of it is left for new output
+ */
+#define DBG_USB_TX_XFER_MAX (DBG_LOG_RING_SIZE / 2)
+
+/**
+ * Max UART DMA transfer taken from the ring at once. Keeps a transfer
+ * well inside the polled send timeout: about 11 ms at 921600 baud
+ */
+#define DBG_UART_TX_XFER_MAX 1024
 
 #if DBG_USE_TIME_DATE
 #include "time_date.h"
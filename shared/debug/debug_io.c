@@ -4,81 +4,111 @@
 #include "debug.h"
 #include "platform.h"
 
-#define DEBUG_CHUNK_SIZE  128
 #define DEBUG_RX_BUFF_LEN 128
-static u8 Debug_RxBuff[DEBUG_RX_BUFF_LEN];
+// circular DMA buffer of the UART, DMA1 can't reach DTCM
+static PL_NO_CACHE_DMA_DATA u8 Debug_RxBuff[DEBUG_RX_BUFF_LEN];
 
 #if DBG_USE_RTOS
-#include "mem_wrapper.h"
 #include "rtos_analyzer.h"
 
+#define DEBUG_DROP_MSG_LEN 64
+
+static PL_DEBUG_LOG_DATA u8 DebugSend_RingBuff[DBG_LOG_RING_SIZE];
+static ByteRing_t DebugSend_Ring;
 static TaskHandle_t DebugSend_Handle;
-static QueueHandle_t DebugSend_Queue;
 
-static QueueHandle_t DebugRxSymbol_Queue;
+static bool DebugSend_Submit(void* pCtx, const u8* pData, u32 len);
+
+#if defined DEBUG_OUTPUT_THROUGH_USB
+static DebugTx_Ep_t DebugSend_Ep = {
+	.Submit		= DebugSend_Submit,
+	.pCtx		= NULL,
+	.XferMax	= DBG_USB_TX_XFER_MAX,
+	.PacketSize = 0, // known after the enumeration
+};
+#else  /* DEBUG_OUTPUT_THROUGH_USB */
+static DebugTx_Ep_t DebugSend_Ep = {
+	.Submit		= DebugSend_Submit,
+	.pCtx		= NULL,
+	.XferMax	= DBG_UART_TX_XFER_MAX,
+	.PacketSize = 0,
+};
+#endif /* DEBUG_OUTPUT_THROUGH_USB */
+static DebugTx_t DebugSend_Tx;
+
+static StreamBufferHandle_t DebugRx_Stream;
 static SemaphoreHandle_t DebugRxSequence_Mutex;
+
+static bool Debug_SendBuff(const char* pBuff, u32 len);
 #endif /* DBG_USE_RTOS */
 
-/*
- * Wrapper for printf() function native using via selected interface
+/**
+ * Puts raw bytes to the debug output, used by printf() and the binary log.
+ * Never blocks: with the ring full the bytes are dropped and counted
  */
-int _write(int fd, char* ptr, int len) {
+bool Debug_WriteRaw(const void* pData, u32 len) {
 #if DBG_USE_RTOS
-	if (!DebugSend_Queue)
-		return len;
-
-	char* pBuff = MemWrap_Malloc(len, __FILENAME__, __LINE__, MEM_ALLOC_MAX_TMO);
-	if (!pBuff)
-		return len;
-
-	memcpy((void*)pBuff, (void*)ptr, len);
-	DebugMsg_t msg = {
-		.Ptr = pBuff,
-		.Len = len,
-	};
-	xQueueSend(DebugSend_Queue, (void*)&msg, 0);
+	// Output from before the ring init is lost, the same as it was with the queue
+	if (!DebugSend_Ring.pBuff || !len)
+		return false;
+
+	if (!ByteRing_Write(&DebugSend_Ring, pData, len))
+		return false;
+
+	// Until the task exists the output just waits in the ring
+	if (!DebugSend_Handle)
+		return true;
+
+	if (xPortIsInsideInterrupt()) {
+		BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+		vTaskNotifyGiveFromISR(DebugSend_Handle, &xHigherPriorityTaskWoken);
+		portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+	} else {
+		xTaskNotifyGive(DebugSend_Handle);
+	}
+
+	return true;
 #else  /* DBG_USE_RTOS */
-	Debug_TransmitBuff(ptr, len);
+	return Debug_TransmitBuff((char*)pData, len);
 #endif /* DBG_USE_RTOS */
+}
+
+/*
+ * Wrapper for printf() function native using via selected interface
+ */
+int _write(int fd, char* ptr, int len) {
+	if (len > 0)
+		Debug_WriteRaw(ptr, len);
 
 	return len;
 }
 
-static void Debug_RxClbkUart(void* pVal) {
+/**
+ * Received chunk from the UART DMA or USB, interrupt context
+ */
+static void Debug_RxClbk(u8* pBuff, u32 len) {
 #if DBG_USE_RTOS
 	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-#endif /* DBG_USE_RTOS */
+	Debug_SendBuffFromISR((const char*)pBuff, len, &xHigherPriorityTaskWoken);
 
-	char ch = *(char*)pVal;
-#if DBG_USE_RTOS
-	Debug_SendCharFromISR(ch, &xHigherPriorityTaskWoken);
-#else  /* DBG_USE_RTOS */
-	//
-#endif /* DBG_USE_RTOS */
-
-#if DBG_USE_RTOS
 	if (xHigherPriorityTaskWoken == pdTRUE)
 		portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+#else  /* DBG_USE_RTOS */
+	DISCARD_UNUSED(pBuff);
+	DISCARD_UNUSED(len);
 #endif /* DBG_USE_RTOS */
 }
 
-static void Debug_RxClbkUsb(u8* pBuff, u32 len) {
+static void Debug_TxCpltClbk(void) {
 #if DBG_USE_RTOS
-	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-#endif /* DBG_USE_RTOS */
+	DebugTx_Complete(&DebugSend_Tx);
 
-	for (u32 i = 0; i < len; i++) {
-		char ch = *(char*)&pBuff[i];
-#if DBG_USE_RTOS
-		Debug_SendCharFromISR(ch, &xHigherPriorityTaskWoken);
-#else  /* DBG_USE_RTOS */
-		//
-#endif /* DBG_USE_RTOS */
-	}
+	if (!DebugSend_Handle)
+		return;
 
-#if DBG_USE_RTOS
-	if (xHigherPriorityTaskWoken == pdTRUE)
-		portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	vTaskNotifyGiveFromISR(DebugSend_Handle, &xHigherPriorityTaskWoken);
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 #endif /* DBG_USE_RTOS */
 }
 
@@ -88,9 +118,10 @@ void Debug_Init(void) {
 	// setvbuf(stderr, NULL, _IONBF, 0);
 
 #if defined DEBUG_OUTPUT_THROUGH_UART
-	Pl_DebugUart_Init(DEBUG_UART_BAUDRATE, Debug_RxBuff, sizeof(Debug_RxBuff), Debug_RxClbkUart);
+	Pl_DebugUart_Init(DEBUG_UART_BAUDRATE, Debug_RxBuff, sizeof(Debug_RxBuff), Debug_RxClbk,
+					  Debug_TxCpltClbk);
 #elif defined DEBUG_OUTPUT_THROUGH_USB
-	Pl_USB_CDC_Init(Debug_RxClbkUsb, Debug_RxBuff);
+	Pl_USB_CDC_Init(Debug_RxClbk, Debug_RxBuff, Debug_TxCpltClbk);
 #endif
 }
 
@@ -108,35 +139,47 @@ bool Debug_SendChar(char ch, u32 waitTmo) {
 	// Need mutex here in case of ShellRoot_SendCommand simultaneous using
 	if (xSemaphoreTake(DebugRxSequence_Mutex, waitTmo) != pdTRUE)
 		return false;
-#endif /* DBG_USE_RTOS */
 
-#if DBG_USE_RTOS
-	bool ret = (bool)(xQueueSend(DebugRxSymbol_Queue, &ch, waitTmo) == pdPASS);
+	bool ret = Debug_SendBuff(&ch, sizeof(ch));
 	xSemaphoreGive(DebugRxSequence_Mutex);
 #else  /* DBG_USE_RTOS */
-	// bool ret = false;
+	bool ret = false;
 #endif /* DBG_USE_RTOS */
 
 	return ret;
 }
 
-bool Debug_SendCharFromISR(char ch, BaseType_t* pWoken) {
 #if DBG_USE_RTOS
-	// Need mutex here in case of ShellRoot_SendCommand simultaneous using
-	if (xSemaphoreTakeFromISR(DebugRxSequence_Mutex, pWoken) != pdTRUE)
+/**
+ * @brief Puts the whole buffer into the receive stream or nothing.
+ * The stream buffer allows a single writer only, the receive ISR writes
+ * it too, so each send is made in a critical section. No mutex here,
+ * it can't be taken from an ISR
+ */
+static bool Debug_SendBuff(const char* pBuff, u32 len) {
+	if (xStreamBufferSpacesAvailable(DebugRx_Stream) < len)
 		return false;
-#endif /* DBG_USE_RTOS */
 
-#if DBG_USE_RTOS
-	bool ret = (bool)(xQueueSendFromISR(DebugRxSymbol_Queue, &ch, pWoken) == pdPASS);
-	xSemaphoreGiveFromISR(DebugRxSequence_Mutex, pWoken);
-#else  /* DBG_USE_RTOS */
-	// bool ret = false;
-#endif /* DBG_USE_RTOS */
+	taskENTER_CRITICAL();
+	size_t sent = xStreamBufferSend(DebugRx_Stream, pBuff, len, 0);
+	taskEXIT_CRITICAL();
 
-	return ret;
+	return sent == len;
 }
 
+bool Debug_SendBuffFromISR(const char* pBuff, u32 len, BaseType_t* pWoken) {
+	UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+	size_t sent		  = xStreamBufferSendFromISR(DebugRx_Stream, pBuff, len, pWoken);
+	taskEXIT_CRITICAL_FROM_ISR(state);
+
+	return sent == len;
+}
+
+bool Debug_SendCharFromISR(char ch, BaseType_t* pWoken) {
+	return Debug_SendBuffFromISR(&ch, sizeof(ch), pWoken);
+}
+#endif /* DBG_USE_RTOS */
+
 bool Debug_SendString(char* pStr, u32 waitTmo) {
 	ASSERT_CHECK(pStr);
 
@@ -154,12 +197,18 @@ bool Debug_SendString(char* pStr, u32 waitTmo) {
 		return false;
 	}
 
-	for (u32 i = 0; i < strLen; i++) {
-		if (xQueueSend(DebugRxSymbol_Queue, &pStr[i], waitTmo) != pdTRUE) {
-			xSemaphoreGive(DebugRxSequence_Mutex);
-			PANIC();
-			return false;
-		}
+	// the shell task drains the stream, wait for the room up to waitTmo
+	TickType_t start = xTaskGetTickCount();
+	while (xStreamBufferSpacesAvailable(DebugRx_Stream) < strLen) {
+		if (xTaskGetTickCount() - start >= waitTmo)
+			break;
+		vTaskDelay(RTOS_MIN_TIMEOUT_MS);
+	}
+
+	if (!Debug_SendBuff(pStr, strLen)) {
+		xSemaphoreGive(DebugRxSequence_Mutex);
+		PANIC();
+		return false;
 	}
 
 	xSemaphoreGive(DebugRxSequence_Mutex);
@@ -199,8 +248,8 @@ char Debug_ReceiveSymbol(u32 delay) {
 	char symbol = 0;
 
 #if DBG_USE_RTOS
-	if (DebugRxSymbol_Queue)
-		xQueueReceive(DebugRxSymbol_Queue, &symbol, delay);
+	if (DebugRx_Stream)
+		xStreamBufferReceive(DebugRx_Stream, &symbol, sizeof(symbol), delay);
 #else  /* DBG_USE_RTOS */
 	//
 #endif /* DBG_USE_RTOS */
@@ -208,50 +257,104 @@ char Debug_ReceiveSymbol(u32 delay) {
 	return symbol;
 }
 
+/**
+ * @brief Takes up to size received bytes, waits for the first one only
+ *
+ * @return number of bytes copied to pBuff
+ */
+u32 Debug_ReceiveBuff(char* pBuff, u32 size, u32 delay) {
+	u32 len = 0;
+
+#if DBG_USE_RTOS
+	if (DebugRx_Stream)
+		len = xStreamBufferReceive(DebugRx_Stream, pBuff, size, delay);
+#else  /* DBG_USE_RTOS */
+	DISCARD_UNUSED(pBuff);
+	DISCARD_UNUSED(size);
+	DISCARD_UNUSED(delay);
+#endif /* DBG_USE_RTOS */
+
+	return len;
+}
+
 #if DBG_USE_RTOS
 
 TaskHandle_t DebugSend_GetTaskHandle(void) {
 	return DebugSend_Handle;
 }
 
+ByteRing_Stats_t DebugSend_GetRingStats(void) {
+	return ByteRing_GetStats(&DebugSend_Ring);
+}
+
+DebugTx_Stats_t DebugSend_GetTxStats(void) {
+	return DebugTx_GetStats(&DebugSend_Tx);
+}
+
+static bool DebugSend_Submit(void* pCtx, const u8* pData, u32 len) {
+	DISCARD_UNUSED(pCtx);
+
+#if defined DEBUG_OUTPUT_THROUGH_UART
+	return Pl_DebugUart_SendBuffDMA(pData, len);
+#elif defined DEBUG_OUTPUT_THROUGH_USB
+	if (!Pl_USB_CDC_IsReady())
+		return false;
+
+	return Pl_USB_CDC_Transmit((char*)pData, (u16)len) == RET_STATE_SUCCESS;
+#else
+	return false;
+#endif /* DEBUG_OUTPUT_THROUGH_XXX */
+}
+
+/**
+ * Submits the next block straight from the ring and returns,
+ * the TX complete callback wakes the task for the one after it
+ */
+static void DebugSend_Drain(void) {
+#if defined DEBUG_OUTPUT_THROUGH_USB
+	DebugSend_Ep.PacketSize = Pl_USB_CDC_GetPacketSize();
+#endif /* DEBUG_OUTPUT_THROUGH_USB */
+	DebugTx_Process(&DebugSend_Tx);
+}
+
+/**
+ * Reports the output dropped since the last call. The notice goes through
+ * the ring to keep the order, if it doesn't fit it is tried again later
+ */
+static void DebugSend_ReportDrops(u32* pLastOverflowBytes) {
+	ByteRing_Stats_t stats = ByteRing_GetStats(&DebugSend_Ring);
+	if (stats.OverflowBytes == *pLastOverflowBytes)
+		return;
+
+	u32 dropped = stats.OverflowBytes - *pLastOverflowBytes;
+	char msg[DEBUG_DROP_MSG_LEN];
+	snprintf(msg, sizeof(msg), ESC_END_LINE "[debug: %lu bytes dropped]" ESC_END_LINE,
+			 (unsigned long)dropped);
+
+	u32 len = strlen(msg);
+	if (ByteRing_Write(&DebugSend_Ring, msg, len))
+		*pLastOverflowBytes += dropped;
+	else
+		*pLastOverflowBytes += len; // the notice itself is counted as an overflow
+}
+
 static void vTask_DebugSend_Process(void* pvParameters) {
-	DebugMsg_t msg;
+	u32 lastOverflowBytes = 0;
 	vTaskDelay(DELAY_1_SECOND * 2);
 
 	Debug_PrintMainInfo();
 	Debug_PrintSysInfo();
 
 	for (;;) {
-		xQueueReceive(DebugSend_Queue, &msg, portMAX_DELAY);
+		/**
+		 * A producer preempted between reserve and commit can hold back
+		 * the committed output of others, so poll once in a while too
+		 */
+		ulTaskNotifyTake(pdTRUE, DELAY_1_SECOND);
 		vTaskPrioritySet(NULL, MAX_TASK_PRIORITY);
 
-		// while (true) {
-		// 	Debug_TransmitBuff(msg.Ptr, msg.Len);
-		// 	MemWrap_Free(msg.Ptr);
-		// 	if (uxQueueMessagesWaiting(DebugSend_Queue) > 0)
-		// 		xQueueReceive(DebugSend_Queue, &msg, 0);
-		// 	else
-		// 		break;
-		// }
-
-		while (true) {
-			s32 totalLen = msg.Len;
-			char* pData	 = msg.Ptr;
-
-			while (totalLen > 0) {
-				u32 chunkLen = (totalLen > DEBUG_CHUNK_SIZE) ? DEBUG_CHUNK_SIZE : totalLen;
-				Debug_TransmitBuff(pData, chunkLen);
-				pData += chunkLen;
-				totalLen -= chunkLen;
-			}
-
-			MemWrap_Free(msg.Ptr);
-
-			if (uxQueueMessagesWaiting(DebugSend_Queue) > 0)
-				xQueueReceive(DebugSend_Queue, &msg, 0);
-			else
-				break;
-		}
+		DebugSend_ReportDrops(&lastOverflowBytes);
+		DebugSend_Drain();
 
 		vTaskPrioritySet(NULL, DEBUG_SEND_TASK_PRIORITY);
 
@@ -272,9 +375,11 @@ static void vTask_DebugSend_Process(void* pvParameters) {
 
 void FreeRTOS_DebugSend_InitComponents(bool resources, bool tasks) {
 	if (resources) {
-		DebugSend_Queue = xQueueCreate(100, sizeof(DebugMsg_t));
+		ByteRing_Init(&DebugSend_Ring, DebugSend_RingBuff, sizeof(DebugSend_RingBuff));
+		DebugTx_Init(&DebugSend_Tx, &DebugSend_Ring, &DebugSend_Ep);
 
-		DebugRxSymbol_Queue	  = xQueueCreate(sizeof(Debug_RxBuff) / 3, sizeof(char));
+		// room for two full DMA receive buffers, wakes the reader on any byte
+		DebugRx_Stream		  = xStreamBufferCreate(sizeof(Debug_RxBuff) * 2, 1);
 		DebugRxSequence_Mutex = xSemaphoreCreateMutex();
 		xSemaphoreGive(DebugRxSequence_Mutex);
 	}
@@ -291,6 +396,14 @@ TaskHandle_t DebugSend_GetTaskHandle(void) {
 	return NULL;
 }
 
+ByteRing_Stats_t DebugSend_GetRingStats(void) {
+	return (ByteRing_Stats_t){0};
+}
+
+DebugTx_Stats_t DebugSend_GetTxStats(void) {
+	return (DebugTx_Stats_t){0};
+}
+
 void FreeRTOS_DebugSend_InitComponents(bool resources, bool tasks) {
 	if (resources) {
 	}
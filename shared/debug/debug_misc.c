@@ -17,10 +17,41 @@
 static const LogLvl_t LogLvl[] = {DEBUG_LVL_TABLE()};
 #undef X_ENTRY
 
+typedef struct {
+	const char* Str;
+	LOG_LVL_t BuildLvl;
+} DebugMod_t;
+
+#define X_ENTRY(mod, mod_str, build_lvl) \
+	[mod] = {                            \
+		.Str	  = mod_str,             \
+		.BuildLvl = build_lvl,           \
+	},
+static const DebugMod_t DebugMod[] = {DEBUG_MODULE_TABLE()};
+#undef X_ENTRY
+
 static LOG_LVL_t DebugLogLvl = DEBUG_DEF_LOG_LVL;
+static u8 DebugModLvl[DBG_MOD_ENUM_SIZE] = {[0 ... DBG_MOD_ENUM_SIZE - 1] = DEBUG_MOD_LVL_INHERIT};
+
+/**
+ * Read by every DEBUG_LOG_LVL_PRINT(), keep it a plain byte table
+ */
+u8 Debug_ModLvl_Active[DBG_MOD_ENUM_SIZE] = {[0 ... DBG_MOD_ENUM_SIZE - 1] = DEBUG_DEF_LOG_LVL};
+
+/**
+ * The disabled global level mutes every module, e.g. while the shell is in use
+ */
+static void Debug_ModLvl_Update(void) {
+	for (u32 i = 0; i < DBG_MOD_ENUM_SIZE; i++) {
+		bool inherit		   = DebugModLvl[i] == DEBUG_MOD_LVL_INHERIT;
+		Debug_ModLvl_Active[i] = (DebugLogLvl == LOG_LVL_DISABLE || inherit) ? DebugLogLvl
+																			   : DebugModLvl[i];
+	}
+}
 
 void Debug_LogLvl_Set(LOG_LVL_t lvl) {
 	DebugLogLvl = lvl;
+	Debug_ModLvl_Update();
 }
 
 LOG_LVL_t Debug_LogLvl_Get(void) {
@@ -43,6 +74,49 @@ char* Debug_LogLvl_GetEmoji(LOG_LVL_t lvl) {
 	return LogLvl[lvl].Emoji;
 }
 
+const char* Debug_Mod_GetStr(DBG_MOD_t mod) {
+	return mod < DBG_MOD_ENUM_SIZE ? DebugMod[mod].Str : "n/a";
+}
+
+/**
+ * @return module with the given name, DBG_MOD_ENUM_SIZE if there is none
+ */
+DBG_MOD_t Debug_Mod_GetByStr(const char* pStr) {
+	for (u32 i = 0; i < DBG_MOD_ENUM_SIZE; i++) {
+		if (strcmp(DebugMod[i].Str, pStr) == 0)
+			return (DBG_MOD_t)i;
+	}
+
+	return DBG_MOD_ENUM_SIZE;
+}
+
+LOG_LVL_t Debug_Mod_GetBuildLvl(DBG_MOD_t mod) {
+	return mod < DBG_MOD_ENUM_SIZE ? DebugMod[mod].BuildLvl : LOG_LVL_DISABLE;
+}
+
+/**
+ * @brief Overrides the global level for one module
+ *
+ * @param[in] mod module ID
+ * @param[in] lvl LOG_LVL_t value or DEBUG_MOD_LVL_INHERIT to follow the global level.
+ * Levels below the module build level have no effect on the prints removed at build time
+ */
+void Debug_ModLvl_Set(DBG_MOD_t mod, u8 lvl) {
+	if (mod >= DBG_MOD_ENUM_SIZE)
+		return;
+
+	DebugModLvl[mod] = lvl;
+	Debug_ModLvl_Update();
+}
+
+u8 Debug_ModLvl_Get(DBG_MOD_t mod) {
+	return mod < DBG_MOD_ENUM_SIZE ? DebugModLvl[mod] : DEBUG_MOD_LVL_INHERIT;
+}
+
+LOG_LVL_t Debug_ModLvl_GetActive(DBG_MOD_t mod) {
+	return mod < DBG_MOD_ENUM_SIZE ? (LOG_LVL_t)Debug_ModLvl_Active[mod] : LOG_LVL_DISABLE;
+}
+
 void Debug_PrintMainInfo(void) {
 	DEBUG_PRINT(ESC_END_LINE ESC_END_LINE ESC_COLOR_RED
 				"+++++++++ Device started +++++++++" ESC_RESET_STYLE ESC_END_LINE);
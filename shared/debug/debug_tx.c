@@ -0,0 +1,106 @@
+#include "debug_tx.h"
+
+/**
+ * Moves the debug output ring to an endpoint with one transfer in flight.
+ * The transferred block stays in the ring until the endpoint reports the
+ * completion, so no copy is needed and the producers never overwrite it.
+ * No hardware access here, the endpoint is a submit function only
+ */
+
+void DebugTx_Init(DebugTx_t* pTx, ByteRing_t* pRing, const DebugTx_Ep_t* pEp) {
+	ASSERT_CHECK(pTx);
+	ASSERT_CHECK(pRing);
+	ASSERT_CHECK(pEp && pEp->Submit && pEp->XferMax);
+
+	*pTx = (DebugTx_t){
+		.pRing	  = pRing,
+		.pEp	  = pEp,
+		.InFlight = 0,
+		.Done	  = false,
+	};
+}
+
+/**
+ * @brief Length of the next transfer out of avail contiguous bytes.
+ * A bulk transfer of a whole number of packets has to be ended by a zero
+ * length packet, which costs one more bus transaction. When there are
+ * more than one packet, the transfer is cut by a byte to end short instead
+ *
+ * @param[in] pEp endpoint description
+ * @param[in] avail bytes ready to be sent
+ * @param[out] pEnd how the transfer ends on the bus
+ * @return bytes to submit, 0 if there is nothing to send
+ */
+u32 DebugTx_GetXferLen(const DebugTx_Ep_t* pEp, u32 avail, DEBUG_TX_END_t* pEnd) {
+	u32 len = GET_MIN(avail, pEp->XferMax);
+	*pEnd	= DEBUG_TX_END_SHORT;
+
+	if (!pEp->PacketSize || !len || len % pEp->PacketSize)
+		return len;
+
+	if (len > pEp->PacketSize) {
+		*pEnd = DEBUG_TX_END_CUT;
+		return len - 1;
+	}
+
+	*pEnd = DEBUG_TX_END_ZLP;
+	return len;
+}
+
+/**
+ * @brief Releases the completed transfer and submits the next one.
+ * Task context, call it on every completion and every new output
+ *
+ * @retval true a transfer is in progress
+ * @retval false the ring is empty or the endpoint refused the data
+ */
+bool DebugTx_Process(DebugTx_t* pTx) {
+	ASSERT_CHECK(pTx);
+
+	if (pTx->InFlight) {
+		if (!pTx->Done)
+			return true;
+
+		ByteRing_Release(pTx->pRing, pTx->InFlight);
+		pTx->InFlight = 0;
+	}
+
+	const u8* pData;
+	u32 avail = ByteRing_Peek(pTx->pRing, &pData);
+
+	DEBUG_TX_END_t end;
+	u32 len = DebugTx_GetXferLen(pTx->pEp, avail, &end);
+	if (!len)
+		return false;
+
+	// the completion may come before Submit() returns
+	pTx->Done	  = false;
+	pTx->InFlight = len;
+
+	if (!pTx->pEp->Submit(pTx->pEp->pCtx, pData, len)) {
+		pTx->InFlight = 0;
+		pTx->Stats.Rejects++;
+		return false;
+	}
+
+	pTx->Stats.Xfers++;
+	pTx->Stats.Bytes += len;
+	if (end == DEBUG_TX_END_ZLP)
+		pTx->Stats.Zlps++;
+	else if (end == DEBUG_TX_END_CUT)
+		pTx->Stats.ZlpsSaved++;
+
+	return true;
+}
+
+/**
+ * @brief Marks the transfer in flight as done, safe from an ISR.
+ * Wake the task calling DebugTx_Process() after it
+ */
+void DebugTx_Complete(DebugTx_t* pTx) {
+	pTx->Done = true;
+}
+
+DebugTx_Stats_t DebugTx_GetStats(DebugTx_t* pTx) {
+	return pTx->Stats;
+}
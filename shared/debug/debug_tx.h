@@ -0,0 +1,48 @@
+#ifndef __DEBUG_TX_H
+#define __DEBUG_TX_H
+
+#include "byte_ring.h"
+#include "main.h"
+
+/**
+ * Starts an asynchronous transfer of len bytes, the data stays untouched
+ * until DebugTx_Complete(). Returns false if the endpoint can't take it now
+ */
+typedef bool (*DebugTx_SubmitFunc_t)(void* pCtx, const u8* pData, u32 len);
+
+typedef struct {
+	DebugTx_SubmitFunc_t Submit;
+	void* pCtx;
+	u32 XferMax;	// bytes per transfer
+	u32 PacketSize; // max packet size of a USB endpoint, 0 if there are no packets
+} DebugTx_Ep_t;
+
+typedef enum {
+	DEBUG_TX_END_SHORT = 0, // last packet is short, or no packets at all
+	DEBUG_TX_END_ZLP,		// zero length packet added by the USB class driver
+	DEBUG_TX_END_CUT,		// cut by a byte to end short instead of with a ZLP
+} DEBUG_TX_END_t;
+
+typedef struct {
+	u32 Xfers;
+	u32 Bytes;
+	u32 Zlps;	   // transfers ended by a zero length packet
+	u32 ZlpsSaved; // transfers cut by a byte to end with a short packet instead
+	u32 Rejects;   // submits refused by the endpoint
+} DebugTx_Stats_t;
+
+typedef struct {
+	ByteRing_t* pRing;
+	const DebugTx_Ep_t* pEp;
+	u32 InFlight;		// bytes of the transfer in progress, 0 when idle
+	volatile bool Done; // set by the completion callback
+	DebugTx_Stats_t Stats;
+} DebugTx_t;
+
+void DebugTx_Init(DebugTx_t* pTx, ByteRing_t* pRing, const DebugTx_Ep_t* pEp);
+u32 DebugTx_GetXferLen(const DebugTx_Ep_t* pEp, u32 avail, DEBUG_TX_END_t* pEnd);
+bool DebugTx_Process(DebugTx_t* pTx);
+void DebugTx_Complete(DebugTx_t* pTx);
+DebugTx_Stats_t DebugTx_GetStats(DebugTx_t* pTx);
+
+#endif /* __DEBUG_TX_H */
@@ -1,19 +1,15 @@
+#define DEBUG_MODULE DBG_MOD_MEM
+
 #include "mem_wrapper.h"
 #include "FreeRTOSConfig.h"
 #include "debug.h"
 #include "platform.h"
 
 #if DEBUG_ENABLE
-#define LOCAL_DEBUG_PRINT_ENABLE 0
-#define LOCAL_DEBUG_TEST_ENABLE	 0
+#define LOCAL_DEBUG_TEST_ENABLE 0
 #endif /* DEBUG_ENABLE */
 
-#if LOCAL_DEBUG_PRINT_ENABLE
-#warning LOCAL_DEBUG_PRINT_ENABLE
-#define LOCAL_DEBUG_PRINT DEBUG_PRINT_DIRECT_NL
-#else /* LOCAL_DEBUG_PRINT_ENABLE */
-#define LOCAL_DEBUG_PRINT(_f_, ...)
-#endif /* LOCAL_DEBUG_PRINT_ENABLE */
+#define LOCAL_DEBUG_PRINT(_f_, ...) DEBUG_TRACE_DO(DEBUG_PRINT_DIRECT_NL(_f_, ##__VA_ARGS__))
 
 #if LOCAL_DEBUG_TEST_ENABLE
 #warning LOCAL_DEBUG_TEST_ENABLE
@@ -0,0 +1,176 @@
+#include <unistd.h>
+
+#include "fs_host.h"
+#include "ff.h"
+#include "storage.h"
+#include "storage_cache.h"
+#include "storage_ram.h"
+#include "time_date.h"
+
+#define FS_HOST_CHUNK  1024
+#define FS_HOST_SECTOR 512 // FF_MAX_SS
+
+typedef struct {
+	u8* pDisk;
+	u32 BlockNbr;
+	u32 BusyUs;
+} FsHost_Emmc_t;
+
+static FATFS FsHost_RamFs;
+static FsWrap_Mount_t FsHost_RamMount;
+static u32 FsHost_Capacity;
+static FATFS FsHost_EmmcFs;
+static FsWrap_Mount_t FsHost_EmmcMount;
+static FsHost_Emmc_t FsHost_Emmc;
+
+/* the eMMC side of io_fatfs.c, no card until FsHost_EmmcInit() */
+bool Storage_EmmcHw_IsInit(void) {
+	return FsHost_Emmc.pDisk != NULL;
+}
+
+/* no discard, FatFS gets RES_PARERR for CTRL_TRIM */
+bool Storage_Emmc_GetDeviceInfo(Pl_SdEmmcInfo_t* pSdEmmcInfo) {
+	if (FsHost_Emmc.pDisk == NULL)
+		return false;
+
+	*pSdEmmcInfo = (Pl_SdEmmcInfo_t){
+		.BlockNbr	  = FsHost_Emmc.BlockNbr,
+		.BlockSize	  = FS_HOST_SECTOR,
+		.LogBlockNbr  = FsHost_Emmc.BlockNbr,
+		.LogBlockSize = FS_HOST_SECTOR,
+	};
+	return true;
+}
+
+static bool FsHost_EmmcIsIn(u32 blockIdx, u32 blockNum) {
+	return FsHost_Emmc.pDisk != NULL && blockIdx + blockNum <= FsHost_Emmc.BlockNbr;
+}
+
+bool StorageCache_Read(u8* pData, u32 blockIdx, u32 blockNum) {
+	if (!FsHost_EmmcIsIn(blockIdx, blockNum))
+		return false;
+
+	memcpy(pData, &FsHost_Emmc.pDisk[blockIdx * FS_HOST_SECTOR], blockNum * FS_HOST_SECTOR);
+	return true;
+}
+
+/* the caller waits for the program the way Storage_Emmc_AwaitReady() does */
+bool StorageCache_Write(const u8* pData, u32 blockIdx, u32 blockNum) {
+	if (!FsHost_EmmcIsIn(blockIdx, blockNum))
+		return false;
+
+	memcpy(&FsHost_Emmc.pDisk[blockIdx * FS_HOST_SECTOR], pData, blockNum * FS_HOST_SECTOR);
+	if (FsHost_Emmc.BusyUs)
+		usleep(FsHost_Emmc.BusyUs);
+	return true;
+}
+
+bool StorageCache_Flush(void) {
+	return FsHost_Emmc.pDisk != NULL;
+}
+
+bool StorageCache_Trim(u32 blockIdx, u32 blockNum) {
+	return false;
+}
+
+/* no RTC, FatFS stamps the files with 0 */
+bool TimeDate_IsReady(void) {
+	return false;
+}
+
+void TimeDate_Struct_Init(TimeDate_t* pTimeDate) {
+	memset(pTimeDate, 0, sizeof(*pTimeDate));
+}
+
+void TimeDate_TimeDate_Get(TimeDate_t* pTimeDate) {
+}
+
+static bool FsHost_Mount(void) {
+	FsHost_RamMount = (FsWrap_Mount_t){
+		.pFsData	   = &FsHost_RamFs,
+		.pMntPointPath = FS_HOST_RAM_PATH,
+	};
+
+	return FsWrap_Mount(&FsHost_RamMount) == RET_STATE_SUCCESS;
+}
+
+bool FsHost_Init(u32 capacity) {
+	FsHost_Capacity = capacity;
+
+	return FsWrap_Init() == RET_STATE_SUCCESS && StorageRam_Init(capacity) && FsHost_Mount();
+}
+
+/**
+ * @brief an empty volume for the next test: StorageRam_Init() clears the
+ * drive, so the mount formats it
+ */
+bool FsHost_Format(void) {
+	return FsWrap_Unmount(&FsHost_RamMount) == RET_STATE_SUCCESS &&
+		   StorageRam_Init(FsHost_Capacity) && FsHost_Mount();
+}
+
+/**
+ * @brief mounts the eMMC drive "0:" over @p capacity bytes of host memory,
+ * the format is done before the writes get slow
+ */
+bool FsHost_EmmcInit(u32 capacity, u32 busyUs) {
+	FsHost_Emmc = (FsHost_Emmc_t){
+		.pDisk	  = calloc(1, capacity),
+		.BlockNbr = capacity / FS_HOST_SECTOR,
+	};
+	FsHost_EmmcMount = (FsWrap_Mount_t){
+		.pFsData	   = &FsHost_EmmcFs,
+		.pMntPointPath = FS_HOST_EMMC_PATH,
+	};
+
+	if (FsHost_Emmc.pDisk == NULL || FsWrap_Mount(&FsHost_EmmcMount) != RET_STATE_SUCCESS)
+		return false;
+
+	FsHost_Emmc.BusyUs = busyUs;
+	return true;
+}
+
+/* file contents, each byte a function of its offset and @p seed */
+void FsHost_Fill(u8* pBuff, u32 offset, u32 size, u8 seed) {
+	for (u32 i = 0; i < size; i++)
+		pBuff[i] = (u8)((offset + i) * 31 + seed);
+}
+
+bool FsHost_WriteFile(const char* pPath, u32 size, u8 seed) {
+	FsWrap_File_t file = {0};
+	u8 buff[FS_HOST_CHUNK];
+
+	if (FsWrap_Open(&file, pPath, FS_MODE_WRITE | FS_MODE_CREATE_ALWAYS) != RET_STATE_SUCCESS)
+		return false;
+
+	bool isOk = true;
+	for (u32 pos = 0; pos < size && isOk; pos += FS_HOST_CHUNK) {
+		u32 chunk = GET_MIN(size - pos, FS_HOST_CHUNK);
+		u32 wr	  = 0;
+		FsHost_Fill(buff, pos, chunk, seed);
+		isOk = FsWrap_Write(&file, buff, chunk, &wr) == RET_STATE_SUCCESS && wr == chunk;
+	}
+
+	return FsWrap_Close(&file) == RET_STATE_SUCCESS && isOk;
+}
+
+bool FsHost_CheckFile(const char* pPath, u32 size, u8 seed) {
+	FsWrap_File_t file = {0};
+	u8 buff[FS_HOST_CHUNK];
+	u8 expected[FS_HOST_CHUNK];
+
+	if (FsWrap_Open(&file, pPath, FS_MODE_READ) != RET_STATE_SUCCESS)
+		return false;
+
+	u32 fileSize = 0;
+	bool isOk	 = FsWrap_Size(&file, &fileSize) == RET_STATE_SUCCESS && fileSize == size;
+	for (u32 pos = 0; pos < size && isOk; pos += FS_HOST_CHUNK) {
+		u32 chunk = GET_MIN(size - pos, FS_HOST_CHUNK);
+		u32 rd	  = 0;
+		FsHost_Fill(expected, pos, chunk, seed);
+		isOk = FsWrap_Read(&file, buff, chunk, &rd) == RET_STATE_SUCCESS && rd == chunk &&
+			   memcmp(buff, expected, chunk) == 0;
+	}
+
+	return FsWrap_Close(&file) == RET_STATE_SUCCESS && isOk;
+}
@@ -0,0 +1,25 @@
+#ifndef __FS_HOST_H
+#define __FS_HOST_H
+
+#include "fs_wrapper.h"
+#include "main.h"
+
+/**
+ * The real fs_wrapper and FatFS over the RAM drive "1:", mounted the way
+ * Storage_RamMount() does it. The eMMC drive "0:" is there only after
+ * FsHost_EmmcInit(): host memory behind the storage cache calls, each write
+ * keeps the caller busy for the program time of the card
+ */
+
+#define FS_HOST_EMMC_PATH "0:"
+#define FS_HOST_RAM_PATH  "1:"
+
+bool FsHost_Init(u32 capacity);
+bool FsHost_Format(void);
+bool FsHost_EmmcInit(u32 capacity, u32 busyUs);
+
+void FsHost_Fill(u8* pBuff, u32 offset, u32 size, u8 seed);
+bool FsHost_WriteFile(const char* pPath, u32 size, u8 seed);
+bool FsHost_CheckFile(const char* pPath, u32 size, u8 seed);
+
+#endif /* __FS_HOST_H */
@@ -0,0 +1,39 @@
+#ifndef __HOST_TEST_H
+#define __HOST_TEST_H
+
+#include "main.h"
+
+/**
+ * Minimal checks for the host tests, one test file per binary. A failed
+ * check prints its place and makes the binary return non-zero
+ */
+
+static u32 HostTest_Fails;
+
+#define CHECK(x)                                                         \
+	do {                                                                 \
+		if (!(x)) {                                                      \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); \
+			HostTest_Fails++;                                            \
+		}                                                                \
+	} while (0)
+
+#define CHECK_EQ(a, b)                                                                \
+	do {                                                                              \
+		unsigned long long _a = (a), _b = (b);                                        \
+		if (_a != _b) {                                                               \
+			printf("%s:%d: %s == %llu, expected %llu\n", __FILE__, __LINE__, #a, _a, _b); \
+			HostTest_Fails++;                                                         \
+		}                                                                             \
+	} while (0)
+
+#define HOST_TEST_RUN(test)                                                 \
+	do {                                                                    \
+		u32 _fails = HostTest_Fails;                                        \
+		test();                                                             \
+		printf("%-40s %s\n", #test, HostTest_Fails == _fails ? "ok" : "FAIL"); \
+	} while (0)
+
+#define HOST_TEST_RESULT() (HostTest_Fails ? EXIT_FAILURE : EXIT_SUCCESS)
+
+#endif /* __HOST_TEST_H */
@@ -0,0 +1,8 @@
+#ifndef __FREERTOS_H
+#define __FREERTOS_H
+
+/* Host replacement of the FreeRTOS kernel header for lib/fatfs/ffsystem.c */
+
+#include "def_rtos.h"
+
+#endif /* __FREERTOS_H */
@@ -0,0 +1,6 @@
+#ifndef __CMSIS_COMPILER_H
+#define __CMSIS_COMPILER_H
+
+// Host build, def_types.h needs nothing from the CMSIS compiler header
+
+#endif /* __CMSIS_COMPILER_H */
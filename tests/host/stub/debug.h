@@ -0,0 +1,34 @@
+#ifndef __DEBUG_H
+#define __DEBUG_H
+
+#include "main.h"
+#include "platform.h"
+
+/**
+ * Host replacement of shared/debug/debug.h: the logs are compiled out, the
+ * arguments are still type checked and count as used. The raw output is
+ * left to a test
+ */
+
+#define DBG_TIMER_MICROSEC_GET() PL_GET_US_CNT()
+
+#define ESC_COLOR_RED	 "\e[31m"
+#define ESC_COLOR_GREEN	 "\e[32m"
+#define ESC_COLOR_YELLOW "\e[33m"
+
+/* the ErrorHandler() of a test is the abort */
+#define PANIC() assert(0)
+
+// clang-format off
+#define DEBUG_PRINT(_f_, ...)				do { if (0) printf((_f_), ##__VA_ARGS__); } while (0)
+#define DEBUG_PRINT_NL(_f_, ...)			DEBUG_PRINT(_f_, ##__VA_ARGS__)
+#define DEBUG_PRINT_DIRECT_NL(_f_, ...)		DEBUG_PRINT(_f_, ##__VA_ARGS__)
+#define DEBUG_LOG_PRINT(_f_, ...)			DEBUG_PRINT(_f_, ##__VA_ARGS__)
+#define DEBUG_LOG_COLOR_PRINT(c, _f_, ...)	DEBUG_PRINT(c _f_, ##__VA_ARGS__)
+#define DEBUG_LOG_LVL_PRINT(l, _f_, ...)	DEBUG_PRINT(_f_, ##__VA_ARGS__)
+#define DEBUG_TRACE_DO(...)					do { if (0) { __VA_ARGS__; } } while (0)
+// clang-format on
+
+bool Debug_WriteRaw(const void* pData, u32 len);
+
+#endif /* __DEBUG_H */
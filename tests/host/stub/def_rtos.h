@@ -0,0 +1,192 @@
+#ifndef __DEF_RTOS_H
+#define __DEF_RTOS_H
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "def_types.h"
+
+/**
+ * Host replacement of lib/rtos/def_rtos.h: the part of the FreeRTOS API the
+ * storage modules use. Notifications are counted and never block. A thread
+ * of a test is a task: a critical section is one lock for all of them and a
+ * mutex is a pthread one
+ */
+
+typedef u32 TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef void (*TaskFunction_t)(void*);
+
+typedef struct {
+	u32 Notify[3]; // per index, see configTASK_NOTIFICATION_ARRAY_ENTRIES
+} HostRtos_Task_t;
+
+typedef HostRtos_Task_t* TaskHandle_t;
+
+typedef struct {
+	TickType_t Start;
+} TimeOut_t;
+
+typedef struct {
+	pthread_mutex_t Mutex;
+} HostRtos_Mutex_t;
+
+typedef HostRtos_Mutex_t* SemaphoreHandle_t;
+
+#define pdFALSE			  0
+#define pdTRUE			  1
+#define pdPASS			  pdTRUE
+#define portMAX_DELAY	  0xFFFFFFFFUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+/* one lock for all the modules of a test, see HostRtos_Task, the nesting is per thread */
+__attribute__((weak)) pthread_mutex_t HostRtos_CriticalMutex = PTHREAD_MUTEX_INITIALIZER;
+__attribute__((weak)) __thread u32 HostRtos_CriticalNesting;
+
+static inline u32* HostRtos_Critical(void) {
+	return &HostRtos_CriticalNesting;
+}
+
+static inline void HostRtos_EnterCritical(void) {
+	if (HostRtos_CriticalNesting++ == 0)
+		pthread_mutex_lock(&HostRtos_CriticalMutex);
+}
+
+static inline void HostRtos_ExitCritical(void) {
+	assert(HostRtos_CriticalNesting > 0);
+	if (--HostRtos_CriticalNesting == 0)
+		pthread_mutex_unlock(&HostRtos_CriticalMutex);
+}
+
+#define taskENTER_CRITICAL() HostRtos_EnterCritical()
+#define taskEXIT_CRITICAL()	 HostRtos_ExitCritical()
+
+static inline u32* HostRtos_Suspended(void) {
+	static u32 nesting;
+	return &nesting;
+}
+
+#define vTaskSuspendAll() ((*HostRtos_Suspended())++)
+
+/* no task switch is ever pending */
+static inline BaseType_t xTaskResumeAll(void) {
+	assert(*HostRtos_Suspended() > 0);
+	(*HostRtos_Suspended())--;
+	return pdFALSE;
+}
+
+/* the tests run in one task */
+static inline BaseType_t xPortIsInsideInterrupt(void) {
+	return pdFALSE;
+}
+
+/* one task for all the modules of a test, a weak definition is merged by the linker */
+__attribute__((weak)) HostRtos_Task_t HostRtos_Task;
+
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+	return &HostRtos_Task;
+}
+
+static inline TickType_t xTaskGetTickCount(void) {
+	return 0;
+}
+
+static inline void vTaskDelay(TickType_t ticks) {
+	(void)ticks;
+}
+
+static inline void xTaskNotifyGiveIndexed(TaskHandle_t task, UBaseType_t idx) {
+	task->Notify[idx]++;
+}
+
+/* a wait that would block lets the other threads of a test run first */
+static inline u32 ulTaskNotifyTakeIndexed(UBaseType_t idx, BaseType_t clear, TickType_t ticks) {
+	u32* pCnt = &xTaskGetCurrentTaskHandle()->Notify[idx];
+	u32 cnt	  = *pCnt;
+
+	if (cnt == 0 && ticks != 0)
+		sched_yield();
+
+	*pCnt = clear || cnt == 0 ? 0 : cnt - 1;
+	return cnt;
+}
+
+/* an ISR of a test is a call from the test itself, no switch to do */
+static inline void vTaskNotifyGiveIndexedFromISR(TaskHandle_t task, UBaseType_t idx,
+												 BaseType_t* pWoken) {
+	task->Notify[idx]++;
+	*pWoken = pdTRUE;
+}
+
+#define portEND_SWITCHING_ISR(woken) (void)(woken)
+
+#define xTaskNotifyGive(task)		   xTaskNotifyGiveIndexed(task, 0)
+#define ulTaskNotifyTake(clear, ticks) ulTaskNotifyTakeIndexed(0, clear, ticks)
+
+static inline void vTaskSetTimeOutState(TimeOut_t* pTimeOut) {
+	pTimeOut->Start = xTaskGetTickCount();
+}
+
+/* a wait times out at once, only the other threads of a test run meanwhile */
+static inline BaseType_t xTaskCheckForTimeOut(TimeOut_t* pTimeOut, TickType_t* pTicksLeft) {
+	(void)pTimeOut;
+	(void)pTicksLeft;
+	sched_yield();
+	return pdTRUE;
+}
+
+/* a task taking its own mutex again would block for ever, the error check mutex asserts */
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+	SemaphoreHandle_t mutex = calloc(1, sizeof(HostRtos_Mutex_t));
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
+	pthread_mutex_init(&mutex->Mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+	return mutex;
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t mutex) {
+	int res = pthread_mutex_destroy(&mutex->Mutex);
+	assert(res == 0);
+	(void)res;
+	free(mutex);
+}
+
+/* a tick is a millisecond, see pdMS_TO_TICKS() */
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks) {
+	int res;
+
+	if (ticks == 0) {
+		res = pthread_mutex_trylock(&mutex->Mutex);
+	} else if (ticks == portMAX_DELAY) {
+		res = pthread_mutex_lock(&mutex->Mutex);
+	} else {
+		struct timespec tmo;
+		clock_gettime(CLOCK_REALTIME, &tmo);
+		tmo.tv_sec += ticks / 1000;
+		tmo.tv_nsec += (long)(ticks % 1000) * 1000000;
+		if (tmo.tv_nsec >= 1000000000) {
+			tmo.tv_sec++;
+			tmo.tv_nsec -= 1000000000;
+		}
+		res = pthread_mutex_timedlock(&mutex->Mutex, &tmo);
+	}
+
+	assert(res != EDEADLK);
+	return res == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+	int res = pthread_mutex_unlock(&mutex->Mutex);
+	assert(res == 0);
+	(void)res;
+	return pdTRUE;
+}
+
+#endif /* __DEF_RTOS_H */
@@ -0,0 +1,16 @@
+#ifndef __DEF_SYS_H
+#define __DEF_SYS_H
+
+#include "def_rtos.h"
+
+/* Host replacement of shared/def_sys.h, always the RTOS variant */
+
+#define SYS_CRITICAL_ON()	taskENTER_CRITICAL()
+#define SYS_CRITICAL_OFF()	taskEXIT_CRITICAL()
+#define SYS_OS_IS_RUNNING() (true)
+
+#define SYS_TICK_GET_MS_CNT() xTaskGetTickCount()
+#define SYS_DELAY_MS(a)		  vTaskDelay(a)
+#define SYS_MAX_TIMEOUT		  portMAX_DELAY
+
+#endif /* __DEF_SYS_H */
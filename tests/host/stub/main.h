@@ -0,0 +1,27 @@
+#ifndef __MAIN_H
+#define __MAIN_H
+
+/**
+ * Host replacement of app/main.h: the shared types and macros, the RTOS
+ * part the modules use from stub/def_rtos.h and def_sys.h, no platform. A failed
+ * ASSERT_CHECK() aborts the test. <stddef.h> comes with the HAL headers on the target
+ */
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "def_macro.h"
+#include "def_rtos.h"
+#include "def_sys.h"
+#include "def_types.h"
+
+#define ASSERT_CHECK(x) assert(x)
+
+/* lib/stringlib cuts the path when a test links it */
+#if __has_include("stringlib.h")
+#include "stringlib.h"
+#else
+#define __FILENAME__ __FILE__
+#endif
+
+#endif /* __MAIN_H */
@@ -0,0 +1,81 @@
+#ifndef __PLATFORM_H
+#define __PLATFORM_H
+
+#include <time.h>
+
+#include "main.h"
+
+/**
+ * Host replacement of platform/platform.h: the constants and types of the
+ * M0 platform the storage modules are built with. The Pl_x functions are
+ * declared only, a test links the fakes it needs
+ */
+
+#define PL_STORAGE_IN_RAM_DATA
+#define PL_STORAGE_IN_D2_DATA
+
+#define PL_SD_EMMC_DEF_TMO	 100
+#define PL_SDMMC_SECTOR_SIZE 512U
+#define PL_DCACHE_LINE_SIZE	 32U
+
+static inline u64 Pl_Host_GetUsCnt(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000 + (u64)ts.tv_nsec / 1000;
+}
+
+#define PL_GET_MS_CNT() ((u32)(Pl_Host_GetUsCnt() / 1000))
+#define PL_GET_US_CNT() Pl_Host_GetUsCnt()
+
+/* MemWrap_Malloc() calls so far, a test sees the heap traffic of a call */
+u32 Pl_Host_GetAllocCnt(void);
+
+typedef void (*Pl_Emmc_XferClbk_t)(bool isOk);
+
+typedef enum {
+	PL_SD_EMMC_TIMING_LEGACY = 0,
+	PL_SD_EMMC_TIMING_HS,
+	PL_SD_EMMC_TIMING_DDR52,
+} Pl_SdEmmcTiming_t;
+
+typedef struct {
+	u32 CardType;
+	u32 Class;
+	u32 RelCardAdd;
+	u32 BlockNbr;
+	u32 BlockSize;
+	u32 LogBlockNbr;
+	u32 LogBlockSize;
+	u32 MfgID;
+	char ProdName[6];
+	u32 ProdRev;
+	u32 ProdSN;
+	u32 BusWidth;
+	u32 BusClk;
+	Pl_SdEmmcTiming_t Timing;
+	u32 BusFallbacks;
+	u32 DiscardAlign;
+} Pl_SdEmmcInfo_t;
+
+u32 Pl_Crc32_CheckBuff(const u8* pBuff, u32 buffSize);
+
+void Pl_DCache_Clean(const void* pBuff, u32 len);
+void Pl_DCache_Invalidate(void* pBuff, u32 len);
+
+bool Pl_Emmc_Init(Pl_SdEmmcInfo_t* pSdEmmcInfo, Pl_Emmc_XferClbk_t pXferClbk);
+bool Pl_Emmc_GetDeviceInfo(Pl_SdEmmcInfo_t* pSdEmmcInfo);
+bool Pl_Emmc_Read(u8* pData, u32 blockIdx, u32 blockNum);
+bool Pl_Emmc_ReadDMA(u8* pData, u32 blockIdx, u32 blockNum);
+bool Pl_Emmc_Write(const u8* pData, u32 blockIdx, u32 blockNum);
+bool Pl_Emmc_WriteDMA(const u8* pData, u32 blockIdx, u32 blockNum);
+void Pl_Emmc_AbortDMA(void);
+bool Pl_Emmc_IsDmaBuff(const void* pBuff, u32 len);
+bool Pl_Emmc_Discard(u32 startBlock, u32 endBlock);
+bool Pl_Emmc_IsCrcError(void);
+bool Pl_Emmc_BusFallback(Pl_SdEmmcInfo_t* pSdEmmcInfo);
+u32 Pl_Emmc_GetCardState(void);
+bool Pl_Emmc_IsCardInTransfer(void);
+
+bool Pl_USB_IsClassMSC(void);
+
+#endif /* __PLATFORM_H */
@@ -0,0 +1,60 @@
+#include <malloc.h>
+
+#include "platform.h"
+#include "mem_wrapper.h"
+
+/**
+ * Host versions of the platform and heap calls the storage modules make
+ * besides the eMMC, which a test fakes itself
+ */
+
+/* CRC-32 (IEEE 802.3), the values only need to match between writer and reader */
+u32 Pl_Crc32_CheckBuff(const u8* pBuff, u32 buffSize) {
+	ASSERT_CHECK(pBuff);
+
+	u32 crc = 0xFFFFFFFF;
+	for (u32 i = 0; i < buffSize; i++) {
+		crc ^= pBuff[i];
+		for (u32 bit = 0; bit < 8; bit++)
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+	}
+
+	return ~crc;
+}
+
+void Pl_DCache_Clean(const void* pBuff, u32 len) {
+	ASSERT_CHECK(pBuff || len == 0);
+}
+
+void Pl_DCache_Invalidate(void* pBuff, u32 len) {
+	ASSERT_CHECK(pBuff || len == 0);
+}
+
+/* the heap of a test only counts against this, the RAM drive buffer is in it too */
+#define HOST_HEAP_SIZE (64 * DATA_1_MBYTE)
+
+static u32 HostHeap_Used;
+static u32 HostHeap_Allocs;
+
+void* MemWrap_Malloc(size_t size, char* pFile, u32 line, u32 timeoutMs) {
+	void* pAddr = malloc(size);
+	if (pAddr != NULL) {
+		HostHeap_Used += malloc_usable_size(pAddr);
+		HostHeap_Allocs++;
+	}
+	return pAddr;
+}
+
+void MemWrap_Free(void* pAddr) {
+	if (pAddr != NULL)
+		HostHeap_Used -= malloc_usable_size(pAddr);
+	free(pAddr);
+}
+
+u32 MemWrap_GetFreeHeapSize(void) {
+	return HostHeap_Used < HOST_HEAP_SIZE ? HOST_HEAP_SIZE - HostHeap_Used : 0;
+}
+
+u32 Pl_Host_GetAllocCnt(void) {
+	return HostHeap_Allocs;
+}
@@ -0,0 +1,17 @@
+#ifndef __RTOS_ANALYZER_H
+#define __RTOS_ANALYZER_H
+
+#include "def_rtos.h"
+#include "main.h"
+
+/* Host replacement: no tasks are created, a test runs the task body itself */
+static inline BaseType_t HostRtos_CreateTask(TaskFunction_t taskCode, TaskHandle_t* pTaskHandle) {
+	(void)taskCode;
+	*pTaskHandle = NULL;
+	return pdPASS;
+}
+
+#define RTOS_Analyzer_CreateTask(taskCode, pName, stackDepth, pParameters, priority, pTaskHandle) \
+	HostRtos_CreateTask(taskCode, pTaskHandle)
+
+#endif /* __RTOS_ANALYZER_H */
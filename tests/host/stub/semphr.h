@@ -0,0 +1,8 @@
+#ifndef __SEMPHR_H
+#define __SEMPHR_H
+
+/* Host replacement, the mutex part is in def_rtos.h */
+
+#include "def_rtos.h"
+
+#endif /* __SEMPHR_H */
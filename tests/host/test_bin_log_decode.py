@@ -0,0 +1,167 @@
+import json
+import os
+import re
+import struct
+import subprocess
+import sys
+import types
+import unittest
+from pathlib import Path
+
+REPO_ROOT = Path(__file__).resolve().parents[2]
+sys.path.insert(0, str(REPO_ROOT / "utils" / "fw_analyse"))
+
+# The decoder takes its sites from the ELF, the records are tested without one.
+# A stub keeps the test free of pyelftools and coloredlogs
+sys.modules.setdefault("elf_map_parse", types.SimpleNamespace(ElfParser=None))
+
+import bin_log_decode as bld  # noqa: E402
+
+SITE_ADDR = 0x08001000
+LVL_INFO = 2
+
+
+def record(site: int, args: bytes = b"", lvl: int = LVL_INFO, time_us: int = 0) -> bytes:
+    """Builds a record the way shared/debug/debug_bin_log.c lays it out"""
+    body = struct.pack("<BII", lvl, site, time_us) + args
+    return bytes([bld.BIN_LOG_MAGIC, len(body)]) + body
+
+
+def bin_str(s: str) -> bytes:
+    raw = s.encode()
+    return bytes([len(raw)]) + raw
+
+
+class BinLogDecodeTest(unittest.TestCase):
+    def decoder(self, fmt: str) -> bld.BinLogDecoder:
+        sites = {SITE_ADDR: bld.LogSite(fmt, "app/src/module.c", "Module_Func", 42)}
+        return bld.BinLogDecoder(sites)
+
+    def msg(self, fmt: str, args: bytes) -> str:
+        out = self.decoder(fmt).feed(record(SITE_ADDR, args))
+        return out.split("\r\n\t  ", 1)[1].rstrip("\r\n")
+
+    def test_plain_text(self):
+        self.assertEqual(self.decoder("").feed(b"shell> ls\r\n"), "shell> ls\r\n")
+
+    def test_header(self):
+        out = self.decoder("boot").feed(record(SITE_ADDR, time_us=1500000))
+        self.assertEqual(
+            out, "[   INFO] [1.500000] [fi: module.c, fn: Module_Func, ln: 42]:\r\n\t  boot\r\n"
+        )
+
+    def test_no_level(self):
+        out = self.decoder("raw").feed(record(SITE_ADDR, lvl=bld.BIN_LOG_LVL_NONE))
+        self.assertTrue(out.startswith("[0.000000] "))
+
+    def test_integers(self):
+        args = struct.pack("<iIIq", -5, 7, 0xBEEF, -(1 << 40))
+        self.assertEqual(self.msg("%d %u %04X %lld", args), f"-5 7 BEEF {-(1 << 40)}")
+
+    def test_star_width_char_ptr(self):
+        args = struct.pack("<iiiI", 6, 42, ord("z"), 0x20000000)
+        self.assertEqual(self.msg("[%*d] %c %p 100%%", args), "[    42] z 0x20000000 100%")
+
+    def test_float(self):
+        self.assertEqual(self.msg("%.2f", struct.pack("<d", 3.14159)), "3.14")
+
+    def test_string(self):
+        args = bin_str("emmc") + struct.pack("<i", 3)
+        self.assertEqual(self.msg("%s:%d", args), "emmc:3")
+
+    def test_missing_args(self):
+        self.assertEqual(self.msg("a=%d b=%d", struct.pack("<i", 1)), "a=1 b=<?>")
+
+    def test_truncated(self):
+        out = self.decoder("x").feed(record(SITE_ADDR, lvl=LVL_INFO | bld.BIN_LOG_TRUNCATED))
+        self.assertIn("x <truncated>", out)
+
+    def test_time_wrap(self):
+        dec = self.decoder("t")
+        dec.feed(record(SITE_ADDR, time_us=0xFFFFFF00))
+        out = dec.feed(record(SITE_ADDR, time_us=0x100))
+        self.assertIn(f"[{((1 << 32) + 0x100) / 1e6:.6f}]", out)
+
+    def test_split_feed(self):
+        dec = self.decoder("n=%d")
+        data = b"pre " + record(SITE_ADDR, struct.pack("<i", 9)) + b" post"
+        out = "".join(dec.feed(data[i : i + 1]) for i in range(len(data)))
+        self.assertEqual(out, self.decoder("n=%d").feed(data))
+        self.assertTrue(out.startswith("pre [   INFO]"))
+        self.assertTrue(out.endswith("n=9\r\n post"))
+
+    def test_unknown_site_is_text(self):
+        dec = self.decoder("ok")
+        out = dec.feed(record(SITE_ADDR + 4) + record(SITE_ADDR))
+        self.assertTrue(out.startswith("�"))
+        self.assertTrue(out.endswith("ok\r\n"))
+
+    def test_interleaved_text(self):
+        dec = self.decoder("rec")
+        out = dec.feed(b"a" + record(SITE_ADDR) + "б".encode() + record(SITE_ADDR) + b"c")
+        self.assertEqual(out.count("rec\r\n"), 2)
+        self.assertTrue(out.startswith("a["))
+        self.assertIn("\r\nб[", out)
+        self.assertTrue(out.endswith("\r\nc"))
+
+
+# Set by CMake to the host build of debug_bin_log.c, see test_debug_bin_log.c
+ENCODER = os.environ.get("BIN_LOG_ENCODER")
+RECORD_RE = re.compile(r"\[fi: [^,]+, fn: (\w+), ln: (\d+)\]:\r\n\t  (.*?)\r\n")
+
+
+@unittest.skipUnless(ENCODER, "BIN_LOG_ENCODER is not set")
+class RoundTripTest(unittest.TestCase):
+    """Records made by the C encoder decode to what snprintf() prints"""
+
+    @classmethod
+    def setUpClass(cls):
+        out = subprocess.run([ENCODER, "--dump"], capture_output=True, check=True, text=True)
+        dump = json.loads(out.stdout)
+
+        cls.cases = {}
+        cls.sites = {}
+        for case in dump["cases"]:
+            fmt = bytes.fromhex(case["fmt"]).decode()
+            site = bld.LogSite(fmt, "test_debug_bin_log.c", case["func"], case["line"])
+            cls.sites[case["site"]] = site
+            cls.cases[case["line"]] = case
+
+        cls.long_size = dump["long_size"]
+        cls.stream = bytes.fromhex(dump["stream"])
+        cls.out = bld.BinLogDecoder(cls.sites, cls.long_size).feed(cls.stream)
+
+    def test_all_records(self):
+        lines = [int(m.group(2)) for m in RECORD_RE.finditer(self.out)]
+        self.assertEqual(sorted(lines), sorted(self.cases))
+
+    def test_text_kept(self):
+        self.assertTrue(self.out.startswith("shell> ls\r\n["))
+        self.assertIn("\r\nplain [", self.out)
+        self.assertIn("\r\ntext\r\n[", self.out)
+        self.assertTrue(self.out.endswith("\r\nend\r\n"))
+
+    def test_messages(self):
+        for m in RECORD_RE.finditer(self.out):
+            case = self.cases[int(m.group(2))]
+            expect = bytes.fromhex(case["expect"]).decode()
+            msg = m.group(3)
+            with self.subTest(line=case["line"], expect=expect):
+                if not case["cut"]:
+                    self.assertEqual(msg, expect)
+                    continue
+
+                # what was cut off is lost, the rest matches
+                self.assertTrue(msg.endswith(" <truncated>"))
+                kept = msg[: -len(" <truncated>")].split("<?>", 1)[0]
+                self.assertGreater(len(kept), 32)
+                self.assertTrue(expect.startswith(kept))
+
+    def test_split_feed(self):
+        dec = bld.BinLogDecoder(self.sites, self.long_size)
+        out = "".join(dec.feed(self.stream[i : i + 7]) for i in range(0, len(self.stream), 7))
+        self.assertEqual(out, self.out)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,246 @@
+#include <pthread.h>
+#include <sched.h>
+
+#include "byte_ring.h"
+#include "host_test.h"
+
+#define TEST_RING_SIZE		   256
+#define TEST_PRODUCERS		   4
+#define TEST_RECORDS_PER_PROD  50000
+#define TEST_RECORD_HDR		   6 // len, producer, seq
+#define TEST_RECORD_LEN_MAX	   40
+#define TEST_POS_WRAP_CHUNK	   200
+
+static u8 RingBuff[TEST_RING_SIZE];
+
+static u32 Ring_ReadAll(ByteRing_t* pRing, u8* pDst, u32 size) {
+	u32 total = 0;
+	const u8* pData;
+	u32 len;
+
+	while ((len = ByteRing_Peek(pRing, &pData)) && total + len <= size) {
+		memcpy(&pDst[total], pData, len);
+		ByteRing_Release(pRing, len);
+		total += len;
+	}
+
+	return total;
+}
+
+static void Test_Empty(void) {
+	ByteRing_t ring;
+	ByteRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+
+	const u8* pData;
+	CHECK_EQ(ByteRing_Peek(&ring, &pData), 0);
+	CHECK_EQ(ByteRing_GetUsed(&ring), 0);
+}
+
+static void Test_WriteRead(void) {
+	ByteRing_t ring;
+	ByteRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+
+	CHECK(ByteRing_Write(&ring, "hello", 5));
+	CHECK(ByteRing_Write(&ring, " world", 6));
+	CHECK_EQ(ByteRing_GetUsed(&ring), 11);
+
+	u8 out[TEST_RING_SIZE];
+	CHECK_EQ(Ring_ReadAll(&ring, out, sizeof(out)), 11);
+	CHECK(memcmp(out, "hello world", 11) == 0);
+	CHECK_EQ(ByteRing_GetUsed(&ring), 0);
+	CHECK_EQ(ByteRing_GetStats(&ring).Written, 11);
+	CHECK_EQ(ByteRing_GetStats(&ring).Peak, 11);
+}
+
+static void Test_Wrap(void) {
+	ByteRing_t ring;
+	ByteRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+
+	u8 pad[TEST_RING_SIZE - 10] = {0};
+	u8 out[TEST_RING_SIZE];
+	CHECK(ByteRing_Write(&ring, pad, sizeof(pad)));
+	CHECK_EQ(Ring_ReadAll(&ring, out, sizeof(out)), sizeof(pad));
+
+	u8 data[30];
+	for (u32 i = 0; i < sizeof(data); i++)
+		data[i] = (u8)(i + 1);
+
+	ByteRing_Span_t span;
+	CHECK(ByteRing_Reserve(&ring, sizeof(data), &span));
+	CHECK_EQ(span.Len[0], 10);
+	CHECK_EQ(span.Len[1], 20);
+	CHECK(span.pPart[1] == RingBuff);
+	memcpy(span.pPart[0], data, span.Len[0]);
+	memcpy(span.pPart[1], &data[span.Len[0]], span.Len[1]);
+	ByteRing_Commit(&ring, &span);
+
+	// the consumer gets the part up to the buffer end first
+	const u8* pData;
+	CHECK_EQ(ByteRing_Peek(&ring, &pData), 10);
+	CHECK_EQ(Ring_ReadAll(&ring, out, sizeof(out)), sizeof(data));
+	CHECK(memcmp(out, data, sizeof(data)) == 0);
+}
+
+static void Test_Overflow(void) {
+	ByteRing_t ring;
+	ByteRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+
+	u8 data[TEST_RING_SIZE + 1] = {0};
+	CHECK(!ByteRing_Write(&ring, data, 0));
+	CHECK(!ByteRing_Write(&ring, data, TEST_RING_SIZE + 1));
+	CHECK(ByteRing_Write(&ring, data, TEST_RING_SIZE));
+	CHECK(!ByteRing_Write(&ring, data, 1));
+
+	ByteRing_Stats_t stats = ByteRing_GetStats(&ring);
+	CHECK_EQ(stats.Overflows, 3);
+	CHECK_EQ(stats.OverflowBytes, TEST_RING_SIZE + 2);
+	CHECK_EQ(stats.Written, TEST_RING_SIZE);
+	CHECK_EQ(stats.Peak, TEST_RING_SIZE);
+
+	// released space is usable again
+	const u8* pData;
+	ByteRing_Release(&ring, ByteRing_Peek(&ring, &pData));
+	CHECK(ByteRing_Write(&ring, data, 1));
+}
+
+static void Test_NestedWriters(void) {
+	ByteRing_t ring;
+	ByteRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+
+	// the second writer preempts the first one between reserve and commit
+	ByteRing_Span_t first, second;
+	CHECK(ByteRing_Reserve(&ring, 4, &first));
+	CHECK(ByteRing_Reserve(&ring, 4, &second));
+	memcpy(second.pPart[0], "BBBB", 4);
+	ByteRing_Commit(&ring, &second);
+
+	const u8* pData;
+	CHECK_EQ(ByteRing_Peek(&ring, &pData), 0);
+
+	memcpy(first.pPart[0], "AAAA", 4);
+	ByteRing_Commit(&ring, &first);
+
+	CHECK_EQ(ByteRing_Peek(&ring, &pData), 8);
+	CHECK(memcmp(pData, "AAAABBBB", 8) == 0);
+}
+
+static void Test_PosWrap(void) {
+	ByteRing_t ring;
+	ByteRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+
+	u8 data[TEST_POS_WRAP_CHUNK];
+	u8 out[TEST_RING_SIZE];
+	u8 seq = 0;
+	bool isOk = true;
+
+	// positions are counted modulo 2^24, go past it a few times
+	for (u32 total = 0; total < 3 * (BYTE_RING_POS_MASK + 1) && isOk; total += sizeof(data)) {
+		for (u32 i = 0; i < sizeof(data); i++)
+			data[i] = seq + (u8)i;
+
+		isOk = ByteRing_Write(&ring, data, sizeof(data)) &&
+			   Ring_ReadAll(&ring, out, sizeof(out)) == sizeof(data) &&
+			   memcmp(out, data, sizeof(data)) == 0;
+		seq++;
+	}
+
+	CHECK(isOk);
+	CHECK_EQ(ByteRing_GetUsed(&ring), 0);
+}
+
+typedef struct {
+	ByteRing_t* pRing;
+	u8 Id;
+} TestProducer_t;
+
+static u32 Record_Len(u32 seq) {
+	return TEST_RECORD_HDR + seq % (TEST_RECORD_LEN_MAX - TEST_RECORD_HDR + 1);
+}
+
+static void* Producer_Thread(void* pArg) {
+	TestProducer_t* pProd = pArg;
+	u8 rec[TEST_RECORD_LEN_MAX];
+
+	for (u32 seq = 0; seq < TEST_RECORDS_PER_PROD; seq++) {
+		u32 len = Record_Len(seq);
+		rec[0]	= (u8)len;
+		rec[1]	= pProd->Id;
+		memcpy(&rec[2], &seq, sizeof(seq));
+		for (u32 i = TEST_RECORD_HDR; i < len; i++)
+			rec[i] = (u8)(seq + i);
+
+		while (!ByteRing_Write(pProd->pRing, rec, len))
+			sched_yield();
+	}
+
+	return NULL;
+}
+
+static void Test_Producers(void) {
+	ByteRing_t ring;
+	ByteRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+
+	pthread_t threads[TEST_PRODUCERS];
+	TestProducer_t prods[TEST_PRODUCERS];
+	for (u32 i = 0; i < TEST_PRODUCERS; i++) {
+		prods[i] = (TestProducer_t){.pRing = &ring, .Id = (u8)i};
+		pthread_create(&threads[i], NULL, Producer_Thread, &prods[i]);
+	}
+
+	// records are whole and in order per producer, whatever the interleaving
+	u32 nextSeq[TEST_PRODUCERS] = {0};
+	u8 rec[TEST_RECORD_LEN_MAX];
+	u32 recPos = 0, records = 0, errors = 0;
+	u64 bytes = 0;
+
+	while (records < TEST_PRODUCERS * TEST_RECORDS_PER_PROD && errors == 0) {
+		const u8* pData;
+		u32 len = ByteRing_Peek(&ring, &pData);
+		if (!len) {
+			sched_yield();
+			continue;
+		}
+
+		for (u32 i = 0; i < len && errors == 0; i++) {
+			rec[recPos++] = pData[i];
+			if (recPos < TEST_RECORD_HDR || recPos < rec[0])
+				continue;
+
+			u32 seq;
+			memcpy(&seq, &rec[2], sizeof(seq));
+			if (rec[1] >= TEST_PRODUCERS || seq != nextSeq[rec[1]] || rec[0] != Record_Len(seq))
+				errors++;
+			for (u32 j = TEST_RECORD_HDR; j < recPos && errors == 0; j++)
+				if (rec[j] != (u8)(seq + j))
+					errors++;
+
+			if (errors == 0)
+				nextSeq[rec[1]]++;
+			records++;
+			recPos = 0;
+		}
+
+		ByteRing_Release(&ring, len);
+		bytes += len;
+	}
+
+	for (u32 i = 0; i < TEST_PRODUCERS; i++)
+		pthread_join(threads[i], NULL);
+
+	CHECK_EQ(errors, 0);
+	CHECK_EQ(records, TEST_PRODUCERS * TEST_RECORDS_PER_PROD);
+	CHECK_EQ(ByteRing_GetStats(&ring).Written, bytes);
+	CHECK_EQ(ByteRing_GetUsed(&ring), 0);
+}
+
+int main(void) {
+	HOST_TEST_RUN(Test_Empty);
+	HOST_TEST_RUN(Test_WriteRead);
+	HOST_TEST_RUN(Test_Wrap);
+	HOST_TEST_RUN(Test_Overflow);
+	HOST_TEST_RUN(Test_NestedWriters);
+	HOST_TEST_RUN(Test_PosWrap);
+	HOST_TEST_RUN(Test_Producers);
+
+	return HOST_TEST_RESULT();
+}
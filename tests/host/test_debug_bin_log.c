@@ -0,0 +1,171 @@
+#include "debug.h"
+#include "debug_bin_log.h"
+#include "host_test.h"
+
+#define TEST_LVL_INFO	 2 // LOG_LVL_INFO
+#define TEST_STREAM_SIZE 8192
+#define TEST_CASES_MAX	 32
+#define TEST_EXPECT_SIZE 512
+
+typedef struct {
+	const DebugBinSite_t* pSite;
+	char Expect[TEST_EXPECT_SIZE]; // snprintf() of the same call
+	bool IsCut;
+} TestCase_t;
+
+static u8 Stream[TEST_STREAM_SIZE];
+static u32 StreamLen;
+static u32 LastRec; // start of the last record in the stream
+static TestCase_t Cases[TEST_CASES_MAX];
+static u32 CasesNum;
+
+bool Debug_WriteRaw(const void* pData, u32 len) {
+	ASSERT_CHECK(StreamLen + len <= sizeof(Stream));
+	LastRec = StreamLen;
+	memcpy(&Stream[StreamLen], pData, len);
+	StreamLen += len;
+	return true;
+}
+
+static void Test_Text(const char* pStr) {
+	u32 len = strlen(pStr);
+	memcpy(&Stream[StreamLen], pStr, len);
+	StreamLen += len;
+}
+
+/* one call site per use, logged and printed with the same arguments */
+#define TEST_LOG(cut, _f_, ...)                                                  \
+	do {                                                                         \
+		static const DebugBinSite_t _site = {_f_, __FILE__, __func__, __LINE__}; \
+		ASSERT_CHECK(CasesNum < TEST_CASES_MAX);                                 \
+		TestCase_t* _pCase = &Cases[CasesNum++];                                 \
+		snprintf(_pCase->Expect, sizeof(_pCase->Expect), _f_, ##__VA_ARGS__);    \
+		_pCase->pSite = &_site;                                                  \
+		_pCase->IsCut = cut;                                                     \
+		Debug_BinLog(TEST_LVL_INFO, &_site, ##__VA_ARGS__);                      \
+	} while (0)
+
+static const u8* Test_LastRec(void) {
+	return &Stream[LastRec];
+}
+
+static void Test_Header(void) {
+	TEST_LOG(false, "boot %d", 7);
+	const u8* pRec = Test_LastRec();
+
+	u32 site;
+	memcpy(&site, &pRec[3], sizeof(site));
+	CHECK_EQ(pRec[0], DEBUG_BIN_LOG_MAGIC);
+	CHECK_EQ(pRec[1], StreamLen - LastRec - 2);
+	CHECK_EQ(pRec[1], 9 + sizeof(int));
+	CHECK_EQ(pRec[2], TEST_LVL_INFO);
+	CHECK_EQ(site, (u32)(uintptr_t)Cases[CasesNum - 1].pSite);
+}
+
+static void Test_Args(void) {
+	s64 big		  = -(1LL << 40);
+	size_t sz	  = 123456;
+	void* pPtr	  = &Stream[0];
+	long neg	  = -70000;
+	unsigned hex  = 0xBEEF;
+	double pi	  = 3.14159265;
+	const char* s = "emmc";
+
+	TEST_LOG(false, "%d %u %04X %o", -5, 7u, hex, 8);
+	TEST_LOG(false, "%lld %llu %ld %zu", (long long)big, 1ULL << 63, neg, sz);
+	TEST_LOG(false, "[%*d] [%-*s] [%.*f]", 6, 42, 8, s, 2, pi);
+	TEST_LOG(false, "%f %.3e %g %.1f", pi, pi * 1e6, 0.5, -2.25);
+	TEST_LOG(false, "%s:%d %c %p 100%%", s, 3, 'z', pPtr);
+	TEST_LOG(false, "%hhu %hd %+d % d", 200, -3, 5, 6);
+	TEST_LOG(false, "no args");
+	TEST_LOG(false, "%s|%s", "", "x");
+}
+
+static void Test_NullStr(void) {
+	const char* volatile pNull = NULL;
+	TEST_LOG(false, "str %s end", pNull);
+	const u8* pRec = Test_LastRec();
+	CHECK_EQ(pRec[11], 6);
+	CHECK(memcmp(&pRec[12], "(null)", 6) == 0);
+}
+
+static void Test_Truncated(void) {
+	char longStr[300];
+	memset(longStr, 'a', sizeof(longStr) - 1);
+	longStr[sizeof(longStr) - 1] = '\0';
+
+	// a cut string keeps what fits in the record
+	TEST_LOG(true, "%d %s", 1, longStr);
+	const u8* pRec = Test_LastRec();
+	CHECK(pRec[2] & DEBUG_BIN_LOG_TRUNCATED);
+	CHECK_EQ(StreamLen - LastRec, DEBUG_BIN_LOG_REC_MAX);
+
+	// arguments past the record end are dropped whole
+	TEST_LOG(true,
+			 "%lld %lld %lld %lld %lld %lld %lld %lld "
+			 "%lld %lld %lld %lld %lld %lld %lld %lld",
+			 1LL, 2LL, 3LL, 4LL, 5LL, 6LL, 7LL, 8LL, 9LL, 10LL, 11LL, 12LL, 13LL, 14LL, 15LL, 16LL);
+	pRec = Test_LastRec();
+	CHECK(pRec[2] & DEBUG_BIN_LOG_TRUNCATED);
+	CHECK_EQ((pRec[1] - 9) % sizeof(long long), 0);
+
+	// a record that just fits is whole: the header, the string length and the string
+	longStr[DEBUG_BIN_LOG_REC_MAX - 12] = '\0';
+	TEST_LOG(false, "%s", longStr);
+	CHECK(!(Test_LastRec()[2] & DEBUG_BIN_LOG_TRUNCATED));
+	CHECK_EQ(StreamLen - LastRec, DEBUG_BIN_LOG_REC_MAX);
+}
+
+static void Test_Stream(void) {
+	Test_Text("shell> ls\r\n");
+	Test_Header();
+	Test_Text("plain ");
+	Test_Args();
+	Test_NullStr();
+	Test_Text("text\r\n");
+	Test_Truncated();
+	Test_Text("end\r\n");
+}
+
+static void Test_PrintHex(const void* pData, u32 len) {
+	putchar('"');
+	for (u32 i = 0; i < len; i++)
+		printf("%02x", ((const u8*)pData)[i]);
+	putchar('"');
+}
+
+/**
+ * The stream and the call sites as JSON for test_bin_log_decode.py, strings
+ * in hex to keep them as they are
+ */
+static void Test_Dump(void) {
+	printf("{\"long_size\": %u, \"cases\": [", (u32)sizeof(long));
+	for (u32 i = 0; i < CasesNum; i++) {
+		const DebugBinSite_t* pSite = Cases[i].pSite;
+		printf("%s{\"site\": %u, \"line\": %u, \"cut\": %s, \"func\": \"%s\", \"fmt\": ",
+			   i ? ", " : "", (u32)(uintptr_t)pSite, pSite->Line, Cases[i].IsCut ? "true" : "false",
+			   pSite->pFunc);
+		Test_PrintHex(pSite->pFmt, strlen(pSite->pFmt));
+		printf(", \"expect\": ");
+		Test_PrintHex(Cases[i].Expect, strlen(Cases[i].Expect));
+		printf("}");
+	}
+	printf("], \"stream\": ");
+	Test_PrintHex(Stream, StreamLen);
+	printf("}\n");
+}
+
+int main(int argc, char** argv) {
+	if (argc > 1 && strcmp(argv[1], "--dump") == 0) {
+		Test_Stream();
+		Test_Dump();
+		return EXIT_SUCCESS;
+	}
+
+	HOST_TEST_RUN(Test_Header);
+	HOST_TEST_RUN(Test_Args);
+	HOST_TEST_RUN(Test_NullStr);
+	HOST_TEST_RUN(Test_Truncated);
+
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,181 @@
+#include "byte_ring.h"
+#include "debug_tx.h"
+#include "host_test.h"
+
+#define TEST_RING_SIZE	 1024
+#define TEST_PACKET_SIZE 64
+#define TEST_XFER_MAX	 512
+
+typedef struct {
+	u8 Out[4 * TEST_RING_SIZE]; // everything taken by the endpoint, in order
+	u32 OutLen;
+	u32 Submits;
+	u32 LastLen;
+	bool Reject;			// refuse the next submit
+	DebugTx_t* pCompleteTx; // complete from inside Submit(), like a fast ISR
+} TestEp_t;
+
+static u8 RingBuff[TEST_RING_SIZE];
+
+static bool TestEp_Submit(void* pCtx, const u8* pData, u32 len) {
+	TestEp_t* pEp = pCtx;
+
+	if (pEp->Reject) {
+		pEp->Reject = false;
+		return false;
+	}
+
+	memcpy(&pEp->Out[pEp->OutLen], pData, len);
+	pEp->OutLen += len;
+	pEp->LastLen = len;
+	pEp->Submits++;
+
+	if (pEp->pCompleteTx)
+		DebugTx_Complete(pEp->pCompleteTx);
+
+	return true;
+}
+
+static void Test_XferLen(void) {
+	DebugTx_Ep_t ep = {.XferMax = TEST_XFER_MAX, .PacketSize = TEST_PACKET_SIZE};
+	DEBUG_TX_END_t end;
+
+	CHECK_EQ(DebugTx_GetXferLen(&ep, 0, &end), 0);
+	CHECK_EQ(DebugTx_GetXferLen(&ep, 10, &end), 10);
+	CHECK_EQ(end, DEBUG_TX_END_SHORT);
+	CHECK_EQ(DebugTx_GetXferLen(&ep, 64, &end), 64);
+	CHECK_EQ(end, DEBUG_TX_END_ZLP);
+	CHECK_EQ(DebugTx_GetXferLen(&ep, 128, &end), 127);
+	CHECK_EQ(end, DEBUG_TX_END_CUT);
+	CHECK_EQ(DebugTx_GetXferLen(&ep, 130, &end), 130);
+	CHECK_EQ(end, DEBUG_TX_END_SHORT);
+	CHECK_EQ(DebugTx_GetXferLen(&ep, 1000, &end), TEST_XFER_MAX - 1);
+	CHECK_EQ(end, DEBUG_TX_END_CUT);
+
+	// no packets, e.g. a UART
+	ep.PacketSize = 0;
+	CHECK_EQ(DebugTx_GetXferLen(&ep, 1000, &end), TEST_XFER_MAX);
+	CHECK_EQ(end, DEBUG_TX_END_SHORT);
+}
+
+static void Test_OneInFlight(void) {
+	ByteRing_t ring;
+	TestEp_t testEp = {0};
+	DebugTx_Ep_t ep = {TestEp_Submit, &testEp, TEST_XFER_MAX, TEST_PACKET_SIZE};
+	DebugTx_t tx;
+	ByteRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+	DebugTx_Init(&tx, &ring, &ep);
+
+	CHECK(!DebugTx_Process(&tx));
+	CHECK_EQ(testEp.Submits, 0);
+
+	CHECK(ByteRing_Write(&ring, "first", 5));
+	CHECK(DebugTx_Process(&tx));
+	CHECK_EQ(testEp.Submits, 1);
+
+	// new output waits for the completion, the block stays in the ring
+	CHECK(ByteRing_Write(&ring, " second", 7));
+	CHECK(DebugTx_Process(&tx));
+	CHECK_EQ(testEp.Submits, 1);
+	CHECK_EQ(ByteRing_GetUsed(&ring), 12);
+
+	DebugTx_Complete(&tx);
+	CHECK(DebugTx_Process(&tx));
+	CHECK_EQ(testEp.Submits, 2);
+	CHECK_EQ(testEp.LastLen, 7);
+
+	DebugTx_Complete(&tx);
+	CHECK(!DebugTx_Process(&tx));
+	CHECK_EQ(ByteRing_GetUsed(&ring), 0);
+	CHECK_EQ(testEp.OutLen, 12);
+	CHECK(memcmp(testEp.Out, "first second", 12) == 0);
+
+	DebugTx_Stats_t stats = DebugTx_GetStats(&tx);
+	CHECK_EQ(stats.Xfers, 2);
+	CHECK_EQ(stats.Bytes, 12);
+}
+
+static void Test_Reject(void) {
+	ByteRing_t ring;
+	TestEp_t testEp = {0};
+	DebugTx_Ep_t ep = {TestEp_Submit, &testEp, TEST_XFER_MAX, TEST_PACKET_SIZE};
+	DebugTx_t tx;
+	ByteRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+	DebugTx_Init(&tx, &ring, &ep);
+
+	CHECK(ByteRing_Write(&ring, "data", 4));
+	testEp.Reject = true;
+	CHECK(!DebugTx_Process(&tx));
+	CHECK_EQ(DebugTx_GetStats(&tx).Rejects, 1);
+	CHECK_EQ(ByteRing_GetUsed(&ring), 4);
+
+	// the refused data goes out with the next try
+	CHECK(DebugTx_Process(&tx));
+	DebugTx_Complete(&tx);
+	CHECK(!DebugTx_Process(&tx));
+	CHECK_EQ(testEp.OutLen, 4);
+	CHECK(memcmp(testEp.Out, "data", 4) == 0);
+}
+
+static void Test_CompleteInSubmit(void) {
+	ByteRing_t ring;
+	TestEp_t testEp = {0};
+	DebugTx_Ep_t ep = {TestEp_Submit, &testEp, TEST_XFER_MAX, TEST_PACKET_SIZE};
+	DebugTx_t tx;
+	ByteRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+	DebugTx_Init(&tx, &ring, &ep);
+	testEp.pCompleteTx = &tx;
+
+	CHECK(ByteRing_Write(&ring, "fast", 4));
+	CHECK(DebugTx_Process(&tx));
+	CHECK(!DebugTx_Process(&tx));
+	CHECK_EQ(testEp.Submits, 1);
+	CHECK_EQ(ByteRing_GetUsed(&ring), 0);
+}
+
+static void Test_Stream(void) {
+	ByteRing_t ring;
+	TestEp_t testEp = {0};
+	DebugTx_Ep_t ep = {TestEp_Submit, &testEp, TEST_XFER_MAX, TEST_PACKET_SIZE};
+	DebugTx_t tx;
+	ByteRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+	DebugTx_Init(&tx, &ring, &ep);
+
+	u8 data[sizeof(testEp.Out)];
+	for (u32 i = 0; i < sizeof(data); i++)
+		data[i] = (u8)(i * 7);
+
+	// writes of whole packets, so the cut and the ZLP cases both come up
+	u32 written	 = 0;
+	u32 zlpXfers = 0;
+	for (u32 i = 0; written < sizeof(data) || tx.InFlight; i++) {
+		u32 len = GET_MIN((i % 3 + 1) * TEST_PACKET_SIZE, sizeof(data) - written);
+		if (len && ByteRing_Write(&ring, &data[written], len))
+			written += len;
+
+		if (DebugTx_Process(&tx)) {
+			if (testEp.LastLen % TEST_PACKET_SIZE == 0)
+				zlpXfers++;
+			DebugTx_Complete(&tx);
+		}
+	}
+
+	CHECK_EQ(testEp.OutLen, sizeof(data));
+	CHECK(memcmp(testEp.Out, data, sizeof(data)) == 0);
+
+	DebugTx_Stats_t stats = DebugTx_GetStats(&tx);
+	CHECK_EQ(stats.Bytes, sizeof(data));
+	CHECK(stats.Zlps > 0);
+	CHECK(stats.ZlpsSaved > 0);
+	CHECK_EQ(stats.Zlps, zlpXfers);
+}
+
+int main(void) {
+	HOST_TEST_RUN(Test_XferLen);
+	HOST_TEST_RUN(Test_OneInFlight);
+	HOST_TEST_RUN(Test_Reject);
+	HOST_TEST_RUN(Test_CompleteInSubmit);
+	HOST_TEST_RUN(Test_Stream);
+
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,116 @@
+#include "dma_rx_ring.h"
+#include "host_test.h"
+
+#define TEST_RING_SIZE 64
+#define TEST_DMA_STEPS 100000
+
+static u8 RingBuff[TEST_RING_SIZE];
+
+static u32 Remaining(u32 writePos) {
+	return TEST_RING_SIZE - writePos;
+}
+
+static void Test_Empty(void) {
+	DmaRxRing_t ring;
+	DmaRxRing_Chunk_t chunks[DMA_RX_RING_CHUNKS_MAX];
+	DmaRxRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+
+	// both readings of the counter at the buffer start mean no data
+	CHECK_EQ(DmaRxRing_Update(&ring, TEST_RING_SIZE, chunks), 0);
+	CHECK_EQ(DmaRxRing_Update(&ring, 0, chunks), 0);
+	CHECK_EQ(ring.ReadPos, 0);
+}
+
+static void Test_Linear(void) {
+	DmaRxRing_t ring;
+	DmaRxRing_Chunk_t chunks[DMA_RX_RING_CHUNKS_MAX];
+	DmaRxRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+
+	CHECK_EQ(DmaRxRing_Update(&ring, Remaining(10), chunks), 1);
+	CHECK(chunks[0].pData == RingBuff);
+	CHECK_EQ(chunks[0].Len, 10);
+
+	CHECK_EQ(DmaRxRing_Update(&ring, Remaining(10), chunks), 0);
+
+	CHECK_EQ(DmaRxRing_Update(&ring, Remaining(25), chunks), 1);
+	CHECK(chunks[0].pData == &RingBuff[10]);
+	CHECK_EQ(chunks[0].Len, 15);
+}
+
+static void Test_BufferEnd(void) {
+	DmaRxRing_Chunk_t chunks[DMA_RX_RING_CHUNKS_MAX];
+	u32 ends[] = {0, TEST_RING_SIZE};
+
+	// the counter at the wrap reads 0 or the reloaded size
+	for (u32 i = 0; i < NUM_ELEMENTS(ends); i++) {
+		DmaRxRing_t ring;
+		DmaRxRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+		DmaRxRing_Update(&ring, Remaining(40), chunks);
+
+		CHECK_EQ(DmaRxRing_Update(&ring, ends[i], chunks), 1);
+		CHECK(chunks[0].pData == &RingBuff[40]);
+		CHECK_EQ(chunks[0].Len, TEST_RING_SIZE - 40);
+		CHECK_EQ(ring.ReadPos, 0);
+	}
+}
+
+static void Test_Wrap(void) {
+	DmaRxRing_t ring;
+	DmaRxRing_Chunk_t chunks[DMA_RX_RING_CHUNKS_MAX];
+	DmaRxRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+
+	DmaRxRing_Update(&ring, Remaining(50), chunks);
+	CHECK_EQ(DmaRxRing_Update(&ring, Remaining(5), chunks), 2);
+	CHECK(chunks[0].pData == &RingBuff[50]);
+	CHECK_EQ(chunks[0].Len, TEST_RING_SIZE - 50);
+	CHECK(chunks[1].pData == RingBuff);
+	CHECK_EQ(chunks[1].Len, 5);
+
+	CHECK_EQ(ring.Chunks, 3);
+	CHECK_EQ(ring.Bytes, TEST_RING_SIZE + 5);
+}
+
+static void Test_Stream(void) {
+	DmaRxRing_t ring;
+	DmaRxRing_Chunk_t chunks[DMA_RX_RING_CHUNKS_MAX];
+	DmaRxRing_Init(&ring, RingBuff, TEST_RING_SIZE);
+	srand(1);
+
+	u32 writePos = 0, errors = 0;
+	u8 dmaByte = 0, readByte = 0;
+	u64 dmaBytes = 0;
+
+	// events come at most half a buffer apart, as the half and full interrupts do
+	for (u32 step = 0; step < TEST_DMA_STEPS && errors == 0; step++) {
+		u32 len = (u32)rand() % (TEST_RING_SIZE / 2 + 1);
+		for (u32 i = 0; i < len; i++) {
+			RingBuff[writePos] = dmaByte++;
+			writePos		   = (writePos + 1) % TEST_RING_SIZE;
+		}
+		dmaBytes += len;
+
+		u32 remaining = Remaining(writePos);
+		if (writePos == 0 && rand() % 2)
+			remaining = 0;
+
+		u32 num = DmaRxRing_Update(&ring, remaining, chunks);
+		for (u32 c = 0; c < num; c++)
+			for (u32 i = 0; i < chunks[c].Len; i++)
+				if (chunks[c].pData[i] != readByte++)
+					errors++;
+	}
+
+	CHECK_EQ(errors, 0);
+	CHECK_EQ(ring.Bytes, (u32)dmaBytes);
+	CHECK_EQ(ring.ReadPos, writePos);
+}
+
+int main(void) {
+	HOST_TEST_RUN(Test_Empty);
+	HOST_TEST_RUN(Test_Linear);
+	HOST_TEST_RUN(Test_BufferEnd);
+	HOST_TEST_RUN(Test_Wrap);
+	HOST_TEST_RUN(Test_Stream);
+
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,234 @@
+#include "host_test.h"
+
+/* the queue helpers are static, the module is built into the test */
+#include "fs_async.c"
+
+#define TEST_REQS_MAX 32
+
+typedef struct {
+	u32 Seeks;
+	s32 SeekOffset;
+	u32 Calls;
+	u32 CallSize[TEST_REQS_MAX];
+	u32 Syncs;
+	u32 DoneMax; // bytes a call transfers at most
+	RET_STATE_t Res;
+	FsWrap_AsyncReq_t* pCompleted[TEST_REQS_MAX];
+	u32 CompletedNum;
+} FakeFs_t;
+
+static FakeFs_t Fake;
+static FsWrap_File_t FileA, FileB;
+static FsWrap_AsyncReq_t Reqs[TEST_REQS_MAX];
+static u8 Data[TEST_REQS_MAX * 100];
+
+RET_STATE_t FsWrap_Seek(FsWrap_File_t* pFile, s32 offset, FS_SEEK_t whence) {
+	(void)pFile;
+	CHECK_EQ(whence, FS_SEEK_START);
+	Fake.Seeks++;
+	Fake.SeekOffset = offset;
+	return RET_STATE_SUCCESS;
+}
+
+static RET_STATE_t FakeFs_Xfer(u32 size, u32* pDone) {
+	Fake.CallSize[Fake.Calls++] = size;
+	*pDone						= GET_MIN(size, Fake.DoneMax);
+	return Fake.Res;
+}
+
+RET_STATE_t FsWrap_Read(FsWrap_File_t* pFile, void* pData, u32 size, u32* pBytesRd) {
+	(void)pFile;
+	(void)pData;
+	return FakeFs_Xfer(size, pBytesRd);
+}
+
+RET_STATE_t FsWrap_Write(FsWrap_File_t* pFile, const void* pData, u32 size, u32* pBytesWr) {
+	(void)pFile;
+	(void)pData;
+	return FakeFs_Xfer(size, pBytesWr);
+}
+
+RET_STATE_t FsWrap_Sync(FsWrap_File_t* pFile) {
+	(void)pFile;
+	Fake.Syncs++;
+	return Fake.Res;
+}
+
+static void Test_Clbk(FsWrap_AsyncReq_t* pReq) {
+	Fake.pCompleted[Fake.CompletedNum++] = pReq;
+}
+
+static void Test_Reset(void) {
+	memset(&Fake, 0, sizeof(Fake));
+	memset(Reqs, 0, sizeof(Reqs));
+	Fake.DoneMax = 0xFFFFFFFF;
+	Fake.Res	 = RET_STATE_SUCCESS;
+
+	FsAsync_QueueNum = 0;
+	FsAsync_Handle	 = xTaskGetCurrentTaskHandle();
+}
+
+static FsWrap_AsyncReq_t* Test_Queue(u32 idx, FsWrap_File_t* pFile, FS_ASYNC_OP_t op, u32 offset,
+									 FS_ASYNC_PRIO_t prio) {
+	FsWrap_AsyncReq_t* pReq = &Reqs[idx];
+	*pReq = (FsWrap_AsyncReq_t){.pFile = pFile, .pData = &Data[idx * 100], .Offset = offset,
+								.Size = 100, .Prio = prio, .Clbk = Test_Clbk};
+	CHECK_EQ(FsAsync_Submit(pReq, op), RET_STATE_SUCCESS);
+	return pReq;
+}
+
+static u32 Test_TakeBatch(FsWrap_AsyncReq_t** ppBatch) {
+	u32 num = FsAsync_QueueTakeBatch(ppBatch);
+	CHECK_EQ(*HostRtos_Critical(), 0);
+	for (u32 i = 0; i < num; i++)
+		CHECK_EQ(ppBatch[i]->State, FS_ASYNC_STATE_BUSY);
+	return num;
+}
+
+static void Test_Priority(void) {
+	Test_Reset();
+	FsWrap_File_t files[5];
+	FS_ASYNC_PRIO_t prios[] = {FS_ASYNC_PRIO_LOW, FS_ASYNC_PRIO_HIGH, FS_ASYNC_PRIO_NORMAL,
+							   FS_ASYNC_PRIO_HIGH, FS_ASYNC_PRIO_LOW};
+	for (u32 i = 0; i < NUM_ELEMENTS(prios); i++)
+		Test_Queue(i, &files[i], FS_ASYNC_OP_READ, 0, prios[i]);
+
+	// high ones first, each priority in the order of submission
+	u32 order[] = {1, 3, 2, 0, 4};
+	FsWrap_AsyncReq_t* batch[FS_ASYNC_MERGE_MAX];
+	for (u32 i = 0; i < NUM_ELEMENTS(order); i++) {
+		CHECK_EQ(Test_TakeBatch(batch), 1);
+		CHECK(batch[0] == &Reqs[order[i]]);
+	}
+	CHECK_EQ(Test_TakeBatch(batch), 0);
+}
+
+static void Test_FileOrder(void) {
+	Test_Reset();
+	FsWrap_AsyncReq_t* batch[FS_ASYNC_MERGE_MAX];
+
+	// the read at 100 continues the first one, the write between them stops it
+	Test_Queue(0, &FileA, FS_ASYNC_OP_READ, 0, FS_ASYNC_PRIO_NORMAL);
+	Test_Queue(1, &FileA, FS_ASYNC_OP_WRITE, 100, FS_ASYNC_PRIO_NORMAL);
+	Test_Queue(2, &FileA, FS_ASYNC_OP_READ, 100, FS_ASYNC_PRIO_NORMAL);
+
+	for (u32 i = 0; i < 3; i++) {
+		CHECK_EQ(Test_TakeBatch(batch), 1);
+		CHECK(batch[0] == &Reqs[i]);
+	}
+
+	// the same for a request at another offset
+	Test_Queue(0, &FileA, FS_ASYNC_OP_READ, 0, FS_ASYNC_PRIO_NORMAL);
+	Test_Queue(1, &FileA, FS_ASYNC_OP_READ, 500, FS_ASYNC_PRIO_NORMAL);
+	Test_Queue(2, &FileA, FS_ASYNC_OP_READ, 100, FS_ASYNC_PRIO_NORMAL);
+	CHECK_EQ(Test_TakeBatch(batch), 1);
+	CHECK_EQ(Test_TakeBatch(batch), 1);
+	CHECK(batch[0] == &Reqs[1]);
+}
+
+static void Test_Merge(void) {
+	Test_Reset();
+	FsWrap_AsyncReq_t* batch[FS_ASYNC_MERGE_MAX];
+	u32 merged = FsAsync_Stats.Merged;
+
+	// other files in between do not stop the merge
+	Test_Queue(0, &FileA, FS_ASYNC_OP_READ, 0, FS_ASYNC_PRIO_NORMAL);
+	Test_Queue(1, &FileB, FS_ASYNC_OP_READ, 100, FS_ASYNC_PRIO_NORMAL);
+	Test_Queue(2, &FileA, FS_ASYNC_OP_READ, 100, FS_ASYNC_PRIO_NORMAL);
+	Test_Queue(3, &FileA, FS_ASYNC_OP_READ, FS_ASYNC_OFFSET_CUR, FS_ASYNC_PRIO_NORMAL);
+
+	CHECK_EQ(Test_TakeBatch(batch), 3);
+	CHECK(batch[1] == &Reqs[2] && batch[2] == &Reqs[3]);
+	CHECK_EQ(FsAsync_Stats.Merged - merged, 2);
+	CHECK_EQ(Test_TakeBatch(batch), 1);
+	CHECK(batch[0] == &Reqs[1]);
+
+	// after the current position the end is unknown, only another one there follows
+	Test_Queue(0, &FileA, FS_ASYNC_OP_WRITE, FS_ASYNC_OFFSET_CUR, FS_ASYNC_PRIO_NORMAL);
+	Test_Queue(1, &FileA, FS_ASYNC_OP_WRITE, FS_ASYNC_OFFSET_CUR, FS_ASYNC_PRIO_NORMAL);
+	Test_Queue(2, &FileA, FS_ASYNC_OP_WRITE, 200, FS_ASYNC_PRIO_NORMAL);
+	CHECK_EQ(Test_TakeBatch(batch), 2);
+	CHECK_EQ(Test_TakeBatch(batch), 1);
+
+	// consecutive syncs go together whatever the offset
+	Test_Queue(0, &FileA, FS_ASYNC_OP_SYNC, 0, FS_ASYNC_PRIO_NORMAL);
+	Test_Queue(1, &FileA, FS_ASYNC_OP_SYNC, 0, FS_ASYNC_PRIO_NORMAL);
+	CHECK_EQ(Test_TakeBatch(batch), 2);
+	FsAsync_ServeSync(batch, 2);
+	CHECK_EQ(Fake.Syncs, 1);
+
+	// one pass serves FS_ASYNC_MERGE_MAX requests at most
+	u32 num = FS_ASYNC_MERGE_MAX + 2;
+	for (u32 i = 0; i < num; i++)
+		Test_Queue(i, &FileA, FS_ASYNC_OP_READ, i * 100, FS_ASYNC_PRIO_NORMAL);
+	CHECK_EQ(Test_TakeBatch(batch), FS_ASYNC_MERGE_MAX);
+	CHECK_EQ(Test_TakeBatch(batch), 2);
+	CHECK(batch[0] == &Reqs[FS_ASYNC_MERGE_MAX]);
+}
+
+static void Test_QueueFull(void) {
+	Test_Reset();
+	u32 rejected = FsAsync_Stats.Rejected;
+
+	for (u32 i = 0; i < FS_ASYNC_QUEUE_SIZE; i++)
+		Test_Queue(i, &FileA, FS_ASYNC_OP_READ, 0, FS_ASYNC_PRIO_NORMAL);
+	CHECK_EQ(FsWrap_AsyncGetFree(), 0);
+
+	FsWrap_AsyncReq_t* pReq = &Reqs[FS_ASYNC_QUEUE_SIZE];
+	*pReq = (FsWrap_AsyncReq_t){.pFile = &FileA, .pData = Data, .Size = 1, .Clbk = Test_Clbk};
+	CHECK_EQ(FsWrap_ReadAsync(pReq), RET_STATE_ERR_BUSY);
+	CHECK_EQ(pReq->State, FS_ASYNC_STATE_IDLE);
+	CHECK_EQ(FsAsync_Stats.Rejected - rejected, 1);
+	CHECK_EQ(*HostRtos_Critical(), 0);
+
+	// a queued request can not be submitted again
+	CHECK_EQ(FsWrap_ReadAsync(&Reqs[0]), RET_STATE_ERR_PARAM);
+}
+
+static void Test_ShortXfer(void) {
+	Test_Reset();
+	FsWrap_AsyncReq_t* batch[FS_ASYNC_MERGE_MAX];
+
+	// three requests with buffers one after another, the call ends in the second
+	for (u32 i = 0; i < 3; i++)
+		Test_Queue(i, &FileA, FS_ASYNC_OP_WRITE, 1000 + i * 100, FS_ASYNC_PRIO_NORMAL);
+	Fake.DoneMax = 150;
+
+	u32 num = Test_TakeBatch(batch);
+	CHECK_EQ(num, 3);
+	FsAsync_ServeData(batch, num);
+
+	CHECK_EQ(Fake.Seeks, 1);
+	CHECK_EQ(Fake.SeekOffset, 1000);
+	CHECK_EQ(Fake.Calls, 1);
+	CHECK_EQ(Fake.CallSize[0], 300);
+	CHECK_EQ(Fake.CompletedNum, 3);
+	CHECK_EQ(Reqs[0].Done, 100);
+	CHECK_EQ(Reqs[1].Done, 50);
+	CHECK_EQ(Reqs[2].Done, 0);
+	for (u32 i = 0; i < 3; i++) {
+		CHECK_EQ(Reqs[i].Result, RET_STATE_SUCCESS);
+		CHECK_EQ(Reqs[i].State, FS_ASYNC_STATE_DONE);
+	}
+
+	// a gap between the buffers splits the call, the file stays contiguous
+	Test_Reset();
+	Test_Queue(0, &FileA, FS_ASYNC_OP_READ, 0, FS_ASYNC_PRIO_NORMAL);
+	Test_Queue(2, &FileA, FS_ASYNC_OP_READ, 100, FS_ASYNC_PRIO_NORMAL);
+	num = Test_TakeBatch(batch);
+	CHECK_EQ(num, 2);
+	FsAsync_ServeData(batch, num);
+	CHECK_EQ(Fake.Seeks, 1);
+	CHECK_EQ(Fake.Calls, 2);
+	CHECK_EQ(Reqs[2].Done, 100);
+}
+
+int main(void) {
+	HOST_TEST_RUN(Test_Priority);
+	HOST_TEST_RUN(Test_FileOrder);
+	HOST_TEST_RUN(Test_Merge);
+	HOST_TEST_RUN(Test_QueueFull);
+	HOST_TEST_RUN(Test_ShortXfer);
+
+	return HOST_TEST_RESULT();
+}
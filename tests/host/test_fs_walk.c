@@ -0,0 +1,195 @@
+#include "fs_host.h"
+#include "fs_walk.h"
+#include "host_test.h"
+#include "mem_wrapper.h"
+#include "storage_cfg.h"
+#include "storage_ram.h"
+
+#define TEST_CAPACITY STORAGE_RAM_HEAP_SIZE
+#define TEST_ROOT	  FS_HOST_RAM_PATH "/walk"
+#define TEST_TOP	  16 // directories of the root
+#define TEST_SUB	  4	 // directories of each of them
+#define TEST_FILES	  32 // files of each of those
+#define TEST_DIRS	  (TEST_TOP + TEST_TOP * TEST_SUB)
+#define TEST_ENTRIES  (TEST_DIRS + TEST_DIRS / (TEST_SUB + 1) * TEST_SUB * TEST_FILES)
+#define TEST_STOP_AT  100
+
+typedef struct {
+	u32 Files;
+	u32 Dirs;
+	u32 Lasts;
+	u32 MaxDepth;
+	u32 StopAt; // 0 for the whole tree
+	u32 PathErrs;
+} Walked_t;
+
+static FsWrap_Walk_t Walk;
+
+/**
+ * @brief 1:/walk/dNN/sN/fNN.log, empty files so the tree is all directory
+ * entries. Short lower case names take no LFN entry
+ */
+static bool Test_MakeTree(void) {
+	char path[FS_MAX_FILE_NAME + 1];
+	FsWrap_File_t file = {0};
+	bool isOk		   = FsWrap_Mkdir(TEST_ROOT) == RET_STATE_SUCCESS;
+
+	for (u32 top = 0; top < TEST_TOP && isOk; top++) {
+		snprintf(path, sizeof(path), TEST_ROOT "/d%02u", top);
+		isOk = FsWrap_Mkdir(path) == RET_STATE_SUCCESS;
+
+		for (u32 sub = 0; sub < TEST_SUB && isOk; sub++) {
+			snprintf(path, sizeof(path), TEST_ROOT "/d%02u/s%u", top, sub);
+			isOk = FsWrap_Mkdir(path) == RET_STATE_SUCCESS;
+
+			for (u32 i = 0; i < TEST_FILES && isOk; i++) {
+				snprintf(path, sizeof(path), TEST_ROOT "/d%02u/s%u/f%02u.log", top, sub, i);
+				isOk = FsWrap_Open(&file, path, FS_MODE_WRITE | FS_MODE_CREATE_ALWAYS) ==
+						   RET_STATE_SUCCESS &&
+					   FsWrap_Close(&file) == RET_STATE_SUCCESS;
+			}
+		}
+	}
+
+	return isOk;
+}
+
+static FS_WALK_t Test_Visitor(const FsWrap_WalkEntry_t* pEntry) {
+	Walked_t* pWalked = pEntry->pCtx;
+
+	if (pEntry->pEntry->Type & FS_DIR_ENTRY_DIR)
+		pWalked->Dirs++;
+	else
+		pWalked->Files++;
+
+	// the path is the root, one name per level and the name of the entry
+	const char* pRel = &pEntry->pPath[strlen(TEST_ROOT)];
+	u32 levels		 = 0;
+	for (const char* pCh = pRel; *pCh; pCh++)
+		levels += *pCh == '/';
+	bool isPathOk = strncmp(pEntry->pPath, TEST_ROOT "/", strlen(TEST_ROOT) + 1) == 0 &&
+					levels == pEntry->Depth + 1 &&
+					strcmp(strrchr(pRel, '/') + 1, pEntry->pEntry->Name) == 0;
+	pWalked->PathErrs += !isPathOk;
+
+	pWalked->Lasts += pEntry->IsLast;
+	pWalked->MaxDepth = GET_MAX(pWalked->MaxDepth, pEntry->Depth);
+	if (pWalked->StopAt && pWalked->Files + pWalked->Dirs == pWalked->StopAt)
+		return FS_WALK_STOP;
+
+	return FS_WALK_CONTINUE;
+}
+
+static u32 Test_WalkUs(Walked_t* pWalked, u32 maxDepth) {
+	FsWrap_WalkCfg_t cfg = {
+		.Visitor  = Test_Visitor,
+		.MaxDepth = maxDepth,
+		.pCtx	  = pWalked,
+	};
+
+	u64 start = PL_GET_US_CNT();
+	CHECK(FsWrap_Walk(&Walk, TEST_ROOT, &cfg) == RET_STATE_SUCCESS);
+	return (u32)(PL_GET_US_CNT() - start);
+}
+
+/**
+ * The walk fs -s did before FsWrap_Walk: every directory is read twice, a
+ * count for the last entry and then the listing, four blocks per level
+ */
+static u32 Test_TwoPassScan(const char* pPath) {
+	char* pCurrPath		  = malloc(FS_MAX_FILE_NAME + 1);
+	char* pPrefix		  = malloc(FS_MAX_FILE_NAME + 1);
+	FsWrap_Dir_t* pDir	  = calloc(1, sizeof(FsWrap_Dir_t));
+	FsWrap_DirEnt_t* pFno = malloc(sizeof(FsWrap_DirEnt_t));
+	u32 entries = 0, dirCnt = 0, currCnt = 0;
+
+	strcpy(pCurrPath, pPath);
+	CHECK(FsWrap_OpenDir(pDir, pCurrPath) == RET_STATE_SUCCESS);
+	while (FsWrap_ReadDir(pDir, pFno) == RET_STATE_SUCCESS && pFno->Name[0] != 0)
+		dirCnt++;
+	FsWrap_CloseDir(pDir);
+
+	CHECK(FsWrap_OpenDir(pDir, pCurrPath) == RET_STATE_SUCCESS);
+	while (FsWrap_ReadDir(pDir, pFno) == RET_STATE_SUCCESS && pFno->Name[0] != 0) {
+		if (pFno->Name[0] == '.')
+			continue;
+
+		entries++;
+		snprintf(pPrefix, FS_MAX_FILE_NAME + 1, "%s", ++currCnt == dirCnt ? "└" : "├");
+		if (pFno->Type & FS_DIR_ENTRY_DIR) {
+			u32 len = strlen(pCurrPath);
+			snprintf(&pCurrPath[len], FS_MAX_FILE_NAME + 1 - len, "/%s", pFno->Name);
+			entries += Test_TwoPassScan(pCurrPath);
+			pCurrPath[len] = 0;
+		}
+	}
+	FsWrap_CloseDir(pDir);
+
+	free(pCurrPath);
+	free(pPrefix);
+	free(pDir);
+	free(pFno);
+	return entries;
+}
+
+static void Test_WalkBench(void) {
+	Walked_t walked = {0};
+
+	u32 readsFrom = StorageRam_GetStats().Reads;
+	u32 walkUs	  = Test_WalkUs(&walked, 0);
+	u32 walkReads = StorageRam_GetStats().Reads - readsFrom;
+	CHECK_EQ(walked.Files + walked.Dirs, TEST_ENTRIES);
+	CHECK_EQ(walked.Dirs, TEST_DIRS);
+	CHECK_EQ(walked.Lasts, 1 + TEST_DIRS); // the root and every directory have a last entry
+	CHECK_EQ(walked.MaxDepth, 2);
+	CHECK_EQ(walked.PathErrs, 0);
+
+	readsFrom	 = StorageRam_GetStats().Reads;
+	u64 start	 = PL_GET_US_CNT();
+	u32 entries	 = Test_TwoPassScan(TEST_ROOT);
+	u32 scanUs	 = (u32)(PL_GET_US_CNT() - start);
+	u32 scanRead = StorageRam_GetStats().Reads - readsFrom;
+	CHECK_EQ(entries, TEST_ENTRIES);
+
+	printf("  %u entries: walk %u us %u sectors, two pass scan %u us %u sectors\n", TEST_ENTRIES,
+		   walkUs, walkReads, scanUs, scanRead);
+	// the times are close on the RAM drive, each sector read is a transfer on the eMMC
+	CHECK(walkReads * 3 < scanRead * 2);
+}
+
+static void Test_WalkLimits(void) {
+	FsWrap_PoolStats_t filStats, dirStats;
+	u32 heapFrom = MemWrap_GetFreeHeapSize();
+
+	// the files are on depth 2, a limit of 2 open levels stops above them
+	Walked_t walked = {0};
+	Test_WalkUs(&walked, 2);
+	CHECK_EQ(walked.Files, 0);
+	CHECK_EQ(walked.Dirs, TEST_DIRS);
+	CHECK_EQ(walked.MaxDepth, 1);
+
+	// a stop closes every open directory
+	walked = (Walked_t){.StopAt = TEST_STOP_AT};
+	Test_WalkUs(&walked, 0);
+	CHECK_EQ(walked.Files + walked.Dirs, TEST_STOP_AT);
+	CHECK(FsWrap_GetPoolStats(FS_TYPE_FATFS, &filStats, &dirStats) == RET_STATE_SUCCESS);
+	CHECK_EQ(dirStats.InUse, 0);
+	CHECK_EQ(MemWrap_GetFreeHeapSize(), heapFrom);
+
+	// a missing root is the error of the open
+	FsWrap_WalkCfg_t cfg = {.Visitor = Test_Visitor, .pCtx = &walked};
+	CHECK(FsWrap_Walk(&Walk, TEST_ROOT "/none", &cfg) != RET_STATE_SUCCESS);
+	CHECK(FsWrap_Walk(&Walk, TEST_ROOT, &(FsWrap_WalkCfg_t){0}) == RET_STATE_ERR_PARAM);
+}
+
+int main(void) {
+	if (!FsHost_Init(TEST_CAPACITY) || !Test_MakeTree()) {
+		printf("RAM drive tree failed\n");
+		return EXIT_FAILURE;
+	}
+
+	HOST_TEST_RUN(Test_WalkBench);
+	HOST_TEST_RUN(Test_WalkLimits);
+
+	return HOST_TEST_RESULT();
+}
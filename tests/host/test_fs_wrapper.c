@@ -0,0 +1,671 @@
+#include <pthread.h>
+
+#include "ff.h"
+#include "fs_host.h"
+#include "host_test.h"
+#include "mem_wrapper.h"
+#include "platform.h"
+#include "storage_cfg.h"
+#include "storage_ram.h"
+
+#define TEST_CAPACITY	STORAGE_RAM_HEAP_SIZE
+#define TEST_PATH		FS_HOST_RAM_PATH "/stream.bin"
+#define TEST_REC_SIZE	24 // a log record, far below a sector
+#define TEST_RECS		4096
+#define TEST_FILE_SIZE	(TEST_REC_SIZE * TEST_RECS)
+#define TEST_BUFF_SIZE	2048
+#define TEST_MOUNTS		8 // drives "2:" to "9:", the RAM drive is "1:"
+#define TEST_LOOKUPS	100000
+#define TEST_CHURN		4000 // open and close pairs
+#define TEST_PATHS		32 // the churn goes round them
+#define TEST_POOL_SIZE	5 // FF_FS_LOCK
+#define TEST_PATH_LEN	16
+#define TEST_SEEK_SIZE	(96 * DATA_1_KBYTE) // two of them fill the most of the drive
+#define TEST_SEEKS		4000
+#define TEST_SEEK_READ	16
+#define TEST_SECTOR		512 // FF_MAX_SS
+#define TEST_TRIM_SIZE	(32 * DATA_1_KBYTE)
+#define TEST_EMMC_SIZE	(4 * DATA_1_MBYTE)
+#define TEST_EMMC_BUSY	20000 // us, a slow eMMC program
+#define TEST_EMMC_RUN	10 // eMMC writes the RAM drive is timed through
+#define TEST_LAT_WRITES 4000
+#define TEST_LAT_SIZE	(32 * DATA_1_KBYTE)
+#define TEST_DEEP_DIR	FS_HOST_RAM_PATH "/log/2026/10"
+#define TEST_DEEP_PATH	TEST_DEEP_DIR "/app.log"
+#define TEST_DIR_FILL	40 // files ahead of the one on the path, 3 sectors of entries
+#define TEST_OPENS		10000
+
+/* the other task, it keeps the eMMC volume busy */
+typedef struct {
+	FsWrap_File_t File;
+	volatile bool IsStop;
+	volatile u32 Writes;
+} Hammer_t;
+
+typedef struct {
+	u32 Writes;
+	u32 AvgNs;
+	u32 MaxUs;
+	u32 Slow; // writes that took half an eMMC program or more
+} Test_Latency_t;
+
+static Hammer_t Hammer;
+
+/* a file system that does nothing, only the lookup of its mount point costs */
+typedef struct {
+	u32 Stats;
+	const FsWrap_Mount_t* pLastMount;
+} FakeFs_t;
+
+static FakeFs_t Fake;
+static u8 FakeVolumes[2 * TEST_MOUNTS]; // pFsData tells the mounts apart
+static FsWrap_Mount_t FakeMounts[2 * TEST_MOUNTS];
+static char FakePaths[2 * TEST_MOUNTS][TEST_PATH_LEN];
+
+static FsWrap_Stats_t Test_StatsDiff(FsWrap_Stats_t from) {
+	FsWrap_Stats_t to = FsWrap_GetStats();
+
+	return (FsWrap_Stats_t){
+		.BackendReads  = to.BackendReads - from.BackendReads,
+		.BackendWrites = to.BackendWrites - from.BackendWrites,
+		.BuffReads	   = to.BuffReads - from.BuffReads,
+		.BuffWrites	   = to.BuffWrites - from.BuffWrites,
+		.BypassReads   = to.BypassReads - from.BypassReads,
+		.BypassWrites  = to.BypassWrites - from.BypassWrites,
+	};
+}
+
+static u32 Test_ClustSize(void) {
+	FsWrap_StatVfs_t vfs;
+	CHECK(FsWrap_StatVFS(FS_HOST_RAM_PATH, &vfs) == RET_STATE_SUCCESS);
+	return vfs.AllocUnitSize;
+}
+
+/* the records one by one, through a stream buffer of @p buffSize or none */
+static FsWrap_Stats_t Test_WriteRecords(u32 buffSize, u64* pTimeUs) {
+	FsWrap_File_t file = {0};
+	u8 rec[TEST_REC_SIZE];
+
+	CHECK(FsHost_Format());
+	CHECK(FsWrap_Open(&file, TEST_PATH, FS_MODE_WRITE | FS_MODE_CREATE_ALWAYS) ==
+		  RET_STATE_SUCCESS);
+	CHECK(FsWrap_SetBuff(&file, buffSize) == RET_STATE_SUCCESS);
+
+	FsWrap_Stats_t from = FsWrap_GetStats();
+	u64 start			= PL_GET_US_CNT();
+	for (u32 i = 0; i < TEST_RECS; i++) {
+		u32 wr = 0;
+		FsHost_Fill(rec, i * TEST_REC_SIZE, TEST_REC_SIZE, 1);
+		CHECK(FsWrap_Write(&file, rec, TEST_REC_SIZE, &wr) == RET_STATE_SUCCESS);
+		CHECK_EQ(wr, TEST_REC_SIZE);
+	}
+	CHECK(FsWrap_Close(&file) == RET_STATE_SUCCESS);
+	*pTimeUs = PL_GET_US_CNT() - start;
+
+	CHECK(FsHost_CheckFile(TEST_PATH, TEST_FILE_SIZE, 1));
+	return Test_StatsDiff(from);
+}
+
+static FsWrap_Stats_t Test_ReadRecords(u32 buffSize, u64* pTimeUs) {
+	FsWrap_File_t file = {0};
+	u8 rec[TEST_REC_SIZE];
+	u8 expected[TEST_REC_SIZE];
+
+	CHECK(FsWrap_Open(&file, TEST_PATH, FS_MODE_READ) == RET_STATE_SUCCESS);
+	CHECK(FsWrap_SetBuff(&file, buffSize) == RET_STATE_SUCCESS);
+
+	FsWrap_Stats_t from = FsWrap_GetStats();
+	u64 start			= PL_GET_US_CNT();
+	for (u32 i = 0; i < TEST_RECS; i++) {
+		u32 rd = 0;
+		FsHost_Fill(expected, i * TEST_REC_SIZE, TEST_REC_SIZE, 1);
+		CHECK(FsWrap_Read(&file, rec, TEST_REC_SIZE, &rd) == RET_STATE_SUCCESS);
+		CHECK_EQ(rd, TEST_REC_SIZE);
+		CHECK(memcmp(rec, expected, TEST_REC_SIZE) == 0);
+	}
+	CHECK(FsWrap_Close(&file) == RET_STATE_SUCCESS);
+	*pTimeUs = PL_GET_US_CNT() - start;
+
+	return Test_StatsDiff(from);
+}
+
+static void Test_BuffBench(void) {
+	u64 directUs, buffUs;
+
+	FsWrap_Stats_t direct = Test_WriteRecords(0, &directUs);
+	FsWrap_Stats_t buff	  = Test_WriteRecords(TEST_BUFF_SIZE, &buffUs);
+	printf("  %u writes of %u bytes: direct %u calls %lu us, buffered %u calls %lu us\n",
+		   TEST_RECS, TEST_REC_SIZE, direct.BackendWrites, (unsigned long)directUs,
+		   buff.BackendWrites, (unsigned long)buffUs);
+
+	// every write reaches FatFS without the buffer, one per full buffer with it
+	CHECK_EQ(direct.BackendWrites, TEST_RECS);
+	CHECK_EQ(direct.BuffWrites + direct.BypassWrites, 0);
+	CHECK_EQ(buff.BackendWrites, TEST_FILE_SIZE / TEST_BUFF_SIZE);
+	CHECK_EQ(buff.BuffWrites + buff.BackendWrites, TEST_RECS);
+	CHECK_EQ(buff.BypassWrites, 0);
+
+	direct = Test_ReadRecords(0, &directUs);
+	buff   = Test_ReadRecords(TEST_BUFF_SIZE, &buffUs);
+	printf("  %u reads of %u bytes: direct %u calls %lu us, buffered %u calls %lu us\n",
+		   TEST_RECS, TEST_REC_SIZE, direct.BackendReads, (unsigned long)directUs,
+		   buff.BackendReads, (unsigned long)buffUs);
+
+	CHECK_EQ(direct.BackendReads, TEST_RECS);
+	CHECK_EQ(buff.BackendReads, TEST_FILE_SIZE / TEST_BUFF_SIZE);
+	CHECK_EQ(buff.BuffReads + buff.BackendReads, TEST_RECS);
+}
+
+/* cluster sized transfers skip the buffer, a small one between them keeps the order */
+static void Test_BuffBypass(void) {
+	FsWrap_File_t file = {0};
+	u32 clustSize	   = Test_ClustSize();
+	u32 size		   = 8 * clustSize + TEST_REC_SIZE;
+	u8* pData		   = malloc(size);
+	u32 xfer		   = 0;
+
+	CHECK(FsHost_Format());
+	FsHost_Fill(pData, 0, size, 2);
+	CHECK(FsWrap_Open(&file, TEST_PATH, FS_MODE_READ | FS_MODE_WRITE | FS_MODE_CREATE_ALWAYS) ==
+		  RET_STATE_SUCCESS);
+	CHECK(FsWrap_SetBuff(&file, 4 * clustSize) == RET_STATE_SUCCESS);
+	CHECK_EQ(file.Buff.BypassSize, clustSize);
+
+	FsWrap_Stats_t from = FsWrap_GetStats();
+	CHECK(FsWrap_Write(&file, pData, TEST_REC_SIZE, &xfer) == RET_STATE_SUCCESS);
+	for (u32 i = 0; i < 8; i++) {
+		CHECK(FsWrap_Write(&file, &pData[TEST_REC_SIZE + i * clustSize], clustSize, &xfer) ==
+			  RET_STATE_SUCCESS);
+		CHECK_EQ(xfer, clustSize);
+	}
+	FsWrap_Stats_t stats = Test_StatsDiff(from);
+	CHECK_EQ(stats.BypassWrites, 8);
+	CHECK_EQ(stats.BuffWrites, 1);
+	CHECK_EQ(stats.BackendWrites, 8 + 1); // the record is drained ahead of the first bypass
+
+	// a bulk read goes straight through as well, from a position in the middle of the buffer
+	u8* pRead = malloc(size);
+	CHECK(FsWrap_Seek(&file, 0, FS_SEEK_START) == RET_STATE_SUCCESS);
+	from = FsWrap_GetStats();
+	CHECK(FsWrap_Read(&file, pRead, TEST_REC_SIZE, &xfer) == RET_STATE_SUCCESS);
+	CHECK(FsWrap_Read(&file, &pRead[TEST_REC_SIZE], size - TEST_REC_SIZE, &xfer) ==
+		  RET_STATE_SUCCESS);
+	CHECK_EQ(xfer, size - TEST_REC_SIZE);
+	stats = Test_StatsDiff(from);
+	CHECK(memcmp(pRead, pData, size) == 0);
+	CHECK_EQ(stats.BypassReads, 1);
+
+	CHECK(FsWrap_Close(&file) == RET_STATE_SUCCESS);
+	CHECK(FsHost_CheckFile(TEST_PATH, size, 2));
+	free(pRead);
+	free(pData);
+}
+
+static RET_STATE_t FakeFs_Mount(FsWrap_Mount_t* pMntPoint) {
+	return RET_STATE_SUCCESS;
+}
+
+static RET_STATE_t FakeFs_Stat(FsWrap_Mount_t* pMntPoint, const char* pPath,
+							   FsWrap_DirEnt_t* pEntry) {
+	Fake.Stats++;
+	Fake.pLastMount = pMntPoint;
+	return RET_STATE_SUCCESS;
+}
+
+static const FsWrap_FileSystem_t FakeFs = {
+	.mount	 = FakeFs_Mount,
+	.unmount = FakeFs_Mount,
+	.stat	 = FakeFs_Stat,
+};
+
+/* @p idx below TEST_MOUNTS is drive idx + 2, the rest are mounted on a path */
+static void FakeFs_MountOne(u32 idx) {
+	if (idx < TEST_MOUNTS)
+		snprintf(FakePaths[idx], sizeof(FakePaths[idx]), "%u:", idx + 2);
+	else
+		snprintf(FakePaths[idx], sizeof(FakePaths[idx]), "/mnt%u", idx - TEST_MOUNTS);
+
+	FakeMounts[idx] = (FsWrap_Mount_t){
+		.Type		   = FS_TYPE_EXTERNAL_BASE,
+		.pMntPointPath = FakePaths[idx],
+		.pFsData	   = &FakeVolumes[idx],
+	};
+	CHECK(FsWrap_Mount(&FakeMounts[idx]) == RET_STATE_SUCCESS);
+}
+
+/* ns per FsWrap_Stat() of @p pPath, the call checks it reached the mount of @p idx */
+static u32 FakeFs_LookupNs(const char* pPath, u32 idx) {
+	FsWrap_DirEnt_t entry;
+
+	Fake.Stats = 0;
+	u64 start  = PL_GET_US_CNT();
+	for (u32 i = 0; i < TEST_LOOKUPS; i++)
+		FsWrap_Stat(pPath, &entry);
+	u64 timeUs = PL_GET_US_CNT() - start;
+
+	CHECK_EQ(Fake.Stats, TEST_LOOKUPS);
+	CHECK(Fake.pLastMount != NULL && Fake.pLastMount->pFsData == &FakeVolumes[idx]);
+	return (u32)(timeUs * 1000 / TEST_LOOKUPS);
+}
+
+static void Test_MountLookupBench(void) {
+	CHECK(FsWrap_Register(FS_TYPE_EXTERNAL_BASE, &FakeFs) == RET_STATE_SUCCESS);
+	CHECK_EQ(*HostRtos_Critical(), 0);
+
+	// "N:" paths go through the drive table, the first and the last mount cost the same
+	FakeFs_MountOne(0);
+	u32 oneNs = FakeFs_LookupNs("2:/log.txt", 0);
+	for (u32 i = 1; i < TEST_MOUNTS; i++)
+		FakeFs_MountOne(i);
+	u32 firstNs = FakeFs_LookupNs("2:/log.txt", 0);
+	u32 lastNs	= FakeFs_LookupNs("9:/log.txt", TEST_MOUNTS - 1);
+	printf("  drive lookup: 1 mount %u ns, %u mounts %u ns first, %u ns last\n", oneNs,
+		   TEST_MOUNTS + 1, firstNs, lastNs);
+
+	// the other mounts are a longest prefix match over the locked list
+	u32 pathNs = 0;
+	for (u32 i = TEST_MOUNTS; i < NUM_ELEMENTS(FakeMounts); i++) {
+		FakeFs_MountOne(i);
+		pathNs = FakeFs_LookupNs("/mnt0/log.txt", TEST_MOUNTS);
+		printf("  path lookup: %u mounts %u ns\n", i + 2, pathNs);
+	}
+	CHECK(lastNs * 4 < pathNs);
+
+	// a drive can't be shadowed, it still resolves with path mounts around
+	FakeFs_LookupNs("5:/log.txt", 3);
+	FsWrap_DirEnt_t entry;
+	CHECK(FsWrap_Stat("0:/log.txt", &entry) != RET_STATE_SUCCESS);
+
+	for (u32 i = 0; i < NUM_ELEMENTS(FakeMounts); i++)
+		CHECK(FsWrap_Unmount(&FakeMounts[i]) == RET_STATE_SUCCESS);
+	CHECK(FsWrap_Unregister(FS_TYPE_EXTERNAL_BASE, &FakeFs) == RET_STATE_SUCCESS);
+	CHECK_EQ(*HostRtos_Critical(), 0);
+
+	// back to the table with the path mounts gone
+	Fake.Stats = 0;
+	CHECK(FsWrap_Stat("2:/log.txt", &entry) != RET_STATE_SUCCESS);
+	CHECK_EQ(Fake.Stats, 0);
+}
+
+static void Test_ChurnPath(char* pPath, u32 idx) {
+	snprintf(pPath, TEST_PATH_LEN, FS_HOST_RAM_PATH "/c%u.bin", idx % TEST_PATHS);
+}
+
+/**
+ * Thousands of files opened and closed with bursts that run the pools dry.
+ * The host heap is not heap_4, what counts is that no open takes any of it
+ */
+static void Test_HandlePoolStress(void) {
+	FsWrap_PoolStats_t filFrom, dirFrom, filStats, dirStats;
+	FsWrap_File_t files[TEST_POOL_SIZE + 1] = {0};
+	FsWrap_Dir_t dir						= {0};
+	FsWrap_DirEnt_t entry;
+	char path[TEST_PATH_LEN];
+	u8 rec[TEST_REC_SIZE] = {0};
+	u32 xfer, bursts = 0;
+
+	CHECK(FsHost_Format());
+	CHECK(FsWrap_GetPoolStats(FS_TYPE_FATFS, &filFrom, &dirFrom) == RET_STATE_SUCCESS);
+	CHECK_EQ(filFrom.InUse + dirFrom.InUse, 0);
+	u32 heapFrom = MemWrap_GetFreeHeapSize();
+	u32 heapMin	 = heapFrom;
+
+	u64 start = PL_GET_US_CNT();
+	for (u32 i = 0; i < TEST_CHURN; i++) {
+		Test_ChurnPath(path, i);
+		CHECK(FsWrap_Open(&files[0], path, FS_MODE_WRITE | FS_MODE_CREATE_OR_APPEND) ==
+			  RET_STATE_SUCCESS);
+		CHECK(FsWrap_Write(&files[0], rec, sizeof(rec), &xfer) == RET_STATE_SUCCESS);
+		heapMin = GET_MIN(heapMin, MemWrap_GetFreeHeapSize());
+		CHECK(FsWrap_Close(&files[0]) == RET_STATE_SUCCESS);
+
+		if (i % 16 == 0) {
+			CHECK(FsWrap_OpenDir(&dir, FS_HOST_RAM_PATH "/") == RET_STATE_SUCCESS);
+			CHECK(FsWrap_ReadDir(&dir, &entry) == RET_STATE_SUCCESS);
+			heapMin = GET_MIN(heapMin, MemWrap_GetFreeHeapSize());
+			CHECK(FsWrap_CloseDir(&dir) == RET_STATE_SUCCESS);
+		}
+
+		// every open file in a pool item, then one more than FatFS may keep open
+		if (i % 256 == 0) {
+			for (u32 f = 0; f < TEST_POOL_SIZE; f++) {
+				Test_ChurnPath(path, i + f);
+				CHECK(FsWrap_Open(&files[f], path, FS_MODE_READ | FS_MODE_CREATE_OR_APPEND) ==
+					  RET_STATE_SUCCESS);
+			}
+			heapMin = GET_MIN(heapMin, MemWrap_GetFreeHeapSize());
+			Test_ChurnPath(path, i + TEST_POOL_SIZE);
+			CHECK(FsWrap_Open(&files[TEST_POOL_SIZE], path, FS_MODE_READ) != RET_STATE_SUCCESS);
+			for (u32 f = 0; f < TEST_POOL_SIZE; f++)
+				CHECK(FsWrap_Close(&files[f]) == RET_STATE_SUCCESS);
+			bursts++;
+		}
+	}
+	u64 timeUs = PL_GET_US_CNT() - start;
+
+	CHECK(FsWrap_GetPoolStats(FS_TYPE_FATFS, &filStats, &dirStats) == RET_STATE_SUCCESS);
+	u32 heapTo = MemWrap_GetFreeHeapSize();
+	printf("  %u opens in %lu us: heap free %u before, %u lowest, %u after, "
+		   "FIL peak %u exhausted %u\n",
+		   TEST_CHURN, (unsigned long)timeUs, heapFrom, heapMin, heapTo, filStats.Peak,
+		   filStats.Exhausted - filFrom.Exhausted);
+
+	CHECK_EQ(heapMin, heapFrom);
+	CHECK_EQ(heapTo, heapFrom);
+	CHECK_EQ(filStats.InUse + dirStats.InUse, 0);
+	CHECK_EQ(filStats.Peak, TEST_POOL_SIZE);
+	CHECK_EQ(dirStats.Peak, 1);
+	CHECK_EQ(filStats.Exhausted - filFrom.Exhausted, bursts); // heap fallback, then FatFS says no
+	CHECK_EQ(dirStats.Exhausted, dirFrom.Exhausted);
+	for (u32 i = 0; i < TEST_PATHS; i++) {
+		Test_ChurnPath(path, i);
+		CHECK(FsWrap_Stat(path, &entry) == RET_STATE_SUCCESS);
+		CHECK_EQ(entry.Size, (TEST_CHURN / TEST_PATHS) * TEST_REC_SIZE);
+	}
+}
+
+/**
+ * Two files written a cluster at a time in turns, so every cluster of
+ * each one is a fragment of its own
+ */
+static void Test_WriteFragmented(const char* pPathA, const char* pPathB, u32 size) {
+	FsWrap_File_t fileA = {0}, fileB = {0};
+	u32 clustSize		= Test_ClustSize();
+	u8* pData			= malloc(clustSize);
+	u32 xfer;
+
+	CHECK(FsWrap_Open(&fileA, pPathA, FS_MODE_WRITE | FS_MODE_CREATE_ALWAYS) == RET_STATE_SUCCESS);
+	CHECK(FsWrap_Open(&fileB, pPathB, FS_MODE_WRITE | FS_MODE_CREATE_ALWAYS) == RET_STATE_SUCCESS);
+	for (u32 pos = 0; pos < size; pos += clustSize) {
+		FsHost_Fill(pData, pos, clustSize, 3);
+		CHECK(FsWrap_Write(&fileA, pData, clustSize, &xfer) == RET_STATE_SUCCESS);
+		FsHost_Fill(pData, pos, clustSize, 4);
+		CHECK(FsWrap_Write(&fileB, pData, clustSize, &xfer) == RET_STATE_SUCCESS);
+	}
+	CHECK(FsWrap_Close(&fileA) == RET_STATE_SUCCESS);
+	CHECK(FsWrap_Close(&fileB) == RET_STATE_SUCCESS);
+	free(pData);
+}
+
+/* random reads of @p file written with @p seed, ns per seek and read */
+static u32 Test_SeekReads(FsWrap_File_t* pFile, u32 size, u8 seed, u32* pSectorReads) {
+	u8 buff[TEST_SEEK_READ], expected[TEST_SEEK_READ];
+	u32 rnd = 12345, xfer;
+
+	u32 readsFrom = StorageRam_GetStats().Reads;
+	u64 start	  = PL_GET_US_CNT();
+	for (u32 i = 0; i < TEST_SEEKS; i++) {
+		rnd		= rnd * 1103515245 + 12345;
+		u32 pos = (rnd >> 8) % (size - TEST_SEEK_READ);
+		CHECK(FsWrap_Seek(pFile, pos, FS_SEEK_START) == RET_STATE_SUCCESS);
+		CHECK(FsWrap_Read(pFile, buff, TEST_SEEK_READ, &xfer) == RET_STATE_SUCCESS);
+		FsHost_Fill(expected, pos, TEST_SEEK_READ, seed);
+		CHECK(memcmp(buff, expected, TEST_SEEK_READ) == 0);
+	}
+	u64 timeUs = PL_GET_US_CNT() - start;
+
+	*pSectorReads = StorageRam_GetStats().Reads - readsFrom;
+	return (u32)(timeUs * 1000 / TEST_SEEKS);
+}
+
+static void Test_FastSeekBench(void) {
+	const char* pPathA = FS_HOST_RAM_PATH "/seek_a.bin";
+	const char* pPathB = FS_HOST_RAM_PATH "/seek_b.bin";
+	FsWrap_File_t file = {0};
+	u32 plainReads, fastReads;
+
+	CHECK(FsHost_Format());
+	Test_WriteFragmented(pPathA, pPathB, TEST_SEEK_SIZE);
+
+	CHECK(FsWrap_Open(&file, pPathA, FS_MODE_READ) == RET_STATE_SUCCESS);
+	u32 plainNs = Test_SeekReads(&file, TEST_SEEK_SIZE, 3, &plainReads);
+	CHECK(FsWrap_Close(&file) == RET_STATE_SUCCESS);
+
+	CHECK(FsWrap_Open(&file, pPathA, FS_MODE_READ | FS_MODE_FAST_SEEK) == RET_STATE_SUCCESS);
+	u32 fastNs = Test_SeekReads(&file, TEST_SEEK_SIZE, 3, &fastReads);
+	CHECK(FsWrap_Close(&file) == RET_STATE_SUCCESS);
+
+	printf("  %u seeks over %u fragments: chain walk %u ns %u sectors, "
+		   "link map %u ns %u sectors\n",
+		   TEST_SEEKS, TEST_SEEK_SIZE / Test_ClustSize(), plainNs, plainReads, fastNs, fastReads);
+	CHECK(fastNs * 2 < plainNs);
+	CHECK(fastReads <= plainReads);
+
+	// a write past the end grows the chain, the map is rebuilt and follows it
+	u32 clustSize = Test_ClustSize();
+	u32 grownSize = TEST_SEEK_SIZE + 4 * clustSize;
+	u8* pData	  = malloc(grownSize);
+	FsHost_Fill(pData, 0, grownSize, 4);
+	CHECK(FsWrap_Open(&file, pPathB, FS_MODE_READ | FS_MODE_WRITE | FS_MODE_FAST_SEEK) ==
+		  RET_STATE_SUCCESS);
+	CHECK(((FIL*)file.pFileHandler)->cltbl != NULL);
+	u32 tailPos = TEST_SEEK_SIZE - TEST_REC_SIZE, xfer;
+	CHECK(FsWrap_Seek(&file, tailPos, FS_SEEK_START) == RET_STATE_SUCCESS);
+	CHECK(FsWrap_Write(&file, &pData[tailPos], grownSize - tailPos, &xfer) == RET_STATE_SUCCESS);
+	CHECK(((FIL*)file.pFileHandler)->cltbl != NULL);
+	Test_SeekReads(&file, grownSize, 4, &fastReads);
+	CHECK(FsWrap_Close(&file) == RET_STATE_SUCCESS);
+	CHECK(FsHost_CheckFile(pPathB, grownSize, 4));
+	free(pData);
+}
+
+/* RAM drive sectors that hold file data of @p seed, all of its sectors are alike */
+static u32 Test_SectorsOf(u8 seed) {
+	u8 sector[TEST_SECTOR];
+	u32 num = 0;
+
+	FsHost_Fill(sector, 0, TEST_SECTOR, seed);
+	for (u32 offset = 0; offset < StorageRam_GetCapacity(); offset += TEST_SECTOR) {
+		if (memcmp(StorageRam_Map(offset, TEST_SECTOR), sector, TEST_SECTOR) == 0)
+			num++;
+	}
+
+	return num;
+}
+
+/* the clusters FatFS frees reach the RAM drive as CTRL_TRIM and read back as zeroes */
+static void Test_TrimOnFree(void) {
+	const char* pPathA = FS_HOST_RAM_PATH "/trim_a.bin";
+	const char* pPathB = FS_HOST_RAM_PATH "/trim_b.bin";
+	const u32 sectors  = TEST_TRIM_SIZE / TEST_SECTOR;
+	FsWrap_File_t file = {0};
+
+	CHECK(FsHost_Format());
+	CHECK(FsHost_WriteFile(pPathA, TEST_TRIM_SIZE, 5));
+	CHECK(FsHost_WriteFile(pPathB, TEST_TRIM_SIZE, 6));
+	CHECK_EQ(Test_SectorsOf(5), sectors);
+
+	// a truncate frees the clusters past the new end
+	Storage_TrimStats_t from = StorageRam_GetTrimStats();
+	CHECK(FsWrap_Open(&file, pPathA, FS_MODE_WRITE) == RET_STATE_SUCCESS);
+	CHECK(FsWrap_Truncate(&file, TEST_TRIM_SIZE / 2) == RET_STATE_SUCCESS);
+	CHECK(FsWrap_Close(&file) == RET_STATE_SUCCESS);
+	CHECK_EQ(Test_SectorsOf(5), sectors / 2);
+	CHECK(StorageRam_GetTrimStats().Cmds > from.Cmds);
+	CHECK_EQ(StorageRam_GetTrimStats().Blocks - from.Blocks, sectors / 2);
+
+	// an unlink the rest of them, the other file keeps its data
+	CHECK(FsWrap_Unlink(pPathA) == RET_STATE_SUCCESS);
+	Storage_TrimStats_t stats = StorageRam_GetTrimStats();
+	printf("  %u KiB freed: %u trim commands %u sectors\n", TEST_TRIM_SIZE / DATA_1_KBYTE,
+		   stats.Cmds - from.Cmds, stats.Blocks - from.Blocks);
+	CHECK_EQ(Test_SectorsOf(5), 0);
+	CHECK_EQ(stats.Blocks - from.Blocks, sectors);
+	CHECK_EQ(stats.Errors, from.Errors);
+	CHECK_EQ(Test_SectorsOf(6), sectors);
+	CHECK(FsHost_CheckFile(pPathB, TEST_TRIM_SIZE, 6));
+}
+
+/* 2 KiB writes to the eMMC over and over, each one a program of TEST_EMMC_BUSY */
+static void* Hammer_Task(void* pArg) {
+	u8 buff[TEST_BUFF_SIZE];
+	u32 pos = 0, xfer;
+
+	FsHost_Fill(buff, 0, sizeof(buff), 8);
+	while (!Hammer.IsStop) {
+		if (pos == TEST_EMMC_SIZE / 4) {
+			if (FsWrap_Seek(&Hammer.File, 0, FS_SEEK_START) != RET_STATE_SUCCESS)
+				break;
+			pos = 0;
+		}
+
+		if (FsWrap_Write(&Hammer.File, buff, sizeof(buff), &xfer) != RET_STATE_SUCCESS)
+			break;
+		pos += sizeof(buff);
+		Hammer.Writes++;
+	}
+
+	return NULL;
+}
+
+/**
+ * 1 KiB writes to the RAM drive, TEST_LAT_WRITES of them or, with the
+ * hammer running, as many as fit in TEST_EMMC_RUN eMMC writes
+ */
+static Test_Latency_t Test_RamLatency(FsWrap_File_t* pFile, bool isHammered) {
+	Test_Latency_t lat = {0};
+	u8 buff[DATA_1_KBYTE];
+	u32 hammerFrom = Hammer.Writes, pos = 0, xfer;
+	u64 sumUs	   = 0;
+
+	FsHost_Fill(buff, 0, sizeof(buff), 9);
+	while (isHammered ? Hammer.Writes - hammerFrom < TEST_EMMC_RUN : lat.Writes < TEST_LAT_WRITES) {
+		if (pos == TEST_LAT_SIZE) {
+			CHECK(FsWrap_Seek(pFile, 0, FS_SEEK_START) == RET_STATE_SUCCESS);
+			pos = 0;
+		}
+
+		u64 start = PL_GET_US_CNT();
+		CHECK(FsWrap_Write(pFile, buff, sizeof(buff), &xfer) == RET_STATE_SUCCESS);
+		u32 timeUs = (u32)(PL_GET_US_CNT() - start);
+
+		pos += sizeof(buff);
+		sumUs += timeUs;
+		lat.MaxUs = GET_MAX(lat.MaxUs, timeUs);
+		lat.Slow += timeUs * 2 >= TEST_EMMC_BUSY;
+		lat.Writes++;
+	}
+
+	lat.AvgNs = (u32)(sumUs * 1000 / lat.Writes);
+	return lat;
+}
+
+/* a RAM drive write doesn't wait for an eMMC program of the other task */
+static void Test_VolumeLatencyBench(void) {
+	const char* pRamPath  = FS_HOST_RAM_PATH "/latency.bin";
+	const char* pEmmcPath = FS_HOST_EMMC_PATH "/hammer.bin";
+	FsWrap_File_t file	  = {0};
+	pthread_t task;
+
+	CHECK(FsHost_Format());
+	CHECK(FsHost_EmmcInit(TEST_EMMC_SIZE, TEST_EMMC_BUSY));
+	CHECK(FsWrap_Open(&file, pRamPath, FS_MODE_WRITE | FS_MODE_CREATE_ALWAYS) == RET_STATE_SUCCESS);
+	CHECK(FsWrap_Open(&Hammer.File, pEmmcPath, FS_MODE_WRITE | FS_MODE_CREATE_ALWAYS) ==
+		  RET_STATE_SUCCESS);
+	Test_Latency_t idle = Test_RamLatency(&file, false);
+
+	CHECK(pthread_create(&task, NULL, Hammer_Task, NULL) == 0);
+	Test_Latency_t busy = Test_RamLatency(&file, true);
+	Hammer.IsStop		= true;
+	CHECK(pthread_join(task, NULL) == 0);
+
+	printf("  RAM drive 1 KiB write: idle %u ns avg %u us max, "
+		   "eMMC busy %u ns avg %u us max %u slow of %u\n",
+		   idle.AvgNs, idle.MaxUs, busy.AvgNs, busy.MaxUs, busy.Slow, busy.Writes);
+	CHECK(Hammer.Writes >= TEST_EMMC_RUN);
+
+	// a shared lock makes most eMMC writes hold up a RAM one, a host time slice only a few
+	CHECK(busy.Slow * 4 < TEST_EMMC_RUN);
+
+	CHECK(FsWrap_Close(&Hammer.File) == RET_STATE_SUCCESS);
+	CHECK(FsWrap_Close(&file) == RET_STATE_SUCCESS);
+}
+
+/* each directory of the path has TEST_DIR_FILL files ahead of the next name */
+static void Test_MakeDeepPath(void) {
+	const char* pDirs[] = {FS_HOST_RAM_PATH "/log", FS_HOST_RAM_PATH "/log/2026", TEST_DEEP_DIR};
+	char path[FS_MAX_FILE_NAME + 1];
+
+	for (u32 i = 0; i < NUM_ELEMENTS(pDirs); i++) {
+		CHECK(FsWrap_Mkdir(pDirs[i]) == RET_STATE_SUCCESS);
+		for (u32 n = 0; n < TEST_DIR_FILL; n++) {
+			snprintf(path, sizeof(path), "%s/f%02u.txt", pDirs[i], n);
+			CHECK(FsHost_WriteFile(path, 0, 0));
+		}
+	}
+
+	CHECK(FsHost_WriteFile(TEST_DEEP_PATH, TEST_REC_SIZE, 10));
+}
+
+/**
+ * ns per open and close of @p pPath. Without @p isCached the cache is
+ * dropped before each open, the lookup scans the directories as it did
+ * before the cache. One thread runs, the volume lock is not needed
+ */
+static u32 Test_OpenNs(const char* pPath, FATFS* pFs, bool isCached, u32* pSectorReads) {
+	FsWrap_File_t file = {0};
+
+	u32 readsFrom = StorageRam_GetStats().Reads;
+	u64 start	  = PL_GET_US_CNT();
+	for (u32 i = 0; i < TEST_OPENS; i++) {
+		if (!isCached)
+			ff_dircache_drop(pFs);
+		CHECK(FsWrap_Open(&file, pPath, FS_MODE_READ) == RET_STATE_SUCCESS);
+		CHECK(FsWrap_Close(&file) == RET_STATE_SUCCESS);
+	}
+	u64 timeUs = PL_GET_US_CNT() - start;
+
+	*pSectorReads = StorageRam_GetStats().Reads - readsFrom;
+	return (u32)(timeUs * 1000 / TEST_OPENS);
+}
+
+static void Test_DirCacheBench(void) {
+	u32 plainReads, cachedReads;
+	DWORD freeClust;
+	FATFS* pFs;
+
+	CHECK(FsHost_Format());
+	Test_MakeDeepPath();
+	CHECK(f_getfree(FS_HOST_RAM_PATH, &freeClust, &pFs) == FR_OK);
+
+	u32 allocsFrom = Pl_Host_GetAllocCnt();
+	u32 plainNs	   = Test_OpenNs(TEST_DEEP_PATH, pFs, false, &plainReads);
+	u32 cachedNs   = Test_OpenNs(TEST_DEEP_PATH, pFs, true, &cachedReads);
+	printf("  %u opens of %s: scan %u ns %u sectors, cache %u ns %u sectors\n", TEST_OPENS,
+		   TEST_DEEP_PATH, plainNs, plainReads, cachedNs, cachedReads);
+	CHECK(cachedReads * 2 < plainReads);
+	CHECK(cachedNs < plainNs);
+
+	// the LFN buffer is the one of the volume and the FIL comes from the pool, no heap
+	CHECK_EQ(Pl_Host_GetAllocCnt(), allocsFrom);
+
+	// a name removed and made again lands on another entry, the lookup follows it
+	CHECK(FsWrap_Unlink(TEST_DEEP_PATH) == RET_STATE_SUCCESS);
+	CHECK(FsHost_WriteFile(TEST_DEEP_DIR "/new.txt", 0, 0));
+	CHECK(FsHost_WriteFile(TEST_DEEP_PATH, TEST_REC_SIZE, 11));
+	CHECK(FsHost_CheckFile(TEST_DEEP_PATH, TEST_REC_SIZE, 11));
+
+	// a renamed file is gone from its old name
+	FsWrap_File_t file = {0};
+	CHECK(FsWrap_Rename(TEST_DEEP_PATH, TEST_DEEP_DIR "/old.log") == RET_STATE_SUCCESS);
+	CHECK(FsWrap_Open(&file, TEST_DEEP_PATH, FS_MODE_READ) != RET_STATE_SUCCESS);
+	CHECK(FsHost_CheckFile(TEST_DEEP_DIR "/old.log", TEST_REC_SIZE, 11));
+}
+
+int main(void) {
+	if (!FsHost_Init(TEST_CAPACITY)) {
+		printf("RAM drive mount failed\n");
+		return EXIT_FAILURE;
+	}
+
+	HOST_TEST_RUN(Test_BuffBench);
+	HOST_TEST_RUN(Test_BuffBypass);
+	HOST_TEST_RUN(Test_MountLookupBench);
+	HOST_TEST_RUN(Test_HandlePoolStress);
+	HOST_TEST_RUN(Test_FastSeekBench);
+	HOST_TEST_RUN(Test_TrimOnFree);
+	HOST_TEST_RUN(Test_VolumeLatencyBench);
+	HOST_TEST_RUN(Test_DirCacheBench);
+
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,123 @@
+#include "host_test.h"
+#include "mmc_bus.h"
+
+#define EXT_CSD_REV			192
+#define EXT_CSD_DEVICE_TYPE 196
+#define EXT_CSD_HS_TIMING	185
+
+typedef struct {
+	u8 Rev;
+	u8 DeviceType;
+} TestCard_t;
+
+/* EXT_CSD_REV and DEVICE_TYPE as the cards report them */
+static const TestCard_t Test_CardDdr	= {8, 0x57}; // eMMC 5.1, HS400/HS200/DDR52/HS52
+static const TestCard_t Test_CardDdr12V = {5, 0x0B}; // eMMC 4.41, DDR52 at 1.2V I/O only
+static const TestCard_t Test_CardHs		= {5, 0x03}; // eMMC 4.41, HS52
+static const TestCard_t Test_CardLegacy = {3, 0x01}; // eMMC 4.3, 26 MHz
+
+static u8 ExtCsd[MMC_BUS_EXT_CSD_SIZE];
+
+static const u8* Test_Dump(const TestCard_t* pCard, u8 hsTiming) {
+	memset(ExtCsd, 0, sizeof(ExtCsd));
+	ExtCsd[EXT_CSD_REV]			= pCard->Rev;
+	ExtCsd[EXT_CSD_DEVICE_TYPE] = pCard->DeviceType;
+	ExtCsd[EXT_CSD_HS_TIMING]	= hsTiming;
+	return ExtCsd;
+}
+
+static void Test_CheckTimings(const TestCard_t* pCard, u32 busWidth, const Pl_SdEmmcTiming_t* pExp,
+							  u32 expNum) {
+	Pl_SdEmmcTiming_t timings[MMC_BUS_TIMINGS_MAX];
+	u32 num = MMC_Bus_GetTimings(Test_Dump(pCard, 0), busWidth, timings);
+
+	CHECK_EQ(num, expNum);
+	for (u32 i = 0; i < GET_MIN(num, expNum); i++)
+		CHECK_EQ(timings[i], pExp[i]);
+}
+
+static void Test_Timings(void) {
+	const Pl_SdEmmcTiming_t all[]	 = {PL_SD_EMMC_TIMING_DDR52, PL_SD_EMMC_TIMING_HS,
+										PL_SD_EMMC_TIMING_LEGACY};
+	const Pl_SdEmmcTiming_t hs[]	 = {PL_SD_EMMC_TIMING_HS, PL_SD_EMMC_TIMING_LEGACY};
+	const Pl_SdEmmcTiming_t legacy[] = {PL_SD_EMMC_TIMING_LEGACY};
+
+	Test_CheckTimings(&Test_CardDdr, 8, all, NUM_ELEMENTS(all));
+	Test_CheckTimings(&Test_CardDdr, 4, all, NUM_ELEMENTS(all));
+	// DDR52 needs a 4/8-bit bus
+	Test_CheckTimings(&Test_CardDdr, 1, hs, NUM_ELEMENTS(hs));
+	// the bus runs at 3.3V
+	Test_CheckTimings(&Test_CardDdr12V, 8, hs, NUM_ELEMENTS(hs));
+	Test_CheckTimings(&Test_CardHs, 8, hs, NUM_ELEMENTS(hs));
+	Test_CheckTimings(&Test_CardLegacy, 8, legacy, NUM_ELEMENTS(legacy));
+	Test_CheckTimings(&Test_CardLegacy, 1, legacy, NUM_ELEMENTS(legacy));
+}
+
+/* the modes MMC_Emmc_StepDownBus() goes through, when no switch works */
+static void Test_CheckSteps(const TestCard_t* pCard, MMC_BusMode_t mode, const MMC_BusMode_t* pExp,
+							u32 expNum) {
+	const u8* pExtCsd = Test_Dump(pCard, 0);
+	u32 num			  = 0;
+
+	while (MMC_Bus_NextMode(pExtCsd, &mode)) {
+		if (num < expNum) {
+			CHECK_EQ(mode.BusWidth, pExp[num].BusWidth);
+			CHECK_EQ(mode.Timing, pExp[num].Timing);
+		}
+		num++;
+	}
+
+	CHECK_EQ(num, expNum);
+	CHECK_EQ(mode.BusWidth, 1);
+	CHECK_EQ(mode.Timing, PL_SD_EMMC_TIMING_LEGACY);
+}
+
+static void Test_StepDown(void) {
+	const MMC_BusMode_t ddr[] = {
+		{8, PL_SD_EMMC_TIMING_HS},
+		{8, PL_SD_EMMC_TIMING_LEGACY},
+		{4, PL_SD_EMMC_TIMING_LEGACY},
+		{1, PL_SD_EMMC_TIMING_LEGACY},
+	};
+	const MMC_BusMode_t hs[] = {
+		{4, PL_SD_EMMC_TIMING_LEGACY},
+		{1, PL_SD_EMMC_TIMING_LEGACY},
+	};
+	const MMC_BusMode_t legacy[] = {
+		{4, PL_SD_EMMC_TIMING_LEGACY},
+		{1, PL_SD_EMMC_TIMING_LEGACY},
+	};
+
+	Test_CheckSteps(&Test_CardDdr, (MMC_BusMode_t){8, PL_SD_EMMC_TIMING_DDR52}, ddr,
+					NUM_ELEMENTS(ddr));
+	// the timing steps down before the width, and the width at legacy only
+	Test_CheckSteps(&Test_CardHs, (MMC_BusMode_t){4, PL_SD_EMMC_TIMING_HS}, hs, NUM_ELEMENTS(hs));
+	// the width probe of the init goes the same way
+	Test_CheckSteps(&Test_CardLegacy, (MMC_BusMode_t){MMC_BUS_WIDTH_MAX, PL_SD_EMMC_TIMING_LEGACY},
+					legacy, NUM_ELEMENTS(legacy));
+
+	MMC_BusMode_t mode = {1, PL_SD_EMMC_TIMING_LEGACY};
+	CHECK(!MMC_Bus_NextMode(Test_Dump(&Test_CardDdr, 0), &mode));
+}
+
+static void Test_TimingSet(void) {
+	CHECK(MMC_Bus_IsTimingSet(Test_Dump(&Test_CardDdr, 0), PL_SD_EMMC_TIMING_LEGACY));
+	CHECK(!MMC_Bus_IsTimingSet(Test_Dump(&Test_CardDdr, 0), PL_SD_EMMC_TIMING_HS));
+	CHECK(MMC_Bus_IsTimingSet(Test_Dump(&Test_CardDdr, 1), PL_SD_EMMC_TIMING_HS));
+	// DDR52 is HS timing with the DDR bus width
+	CHECK(MMC_Bus_IsTimingSet(Test_Dump(&Test_CardDdr, 1), PL_SD_EMMC_TIMING_DDR52));
+	CHECK(!MMC_Bus_IsTimingSet(Test_Dump(&Test_CardDdr, 1), PL_SD_EMMC_TIMING_LEGACY));
+	// the driver strength in the upper half doesn't count
+	CHECK(MMC_Bus_IsTimingSet(Test_Dump(&Test_CardDdr, 0x11), PL_SD_EMMC_TIMING_HS));
+	// a card left in HS200 is in none of the modes used here
+	CHECK(!MMC_Bus_IsTimingSet(Test_Dump(&Test_CardDdr, 2), PL_SD_EMMC_TIMING_HS));
+	CHECK(!MMC_Bus_IsTimingSet(Test_Dump(&Test_CardDdr, 2), PL_SD_EMMC_TIMING_LEGACY));
+}
+
+int main(void) {
+	HOST_TEST_RUN(Test_Timings);
+	HOST_TEST_RUN(Test_StepDown);
+	HOST_TEST_RUN(Test_TimingSet);
+
+	return HOST_TEST_RESULT();
+}
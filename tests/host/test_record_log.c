@@ -0,0 +1,386 @@
+#include "host_test.h"
+#include "record_log.h"
+
+#define TEST_DIR		  "0:/rlog"
+#define TEST_SEG_SIZE	  700
+#define TEST_BUFF_SIZE	  256
+#define TEST_REC_LEN_MAX  90
+#define TEST_BOOTS		  300
+#define TEST_BUDGET_MAX	  1500 // bytes written before the power goes
+#define FAKE_FILES_MAX	  512
+#define FAKE_FILE_SIZE	  1024
+#define TEST_RECS_MAX	  8192
+#define FAKE_SEG_HDR_SIZE 16 // RecLog_SegHdr_t
+
+/**
+ * RAM file system under the fs_wrapper API. Written bytes are on the media
+ * at once, the power goes at a byte offset of the write stream: that write
+ * stops there and every call fails until the next boot
+ */
+typedef struct {
+	char Path[RECLOG_PATH_LEN];
+	u8 Data[FAKE_FILE_SIZE];
+	u32 Size;
+	bool IsUsed;
+} FakeFile_t;
+
+typedef struct {
+	FakeFile_t* pNode;
+	u32 Pos;
+} FakeHandle_t;
+
+typedef struct {
+	FakeFile_t Files[FAKE_FILES_MAX];
+	u32 Handles; // open files and directories
+	u32 Budget;
+	bool IsPowerOff;
+} FakeFs_t;
+
+static FakeFs_t Fs;
+static u8 Buff[TEST_BUFF_SIZE];
+static u8 Gens[TEST_RECS_MAX]; // boot of each appended record, a stale one differs from it
+
+static FakeFile_t* FakeFs_Find(const char* pPath) {
+	for (u32 i = 0; i < FAKE_FILES_MAX; i++)
+		if (Fs.Files[i].IsUsed && strcmp(Fs.Files[i].Path, pPath) == 0)
+			return &Fs.Files[i];
+	return NULL;
+}
+
+static FakeHandle_t* FakeFs_Handle(FsWrap_File_t* pFile) {
+	return pFile->pFileHandler;
+}
+
+RET_STATE_t FsWrap_Open(FsWrap_File_t* pFile, const char* pPath, u32 flags) {
+	if (Fs.IsPowerOff)
+		return RET_STATE_ERROR;
+
+	FakeFile_t* pNode = FakeFs_Find(pPath);
+	if (pNode == NULL && (flags & FS_MODE_CREATE_ALWAYS)) {
+		for (u32 i = 0; i < FAKE_FILES_MAX && pNode == NULL; i++)
+			if (!Fs.Files[i].IsUsed)
+				pNode = &Fs.Files[i];
+		ASSERT_CHECK(pNode != NULL);
+		memset(pNode, 0, sizeof(FakeFile_t));
+		snprintf(pNode->Path, sizeof(pNode->Path), "%s", pPath);
+		pNode->IsUsed = true;
+	}
+	if (pNode == NULL)
+		return RET_STATE_ERR_EMPTY;
+
+	if (flags & FS_MODE_CREATE_ALWAYS)
+		pNode->Size = 0;
+
+	FakeHandle_t* pHandle = calloc(1, sizeof(FakeHandle_t));
+	pHandle->pNode		  = pNode;
+	pFile->pFileHandler	  = pHandle;
+	Fs.Handles++;
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Close(FsWrap_File_t* pFile) {
+	if (pFile->pFileHandler == NULL)
+		return RET_STATE_ERR_PARAM;
+
+	free(pFile->pFileHandler);
+	pFile->pFileHandler = NULL;
+	Fs.Handles--;
+	return Fs.IsPowerOff ? RET_STATE_ERROR : RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Read(FsWrap_File_t* pFile, void* pData, u32 size, u32* pBytesRd) {
+	if (Fs.IsPowerOff)
+		return RET_STATE_ERROR;
+
+	FakeHandle_t* pHandle = FakeFs_Handle(pFile);
+	FakeFile_t* pNode	  = pHandle->pNode;
+	u32 avail			  = pHandle->Pos < pNode->Size ? pNode->Size - pHandle->Pos : 0;
+	*pBytesRd			  = GET_MIN(size, avail);
+	memcpy(pData, &pNode->Data[pHandle->Pos], *pBytesRd);
+	pHandle->Pos += *pBytesRd;
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Write(FsWrap_File_t* pFile, const void* pData, u32 size, u32* pBytesWr) {
+	if (Fs.IsPowerOff)
+		return RET_STATE_ERROR;
+
+	FakeHandle_t* pHandle = FakeFs_Handle(pFile);
+	FakeFile_t* pNode	  = pHandle->pNode;
+	u32 len				  = GET_MIN(size, Fs.Budget);
+	ASSERT_CHECK(pHandle->Pos + size <= FAKE_FILE_SIZE);
+
+	memcpy(&pNode->Data[pHandle->Pos], pData, len);
+	pHandle->Pos += len;
+	pNode->Size = GET_MAX(pNode->Size, pHandle->Pos);
+	Fs.Budget -= len;
+	*pBytesWr = len;
+
+	// the sync after the last whole write is lost too
+	if (Fs.Budget == 0) {
+		Fs.IsPowerOff = true;
+		return RET_STATE_ERROR;
+	}
+
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Seek(FsWrap_File_t* pFile, s32 offset, FS_SEEK_t whence) {
+	if (Fs.IsPowerOff)
+		return RET_STATE_ERROR;
+
+	ASSERT_CHECK(whence == FS_SEEK_START);
+	FakeFs_Handle(pFile)->Pos = (u32)offset;
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Sync(FsWrap_File_t* pFile) {
+	return Fs.IsPowerOff ? RET_STATE_ERROR : RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Size(FsWrap_File_t* pFile, u32* pSize) {
+	if (Fs.IsPowerOff)
+		return RET_STATE_ERROR;
+
+	*pSize = FakeFs_Handle(pFile)->pNode->Size;
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Truncate(FsWrap_File_t* pFile, u32 length) {
+	if (Fs.IsPowerOff)
+		return RET_STATE_ERROR;
+
+	FakeFile_t* pNode = FakeFs_Handle(pFile)->pNode;
+	pNode->Size		  = GET_MIN(pNode->Size, length);
+	return RET_STATE_SUCCESS;
+}
+
+/* the reserved clusters hold whatever was there before */
+RET_STATE_t FsWrap_Preallocate(FsWrap_File_t* pFile, u32 bytesNum, bool isContiguous) {
+	if (Fs.IsPowerOff)
+		return RET_STATE_ERROR;
+
+	FakeFile_t* pNode = FakeFs_Handle(pFile)->pNode;
+	ASSERT_CHECK(bytesNum <= FAKE_FILE_SIZE);
+	for (; pNode->Size < bytesNum; pNode->Size++)
+		pNode->Data[pNode->Size] = (u8)rand();
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Unlink(const char* pPath) {
+	if (Fs.IsPowerOff)
+		return RET_STATE_ERROR;
+
+	FakeFile_t* pNode = FakeFs_Find(pPath);
+	if (pNode == NULL)
+		return RET_STATE_ERR_EMPTY;
+
+	pNode->IsUsed = false;
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Mkdir(const char* pPath) {
+	return Fs.IsPowerOff ? RET_STATE_ERROR : RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_OpenDir(FsWrap_Dir_t* pDir, const char* pPath) {
+	if (Fs.IsPowerOff)
+		return RET_STATE_ERROR;
+
+	ASSERT_CHECK(strcmp(pPath, TEST_DIR) == 0);
+	pDir->pDirHandler = calloc(1, sizeof(u32));
+	Fs.Handles++;
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_ReadDir(FsWrap_Dir_t* pDir, FsWrap_DirEnt_t* pEntry) {
+	if (Fs.IsPowerOff)
+		return RET_STATE_ERROR;
+
+	u32* pIdx		= pDir->pDirHandler;
+	pEntry->Name[0] = 0;
+	for (; *pIdx < FAKE_FILES_MAX; (*pIdx)++) {
+		FakeFile_t* pNode = &Fs.Files[*pIdx];
+		if (pNode->IsUsed) {
+			pEntry->Type = FS_DIR_ENTRY_FILE;
+			pEntry->Size = pNode->Size;
+			snprintf(pEntry->Name, sizeof(pEntry->Name), "%s", pNode->Path + strlen(TEST_DIR "/"));
+			(*pIdx)++;
+			break;
+		}
+	}
+
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_CloseDir(FsWrap_Dir_t* pDir) {
+	free(pDir->pDirHandler);
+	Fs.Handles--;
+	return RET_STATE_SUCCESS;
+}
+
+static void FakeFs_Boot(u32 budget) {
+	Fs.IsPowerOff = false;
+	Fs.Budget	  = budget;
+}
+
+static void FakeFs_Format(void) {
+	memset(&Fs, 0, sizeof(Fs));
+	memset(Gens, 0, sizeof(Gens));
+	FakeFs_Boot(0xFFFFFFFF);
+}
+
+static const RecLog_Cfg_t TestCfg = {
+	.pDir		   = TEST_DIR,
+	.SegmentSize   = TEST_SEG_SIZE,
+	.SegmentsMax   = 0,
+	.CommitLatency = 0,
+	.pBuff		   = Buff,
+	.BuffSize	   = TEST_BUFF_SIZE,
+};
+
+static u32 Record_Len(u32 seq) {
+	return 1 + (seq * 37 + Gens[seq] * 11) % TEST_REC_LEN_MAX;
+}
+
+static u8 Record_Byte(u32 seq, u32 idx) {
+	return (u8)(seq * 7 + Gens[seq] * 3 + idx);
+}
+
+static RET_STATE_t Record_Append(RecLog_t* pLog, u32 seq) {
+	u8 rec[TEST_REC_LEN_MAX];
+	ASSERT_CHECK(seq < TEST_RECS_MAX);
+	for (u32 i = 0; i < Record_Len(seq); i++)
+		rec[i] = Record_Byte(seq, i);
+	return RecLog_Append(pLog, rec, Record_Len(seq));
+}
+
+typedef struct {
+	u32 Records;
+	u32 Errors;
+} TestReplay_t;
+
+static bool Test_ReplayClbk(u32 seq, const u8* pData, u32 size, void* pCtx) {
+	TestReplay_t* pReplay = pCtx;
+	bool isOk			  = seq == pReplay->Records && size == Record_Len(seq);
+	for (u32 i = 0; i < size && isOk; i++)
+		isOk = pData[i] == Record_Byte(seq, i);
+
+	pReplay->Errors += !isOk;
+	pReplay->Records++;
+	return isOk;
+}
+
+/* all the records on the media, they must run from sequence number 0 without a gap */
+static u32 Test_Replay(RecLog_t* pLog) {
+	TestReplay_t replay = {0};
+	CHECK_EQ(RecLog_Replay(pLog, Test_ReplayClbk, &replay), RET_STATE_SUCCESS);
+	CHECK_EQ(replay.Errors, 0);
+	return replay.Records;
+}
+
+static void Test_Plain(void) {
+	FakeFs_Format();
+	RecLog_t log;
+
+	CHECK_EQ(RecLog_Open(&log, &TestCfg), RET_STATE_SUCCESS);
+	for (u32 seq = 0; seq < 50; seq++)
+		CHECK_EQ(Record_Append(&log, seq), RET_STATE_SUCCESS);
+	CHECK_EQ(Test_Replay(&log), 50);
+	CHECK(RecLog_GetStats(&log).Segments > 1);
+	CHECK_EQ(RecLog_Close(&log), RET_STATE_SUCCESS);
+
+	// reopened, the log goes on after the last record
+	CHECK_EQ(RecLog_Open(&log, &TestCfg), RET_STATE_SUCCESS);
+	CHECK(RecLog_GetStats(&log).Recovered > 0);
+	CHECK_EQ(Record_Append(&log, 50), RET_STATE_SUCCESS);
+	CHECK_EQ(Test_Replay(&log), 51);
+	CHECK_EQ(RecLog_Close(&log), RET_STATE_SUCCESS);
+	CHECK_EQ(Fs.Handles, 0);
+}
+
+static void Test_TornSegHdr(void) {
+	FakeFs_Format();
+	RecLog_t log;
+	CHECK_EQ(RecLog_Open(&log, &TestCfg), RET_STATE_SUCCESS);
+
+	// committed one by one up to the segment end
+	u32 seq = 0;
+	while (log.SegPos + 12 + Record_Len(seq) <= TEST_SEG_SIZE) {
+		CHECK_EQ(Record_Append(&log, seq++), RET_STATE_SUCCESS);
+		CHECK_EQ(RecLog_Commit(&log), RET_STATE_SUCCESS);
+	}
+
+	// the next record starts a segment, the power goes inside its header
+	FakeFs_Boot(FAKE_SEG_HDR_SIZE / 2);
+	CHECK(Record_Append(&log, seq) != RET_STATE_SUCCESS);
+	RecLog_Close(&log);
+
+	// the rest of the header is what the reserved space held before
+	CHECK(Fs.IsPowerOff);
+	CHECK(FakeFs_Find(TEST_DIR "/00000001.rlg") != NULL);
+
+	// the segment is made again and continues the sequence of the previous one
+	FakeFs_Boot(0xFFFFFFFF);
+	CHECK_EQ(RecLog_Open(&log, &TestCfg), RET_STATE_SUCCESS);
+	CHECK_EQ(RecLog_GetStats(&log).Segments, 1);
+	CHECK_EQ(RecLog_GetStats(&log).Recovered, 0);
+	CHECK_EQ(log.SegLast, 1);
+	CHECK_EQ(log.NextSeq, seq);
+	CHECK_EQ(Test_Replay(&log), seq);
+
+	CHECK_EQ(Record_Append(&log, seq), RET_STATE_SUCCESS);
+	CHECK_EQ(Test_Replay(&log), seq + 1);
+	CHECK_EQ(RecLog_Close(&log), RET_STATE_SUCCESS);
+	CHECK_EQ(Fs.Handles, 0);
+}
+
+static void Test_PowerLoss(void) {
+	FakeFs_Format();
+	srand(1);
+
+	u32 appended = 0; // records handed to the log, the ones after a failure are not
+	u32 committed = 0;
+	u32 opened	  = 0;
+
+	for (u32 boot = 0; boot < TEST_BOOTS; boot++) {
+		FakeFs_Boot(1 + (u32)rand() % TEST_BUDGET_MAX);
+		RecLog_t log;
+		if (RecLog_Open(&log, &TestCfg) != RET_STATE_SUCCESS) {
+			CHECK(Fs.IsPowerOff);
+			continue;
+		}
+		opened++;
+
+		// nothing committed is lost, nothing past the appended records shows up
+		u32 kept = Test_Replay(&log);
+		CHECK(kept >= committed);
+		CHECK(kept <= appended);
+		appended  = kept;
+		committed = kept;
+
+		while (!Fs.IsPowerOff) {
+			Gens[appended] = (u8)boot;
+			if (Record_Append(&log, appended) != RET_STATE_SUCCESS)
+				break;
+			appended++;
+
+			if (rand() % 4 == 0 && RecLog_Commit(&log) == RET_STATE_SUCCESS)
+				committed = appended;
+		}
+
+		RecLog_Close(&log);
+		CHECK_EQ(Fs.Handles, 0);
+	}
+
+	CHECK(opened > TEST_BOOTS / 2);
+	CHECK(committed > 1000);
+}
+
+int main(void) {
+	HOST_TEST_RUN(Test_Plain);
+	HOST_TEST_RUN(Test_TornSegHdr);
+	HOST_TEST_RUN(Test_PowerLoss);
+
+	return HOST_TEST_RESULT();
+}
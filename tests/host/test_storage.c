@@ -0,0 +1,423 @@
+#include "delay.h"
+#include "fs_async.h"
+#include "fs_wrapper.h"
+#include "host_test.h"
+#include "io_msc.h"
+#include "record_log.h"
+#include "storage.h"
+#include "storage_cache.h"
+#include "storage_cfg.h"
+#include "storage_ram.h"
+
+#define TEST_BLOCKS 256
+#define TEST_SECTOR PL_SDMMC_SECTOR_SIZE
+#define TEST_BUFF	(32 * TEST_SECTOR)
+
+typedef enum {
+	FAKE_DMA_DONE = 0,
+	FAKE_DMA_ERROR,
+	FAKE_DMA_HANG, // no IRQ, the test completes it or the driver aborts it
+	FAKE_DMA_START_FAIL,
+} FakeDma_Mode_t;
+
+/* SDMMC1 with its IDMA: a transfer completes through the callback the driver registered */
+typedef struct {
+	u8 Disk[TEST_BLOCKS * TEST_SECTOR];
+	Pl_Emmc_XferClbk_t pXferClbk;
+	FakeDma_Mode_t Mode;
+	bool IsBusy;
+	bool IsWrite;
+	u8* pBuff;
+	u32 BlockIdx;
+	u32 BlockNum;
+	u32 Starts;
+	u32 Aborts;
+	u32 ChunkNums[8];
+	const u8* pCleaned; // the last range written back from the cache
+	u32 CleanedLen;
+	const u8* pStale; // the last range read by DMA under the cache, until invalidated
+	u32 StaleLen;
+} FakeDev_t;
+
+static FakeDev_t Fake;
+
+/* AXI SRAM, reachable by IDMA, and DTCM, which is not */
+static u8 DmaRam[TEST_BUFF] __attribute__((aligned(PL_DCACHE_LINE_SIZE)));
+static u8 Dtcm[TEST_BUFF] __attribute__((aligned(PL_DCACHE_LINE_SIZE)));
+
+static bool FakeDev_IsIn(const u8* pRange, u32 rangeLen, const void* pBuff, u32 len) {
+	return (const u8*)pBuff >= pRange && (const u8*)pBuff + len <= pRange + rangeLen;
+}
+
+bool Pl_Emmc_IsDmaBuff(const void* pBuff, u32 len) {
+	return (uintptr_t)pBuff % PL_DCACHE_LINE_SIZE == 0 && len % PL_DCACHE_LINE_SIZE == 0 &&
+		   !FakeDev_IsIn(Dtcm, sizeof(Dtcm), pBuff, len);
+}
+
+void Pl_DCache_Clean(const void* pBuff, u32 len) {
+	Fake.pCleaned	= pBuff;
+	Fake.CleanedLen = len;
+}
+
+void Pl_DCache_Invalidate(void* pBuff, u32 len) {
+	if (Fake.pStale && FakeDev_IsIn(pBuff, len, Fake.pStale, Fake.StaleLen))
+		Fake.pStale = NULL;
+}
+
+static void FakeDma_Complete(bool isOk) {
+	u32 len = Fake.BlockNum * TEST_SECTOR;
+	u8* pDisk = &Fake.Disk[Fake.BlockIdx * TEST_SECTOR];
+
+	if (isOk && Fake.IsBusy) {
+		if (Fake.IsWrite) {
+			memcpy(pDisk, Fake.pBuff, len);
+		} else {
+			memcpy(Fake.pBuff, pDisk, len);
+			Fake.pStale	  = Fake.pBuff;
+			Fake.StaleLen = len;
+		}
+	}
+
+	Fake.IsBusy = false;
+	Fake.pXferClbk(isOk);
+}
+
+static bool FakeDma_Start(u8* pData, u32 blockIdx, u32 blockNum, bool isWrite) {
+	u32 len = blockNum * TEST_SECTOR;
+
+	// one transfer at a time, from memory the IDMA reaches, with no dirty lines over it
+	CHECK(!Fake.IsBusy);
+	CHECK(blockIdx + blockNum <= TEST_BLOCKS);
+	CHECK(Pl_Emmc_IsDmaBuff(pData, len));
+	CHECK(Fake.pStale == NULL);
+	if (isWrite)
+		CHECK(FakeDev_IsIn(Fake.pCleaned, Fake.CleanedLen, pData, len));
+
+	if (Fake.Mode == FAKE_DMA_START_FAIL)
+		return false;
+
+	if (Fake.Starts < NUM_ELEMENTS(Fake.ChunkNums))
+		Fake.ChunkNums[Fake.Starts] = blockNum;
+	Fake.Starts++;
+	Fake.IsBusy	  = true;
+	Fake.IsWrite  = isWrite;
+	Fake.pBuff	  = pData;
+	Fake.BlockIdx = blockIdx;
+	Fake.BlockNum = blockNum;
+
+	if (Fake.Mode != FAKE_DMA_HANG)
+		FakeDma_Complete(Fake.Mode == FAKE_DMA_DONE);
+	return true;
+}
+
+bool Pl_Emmc_Init(Pl_SdEmmcInfo_t* pSdEmmcInfo, Pl_Emmc_XferClbk_t pXferClbk) {
+	Fake.pXferClbk			  = pXferClbk;
+	pSdEmmcInfo->LogBlockNbr  = TEST_BLOCKS;
+	pSdEmmcInfo->LogBlockSize = TEST_SECTOR;
+	return true;
+}
+
+bool Pl_Emmc_ReadDMA(u8* pData, u32 blockIdx, u32 blockNum) {
+	return FakeDma_Start(pData, blockIdx, blockNum, false);
+}
+
+bool Pl_Emmc_WriteDMA(const u8* pData, u32 blockIdx, u32 blockNum) {
+	return FakeDma_Start((u8*)pData, blockIdx, blockNum, true);
+}
+
+void Pl_Emmc_AbortDMA(void) {
+	Fake.IsBusy = false;
+	Fake.Aborts++;
+}
+
+/* the scheduler runs in the tests, polling is not used */
+bool Pl_Emmc_Read(u8* pData, u32 blockIdx, u32 blockNum) {
+	CHECK(false);
+	return false;
+}
+
+bool Pl_Emmc_Write(const u8* pData, u32 blockIdx, u32 blockNum) {
+	CHECK(false);
+	return false;
+}
+
+bool Pl_Emmc_GetDeviceInfo(Pl_SdEmmcInfo_t* pSdEmmcInfo) {
+	return true;
+}
+
+bool Pl_Emmc_Discard(u32 startBlock, u32 endBlock) {
+	return true;
+}
+
+bool Pl_Emmc_IsCrcError(void) {
+	return false;
+}
+
+bool Pl_Emmc_BusFallback(Pl_SdEmmcInfo_t* pSdEmmcInfo) {
+	return false;
+}
+
+u32 Pl_Emmc_GetCardState(void) {
+	return 4; // transfer
+}
+
+bool Pl_Emmc_IsCardInTransfer(void) {
+	return true;
+}
+
+/* the rest of the storage layer, Storage_Init() finds no file systems */
+RET_STATE_t FsWrap_Init(void) {
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Mount(FsWrap_Mount_t* pMntPoint) {
+	return RET_STATE_ERROR;
+}
+
+RET_STATE_t FsWrap_Unmount(FsWrap_Mount_t* pMntPoint) {
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_SetLabel(const char* pLabel) {
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_GetLabel(const char* pPath, char* pLabel, u32* pVsn) {
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Lock(const char* pPath) {
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Unlock(const char* pPath) {
+	return RET_STATE_SUCCESS;
+}
+
+bool StorageRam_Init(u32 capacity) {
+	return false;
+}
+
+const char* StorageRam_GetRegionStr(void) {
+	return "";
+}
+
+u32 StorageRam_GetCapacity(void) {
+	return 0;
+}
+
+u32 StorageRam_GetCapacityMax(void) {
+	return 0;
+}
+
+u32 StorageRam_GetOpsLastTime(void) {
+	return 0;
+}
+
+bool StorageRam_SnapshotSave(const char* pPath) {
+	return false;
+}
+
+bool StorageRam_SnapshotLoad(const char* pPath) {
+	return false;
+}
+
+StorageRam_Stats_t StorageRam_GetStats(void) {
+	return (StorageRam_Stats_t){0};
+}
+
+void StorageCache_Init(u32 blockCnt) {
+}
+
+bool StorageCache_Flush(void) {
+	return true;
+}
+
+void FreeRTOS_StorageCache_InitComponents(bool resources, bool tasks) {
+}
+
+void FreeRTOS_FsAsync_InitComponents(bool resources, bool tasks) {
+}
+
+void FreeRTOS_RecLog_InitComponents(bool resources, bool tasks) {
+}
+
+void FreeRTOS_IoMsc_InitComponents(bool resources, bool tasks) {
+}
+
+void Delay_WaitTime_MilliSec(u32 ms) {
+}
+
+void Delay_WaitTime_MicroSec(u64 us) {
+}
+
+static void FakeDev_Reset(void) {
+	Pl_Emmc_XferClbk_t pXferClbk = Fake.pXferClbk;
+
+	memset(&Fake, 0, sizeof(Fake));
+	Fake.pXferClbk = pXferClbk;
+	for (u32 i = 0; i < sizeof(Fake.Disk); i++)
+		Fake.Disk[i] = (u8)(i / TEST_SECTOR + i * 7);
+}
+
+static void Test_Fill(u8* pBuff, u32 len, u8 seed) {
+	for (u32 i = 0; i < len; i++)
+		pBuff[i] = (u8)(seed + i * 13);
+}
+
+static bool Test_IsOnDisk(const u8* pData, u32 blockIdx, u32 blockNum) {
+	return memcmp(&Fake.Disk[blockIdx * TEST_SECTOR], pData, blockNum * TEST_SECTOR) == 0;
+}
+
+static u32 Test_NotifyPending(void) {
+	return xTaskGetCurrentTaskHandle()->Notify[STORAGE_EMMC_XFER_NOTIFY_IDX];
+}
+
+static void Test_Aligned(void) {
+	FakeDev_Reset();
+	Storage_XferStats_t stats = Storage_Emmc_GetXferStats();
+
+	// the IDMA works on the buffer of the caller, one transfer each way
+	Test_Fill(DmaRam, 4 * TEST_SECTOR, 0x10);
+	CHECK(Storage_Emmc_Write(DmaRam, 10, 4));
+	CHECK_EQ(Fake.Starts, 1);
+	CHECK(Fake.pBuff == DmaRam);
+	CHECK(Test_IsOnDisk(DmaRam, 10, 4));
+
+	u8* pRead = &DmaRam[8 * TEST_SECTOR];
+	CHECK(Storage_Emmc_Read(pRead, 10, 4));
+	CHECK_EQ(Fake.Starts, 2);
+	CHECK(Fake.pBuff == pRead);
+	CHECK(Fake.pStale == NULL);
+	CHECK(memcmp(pRead, DmaRam, 4 * TEST_SECTOR) == 0);
+
+	Storage_XferStats_t now = Storage_Emmc_GetXferStats();
+	CHECK_EQ(now.DmaXfers - stats.DmaXfers, 2);
+	CHECK_EQ(now.BounceXfers, stats.BounceXfers);
+	CHECK_EQ(now.PollXfers, stats.PollXfers);
+	CHECK_EQ(now.Errors, stats.Errors);
+}
+
+static void Test_Bounce(void) {
+	FakeDev_Reset();
+	Storage_XferStats_t stats = Storage_Emmc_GetXferStats();
+	u32 blockNum			  = 2 * STORAGE_EMMC_DMA_BUFF_BLOCKS + 4;
+
+	// DTCM goes through the bounce buffer in chunks of its size
+	Test_Fill(Dtcm, blockNum * TEST_SECTOR, 0x20);
+	CHECK(Storage_Emmc_Write(Dtcm, 40, blockNum));
+	CHECK_EQ(Fake.Starts, 3);
+	CHECK_EQ(Fake.ChunkNums[0], STORAGE_EMMC_DMA_BUFF_BLOCKS);
+	CHECK_EQ(Fake.ChunkNums[1], STORAGE_EMMC_DMA_BUFF_BLOCKS);
+	CHECK_EQ(Fake.ChunkNums[2], 4);
+	CHECK(Test_IsOnDisk(Dtcm, 40, blockNum));
+
+	// so does a buffer off a cache line, the data lands at its place
+	u8* pRead = &DmaRam[1];
+	memset(DmaRam, 0, sizeof(DmaRam));
+	CHECK(Storage_Emmc_Read(pRead, 40, blockNum));
+	CHECK_EQ(Fake.Starts, 6);
+	CHECK(Fake.pStale == NULL);
+	CHECK(memcmp(pRead, Dtcm, blockNum * TEST_SECTOR) == 0);
+	CHECK_EQ(DmaRam[0], 0);
+	CHECK_EQ(pRead[blockNum * TEST_SECTOR], 0);
+
+	Storage_XferStats_t now = Storage_Emmc_GetXferStats();
+	CHECK_EQ(now.BounceXfers - stats.BounceXfers, 6);
+	CHECK_EQ(now.DmaXfers, stats.DmaXfers);
+}
+
+static void Test_Timeout(void) {
+	FakeDev_Reset();
+	Storage_XferStats_t stats = Storage_Emmc_GetXferStats();
+
+	// no IRQ comes, the transfer is aborted and counted as a timeout only
+	Fake.Mode = FAKE_DMA_HANG;
+	Test_Fill(DmaRam, 2 * TEST_SECTOR, 0x30);
+	CHECK(!Storage_Emmc_Write(DmaRam, 20, 2));
+	CHECK_EQ(Fake.Aborts, 1);
+	CHECK(!Fake.IsBusy);
+
+	Storage_XferStats_t now = Storage_Emmc_GetXferStats();
+	CHECK_EQ(now.Timeouts - stats.Timeouts, 1);
+	CHECK_EQ(now.Errors, stats.Errors);
+
+	// the IRQ coming after the abort is ignored
+	Fake.IsBusy = true;
+	FakeDma_Complete(true);
+	CHECK_EQ(Test_NotifyPending(), 0);
+
+	// a bounced transfer stops at the chunk which timed out
+	CHECK(!Storage_Emmc_Write(Dtcm, 40, 2 * STORAGE_EMMC_DMA_BUFF_BLOCKS));
+	CHECK_EQ(Fake.Starts, 2);
+	CHECK_EQ(Fake.Aborts, 2);
+
+	// a notification left over by a late IRQ does not complete the next transfer
+	xTaskNotifyGiveIndexed(xTaskGetCurrentTaskHandle(), STORAGE_EMMC_XFER_NOTIFY_IDX);
+	CHECK(!Storage_Emmc_Read(DmaRam, 20, 2));
+	CHECK_EQ(Fake.Aborts, 3);
+
+	now = Storage_Emmc_GetXferStats();
+	CHECK_EQ(now.Timeouts - stats.Timeouts, 3);
+	CHECK_EQ(now.Errors, stats.Errors);
+
+	// and the card is usable again
+	Fake.Mode = FAKE_DMA_DONE;
+	CHECK(Storage_Emmc_Write(DmaRam, 20, 2));
+	CHECK(Test_IsOnDisk(DmaRam, 20, 2));
+}
+
+static void Test_Error(void) {
+	FakeDev_Reset();
+	Storage_XferStats_t stats = Storage_Emmc_GetXferStats();
+
+	Fake.Mode = FAKE_DMA_ERROR;
+	CHECK(!Storage_Emmc_Read(DmaRam, 30, 2));
+	Fake.Mode = FAKE_DMA_START_FAIL;
+	CHECK(!Storage_Emmc_Read(Dtcm, 30, 2));
+	CHECK_EQ(Fake.Aborts, 0);
+
+	Storage_XferStats_t now = Storage_Emmc_GetXferStats();
+	CHECK_EQ(now.Errors - stats.Errors, 2);
+	CHECK_EQ(now.Timeouts, stats.Timeouts);
+}
+
+static void Test_Async(void) {
+	FakeDev_Reset();
+	bool isOk = false;
+
+	// only a DMA-capable buffer can be started without a bounce
+	CHECK(!Storage_Emmc_XferStart(Dtcm, 50, 2, false));
+	CHECK(!Storage_Emmc_XferStart(&DmaRam[1], 50, 2, false));
+	CHECK_EQ(Fake.Starts, 0);
+
+	Fake.Mode = FAKE_DMA_HANG;
+	CHECK(Storage_Emmc_XferStart(DmaRam, 50, 2, false));
+	CHECK(!Storage_Emmc_XferWait(&isOk, 5));
+	FakeDma_Complete(true);
+	CHECK(Storage_Emmc_XferWait(&isOk, 5));
+	CHECK(isOk);
+	CHECK(Fake.pStale == NULL);
+	CHECK(Test_IsOnDisk(DmaRam, 50, 2));
+
+	// an aborted transfer gives the card back
+	CHECK(Storage_Emmc_XferStart(DmaRam, 50, 2, true));
+	Storage_Emmc_XferAbort();
+	CHECK_EQ(Fake.Aborts, 1);
+	Fake.Mode = FAKE_DMA_DONE;
+	CHECK(Storage_Emmc_Read(DmaRam, 50, 2));
+}
+
+int main(void) {
+	FreeRTOS_Storage_InitComponents(true, false);
+	Storage_Init();
+	CHECK(Storage_EmmcHw_IsInit());
+
+	HOST_TEST_RUN(Test_Aligned);
+	HOST_TEST_RUN(Test_Bounce);
+	HOST_TEST_RUN(Test_Timeout);
+	HOST_TEST_RUN(Test_Error);
+	HOST_TEST_RUN(Test_Async);
+
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,183 @@
+#include <pthread.h>
+
+#include "fs_host.h"
+#include "host_test.h"
+#include "mem_wrapper.h"
+#include "storage_bench.h"
+#include "storage_cfg.h"
+
+/* the worker task body is static, the module is built into the test */
+#include "fs_async.c"
+
+#define TEST_CAPACITY STORAGE_RAM_HEAP_SIZE
+#define TEST_DRIVE	  FS_HOST_RAM_PATH
+#define TEST_PATH	  TEST_DRIVE STORAGE_BENCH_FILE_NAME
+#define TEST_BLOCK	  DATA_1_KBYTE
+#define TEST_SIZE	  (64 * DATA_1_KBYTE)
+#define TEST_BLOCKS	  (TEST_SIZE / TEST_BLOCK)
+#define TEST_SYNC	  4
+#define TEST_QD		  4
+
+static u32 Test_HistOps(const StorageBench_Stat_t* pStat) {
+	u32 ops = 0;
+	for (u32 i = 0; i < STORAGE_BENCH_HIST_SIZE; i++)
+		ops += pStat->Hist[i];
+	return ops;
+}
+
+/* the counts of a phase add up, the percentiles are in order */
+static void Test_CheckStat(const StorageBench_Stat_t* pStat, u32 ops) {
+	CHECK_EQ(pStat->Ops, ops);
+	CHECK_EQ(pStat->Errors, 0);
+	CHECK_EQ(pStat->Bytes, ops * TEST_BLOCK);
+	CHECK_EQ(Test_HistOps(pStat), ops);
+
+	u32 p50 = StorageBench_GetPercentile(pStat, 50);
+	u32 p99 = StorageBench_GetPercentile(pStat, 99);
+	CHECK(p50 <= p99 && p99 <= pStat->LatMaxUs);
+	CHECK_EQ(StorageBench_GetPercentile(pStat, 100), pStat->LatMaxUs);
+}
+
+static void Test_Print(const char* pName, const StorageBench_Cfg_t* pCfg,
+					   const StorageBench_Result_t* pRes) {
+	const StorageBench_Stat_t* pStats[] = {&pRes->Write, &pRes->Read};
+	const char* pOps[]					= {"write", "read"};
+
+	for (u32 i = 0; i < NUM_ELEMENTS(pStats); i++) {
+		if (pStats[i]->Ops == 0)
+			continue;
+
+		printf("  %s %s qd %u: %u %s %.1f MB/s p50 %u us p99 %u us max %u us\n", pName,
+			   StorageBench_GetPatternStr(pCfg->Pattern), pCfg->QueueDepth, pStats[i]->Ops,
+			   pOps[i], StorageBench_GetSpeed(pStats[i]), StorageBench_GetPercentile(pStats[i], 50),
+			   StorageBench_GetPercentile(pStats[i], 99), pStats[i]->LatMaxUs);
+	}
+}
+
+/* one run on the RAM drive, the file is gone after it and the heap as it was */
+static RET_STATE_t Test_Run(const char* pName, const StorageBench_Cfg_t* pCfg,
+							StorageBench_Result_t* pRes) {
+	FsWrap_DirEnt_t entry;
+	u32 heapFrom = MemWrap_GetFreeHeapSize();
+
+	RET_STATE_t res = StorageBench_Run(TEST_DRIVE, pCfg, pRes);
+	if (res == RET_STATE_SUCCESS)
+		Test_Print(pName, pCfg, pRes);
+
+	CHECK(FsWrap_Stat(TEST_PATH, &entry) != RET_STATE_SUCCESS);
+	CHECK_EQ(MemWrap_GetFreeHeapSize(), heapFrom);
+	return res;
+}
+
+static void Test_WriteRead(void) {
+	StorageBench_Cfg_t cfg	  = STORAGE_BENCH_CFG_DEF;
+	StorageBench_Result_t res = {0};
+
+	// the default is the old fs -t: 2 KiB blocks over 80 KiB
+	CHECK(Test_Run("write-read", &cfg, &res) == RET_STATE_SUCCESS);
+	CHECK_EQ(res.Write.Ops, cfg.FileSize / cfg.BlockSize);
+	CHECK_EQ(res.Read.Ops, res.Write.Ops);
+	CHECK_EQ(res.Syncs, 1);
+
+	cfg.BlockSize = TEST_BLOCK;
+	cfg.FileSize  = TEST_SIZE;
+	CHECK(Test_Run("write-read", &cfg, &res) == RET_STATE_SUCCESS);
+	Test_CheckStat(&res.Write, TEST_BLOCKS);
+	Test_CheckStat(&res.Read, TEST_BLOCKS);
+	CHECK(StorageBench_GetSpeed(&res.Write) > 0.0f);
+}
+
+static void Test_Random(void) {
+	StorageBench_Cfg_t cfg	  = STORAGE_BENCH_CFG_DEF;
+	StorageBench_Result_t res = {0}, again = {0};
+
+	cfg.BlockSize = TEST_BLOCK;
+	cfg.FileSize  = TEST_SIZE;
+	cfg.Pattern	  = STORAGE_BENCH_PATTERN_RAND;
+	cfg.Op		  = STORAGE_BENCH_OP_READ;
+	CHECK(Test_Run("read", &cfg, &res) == RET_STATE_SUCCESS);
+	Test_CheckStat(&res.Read, TEST_BLOCKS);
+	CHECK_EQ(res.Write.Ops, 0);
+
+	// a mixed run syncs every TEST_SYNC writes and at the end, the mix is the same for a seed
+	cfg.Op		  = STORAGE_BENCH_OP_MIXED;
+	cfg.ReadPct	  = 30;
+	cfg.SyncEvery = TEST_SYNC;
+	CHECK(Test_Run("mixed", &cfg, &res) == RET_STATE_SUCCESS);
+	CHECK_EQ(res.Read.Ops + res.Write.Ops, TEST_BLOCKS);
+	CHECK(res.Read.Ops > TEST_BLOCKS / 5 && res.Read.Ops < TEST_BLOCKS * 2 / 5);
+	CHECK_EQ(res.Syncs, res.Write.Ops / TEST_SYNC + 1);
+	Test_CheckStat(&res.Write, res.Write.Ops);
+	Test_CheckStat(&res.Read, res.Read.Ops);
+
+	CHECK(StorageBench_Run(TEST_DRIVE, &cfg, &again) == RET_STATE_SUCCESS);
+	CHECK_EQ(again.Read.Ops, res.Read.Ops);
+	cfg.Seed++;
+	CHECK(StorageBench_Run(TEST_DRIVE, &cfg, &again) == RET_STATE_SUCCESS);
+	CHECK(again.Read.Ops != res.Read.Ops);
+}
+
+static void Test_Errors(void) {
+	StorageBench_Cfg_t cfg	  = STORAGE_BENCH_CFG_DEF;
+	StorageBench_Result_t res = {0};
+
+	cfg.QueueDepth = STORAGE_BENCH_QD_MAX + 1;
+	CHECK(Test_Run("bad", &cfg, &res) == RET_STATE_ERR_PARAM);
+	cfg			 = (StorageBench_Cfg_t)STORAGE_BENCH_CFG_DEF;
+	cfg.FileSize = cfg.BlockSize - 1;
+	CHECK(Test_Run("bad", &cfg, &res) == RET_STATE_ERR_PARAM);
+
+	// a file larger than the drive: the writes past the end are short, counted as errors
+	cfg			 = (StorageBench_Cfg_t)STORAGE_BENCH_CFG_DEF;
+	cfg.Op		 = STORAGE_BENCH_OP_WRITE;
+	cfg.FileSize = 2 * TEST_CAPACITY;
+	CHECK(Test_Run("full", &cfg, &res) == RET_STATE_ERROR);
+	CHECK(res.Write.Errors > 0);
+	CHECK_EQ(res.Write.Ops, cfg.FileSize / cfg.BlockSize);
+	CHECK(res.Write.Bytes < TEST_CAPACITY);
+}
+
+/* the fs-async task, a notification wait lets the test thread run */
+static void* Test_AsyncTask(void* pArg) {
+	vTask_FsAsync_Process(pArg);
+	return NULL;
+}
+
+/* last one: the worker never returns, it ends with the test */
+static void Test_QueueDepth(void) {
+	StorageBench_Cfg_t cfg	  = STORAGE_BENCH_CFG_DEF;
+	StorageBench_Result_t res = {0};
+	pthread_t task;
+
+	FsAsync_Handle = xTaskGetCurrentTaskHandle();
+	CHECK(pthread_create(&task, NULL, Test_AsyncTask, NULL) == 0);
+	CHECK(pthread_detach(task) == 0);
+
+	cfg.BlockSize  = TEST_BLOCK;
+	cfg.FileSize   = TEST_SIZE;
+	cfg.QueueDepth = TEST_QD;
+	cfg.SyncEvery  = TEST_SYNC;
+	CHECK(Test_Run("write-read", &cfg, &res) == RET_STATE_SUCCESS);
+	Test_CheckStat(&res.Write, TEST_BLOCKS);
+	Test_CheckStat(&res.Read, TEST_BLOCKS);
+
+	FsWrap_AsyncStats_t stats = FsWrap_AsyncGetStats();
+	CHECK_EQ(stats.Submitted, 2 * TEST_BLOCKS);
+	CHECK_EQ(stats.Rejected, 0);
+	CHECK(stats.DepthMax <= TEST_QD);
+	CHECK_EQ(FsWrap_AsyncGetFree(), FS_ASYNC_QUEUE_SIZE);
+}
+
+int main(void) {
+	if (!FsHost_Init(TEST_CAPACITY)) {
+		printf("RAM drive mount failed\n");
+		return EXIT_FAILURE;
+	}
+
+	HOST_TEST_RUN(Test_WriteRead);
+	HOST_TEST_RUN(Test_Random);
+	HOST_TEST_RUN(Test_Errors);
+	HOST_TEST_RUN(Test_QueueDepth);
+
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,261 @@
+#include "host_test.h"
+#include "storage.h"
+#include "storage_cache.h"
+#include "storage_cfg.h"
+
+#define TEST_BLOCKS		  4096
+#define TEST_SECTOR		  PL_SDMMC_SECTOR_SIZE
+#define TEST_FAT_IDX	  32
+#define TEST_DIR_IDX	  64
+#define TEST_DATA_IDX	  256
+#define TEST_CHUNK_BLOCKS 4 // 2 KiB appends, as StorageUtils_FsSpeedTest does
+#define TEST_CHUNKS		  256
+
+/* the card under the storage layer, counts transfers and their card commands */
+typedef struct {
+	u8 Disk[TEST_BLOCKS * TEST_SECTOR];
+	u32 Reads;
+	u32 ReadBlocks;
+	u32 Writes;
+	u32 WriteBlocks;
+	u32 WriteCmds; // CMD24, or CMD23 and CMD25
+	u32 LastWrIdx;
+	u32 LastWrNum;
+} FakeDev_t;
+
+static FakeDev_t Fake;
+static u8 Image[TEST_BLOCKS * TEST_SECTOR]; // what the card must hold after a flush
+
+bool Storage_Emmc_Read(u8* pData, u32 blockIdx, u32 blockNum) {
+	CHECK(blockIdx + blockNum <= TEST_BLOCKS);
+	memcpy(pData, &Fake.Disk[blockIdx * TEST_SECTOR], blockNum * TEST_SECTOR);
+	Fake.Reads++;
+	Fake.ReadBlocks += blockNum;
+	return true;
+}
+
+bool Storage_Emmc_Write(const u8* pData, u32 blockIdx, u32 blockNum) {
+	CHECK(blockIdx + blockNum <= TEST_BLOCKS);
+	memcpy(&Fake.Disk[blockIdx * TEST_SECTOR], pData, blockNum * TEST_SECTOR);
+	Fake.Writes++;
+	Fake.WriteBlocks += blockNum;
+	Fake.WriteCmds += blockNum == 1 ? 1 : 2;
+	Fake.LastWrIdx = blockIdx;
+	Fake.LastWrNum = blockNum;
+	return true;
+}
+
+bool Storage_Emmc_Discard(u32 blockIdx, u32 blockNum) {
+	return true;
+}
+
+bool Storage_Emmc_AwaitReady(void) {
+	return true;
+}
+
+u32 Storage_GetReadWriteOps_LastTime(void) {
+	return 0;
+}
+
+bool Pl_USB_IsClassMSC(void) {
+	return false;
+}
+
+static void FakeDev_Reset(void) {
+	memset(&Fake, 0, sizeof(Fake));
+	for (u32 i = 0; i < sizeof(Fake.Disk); i++)
+		Fake.Disk[i] = (u8)(i / TEST_SECTOR + i * 7);
+	memcpy(Image, Fake.Disk, sizeof(Image));
+	StorageCache_Init(TEST_BLOCKS);
+}
+
+/* one sector read that is no continuation of the last one, no read-ahead */
+static bool Test_ReadOne(u32 blockIdx) {
+	u8 block[TEST_SECTOR];
+	return StorageCache_Read(block, blockIdx, 1) &&
+		   memcmp(block, &Image[blockIdx * TEST_SECTOR], TEST_SECTOR) == 0;
+}
+
+static void Test_Write(u32 blockIdx, u8 value, bool isWriteThrough) {
+	u8 block[TEST_SECTOR];
+	memset(block, value, sizeof(block));
+	memcpy(&Image[blockIdx * TEST_SECTOR], block, TEST_SECTOR);
+
+	if (isWriteThrough)
+		CHECK(StorageCache_WriteThrough(block, blockIdx, 1));
+	else
+		CHECK(StorageCache_Write(block, blockIdx, 1));
+}
+
+/**
+ * A file appended in 2 KiB chunks the way FatFS writes it: each data
+ * sector on its own, then the FAT sector and the directory entry
+ */
+static u32 Test_Append(bool isWriteThrough) {
+	u32 sectors = 0;
+	for (u32 chunk = 0; chunk < TEST_CHUNKS; chunk++) {
+		u32 dataIdx = TEST_DATA_IDX + chunk * TEST_CHUNK_BLOCKS;
+		for (u32 i = 0; i < TEST_CHUNK_BLOCKS; i++) {
+			Test_Write(dataIdx + i, (u8)(chunk + i), isWriteThrough);
+			sectors++;
+		}
+
+		Test_Write(TEST_FAT_IDX + chunk * TEST_CHUNK_BLOCKS / 128, (u8)chunk, isWriteThrough);
+		Test_Write(TEST_DIR_IDX, (u8)chunk, isWriteThrough);
+		sectors += 2;
+	}
+
+	CHECK(StorageCache_Flush());
+	CHECK(memcmp(Fake.Disk, Image, sizeof(Image)) == 0);
+	return sectors;
+}
+
+static void Test_CoalesceBench(void) {
+	FakeDev_Reset();
+	u32 sectors		  = Test_Append(true);
+	u32 throughWrites = Fake.Writes;
+	u32 throughCmds	  = Fake.WriteCmds;
+	CHECK_EQ(throughWrites, sectors);
+
+	FakeDev_Reset();
+	CHECK_EQ(Test_Append(false), sectors);
+	printf("  %u sectors: write-through %u writes %u cmds, coalesced %u writes %u cmds\n", sectors,
+		   throughWrites, throughCmds, Fake.Writes, Fake.WriteCmds);
+
+	// the metadata sectors are written once per flush, data goes in runs
+	CHECK(Fake.Writes * 4 < sectors);
+	CHECK(Fake.WriteCmds * 2 < throughCmds);
+	CHECK_EQ(StorageCache_GetStats().WriteCmds, Fake.Writes);
+	CHECK_EQ(StorageCache_GetStats().WriteBlocks, Fake.WriteBlocks);
+}
+
+static void Test_CoalesceSequential(void) {
+	FakeDev_Reset();
+	u32 sectors = 4 * STORAGE_CACHE_COALESCE_BLOCKS;
+	for (u32 i = 0; i < sectors; i++)
+		Test_Write(TEST_DATA_IDX + i, (u8)i, false);
+	CHECK(StorageCache_Flush());
+
+	// a full dirty set is one run, one predefined multi-block write
+	CHECK_EQ(Fake.Writes, sectors / STORAGE_CACHE_COALESCE_BLOCKS);
+	CHECK_EQ(Fake.WriteCmds, 2 * Fake.Writes);
+	CHECK_EQ(Fake.WriteBlocks, sectors);
+	CHECK(memcmp(Fake.Disk, Image, sizeof(Image)) == 0);
+}
+
+static void Test_Lru(void) {
+	FakeDev_Reset();
+
+	// a full cache, spread sectors so nothing is read ahead
+	for (u32 i = 0; i < STORAGE_CACHE_ENTRIES; i++)
+		CHECK(Test_ReadOne(1000 + 2 * i));
+	CHECK_EQ(Fake.Reads, STORAGE_CACHE_ENTRIES);
+
+	// the first one is used again, the second one is the oldest now
+	CHECK(Test_ReadOne(1000));
+	CHECK_EQ(Fake.Reads, STORAGE_CACHE_ENTRIES);
+	CHECK(Test_ReadOne(3000));
+	CHECK_EQ(StorageCache_GetStats().Evictions, 1);
+
+	u32 reads = Fake.Reads;
+	CHECK(Test_ReadOne(1000));
+	CHECK_EQ(Fake.Reads, reads);
+	CHECK(Test_ReadOne(1002));
+	CHECK_EQ(Fake.Reads, reads + 1);
+
+	StorageCache_Stats_t stats = StorageCache_GetStats();
+	CHECK_EQ(stats.Hits, 2);
+	CHECK_EQ(stats.Misses, STORAGE_CACHE_ENTRIES + 2);
+	CHECK_EQ(Fake.Writes, 0);
+}
+
+static void Test_ReadAhead(void) {
+	FakeDev_Reset();
+	u8 buff[STORAGE_CACHE_READ_AHEAD_BLOCKS * TEST_SECTOR];
+
+	// the second of two adjacent reads fetches the window, the rest of it is no card read
+	CHECK(Test_ReadOne(500));
+	CHECK(Test_ReadOne(501));
+	CHECK_EQ(Fake.Reads, 2);
+	CHECK_EQ(Fake.ReadBlocks, 1 + STORAGE_CACHE_READ_AHEAD_BLOCKS);
+	for (u32 i = 2; i <= STORAGE_CACHE_READ_AHEAD_BLOCKS; i++)
+		CHECK(Test_ReadOne(500 + i));
+	CHECK_EQ(Fake.Reads, 2);
+	CHECK_EQ(StorageCache_GetStats().ReadAheadHits, STORAGE_CACHE_READ_AHEAD_BLOCKS - 1);
+
+	// read-ahead sectors don't push the LRU ones out
+	CHECK(Test_ReadOne(500));
+	CHECK_EQ(Fake.Reads, 2);
+
+	// a dirty sector in the window is read as written
+	u8 block[TEST_SECTOR];
+	memset(block, 0xD1, sizeof(block));
+	memcpy(&Image[701 * TEST_SECTOR], block, TEST_SECTOR);
+	CHECK(StorageCache_Write(block, 701, 1));
+	CHECK(Test_ReadOne(699));
+	CHECK(StorageCache_Read(buff, 700, 2));
+	CHECK(memcmp(buff, &Image[700 * TEST_SECTOR], 2 * TEST_SECTOR) == 0);
+	u32 restNum = STORAGE_CACHE_READ_AHEAD_BLOCKS - 2;
+	CHECK(StorageCache_Read(buff, 702, restNum));
+	CHECK(memcmp(buff, &Image[702 * TEST_SECTOR], restNum * TEST_SECTOR) == 0);
+
+	// the window stops at the end of the card
+	u32 readBlocks = Fake.ReadBlocks;
+	CHECK(Test_ReadOne(TEST_BLOCKS - 3));
+	CHECK(Test_ReadOne(TEST_BLOCKS - 2));
+	CHECK(Test_ReadOne(TEST_BLOCKS - 1));
+	CHECK_EQ(Fake.ReadBlocks - readBlocks, 1 + 2);
+}
+
+static void Test_EvictRun(void) {
+	FakeDev_Reset();
+
+	// two dirty runs, below the write back threshold
+	for (u32 i = 0; i < 4; i++) {
+		Test_Write(100 + i, 0xA0, false);
+		Test_Write(200 + i, 0xB0, false);
+	}
+	CHECK_EQ(StorageCache_GetStats().Dirty, 8);
+
+	// the rest of the cache is clean, then one more sector pushes out the oldest: 100
+	for (u32 i = 0; i < STORAGE_CACHE_ENTRIES - 8; i++)
+		CHECK(Test_ReadOne(1000 + 2 * i));
+	CHECK_EQ(Fake.Writes, 0);
+	CHECK(Test_ReadOne(3000));
+
+	// the victim goes with its own run only
+	CHECK_EQ(Fake.Writes, 1);
+	CHECK_EQ(Fake.LastWrIdx, 100);
+	CHECK_EQ(Fake.LastWrNum, 4);
+	CHECK_EQ(StorageCache_GetStats().Dirty, 4);
+	CHECK(memcmp(&Fake.Disk[100 * TEST_SECTOR], &Image[100 * TEST_SECTOR], 4 * TEST_SECTOR) == 0);
+	CHECK(memcmp(&Fake.Disk[200 * TEST_SECTOR], &Image[200 * TEST_SECTOR], 4 * TEST_SECTOR) != 0);
+
+	// a victim in the middle of a run takes the sectors below it along
+	FakeDev_Reset();
+	for (u32 i = 0; i < 4; i++)
+		Test_Write(300 + i, 0xC0, false);
+	CHECK(Test_ReadOne(303));
+	CHECK(Test_ReadOne(300));
+	CHECK(Test_ReadOne(301));
+	for (u32 i = 0; i < STORAGE_CACHE_ENTRIES - 4; i++)
+		CHECK(Test_ReadOne(1000 + 2 * i));
+	CHECK(Test_ReadOne(3000));
+
+	CHECK_EQ(Fake.Writes, 1);
+	CHECK_EQ(Fake.LastWrIdx, 300);
+	CHECK_EQ(Fake.LastWrNum, 4);
+	CHECK_EQ(StorageCache_GetStats().Dirty, 0);
+}
+
+int main(void) {
+	FreeRTOS_StorageCache_InitComponents(true, false);
+
+	HOST_TEST_RUN(Test_CoalesceBench);
+	HOST_TEST_RUN(Test_CoalesceSequential);
+	HOST_TEST_RUN(Test_Lru);
+	HOST_TEST_RUN(Test_ReadAhead);
+	HOST_TEST_RUN(Test_EvictRun);
+
+	return HOST_TEST_RESULT();
+}
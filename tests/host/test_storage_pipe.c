@@ -0,0 +1,224 @@
+#include "host_test.h"
+#include "storage_cfg.h"
+#include "storage_pipe.h"
+
+#define TEST_BLOCKS		256
+#define TEST_SECTOR		PL_SDMMC_SECTOR_SIZE
+#define TEST_READ_STEP	8
+
+typedef struct {
+	u8 Disk[TEST_BLOCKS * TEST_SECTOR];
+	u8* pData; // transfer in flight
+	u32 BlockIdx;
+	u32 BlockNum;
+	bool IsWrite;
+	bool InFlight;
+	bool Done;
+	bool IsOk;
+	bool FailNext; // the next transfer completes with an error
+	bool Hang;	   // transfers never complete
+	u32 Starts;
+	u32 Aborts;
+	u32 Invalidates;
+	u32 InvIdx;
+	u32 InvNum;
+	u32 WaitTmo; // the last non-zero wait
+} FakeDev_t;
+
+static FakeDev_t Fake;
+
+static void FakeDev_Finish(void) {
+	Fake.IsOk	  = !Fake.FailNext;
+	Fake.FailNext = false;
+	Fake.Done	  = true;
+	if (!Fake.IsOk)
+		return;
+
+	u8* pDisk = &Fake.Disk[Fake.BlockIdx * TEST_SECTOR];
+	if (Fake.IsWrite)
+		memcpy(pDisk, Fake.pData, Fake.BlockNum * TEST_SECTOR);
+	else
+		memcpy(Fake.pData, pDisk, Fake.BlockNum * TEST_SECTOR);
+}
+
+static bool FakeDev_XferStart(u8* pData, u32 blockIdx, u32 blockNum, bool isWrite) {
+	CHECK(!Fake.InFlight);
+	CHECK(blockIdx + blockNum <= TEST_BLOCKS);
+
+	Fake.pData	  = pData;
+	Fake.BlockIdx = blockIdx;
+	Fake.BlockNum = blockNum;
+	Fake.IsWrite  = isWrite;
+	Fake.InFlight = true;
+	Fake.Done	  = false;
+	Fake.Starts++;
+	return true;
+}
+
+/* the transfer is still running when polled, it completes once waited for */
+static bool FakeDev_XferWait(bool* pIsOk, u32 tmoMs) {
+	CHECK(Fake.InFlight);
+
+	if (tmoMs) {
+		Fake.WaitTmo = tmoMs;
+		if (!Fake.Done && !Fake.Hang)
+			FakeDev_Finish();
+	}
+
+	if (!Fake.Done)
+		return false;
+
+	*pIsOk		  = Fake.IsOk;
+	Fake.InFlight = false;
+	return true;
+}
+
+static void FakeDev_XferAbort(void) {
+	Fake.InFlight = false;
+	Fake.Aborts++;
+}
+
+static void FakeDev_Invalidate(u32 blockIdx, u32 blockNum) {
+	Fake.Invalidates++;
+	Fake.InvIdx = blockIdx;
+	Fake.InvNum = blockNum;
+}
+
+static const StoragePipe_Dev_t FakeDev = {
+	.XferStart	= FakeDev_XferStart,
+	.XferWait	= FakeDev_XferWait,
+	.XferAbort	= FakeDev_XferAbort,
+	.Invalidate = FakeDev_Invalidate,
+};
+
+static void FakeDev_Reset(void) {
+	memset(&Fake, 0, sizeof(Fake));
+	for (u32 i = 0; i < sizeof(Fake.Disk); i++)
+		Fake.Disk[i] = (u8)(i / TEST_SECTOR + i * 13);
+
+	StoragePipe_Init(&FakeDev, TEST_BLOCKS);
+}
+
+static bool Disk_Equals(const u8* pData, u32 blockIdx, u32 blockNum) {
+	return memcmp(pData, &Fake.Disk[blockIdx * TEST_SECTOR], blockNum * TEST_SECTOR) == 0;
+}
+
+static void Test_ReadAhead(void) {
+	FakeDev_Reset();
+	StoragePipe_Stats_t stats = StoragePipe_GetStats();
+	u8 buff[TEST_READ_STEP * TEST_SECTOR];
+
+	// two buffers worth of sequential reads: one miss, the rest is read ahead
+	u32 reads = 2 * STORAGE_PIPE_BUFF_BLOCKS / TEST_READ_STEP;
+	for (u32 i = 0; i < reads; i++) {
+		CHECK(StoragePipe_Read(buff, i * TEST_READ_STEP, TEST_READ_STEP));
+		CHECK(Disk_Equals(buff, i * TEST_READ_STEP, TEST_READ_STEP));
+	}
+
+	StoragePipe_Stats_t now = StoragePipe_GetStats();
+	CHECK_EQ(now.Reads - stats.Reads, reads);
+	CHECK_EQ(now.ReadHits - stats.ReadHits, reads - 1);
+	CHECK_EQ(now.Prefetches - stats.Prefetches, 2);
+	CHECK_EQ(Fake.Starts, 3);
+	CHECK(StoragePipe_IsBusy());
+
+	// a jump is no sequence, nothing is read ahead
+	CHECK(StoragePipe_Read(buff, 200, TEST_READ_STEP));
+	CHECK(Disk_Equals(buff, 200, TEST_READ_STEP));
+	CHECK_EQ(StoragePipe_GetStats().Prefetches, now.Prefetches);
+	CHECK(!StoragePipe_IsBusy());
+
+	// the read ahead stops at the end of the device
+	CHECK(StoragePipe_Read(buff, TEST_BLOCKS - TEST_READ_STEP, TEST_READ_STEP));
+	CHECK(StoragePipe_Read(buff, TEST_BLOCKS - 1, 1));
+	CHECK(!StoragePipe_Read(buff, TEST_BLOCKS - 1, 2));
+	CHECK(StoragePipe_Drain());
+}
+
+static void Test_WriteInvalidates(void) {
+	FakeDev_Reset();
+	u8 buff[TEST_READ_STEP * TEST_SECTOR];
+
+	// block 4 is in a ready buffer, the next ones are being read ahead
+	CHECK(StoragePipe_Read(buff, 0, TEST_READ_STEP));
+	CHECK(StoragePipe_IsBusy());
+
+	u8 block[TEST_SECTOR];
+	memset(block, 0xA5, sizeof(block));
+	CHECK(StoragePipe_Write(block, 4, 1));
+	CHECK_EQ(Fake.Invalidates, 1);
+	CHECK_EQ(Fake.InvIdx, 4);
+	CHECK_EQ(Fake.InvNum, 1);
+
+	// the stale copy is dropped, the blocks around the write come from the card
+	u32 starts = Fake.Starts;
+	CHECK(StoragePipe_Read(buff, 0, TEST_READ_STEP));
+	CHECK(Fake.Starts > starts);
+	CHECK(memcmp(&buff[4 * TEST_SECTOR], block, TEST_SECTOR) == 0);
+	CHECK(Disk_Equals(buff, 0, TEST_READ_STEP));
+
+	// a write past the buffers leaves them in place
+	starts = Fake.Starts;
+	CHECK(StoragePipe_Write(block, 100, 1));
+	CHECK(StoragePipe_Drain());
+	CHECK(StoragePipe_Read(buff, 0, TEST_READ_STEP));
+	CHECK_EQ(Fake.Starts, starts + 1);
+}
+
+static void Test_DeferredWriteError(void) {
+	FakeDev_Reset();
+	u8 block[TEST_SECTOR] = {0};
+	u32 errors			  = StoragePipe_GetStats().WriteErrors;
+
+	// the failure shows up with the write after the failed one
+	Fake.FailNext = true;
+	CHECK(StoragePipe_Write(block, 10, 1));
+	CHECK(StoragePipe_IsBusy());
+	CHECK(!StoragePipe_Write(block, 11, 1));
+	CHECK_EQ(StoragePipe_GetStats().WriteErrors - errors, 1);
+
+	// reported once, the write that reported it went fine
+	CHECK(StoragePipe_Write(block, 12, 1));
+	CHECK(StoragePipe_Drain());
+
+	// or with the drain when no write follows
+	Fake.FailNext = true;
+	CHECK(StoragePipe_Write(block, 13, 1));
+	CHECK(!StoragePipe_Drain());
+	CHECK(!StoragePipe_IsBusy());
+	CHECK_EQ(StoragePipe_GetStats().WriteErrors - errors, 2);
+}
+
+static void Test_Timeout(void) {
+	FakeDev_Reset();
+	u8 buff[TEST_SECTOR];
+	u32 timeouts = StoragePipe_GetStats().Timeouts;
+
+	Fake.Hang = true;
+	CHECK(!StoragePipe_Read(buff, 0, 1));
+	CHECK_EQ(Fake.Aborts, 1);
+	CHECK_EQ(Fake.WaitTmo, STORAGE_PIPE_XFER_TMO);
+	CHECK_EQ(StoragePipe_GetStats().Timeouts - timeouts, 1);
+	CHECK(!StoragePipe_IsBusy());
+
+	// a hung write is aborted by the drain and reported as failed
+	CHECK(StoragePipe_Write(buff, 0, 1));
+	CHECK(!StoragePipe_Drain());
+	CHECK_EQ(Fake.Aborts, 2);
+
+	// the device works again after the abort
+	Fake.Hang = false;
+	StoragePipe_Init(&FakeDev, TEST_BLOCKS);
+	CHECK(StoragePipe_Read(buff, 0, 1));
+	CHECK(Disk_Equals(buff, 0, 1));
+	CHECK_EQ(StoragePipe_GetStats().Timeouts - timeouts, 2);
+}
+
+int main(void) {
+	HOST_TEST_RUN(Test_ReadAhead);
+	HOST_TEST_RUN(Test_WriteInvalidates);
+	HOST_TEST_RUN(Test_DeferredWriteError);
+	HOST_TEST_RUN(Test_Timeout);
+
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,267 @@
+#include "host_test.h"
+#include "storage_cfg.h"
+#include "storage_ram.h"
+
+#define TEST_SECTOR		512 // FF_MAX_SS
+#define TEST_CAPACITY	(2 * STORAGE_RAM_CAPACITY_MIN)
+#define TEST_SECTORS	(TEST_CAPACITY / TEST_SECTOR)
+#define TEST_PATH		"0:/ramdisk.snp"
+#define TEST_SNAP_HDR	16 // StorageRam_SnapHdr_t
+#define TEST_SNAP_RUN	12 // StorageRam_SnapRun_t
+#define FAKE_FILE_SIZE	(TEST_CAPACITY + TEST_SECTORS * TEST_SNAP_RUN + TEST_SNAP_HDR)
+#define FAKE_WRITE_ANY	0xFFFFFFFF
+
+/* one file under the fs_wrapper API, the snapshot */
+typedef struct {
+	u8 Data[FAKE_FILE_SIZE];
+	u32 Size;
+	u32 Pos;
+	bool IsExist;
+	bool IsOpen;
+	u32 WriteBudget; // bytes written before the writes fail, a reset in the middle of a save
+} FakeFile_t;
+
+static FakeFile_t Fake;
+static u8 Image[TEST_CAPACITY];
+
+RET_STATE_t FsWrap_Open(FsWrap_File_t* pFile, const char* pPath, u32 flags) {
+	CHECK(!Fake.IsOpen);
+	CHECK(strcmp(pPath, TEST_PATH) == 0);
+
+	if (flags & FS_MODE_CREATE_ALWAYS) {
+		Fake.IsExist = true;
+		Fake.Size	 = 0;
+	}
+	if (!Fake.IsExist)
+		return RET_STATE_ERR_EMPTY;
+
+	Fake.Pos			= 0;
+	Fake.IsOpen			= true;
+	pFile->pFileHandler = &Fake;
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Close(FsWrap_File_t* pFile) {
+	CHECK(Fake.IsOpen);
+	Fake.IsOpen = false;
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Read(FsWrap_File_t* pFile, void* pData, u32 size, u32* pBytesRd) {
+	*pBytesRd = GET_MIN(size, Fake.Size - Fake.Pos);
+	memcpy(pData, &Fake.Data[Fake.Pos], *pBytesRd);
+	Fake.Pos += *pBytesRd;
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Write(FsWrap_File_t* pFile, const void* pData, u32 size, u32* pBytesWr) {
+	ASSERT_CHECK(Fake.Pos + size <= FAKE_FILE_SIZE);
+	*pBytesWr = GET_MIN(size, Fake.WriteBudget);
+	memcpy(&Fake.Data[Fake.Pos], pData, *pBytesWr);
+	Fake.Pos += *pBytesWr;
+	Fake.Size = GET_MAX(Fake.Size, Fake.Pos);
+	Fake.WriteBudget -= *pBytesWr;
+	return *pBytesWr == size ? RET_STATE_SUCCESS : RET_STATE_ERROR;
+}
+
+RET_STATE_t FsWrap_Seek(FsWrap_File_t* pFile, s32 offset, FS_SEEK_t whence) {
+	CHECK(whence == FS_SEEK_START);
+	Fake.Pos = (u32)offset;
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Sync(FsWrap_File_t* pFile) {
+	return RET_STATE_SUCCESS;
+}
+
+RET_STATE_t FsWrap_Size(FsWrap_File_t* pFile, u32* pSize) {
+	*pSize = Fake.Size;
+	return RET_STATE_SUCCESS;
+}
+
+static void Test_Reset(void) {
+	memset(&Fake, 0, sizeof(Fake));
+	Fake.WriteBudget = FAKE_WRITE_ANY;
+	CHECK(StorageRam_Init(TEST_CAPACITY));
+}
+
+static bool Drive_Equals(const u8* pImage) {
+	const u8* pDrive = StorageRam_Map(0, TEST_CAPACITY);
+	return pDrive != NULL && memcmp(pDrive, pImage, TEST_CAPACITY) == 0;
+}
+
+static bool Drive_IsZero(void) {
+	static const u8 zero[TEST_CAPACITY];
+	return Drive_Equals(zero);
+}
+
+static void Test_Init(void) {
+	CHECK(!StorageRam_Init(STORAGE_RAM_CAPACITY_MIN - TEST_SECTOR));
+	CHECK(!StorageRam_Init(StorageRam_GetCapacityMax() + TEST_SECTOR));
+	CHECK_EQ(strcmp(StorageRam_GetRegionStr(), "heap"), 0);
+
+	// rounded down to the sector, the resized drive is cleared
+	CHECK(StorageRam_Init(STORAGE_RAM_CAPACITY_MIN + 100));
+	CHECK_EQ(StorageRam_GetCapacity(), STORAGE_RAM_CAPACITY_MIN);
+	u8 data[TEST_SECTOR];
+	memset(data, 0x77, sizeof(data));
+	CHECK(StorageRam_Write(data, 0, sizeof(data)));
+	CHECK(StorageRam_Init(TEST_CAPACITY));
+	CHECK(Drive_IsZero());
+}
+
+static void Test_Range(void) {
+	Test_Reset();
+	StorageRam_Stats_t stats = StorageRam_GetStats();
+	u8 data[2 * TEST_SECTOR] = {0};
+
+	// the last bytes of the drive
+	CHECK(StorageRam_Write(data, TEST_CAPACITY - TEST_SECTOR, TEST_SECTOR));
+	CHECK(StorageRam_Read(data, TEST_CAPACITY - TEST_SECTOR, TEST_SECTOR));
+	CHECK(StorageRam_Map(TEST_CAPACITY - 1, 1) != NULL);
+	CHECK(StorageRam_Read(data, TEST_CAPACITY, 0));
+
+	// past the end, also with an offset plus length that wraps around
+	CHECK(!StorageRam_Read(data, TEST_CAPACITY - TEST_SECTOR, 2 * TEST_SECTOR));
+	CHECK(!StorageRam_Write(data, TEST_CAPACITY - TEST_SECTOR, 2 * TEST_SECTOR));
+	CHECK(!StorageRam_Read(data, TEST_CAPACITY + 1, 0));
+	CHECK(!StorageRam_Write(data, TEST_SECTOR, UINT32_MAX));
+	CHECK(StorageRam_Map(TEST_CAPACITY, 1) == NULL);
+	CHECK(!StorageRam_Trim(0, TEST_CAPACITY + TEST_SECTOR));
+
+	StorageRam_Stats_t now = StorageRam_GetStats();
+	CHECK_EQ(now.Reads - stats.Reads, 2);
+	CHECK_EQ(now.Writes - stats.Writes, 1);
+	CHECK_EQ(now.Errors - stats.Errors, 5);
+	CHECK_EQ(StorageRam_GetTrimStats().Errors, 1);
+}
+
+static void Test_Trim(void) {
+	Test_Reset();
+	memset(Image, 0x3C, sizeof(Image));
+	CHECK(StorageRam_Write(Image, 0, TEST_CAPACITY));
+
+	Storage_TrimStats_t stats = StorageRam_GetTrimStats();
+	CHECK(StorageRam_Trim(4 * TEST_SECTOR, 8 * TEST_SECTOR));
+	memset(&Image[4 * TEST_SECTOR], 0, 8 * TEST_SECTOR);
+	CHECK(Drive_Equals(Image));
+	CHECK_EQ(StorageRam_GetTrimStats().Cmds - stats.Cmds, 1);
+	CHECK_EQ(StorageRam_GetTrimStats().Blocks - stats.Blocks, 8);
+}
+
+/* sectors of random data, the rest in the given fill */
+static void Image_Make(u32 rawFrom, u32 rawNum, u8 fill) {
+	memset(Image, fill, sizeof(Image));
+	for (u32 i = rawFrom * TEST_SECTOR; i < (rawFrom + rawNum) * TEST_SECTOR; i++)
+		Image[i] = (u8)rand();
+}
+
+/* raw runs longer than one snapshot run, a zero gap, fill runs and a raw last sector */
+static void Image_Mixed(void) {
+	srand(2);
+	Image_Make(3, STORAGE_RAM_SNAP_RUN_MAX + 5, 0);
+	memset(&Image[100 * TEST_SECTOR], 0xA5, 7 * TEST_SECTOR);
+	memset(&Image[107 * TEST_SECTOR], 0x5A, 2 * TEST_SECTOR);
+	Image[TEST_CAPACITY - 1] = 1;
+}
+
+static void Test_SnapRoundTrip(void) {
+	Test_Reset();
+	Image_Mixed();
+	CHECK(StorageRam_Write(Image, 0, TEST_CAPACITY));
+
+	CHECK(StorageRam_SnapshotSave(TEST_PATH));
+	u32 raw = STORAGE_RAM_SNAP_RUN_MAX + 5 + 1;
+	CHECK_EQ(StorageRam_GetStats().SnapSize, TEST_SNAP_HDR + 5 * TEST_SNAP_RUN + raw * TEST_SECTOR);
+	CHECK_EQ(Fake.Size, StorageRam_GetStats().SnapSize);
+
+	// what is on the drive before a load doesn't matter
+	Image_Make(0, TEST_SECTORS, 0);
+	CHECK(StorageRam_Write(Image, 0, TEST_CAPACITY));
+
+	u32 loads = StorageRam_GetStats().SnapLoads;
+	CHECK(StorageRam_SnapshotLoad(TEST_PATH));
+	Image_Mixed();
+	CHECK(Drive_Equals(Image));
+	CHECK_EQ(StorageRam_GetStats().SnapLoads - loads, 1);
+}
+
+static void Test_SnapFillZero(void) {
+	Test_Reset();
+
+	// an empty drive is the header alone
+	CHECK(StorageRam_SnapshotSave(TEST_PATH));
+	CHECK_EQ(Fake.Size, TEST_SNAP_HDR);
+	CHECK(StorageRam_SnapshotLoad(TEST_PATH));
+	CHECK(Drive_IsZero());
+
+	// a drive of one byte value is one fill run
+	memset(Image, 0xC3, sizeof(Image));
+	CHECK(StorageRam_Write(Image, 0, TEST_CAPACITY));
+	CHECK(StorageRam_SnapshotSave(TEST_PATH));
+	CHECK_EQ(Fake.Size, TEST_SNAP_HDR + TEST_SNAP_RUN);
+
+	CHECK(StorageRam_Trim(0, TEST_CAPACITY));
+	CHECK(StorageRam_SnapshotLoad(TEST_PATH));
+	CHECK(Drive_Equals(Image));
+}
+
+static void Test_SnapCrc(void) {
+	Test_Reset();
+	Image_Make(0, 4, 0);
+	CHECK(StorageRam_Write(Image, 0, TEST_CAPACITY));
+	CHECK(StorageRam_SnapshotSave(TEST_PATH));
+	u32 errors = StorageRam_GetStats().SnapErrors;
+
+	// a flipped data bit clears the drive, the next mount formats it
+	Fake.Data[TEST_SNAP_HDR + TEST_SNAP_RUN + 3 * TEST_SECTOR] ^= 0x10;
+	CHECK(!StorageRam_SnapshotLoad(TEST_PATH));
+	CHECK(Drive_IsZero());
+	CHECK_EQ(StorageRam_GetStats().SnapErrors - errors, 1);
+
+	// the same for the header
+	CHECK(StorageRam_Write(Image, 0, TEST_CAPACITY));
+	CHECK(StorageRam_SnapshotSave(TEST_PATH));
+	Fake.Data[8] ^= 0x01;
+	CHECK(!StorageRam_SnapshotLoad(TEST_PATH));
+	CHECK(Drive_IsZero());
+
+	// a snapshot of another capacity
+	CHECK(StorageRam_Write(Image, 0, TEST_CAPACITY));
+	CHECK(StorageRam_SnapshotSave(TEST_PATH));
+	CHECK(StorageRam_Init(STORAGE_RAM_CAPACITY_MIN));
+	CHECK(!StorageRam_SnapshotLoad(TEST_PATH));
+	CHECK_EQ(StorageRam_GetStats().SnapErrors - errors, 3);
+	CHECK(StorageRam_Init(TEST_CAPACITY));
+
+	// no snapshot is no error
+	Fake.IsExist = false;
+	CHECK(!StorageRam_SnapshotLoad(TEST_PATH));
+	CHECK_EQ(StorageRam_GetStats().SnapErrors - errors, 3);
+}
+
+static void Test_SnapCut(void) {
+	Test_Reset();
+	Image_Make(0, 4, 0);
+	CHECK(StorageRam_Write(Image, 0, TEST_CAPACITY));
+
+	// the header is written last, a cut save is no snapshot
+	Fake.WriteBudget = TEST_SNAP_HDR + TEST_SNAP_RUN + 4 * TEST_SECTOR;
+	CHECK(!StorageRam_SnapshotSave(TEST_PATH));
+	CHECK(!Fake.IsOpen);
+	CHECK_EQ(Fake.Size, TEST_SNAP_HDR + TEST_SNAP_RUN + 4 * TEST_SECTOR);
+	CHECK(!StorageRam_SnapshotLoad(TEST_PATH));
+	CHECK(Drive_IsZero());
+}
+
+int main(void) {
+	HOST_TEST_RUN(Test_Init);
+	HOST_TEST_RUN(Test_Range);
+	HOST_TEST_RUN(Test_Trim);
+	HOST_TEST_RUN(Test_SnapRoundTrip);
+	HOST_TEST_RUN(Test_SnapFillZero);
+	HOST_TEST_RUN(Test_SnapCrc);
+	HOST_TEST_RUN(Test_SnapCut);
+
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,253 @@
+import argparse
+import codecs
+import logging
+import re
+import struct
+import sys
+from pathlib import Path
+from typing import Optional
+
+from elf_map_parse import ElfParser
+
+# Must match shared/debug/debug_bin_log.h and debug_bin_log.c
+BIN_LOG_MAGIC = 0xFE
+BIN_LOG_LVL_NONE = 0x7F
+BIN_LOG_TRUNCATED = 0x80
+BIN_LOG_SITE_PREFIX = "_dbg_site"
+BIN_LOG_HDR_SIZE = 9  # lvl, site, time after the len byte
+
+# DEBUG_LVL_TABLE() order
+LOG_LVL_STR = ["  TRACE", "  DEBUG", "   INFO", "   WARN", "  ERROR", " CRITIC", "DISABLE"]
+
+FMT_SPEC_RE = re.compile(
+    r"%(?P<flags>[-+ #0]*)(?P<width>\*|\d+)?(?:\.(?P<prec>\*|\d+))?"
+    r"(?P<len>hh|h|ll|l|j|z|t|L)?(?P<conv>[diouxXeEfFgGaAcsp%])"
+)
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Binary debug log decoder")
+    parser.add_argument("-e", "--elf_path", type=Path, required=True, help="Path to the ELF file")
+    parser.add_argument(
+        "-i", "--input_path", type=Path, help="Captured debug output, stdin if not set"
+    )
+    parser.add_argument("-o", "--output_path", type=Path, help="Decoded text, stdout if not set")
+    parser.add_argument(
+        "-s", "--sites", action="store_true", help="Print the log call sites found in the ELF"
+    )
+
+    return parser.parse_args()
+
+
+class LogSite:
+    def __init__(self, fmt: str, file: str, func: str, line: int) -> None:
+        self.fmt = fmt
+        self.file = file
+        self.func = func
+        self.line = line
+
+
+def load_sites(elf_parser: ElfParser) -> dict:
+    """Collects DebugBinSite_t {pFmt, pFile, pFunc, Line} objects from the ELF"""
+    ptr_size = elf_parser.get_pointer_size()
+    endian = "<" if elf_parser.is_little_endian() else ">"
+    ptr_fmt = "I" if ptr_size == 4 else "Q"
+    site_fmt = f"{endian}{ptr_fmt}{ptr_fmt}{ptr_fmt}I"
+    site_size = struct.calcsize(site_fmt)
+
+    sites = {}
+    for name, addr, _ in elf_parser.get_symbols_by_prefix(BIN_LOG_SITE_PREFIX):
+        raw = elf_parser.read_bytes(addr, site_size)
+        if raw is None:
+            logging.warning(f"Site {name} at 0x{addr:08X} is not in a loadable section")
+            continue
+
+        p_fmt, p_file, p_func, line = struct.unpack(site_fmt, raw)
+        sites[addr] = LogSite(
+            elf_parser.read_cstring(p_fmt) or "",
+            elf_parser.read_cstring(p_file) or "?",
+            elf_parser.read_cstring(p_func) or "?",
+            line,
+        )
+
+    logging.info(f"Collected {len(sites)} log sites")
+    return sites
+
+
+class BinLogDecoder:
+    """
+    Splits the debug stream into plain text and binary records and turns
+    the records back into text. Feed it with chunks of any size
+    """
+
+    def __init__(self, sites: dict, long_size: int = 4, little_endian: bool = True) -> None:
+        self.sites = sites
+        self.long_size = long_size
+        self.endian = "<" if little_endian else ">"
+        self.pending = b""
+        self.text = codecs.getincrementaldecoder("utf-8")(errors="replace")
+        self.time_hi = 0
+        self.time_last = 0
+
+    def _unpack(self, fmt: str, data: bytes, pos: int):
+        size = struct.calcsize(self.endian + fmt)
+        if pos + size > len(data):
+            raise ValueError("argument out of record")
+        return struct.unpack_from(self.endian + fmt, data, pos)[0], pos + size
+
+    def _int_fmt(self, length: Optional[str], conv: str) -> str:
+        if length in ("ll", "j"):
+            fmt = "q"
+        elif length in ("l", "z", "t") and self.long_size == 8:
+            fmt = "q"
+        else:
+            fmt = "i"
+
+        return fmt.upper() if conv in "uoxX" else fmt
+
+    def _format(self, fmt: str, args: bytes) -> str:
+        out = []
+        pos = 0
+        last = 0
+
+        for m in FMT_SPEC_RE.finditer(fmt):
+            out.append(fmt[last : m.start()])
+            last = m.end()
+            conv = m.group("conv")
+
+            if conv == "%":
+                out.append("%")
+                continue
+
+            try:
+                width = m.group("width") or ""
+                if width == "*":
+                    val, pos = self._unpack("i", args, pos)
+                    width = str(val)
+
+                prec = m.group("prec")
+                if prec == "*":
+                    val, pos = self._unpack("i", args, pos)
+                    prec = str(val)
+                prec = f".{prec}" if prec is not None else ""
+
+                spec = f"%{m.group('flags')}{width}{prec}"
+
+                if conv in "diouxX":
+                    val, pos = self._unpack(self._int_fmt(m.group("len"), conv), args, pos)
+                    out.append((spec + ("d" if conv in "iu" else conv)) % val)
+                elif conv == "c":
+                    val, pos = self._unpack("i", args, pos)
+                    out.append((spec + "c") % chr(val & 0xFF))
+                elif conv == "p":
+                    val, pos = self._unpack("I" if self.long_size == 4 else "Q", args, pos)
+                    out.append(f"0x{val:x}")
+                elif conv in "aA":
+                    val, pos = self._unpack("d", args, pos)
+                    out.append(val.hex())
+                elif conv in "eEfFgG":
+                    val, pos = self._unpack("d", args, pos)
+                    out.append((spec + conv) % val)
+                elif conv == "s":
+                    if pos >= len(args):
+                        raise ValueError("argument out of record")
+                    str_len = args[pos]
+                    val = args[pos + 1 : pos + 1 + str_len].decode("utf-8", errors="replace")
+                    pos += 1 + str_len
+                    out.append((spec + "s") % val)
+            except ValueError:
+                out.append("<?>")
+                out.append(fmt[last:])
+                return "".join(out)
+
+        out.append(fmt[last:])
+        return "".join(out)
+
+    def _decode_record(self, rec: bytes) -> Optional[str]:
+        lvl_byte = rec[0]
+        site_id, time_us = struct.unpack_from(self.endian + "II", rec, 1)
+
+        site = self.sites.get(site_id)
+        lvl = lvl_byte & ~BIN_LOG_TRUNCATED
+        if site is None or (lvl >= len(LOG_LVL_STR) and lvl != BIN_LOG_LVL_NONE):
+            return None
+
+        # The firmware sends the low word of the microsecond counter
+        if time_us < self.time_last:
+            self.time_hi += 1 << 32
+        self.time_last = time_us
+        time_s = (self.time_hi + time_us) / 1e6
+
+        msg = self._format(site.fmt, rec[BIN_LOG_HDR_SIZE:])
+        if lvl_byte & BIN_LOG_TRUNCATED:
+            msg += " <truncated>"
+
+        file = site.file.rsplit("/", 1)[-1]
+        lvl_str = f"[{LOG_LVL_STR[lvl]}] " if lvl != BIN_LOG_LVL_NONE else ""
+        where = f"[fi: {file}, fn: {site.func}, ln: {site.line}]"
+        return f"{lvl_str}[{time_s:.6f}] {where}:\r\n\t  {msg}\r\n"
+
+    def feed(self, data: bytes) -> str:
+        buf = self.pending + data
+        out = []
+        text_start = 0
+        pos = 0
+
+        while pos < len(buf):
+            if buf[pos] != BIN_LOG_MAGIC:
+                pos += 1
+                continue
+
+            if pos + 2 > len(buf) or pos + 2 + buf[pos + 1] > len(buf):
+                break  # record not complete yet
+
+            rec_len = buf[pos + 1]
+            decoded = None
+            if rec_len >= BIN_LOG_HDR_SIZE:
+                decoded = self._decode_record(buf[pos + 2 : pos + 2 + rec_len])
+
+            if decoded is None:
+                pos += 1  # not a record, keep the byte as text
+                continue
+
+            out.append(self.text.decode(buf[text_start:pos]))
+            out.append(decoded)
+            pos += 2 + rec_len
+            text_start = pos
+
+        out.append(self.text.decode(buf[text_start:pos]))
+        self.pending = buf[pos:]
+        return "".join(out)
+
+
+def main():
+    logging.basicConfig(level=logging.INFO)
+    args = parse_args()
+
+    elf_parser = ElfParser(args.elf_path)
+    sites = load_sites(elf_parser)
+
+    if args.sites:
+        for addr, site in sorted(sites.items()):
+            print(f"0x{addr:08X} {site.file}:{site.line} {site.func}(): {site.fmt!r}")
+        return
+
+    decoder = BinLogDecoder(sites, elf_parser.get_pointer_size(), elf_parser.is_little_endian())
+    src = args.input_path.open("rb") if args.input_path else sys.stdin.buffer
+    dst = args.output_path.open("w", encoding="utf-8") if args.output_path else sys.stdout
+
+    try:
+        while chunk := src.read1(4096):
+            dst.write(decoder.feed(chunk))
+            dst.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if args.input_path:
+            src.close()
+        if args.output_path:
+            dst.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -3,6 +3,7 @@ import logging
 import os
 import re
 import sys
+from typing import Optional
 
 import coloredlogs
 from elftools.elf.elffile import ELFFile
@@ -77,6 +78,7 @@ class ElfParser:
         self.elf_path = elf_path
         self.elf_data = None
         self.elf = None
+        self._alloc_sections = None
         self._load_elf_data()
 
     def _load_elf_data(self) -> None:
@@ -146,3 +148,58 @@ class ElfParser:
 
         logger.info(f"Found {len(function_addresses)} function addresses")
         return function_addresses
+
+    def get_symbols_by_prefix(self, prefix: str) -> list:
+        if not self.elf:
+            logger.error("ELF data not loaded properly")
+            return []
+
+        # Static locals are not unique by name, so return every (name, addr, size)
+        symbols = []
+        for section in self.elf.iter_sections():
+            if section.header["sh_type"] == "SHT_SYMTAB":
+                for symbol in section.iter_symbols():
+                    if symbol.name.startswith(prefix) and symbol.entry.st_size > 0:
+                        symbols.append((symbol.name, symbol.entry.st_value, symbol.entry.st_size))
+
+        logger.info(f"Found {len(symbols)} symbols with prefix '{prefix}'")
+        return symbols
+
+    def read_bytes(self, addr: int, size: int) -> Optional[bytes]:
+        if not self.elf:
+            logger.error("ELF data not loaded properly")
+            return None
+
+        if self._alloc_sections is None:
+            self._alloc_sections = [
+                (sec.header["sh_addr"], sec.header["sh_size"], sec.data())
+                for sec in self.elf.iter_sections()
+                if sec.header["sh_flags"] & 0x2 and sec.header["sh_type"] != "SHT_NOBITS"
+            ]
+
+        for start, length, data in self._alloc_sections:
+            if start <= addr and addr + size <= start + length:
+                return data[addr - start : addr - start + size]
+
+        return None
+
+    def read_cstring(self, addr: int, max_len: int = 1024) -> Optional[str]:
+        if not self.elf:
+            logger.error("ELF data not loaded properly")
+            return None
+
+        if self._alloc_sections is None:
+            self.read_bytes(addr, 0)
+
+        for start, length, data in self._alloc_sections:
+            if start <= addr < start + length:
+                raw = data[addr - start : addr - start + max_len]
+                return raw.split(b"\0", 1)[0].decode("utf-8", errors="replace")
+
+        return None
+
+    def get_pointer_size(self) -> int:
+        return self.elf.elfclass // 8 if self.elf else 4
+
+    def is_little_endian(self) -> bool:
+        return self.elf.little_endian if self.elf else True